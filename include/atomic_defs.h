@@ -11,9 +11,9 @@ namespace lockfree
 	using std::atomic;
 
 #define __declare_memory_order(order) \
-	extern const auto memory_order_##order = std::memory_order::memory_order_##order
+	const auto memory_order_##order = std::memory_order::memory_order_##order
 	// Uncomment this line and comment the one above if you suspect memory ordering problems
-	//	extern const auto memory_order_##order = std::memory_order::memory_order_seq_cst
+	//	const auto memory_order_##order = std::memory_order::memory_order_seq_cst
 
 	__declare_memory_order(relaxed);
 	__declare_memory_order(consume);
@@ -0,0 +1,131 @@
+///////////////////////////////////////////////////////////////////////////
+//
+//epoch.h
+//
+// Epoch-based memory reclamation for the containers that can't rely on tags alone (nodes reachable from more than one link)
+//
+/////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "atomic_defs.h"
+#include "utils.h"
+
+#include <cstdint>
+
+namespace lockfree
+{
+	namespace detail
+	{
+		// Maximum number of threads alive at the same time using any cEpochDomain
+		static constexpr const unsigned MAX_EPOCH_THREADS = 128;
+
+		/// <summary>
+		///		Index in [0, MAX_EPOCH_THREADS) unique among all the threads alive. Indices are recycled when threads finish
+		/// </summary>
+		unsigned GetThreadIndex();
+
+		/// <summary>
+		///		Upper bound of the indices returned by GetThreadIndex so far
+		/// </summary>
+		unsigned GetThreadIndexHighWater();
+	}
+
+/// <summary>
+///		Intrusive header for objects retired through a cEpochDomain
+/// </summary>
+struct tEpochNode
+{
+	tEpochNode*	mNextRetired;
+	uint64_t	mRetireEpoch;
+};
+
+/// <summary>
+///     Epoch-based reclamation (Fraser 2004). Threads access the shared nodes of a container only inside a critical section (see cGuard).
+///		Nodes unlinked from the container are retired instead of freed, and only given back (through the reclaim function provided) once
+///		every thread that could still be holding a reference to them has left its critical section.
+///
+///		- Entering and leaving a critical section costs a store and a fence, no RMWs. Critical sections can be nested
+///		- Retired nodes are kept in per-thread lists, so retiring is just linking the node. Every RECLAIM_THRESHOLD retires, the thread
+///		  tries to advance the global epoch and reclaims whatever has become safe in its own list
+/// </summary>
+/// <remarks>
+///		A thread stalled inside a critical section stops reclamation for everyone (but doesn't block anybody). Retired nodes left by a
+///		thread that finished are reclaimed by the next thread that gets its index, or on destruction of the domain
+/// </remarks>
+class cEpochDomain
+{
+public:
+	typedef void (*tReclaimFnc)(tEpochNode* node, void* context);
+
+	//-------------------------------------------------------------------------
+	// RAII critical section
+	class cGuard
+	{
+	public:
+		explicit cGuard(cEpochDomain& domain);
+		~cGuard();
+
+	private:
+		cGuard(const cGuard&) = delete;
+		cGuard& operator=(const cGuard&) = delete;
+
+		cEpochDomain&	mDomain;
+		unsigned		mThreadIdx;
+	};
+
+	/// <param name="reclaim">
+	///		Called with every retired node once it is safe to reuse it. Never called concurrently for the same thread index
+	/// </param>
+	cEpochDomain(tReclaimFnc reclaim, void* context);
+
+	/// <remarks>
+	///		Reclaims all the nodes still retired. No thread can be inside a critical section of this domain at this point
+	/// </remarks>
+	~cEpochDomain();
+
+	/// <summary>
+	///		Retires a node already unlinked from the container. It will be reclaimed once no thread can be holding a reference to it
+	/// </summary>
+	void Retire(tEpochNode* node);
+
+	/// <summary>
+	///		Tries to advance the epoch and reclaims the nodes retired by the calling thread that are safe to reclaim already
+	/// </summary>
+	/// <remarks>
+	///		Useful to get memory back straight away when a container runs out of it. Works better outside of critical sections (the
+	///		calling thread would be holding back the epoch otherwise)
+	/// </remarks>
+	void Reclaim();
+
+private:
+	cEpochDomain(const cEpochDomain&) = delete;
+	cEpochDomain& operator=(const cEpochDomain&) = delete;
+
+	enum { RECLAIM_THRESHOLD = 64 };
+
+	// Epochs advance in steps of 2, so the lowest bit of a thread's epoch can flag it as being inside a critical section
+	static constexpr const uint64_t ACTIVE_FLAG = 1;
+	static constexpr const uint64_t EPOCH_STEP = 2;
+
+	//-------------------------------------------------------------------------
+	struct alignas(CACHE_LINE_SIZE) tThreadRecord
+	{
+		atomic<uint64_t>	mEpoch;			// epoch | ACTIVE_FLAG while in a critical section, 0 otherwise
+		unsigned			mNesting;
+		unsigned			mNumRetired;
+		tEpochNode*			mRetired;		// newest first
+	};
+
+	void Enter(unsigned thread_idx);
+	void Leave(unsigned thread_idx);
+	bool TryAdvance();
+	void ReclaimRetired(tThreadRecord& record, uint64_t global_epoch);
+
+	alignas(CACHE_LINE_SIZE) atomic<uint64_t>	mGlobalEpoch;
+	tReclaimFnc									mReclaimFnc;
+	void*										mReclaimContext;
+	tThreadRecord								mRecords[detail::MAX_EPOCH_THREADS];
+};
+
+#include "epoch.inl"
+}
@@ -0,0 +1,54 @@
+
+//-------------------------------------------------------------------------
+inline cEpochDomain::cGuard::cGuard(cEpochDomain& domain)
+	: mDomain(domain)
+	, mThreadIdx(detail::GetThreadIndex())
+{
+	mDomain.Enter(mThreadIdx);
+}
+
+//-------------------------------------------------------------------------
+inline cEpochDomain::cGuard::~cGuard()
+{
+	mDomain.Leave(mThreadIdx);
+}
+
+//-------------------------------------------------------------------------
+inline void cEpochDomain::Enter(unsigned thread_idx)
+{
+	tThreadRecord& record = mRecords[thread_idx];
+	if (record.mNesting++ == 0)
+	{
+		// The full fence makes our epoch visible before we read any of the shared nodes. Pairs with the one in TryAdvance
+		record.mEpoch.store(mGlobalEpoch.load(memory_order_relaxed) | ACTIVE_FLAG, memory_order_relaxed);
+		std::atomic_thread_fence(memory_order_seq_cst);
+	}
+}
+
+//-------------------------------------------------------------------------
+inline void cEpochDomain::Leave(unsigned thread_idx)
+{
+	tThreadRecord& record = mRecords[thread_idx];
+	LF_assert(record.mNesting > 0, "Leaving a critical section that was not entered");
+	if (--record.mNesting == 0)
+	{
+		record.mEpoch.store(0, memory_order_release);
+	}
+}
+
+//-------------------------------------------------------------------------
+inline void cEpochDomain::Retire(tEpochNode* node)
+{
+	tThreadRecord& record = mRecords[detail::GetThreadIndex()];
+
+	// Any thread that could still see the node is in this epoch or in the previous one
+	std::atomic_thread_fence(memory_order_seq_cst);
+	node->mRetireEpoch = mGlobalEpoch.load(memory_order_relaxed);
+	node->mNextRetired = record.mRetired;
+	record.mRetired = node;
+
+	if (++record.mNumRetired >= RECLAIM_THRESHOLD)
+	{
+		Reclaim();
+	}
+}
@@ -0,0 +1,131 @@
+///////////////////////////////////////////////////////////////////////////
+//
+//eventcount.h
+//
+/////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "atomic_defs.h"
+#include "futex.h"
+#include "utils.h"
+
+#include <cstdint>
+#include <chrono>
+
+namespace lockfree
+{
+/// <summary>
+///     Eventcount: lets threads block until some condition on a lock-free container becomes true, without adding any kind of lock or
+///		syscall to the fast path of the threads that make that condition true.
+///		Based on http://www.1024cores.net/home/lock-free-algorithms/eventcounts
+///
+///		Waiting threads register themselves, re-check their condition and only then park on a futex. Notifying threads issue a fence
+///		and a load of the waiter count, and only go to the OS when somebody is actually parked (or about to)
+///
+///		Usage from the waiting side (what Await does):
+///			if (try_something()) return;
+///			key = PrepareWait();
+///			if (try_something()) { CancelWait(); return; }
+///			CommitWait(key);
+///		Usage from the notifying side:
+///			make_something_possible();
+///			NotifyOne();
+/// </summary>
+class cEventCount
+{
+public:
+	typedef uint32_t tKey;
+
+	//-------------------------------------------------------------------------
+	cEventCount();
+
+	// non copyable
+	cEventCount(const cEventCount&) = delete;
+	cEventCount& operator=(const cEventCount&) = delete;
+
+	/// <summary>
+	///		Registers the calling thread as a waiter. The condition must be re-checked after calling this, and followed either by a
+	///		CancelWait (if the condition became true) or a CommitWait (if it did not)
+	/// </summary>
+	/// <return>
+	///		Returns the key that needs to be passed to CommitWait
+	/// </return>
+	tKey PrepareWait();
+
+	/// <summary>
+	///		Unregisters the calling thread as a waiter
+	/// </summary>
+	void CancelWait();
+
+	/// <summary>
+	///		Parks the calling thread until there is a notification after the PrepareWait call that returned key. Unregisters the thread
+	///		as a waiter on return
+	/// </summary>
+	void CommitWait(tKey key);
+
+	/// <summary>
+	///		Same as CommitWait, giving up once the timeout has passed
+	/// </summary>
+	/// <return>
+	///		Returns false if the wait timed out
+	/// </return>
+	bool CommitWaitFor(tKey key, std::chrono::nanoseconds timeout);
+
+	/// <summary>
+	///		Wakes one parked waiter, if any. Must be called after making the condition waiters wait for true
+	/// </summary>
+	/// <return>
+	///		Returns true if there were waiters registered
+	/// </return>
+	bool NotifyOne();
+
+	/// <summary>
+	///		Wakes all the parked waiters, if any. Must be called after making the condition waiters wait for true
+	/// </summary>
+	/// <return>
+	///		Returns true if there were waiters registered
+	/// </return>
+	bool NotifyAll();
+
+	/// <summary>
+	///		Same as NotifyOne, for notifiers that made the condition true with a seq_cst atomic operation. That operation already keeps
+	///		the check for waiters from being reordered before it, so the fence NotifyOne needs is saved (a locked instruction is as 
+	///		expensive as a release one on x86, a fence is not)
+	/// </summary>
+	bool NotifyOneAfterSeqCst();
+
+	/// <summary>
+	///		Same as NotifyAll, for notifiers that made the condition true with a seq_cst atomic operation (see NotifyOneAfterSeqCst)
+	/// </summary>
+	bool NotifyAllAfterSeqCst();
+
+	/// <summary>
+	///		Calls try_fnc until it returns true. Spins for a little while before parking the thread between attempts
+	/// </summary>
+	/// <param name="try_fnc">
+	///		Non-blocking attempt of the operation we want to wait for (i.e., a Pop). It needs to return true when successful
+	/// </param>
+	template <typename Fnc>
+	void Await(Fnc&& try_fnc);
+
+	/// <summary>
+	///		Same as Await, but gives up once the timeout has passed
+	/// </summary>
+	/// <return>
+	///		Returns true if try_fnc succeeded before timing out. False otherwise
+	/// </return>
+	template <typename Fnc, class Rep, class Period>
+	bool AwaitFor(Fnc&& try_fnc, const std::chrono::duration<Rep, Period>& timeout);
+
+private:
+	enum { SPIN_ATTEMPTS = 64 };
+
+	bool NotifyIfWaiters(bool notify_all, bool fence);
+
+	// Kept on different words so notifiers can check for waiters without touching the futex word on the fast path
+	atomic<uint32_t>	mEpoch;
+	atomic<uint32_t>	mWaiters;
+};
+
+#include "eventcount.inl"
+}
@@ -0,0 +1,169 @@
+
+//-------------------------------------------------------------------------
+inline cEventCount::cEventCount()
+	: mEpoch(0)
+	, mWaiters(0)
+{
+}
+
+//-------------------------------------------------------------------------
+inline auto cEventCount::PrepareWait() -> tKey
+{
+	// The full fence pairs with the one in NotifyIfWaiters: either the notifier sees us registered, or we see whatever
+	// it made available when re-checking the condition after this call
+	mWaiters.fetch_add(1, memory_order_seq_cst);
+	std::atomic_thread_fence(memory_order_seq_cst);
+	return mEpoch.load(memory_order_acquire);
+}
+
+//-------------------------------------------------------------------------
+inline void cEventCount::CancelWait()
+{
+	mWaiters.fetch_sub(1, memory_order_relaxed);
+}
+
+//-------------------------------------------------------------------------
+inline void cEventCount::CommitWait(tKey key)
+{
+	// If there was a notification since PrepareWait the epoch won't match and we'll return straight away
+	while (mEpoch.load(memory_order_acquire) == key)
+	{
+		futex::Wait(mEpoch, key);
+	}
+	mWaiters.fetch_sub(1, memory_order_relaxed);
+}
+
+//-------------------------------------------------------------------------
+inline bool cEventCount::CommitWaitFor(tKey key, std::chrono::nanoseconds timeout)
+{
+	const auto deadline = std::chrono::steady_clock::now() + timeout;
+
+	bool notified = true;
+	while (mEpoch.load(memory_order_acquire) == key)
+	{
+		const std::chrono::nanoseconds remaining = deadline - std::chrono::steady_clock::now();
+		if (!futex::WaitFor(mEpoch, key, remaining))
+		{
+			notified = (mEpoch.load(memory_order_acquire) != key);
+			break;
+		}
+	}
+	mWaiters.fetch_sub(1, memory_order_relaxed);
+
+	return notified;
+}
+
+//-------------------------------------------------------------------------
+inline bool cEventCount::NotifyOne()
+{
+	return NotifyIfWaiters(false, true);
+}
+
+//-------------------------------------------------------------------------
+inline bool cEventCount::NotifyAll()
+{
+	return NotifyIfWaiters(true, true);
+}
+
+//-------------------------------------------------------------------------
+inline bool cEventCount::NotifyOneAfterSeqCst()
+{
+	return NotifyIfWaiters(false, false);
+}
+
+//-------------------------------------------------------------------------
+inline bool cEventCount::NotifyAllAfterSeqCst()
+{
+	return NotifyIfWaiters(true, false);
+}
+
+//-------------------------------------------------------------------------
+inline bool cEventCount::NotifyIfWaiters(bool notify_all, bool fence)
+{
+	// Without the fence, it's the seq_cst operation of the notifier and this seq_cst load that pair with the fence in PrepareWait
+	if (fence)
+	{
+		std::atomic_thread_fence(memory_order_seq_cst);
+	}
+	if (mWaiters.load(memory_order_seq_cst) == 0)
+	{
+		return false;
+	}
+
+	mEpoch.fetch_add(1, memory_order_release);
+	if (notify_all)
+	{
+		futex::WakeAll(mEpoch);
+	}
+	else
+	{
+		futex::WakeOne(mEpoch);
+	}
+	return true;
+}
+
+//-------------------------------------------------------------------------
+template <typename Fnc>
+void cEventCount::Await(Fnc&& try_fnc)
+{
+	for (unsigned attempt = 0; attempt != SPIN_ATTEMPTS; ++attempt)
+	{
+		if (try_fnc())
+		{
+			return;
+		}
+		LF_cpu_pause();
+	}
+
+	for (;;)
+	{
+		const tKey key = PrepareWait();
+		if (try_fnc())
+		{
+			CancelWait();
+			return;
+		}
+		CommitWait(key);
+
+		if (try_fnc())
+		{
+			return;
+		}
+	}
+}
+
+//-------------------------------------------------------------------------
+template <typename Fnc, class Rep, class Period>
+bool cEventCount::AwaitFor(Fnc&& try_fnc, const std::chrono::duration<Rep, Period>& timeout)
+{
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::nanoseconds>(timeout);
+
+	for (unsigned attempt = 0; attempt != SPIN_ATTEMPTS; ++attempt)
+	{
+		if (try_fnc())
+		{
+			return true;
+		}
+		LF_cpu_pause();
+	}
+
+	for (;;)
+	{
+		const tKey key = PrepareWait();
+		if (try_fnc())
+		{
+			CancelWait();
+			return true;
+		}
+
+		const bool notified = CommitWaitFor(key, deadline - std::chrono::steady_clock::now());
+		if (try_fnc())
+		{
+			return true;
+		}
+		else if (!notified)
+		{
+			return false;
+		}
+	}
+}
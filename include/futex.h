@@ -0,0 +1,45 @@
+///////////////////////////////////////////////////////////////////////////
+//
+//futex.h
+//
+// Thin platform layer for parking threads on the value of a 32-bit word (futex on Linux, WaitOnAddress on Windows)
+//
+/////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "atomic_defs.h"
+
+#include <cstdint>
+#include <chrono>
+
+namespace lockfree
+{
+	namespace futex
+	{
+		/// <summary>
+		///		Blocks the calling thread as long as the word contains the expected value, until woken up by one of the Wake functions
+		/// </summary>
+		/// <remarks>
+		///		Spurious wake-ups are possible, callers are expected to re-check their condition after returning
+		/// </remarks>
+		void Wait(const atomic<uint32_t>& word, uint32_t expected);
+
+		/// <summary>
+		///		Same as Wait, but gives up after the timeout passed
+		/// </summary>
+		/// <return>
+		///		Returns false if the wait timed out. True otherwise (woken up, spuriously or not, or the word not containing the expected value)
+		/// </return>
+		bool WaitFor(const atomic<uint32_t>& word, uint32_t expected, std::chrono::nanoseconds timeout);
+
+		/// <summary>
+		///		Wakes up at most one of the threads blocked on the word
+		/// </summary>
+		void WakeOne(const atomic<uint32_t>& word);
+
+		/// <summary>
+		///		Wakes up all the threads blocked on the word
+		/// </summary>
+		void WakeAll(const atomic<uint32_t>& word);
+	}
+}
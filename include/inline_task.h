@@ -0,0 +1,117 @@
+///////////////////////////////////////////////////////////////////////////
+//
+//inline_task.h
+//
+/////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "utils.h"
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+
+namespace lockfree
+{
+	namespace detail
+	{
+		template <typename tStorage, typename R, typename... Args>
+		struct tInlineTaskOps;
+
+		template <typename Fnc, typename tStorage, typename R, typename... Args>
+		struct tInlineTaskLocalOps;
+
+		template <typename Fnc, typename tStorage, typename R, typename... Args>
+		struct tInlineTaskHeapOps;
+	}
+
+	// Default capacity: what is left of a cache line after the pointer to the operations of the callable
+	static constexpr const size_t INLINE_TASK_DEFAULT_CAPACITY = CACHE_LINE_SIZE - sizeof(void*);
+
+/// <summary>
+///     Move-only, fixed-capacity type-erased callable, the allocation-free counterpart to std::function. The callable is always stored
+///		inside the task itself, so storing cInlineTasks in a pool-based container (e.g. a cLockFreeQueue used as a command queue) is
+///		allocation-free end to end.
+///
+///		Callables that don't fit in the capacity requested (or need more alignment than ALIGNMENT) are rejected at compile-time.
+///		Passing heap_fallback = true allows those to be heap-allocated instead.
+///
+///		Usage:
+///			cLockFreeQueue<cInlineTask<void()>> commands(pool);
+///			commands.Push([this, value] { DoSomething(value); });
+///			...
+///			commands.PopWith([](cInlineTask<void()>& command) { command(); });
+/// </summary>
+/// <remarks>
+///		Unlike std::function, calling an empty task is not checked (other than by an assert)
+/// </remarks>
+template <typename Signature, size_t capacity = INLINE_TASK_DEFAULT_CAPACITY, bool heap_fallback = false>
+class cInlineTask;
+
+template <typename R, typename... Args, size_t capacity, bool heap_fallback>
+class cInlineTask<R(Args...), capacity, heap_fallback>
+{
+	template <typename Fnc>
+	using tEnableIfCallable = std::enable_if_t<!std::is_same<std::decay_t<Fnc>, cInlineTask>::value>;
+
+public:
+	static constexpr const size_t CAPACITY = capacity;
+
+	// Enough for pointers, integers and doubles. Deliberately not max_align_t, that would pad the task in most 64-bit ABIs
+	static constexpr const size_t ALIGNMENT = (alignof(double) > alignof(void*)) ? alignof(double) : alignof(void*);
+
+	/// <summary>
+	///		Queries if a callable of type Fnc would be stored inline (without needing the heap fallback)
+	/// </summary>
+	template <typename Fnc>
+	static constexpr bool FitsInline()
+	{
+		return (sizeof(Fnc) <= capacity) && (alignof(Fnc) <= ALIGNMENT);
+	}
+
+	//-------------------------------------------------------------------------
+	cInlineTask();
+	cInlineTask(std::nullptr_t);
+
+	template <typename Fnc, typename = tEnableIfCallable<Fnc>>
+	cInlineTask(Fnc&& fnc);
+
+	cInlineTask(cInlineTask&& other);
+	cInlineTask& operator=(cInlineTask&& other);
+	cInlineTask& operator=(std::nullptr_t);
+	~cInlineTask();
+
+	/// <summary>
+	///		Invokes the callable stored. The task must not be empty
+	/// </summary>
+	R operator()(Args... args);
+
+	/// <summary>
+	///		Queries if there is a callable stored
+	/// </summary>
+	explicit operator bool() const { return mOps != nullptr; }
+
+	/// <summary>
+	///		Destroys the callable stored, if any, leaving the task empty
+	/// </summary>
+	void Reset();
+
+private:
+	cInlineTask(const cInlineTask&) = delete;
+	cInlineTask& operator=(const cInlineTask&) = delete;
+
+	typedef std::aligned_storage_t<capacity, ALIGNMENT> tStorage;
+	typedef detail::tInlineTaskOps<tStorage, R, Args...> tOps;
+
+	// Callables that don't fit can only get here with heap_fallback enabled
+	template <typename Fnc>
+	using tOpsFor = std::conditional_t<(sizeof(Fnc) <= capacity) && (alignof(Fnc) <= ALIGNMENT),
+		detail::tInlineTaskLocalOps<Fnc, tStorage, R, Args...>,
+		detail::tInlineTaskHeapOps<Fnc, tStorage, R, Args...>>;
+
+	const tOps*	mOps;
+	tStorage	mStorage;
+};
+
+#include "inline_task.inl"
+}
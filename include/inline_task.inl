@@ -0,0 +1,153 @@
+
+namespace detail
+{
+	//-------------------------------------------------------------------------
+	// Type-erased operations of the callable stored in a cInlineTask. One static instance per type of callable
+	template <typename tStorage, typename R, typename... Args>
+	struct tInlineTaskOps
+	{
+		R		(*mInvoke)(tStorage& storage, Args&&... args);
+		void	(*mMove)(tStorage& dst, tStorage& src);	// move-constructs dst from src, and destroys src
+		void	(*mDestroy)(tStorage& storage);
+	};
+
+	//-------------------------------------------------------------------------
+	// The callable lives in the storage of the task
+	template <typename Fnc, typename tStorage, typename R, typename... Args>
+	struct tInlineTaskLocalOps
+	{
+		static Fnc& Get(tStorage& storage) { return *reinterpret_cast<Fnc*>(&storage); }
+
+		template <typename Callable>
+		static void Construct(tStorage& storage, Callable&& fnc) { new (&storage) Fnc(forward<Callable>(fnc)); }
+
+		static R Invoke(tStorage& storage, Args&&... args) { return Get(storage)(forward<Args>(args)...); }
+
+		static void Move(tStorage& dst, tStorage& src)
+		{
+			new (&dst) Fnc(move(Get(src)));
+			Get(src).~Fnc();
+		}
+
+		static void Destroy(tStorage& storage) { Get(storage).~Fnc(); }
+
+		static const tInlineTaskOps<tStorage, R, Args...> sOps;
+	};
+
+	template <typename Fnc, typename tStorage, typename R, typename... Args>
+	const tInlineTaskOps<tStorage, R, Args...> tInlineTaskLocalOps<Fnc, tStorage, R, Args...>::sOps = { &Invoke, &Move, &Destroy };
+
+	//-------------------------------------------------------------------------
+	// The storage of the task only holds a pointer to the heap-allocated callable. Moving the task moves the pointer
+	template <typename Fnc, typename tStorage, typename R, typename... Args>
+	struct tInlineTaskHeapOps
+	{
+		static Fnc*& Get(tStorage& storage) { return *reinterpret_cast<Fnc**>(&storage); }
+
+		template <typename Callable>
+		static void Construct(tStorage& storage, Callable&& fnc) { new (&storage) Fnc*(new Fnc(forward<Callable>(fnc))); }
+
+		static R Invoke(tStorage& storage, Args&&... args) { return (*Get(storage))(forward<Args>(args)...); }
+
+		static void Move(tStorage& dst, tStorage& src) { new (&dst) Fnc*(Get(src)); }
+
+		static void Destroy(tStorage& storage) { delete Get(storage); }
+
+		static const tInlineTaskOps<tStorage, R, Args...> sOps;
+	};
+
+	template <typename Fnc, typename tStorage, typename R, typename... Args>
+	const tInlineTaskOps<tStorage, R, Args...> tInlineTaskHeapOps<Fnc, tStorage, R, Args...>::sOps = { &Invoke, &Move, &Destroy };
+}
+
+//-------------------------------------------------------------------------
+template <typename R, typename... Args, size_t capacity, bool heap_fallback>
+cInlineTask<R(Args...), capacity, heap_fallback>::cInlineTask()
+	: mOps(nullptr)
+{
+}
+
+//-------------------------------------------------------------------------
+template <typename R, typename... Args, size_t capacity, bool heap_fallback>
+cInlineTask<R(Args...), capacity, heap_fallback>::cInlineTask(std::nullptr_t)
+	: mOps(nullptr)
+{
+}
+
+//-------------------------------------------------------------------------
+template <typename R, typename... Args, size_t capacity, bool heap_fallback>
+template <typename Fnc, typename>
+cInlineTask<R(Args...), capacity, heap_fallback>::cInlineTask(Fnc&& fnc)
+{
+	typedef std::decay_t<Fnc> tFnc;
+	static_assert(heap_fallback || FitsInline<tFnc>(), "Callable too big (or over-aligned) for this task's capacity, and heap fallback is disabled");
+	static_assert(sizeof(tFnc*) <= capacity, "Capacity too small to hold even a pointer to a heap-allocated callable");
+
+	tOpsFor<tFnc>::Construct(mStorage, forward<Fnc>(fnc));
+	mOps = &tOpsFor<tFnc>::sOps;
+}
+
+//-------------------------------------------------------------------------
+template <typename R, typename... Args, size_t capacity, bool heap_fallback>
+cInlineTask<R(Args...), capacity, heap_fallback>::cInlineTask(cInlineTask&& other)
+	: mOps(other.mOps)
+{
+	if (mOps)
+	{
+		mOps->mMove(mStorage, other.mStorage);
+		other.mOps = nullptr;
+	}
+}
+
+//-------------------------------------------------------------------------
+template <typename R, typename... Args, size_t capacity, bool heap_fallback>
+auto cInlineTask<R(Args...), capacity, heap_fallback>::operator=(cInlineTask&& other) -> cInlineTask&
+{
+	if (this != &other)
+	{
+		Reset();
+
+		mOps = other.mOps;
+		if (mOps)
+		{
+			mOps->mMove(mStorage, other.mStorage);
+			other.mOps = nullptr;
+		}
+	}
+
+	return *this;
+}
+
+//-------------------------------------------------------------------------
+template <typename R, typename... Args, size_t capacity, bool heap_fallback>
+auto cInlineTask<R(Args...), capacity, heap_fallback>::operator=(std::nullptr_t) -> cInlineTask&
+{
+	Reset();
+	return *this;
+}
+
+//-------------------------------------------------------------------------
+template <typename R, typename... Args, size_t capacity, bool heap_fallback>
+cInlineTask<R(Args...), capacity, heap_fallback>::~cInlineTask()
+{
+	Reset();
+}
+
+//-------------------------------------------------------------------------
+template <typename R, typename... Args, size_t capacity, bool heap_fallback>
+R cInlineTask<R(Args...), capacity, heap_fallback>::operator()(Args... args)
+{
+	LF_assert(mOps, "Calling an empty task");
+	return mOps->mInvoke(mStorage, forward<Args>(args)...);
+}
+
+//-------------------------------------------------------------------------
+template <typename R, typename... Args, size_t capacity, bool heap_fallback>
+void cInlineTask<R(Args...), capacity, heap_fallback>::Reset()
+{
+	if (mOps)
+	{
+		mOps->mDestroy(mStorage);
+		mOps = nullptr;
+	}
+}
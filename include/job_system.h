@@ -0,0 +1,183 @@
+///////////////////////////////////////////////////////////////////////////
+//
+//job_system.h
+//
+/////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "atomic_defs.h"
+#include "eventcount.h"
+#include "inline_task.h"
+#include "lockfree_pool.h"
+#include "lockfree_queue.h"
+#include "lockfree_work_stealing_deque.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace lockfree
+{
+	class cJobSystem;
+
+/// <summary>
+///     Counts the jobs submitted against it that have not finished yet. cJobSystem::Wait blocks until it gets to zero
+/// </summary>
+class cJobCounter
+{
+public:
+	cJobCounter() : mPending(0) {}
+
+	bool IsDone() const { return mPending.load(memory_order_acquire) == 0; }
+
+private:
+	friend class cJobSystem;
+
+	cJobCounter(const cJobCounter&) = delete;
+	cJobCounter& operator=(const cJobCounter&) = delete;
+
+	atomic<unsigned> mPending;
+};
+
+/// <summary>
+///     Work-stealing job system. Runs jobs (any callable small enough to fit inline in a job) on a fixed set of worker threads.
+///
+///		- Each worker owns a cLockFreeWorkStealingDeque. Jobs submitted from a worker go to its own deque (no CAS), idle workers steal
+///		  from the others
+///		- Each worker has a cMPSCLockFreeQueue inbox for jobs submitted from threads that are not workers. Workers move them to their
+///		  deques so they can be stolen too. Those jobs go to a parked worker if there is any, round-robin over the workers otherwise
+///		- Jobs come from a cLockFreePool, so submitting never allocates. Deques are sized to hold the whole pool, so they never grow
+///		- Idle workers park (see cEventCount). Submitting only wakes a worker up when there are workers parked
+///
+///		Forking and joining is done with cJobCounter: submit jobs against a counter and Wait on it. Waiting threads help running jobs
+///		meanwhile. See ParallelFor and ParallelReduce
+/// </summary>
+/// <remarks>
+///		If the job pool is exhausted, jobs run inline in the thread submitting them. This keeps fork-join code correct (and bounded in
+///		memory) no matter how much it forks
+/// </remarks>
+class cJobSystem
+{
+public:
+	// Size of the storage for callables inside each job (so a job fits in one cache line)
+	static constexpr const size_t JOB_PAYLOAD_SIZE = CACHE_LINE_SIZE - 3 * sizeof(void*);
+
+	/// <param name="num_workers">
+	///		Number of worker threads. Zero means as many as hardware threads minus one, with a minimum of one (the thread creating the
+	///		system is expected to Wait, and help running jobs)
+	/// </param>
+	/// <param name="max_jobs">
+	///		Capacity of the job pool. Maximum number of jobs that can be submitted and not yet finished at any time
+	/// </param>
+	cJobSystem(unsigned num_workers = 0, unsigned max_jobs = 4096);
+
+	/// <remarks>
+	///		Waits until all the jobs submitted have been run
+	/// </remarks>
+	~cJobSystem();
+
+	/// <summary>
+	///		Submits a job that will run fnc()
+	/// </summary>
+	template <typename Fnc>
+	void Submit(Fnc&& fnc);
+
+	/// <summary>
+	///		Submits a job that will run fnc(), counted by counter until it finishes
+	/// </summary>
+	template <typename Fnc>
+	void Submit(cJobCounter& counter, Fnc&& fnc);
+
+	/// <summary>
+	///		Blocks until all the jobs submitted against counter have finished. Runs other jobs meanwhile
+	/// </summary>
+	void Wait(cJobCounter& counter);
+
+	unsigned GetNumWorkers() const { return static_cast<unsigned>(mWorkers.size()); }
+
+private:
+	cJobSystem(const cJobSystem&) = delete;
+	cJobSystem& operator=(const cJobSystem&) = delete;
+
+	//-------------------------------------------------------------------------
+	struct tJob
+	{
+		template <typename Fnc>
+		tJob(Fnc&& fnc, cJobCounter* counter)
+			: mTask(forward<Fnc>(fnc))
+			, mCounter(counter)
+		{}
+
+		cInlineTask<void(), JOB_PAYLOAD_SIZE>	mTask;
+		cJobCounter*							mCounter;
+	};
+
+	typedef cMPSCLockFreeQueue<tJob*>	tInbox;
+
+	//-------------------------------------------------------------------------
+	struct tWorker
+	{
+		tWorker(unsigned deque_capacity, tInbox::tLockFreePool& inbox_pool)
+			: mJobs(deque_capacity)
+			, mInbox(inbox_pool)
+			, mParked(false)
+		{}
+
+		cLockFreeWorkStealingDeque<tJob*>		mJobs;
+		tInbox									mInbox;
+		cEventCount								mWakeEvent;
+		atomic<bool>							mParked;		// a hint for picking inboxes, waking relies on mWakeEvent
+		std::thread								mThread;
+	};
+
+	static const unsigned NOT_A_WORKER = ~0U;
+
+	template <typename Fnc>
+	void		SubmitJob(cJobCounter* counter, Fnc&& fnc);
+
+	void		Enqueue(tJob* job);
+	void		RunJob(tJob* job);
+	bool		TryAcquireJob(unsigned worker_idx, tJob*& job);
+	bool		TryStealJob(unsigned worker_idx, tJob*& job);
+	void		WakeIdleWorker();
+	void		WorkerMain(unsigned worker_idx);
+	unsigned	GetCurrentWorkerIdx() const;
+
+	cLockFreePool<tJob>						mJobPool;
+	tInbox::tLockFreePool					mInboxPool;
+	std::vector<std::unique_ptr<tWorker>>	mWorkers;
+	alignas(CACHE_LINE_SIZE) atomic<unsigned> mParkedWorkers;
+	alignas(CACHE_LINE_SIZE) atomic<unsigned> mNextInbox;
+	cEventCount								mJobDoneEvent;
+	atomic<bool>							mStop;
+};
+
+/// <summary>
+///		Runs fnc(i) for every i in [begin, end), splitting the range recursively in jobs of at most grain elements
+/// </summary>
+template <typename Fnc>
+void ParallelFor(cJobSystem& job_system, size_t begin, size_t end, size_t grain, Fnc&& fnc);
+
+/// <summary>
+///		Reduces [begin, end) in parallel. The range is split recursively in chunks of at most grain elements, each chunk gets mapped with
+///		map(chunk_begin, chunk_end) and the results are combined with reduce(T, T)
+/// </summary>
+/// <param name="identity">
+///		Neutral element of the reduction. The result for an empty range
+/// </param>
+template <typename T, typename Map, typename Reduce>
+T ParallelReduce(cJobSystem& job_system, size_t begin, size_t end, size_t grain, const T& identity, Map&& map, Reduce&& reduce);
+
+/// <summary>
+///		Calls fnc(T&amp;) for every acquired element of a pool tracking its occupancy (see cLockFreePool::ForEachLive), splitting its storage
+///		in jobs of at most grain elements. Elements of the same job are visited in address order
+/// </summary>
+template <class T, class tPoolAllocator, unsigned flags, typename Fnc>
+void ParallelForEachLive(cJobSystem& job_system, cLockFreePool<T, tPoolAllocator, flags>& pool, size_t grain, Fnc&& fnc);
+
+#include "job_system.inl"
+}
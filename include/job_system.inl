@@ -0,0 +1,157 @@
+
+//-------------------------------------------------------------------------
+template <typename Fnc>
+void cJobSystem::Submit(Fnc&& fnc)
+{
+	SubmitJob(nullptr, forward<Fnc>(fnc));
+}
+
+//-------------------------------------------------------------------------
+template <typename Fnc>
+void cJobSystem::Submit(cJobCounter& counter, Fnc&& fnc)
+{
+	// Relaxed is enough: whoever waits on the counter either submitted this job or runs after a job that did
+	counter.mPending.fetch_add(1, memory_order_relaxed);
+	SubmitJob(&counter, forward<Fnc>(fnc));
+}
+
+//-------------------------------------------------------------------------
+template <typename Fnc>
+void cJobSystem::SubmitJob(cJobCounter* counter, Fnc&& fnc)
+{
+	static_assert(decltype(tJob::mTask)::FitsInline<std::decay_t<Fnc>>(), "Callable too big to fit in a job, capture by reference or through a pointer");
+
+	tJob* const job = mJobPool.Acquire(forward<Fnc>(fnc), counter);
+	if (job)
+	{
+		Enqueue(job);
+	}
+	else
+	{
+		// Pool exhausted, run it right away. Finishing it is the same as in RunJob: the decrement publishes what the job did, and
+		// whoever is parked waiting on the counter needs waking up
+		fnc();
+		if (counter && (counter->mPending.fetch_sub(1, memory_order_acq_rel) == 1))
+		{
+			mJobDoneEvent.NotifyAll();
+		}
+	}
+}
+
+namespace detail
+{
+	//-------------------------------------------------------------------------
+	// Shared by all the jobs of a ParallelFor, so each job only needs to capture a pointer to it and its range
+	template <typename Fnc>
+	struct tParallelForArgs
+	{
+		cJobSystem*	mJobSystem;
+		size_t		mGrain;
+		Fnc*		mFnc;
+	};
+
+	//-------------------------------------------------------------------------
+	template <typename Fnc>
+	void ParallelForRange(const tParallelForArgs<Fnc>& args, size_t begin, size_t end)
+	{
+		// Keep halving the range, giving the upper half away, until what is left is small enough to run here
+		cJobCounter counter;
+		while ((end - begin) > args.mGrain)
+		{
+			const size_t middle = begin + (end - begin) / 2;
+			const tParallelForArgs<Fnc>* const args_ptr = &args;
+			args.mJobSystem->Submit(counter, [args_ptr, middle, end] { ParallelForRange(*args_ptr, middle, end); });
+			end = middle;
+		}
+
+		for (size_t idx = begin; idx != end; ++idx)
+		{
+			(*args.mFnc)(idx);
+		}
+
+		args.mJobSystem->Wait(counter);
+	}
+
+	//-------------------------------------------------------------------------
+	template <typename T, typename Map, typename Reduce>
+	struct tParallelReduceArgs
+	{
+		cJobSystem*	mJobSystem;
+		size_t		mGrain;
+		const T*	mIdentity;
+		Map*		mMap;
+		Reduce*		mReduce;
+	};
+
+	//-------------------------------------------------------------------------
+	template <typename T, typename Map, typename Reduce>
+	T ParallelReduceRange(const tParallelReduceArgs<T, Map, Reduce>& args, size_t begin, size_t end)
+	{
+		if ((end - begin) <= args.mGrain)
+		{
+			return (*args.mMap)(begin, end);
+		}
+
+		// The upper half goes to a job, the lower one is reduced here
+		const size_t middle = begin + (end - begin) / 2;
+		const tParallelReduceArgs<T, Map, Reduce>* const args_ptr = &args;
+		T upper_result = *args.mIdentity;
+		T* const upper_result_ptr = &upper_result;
+
+		cJobCounter counter;
+		args.mJobSystem->Submit(counter, [args_ptr, middle, end, upper_result_ptr]
+		{
+			*upper_result_ptr = ParallelReduceRange(*args_ptr, middle, end);
+		});
+
+		T lower_result = ParallelReduceRange(args, begin, middle);
+		args.mJobSystem->Wait(counter);
+
+		return (*args.mReduce)(std::move(lower_result), std::move(upper_result));
+	}
+}
+
+//-------------------------------------------------------------------------
+template <typename Fnc>
+void ParallelFor(cJobSystem& job_system, size_t begin, size_t end, size_t grain, Fnc&& fnc)
+{
+	if (begin >= end)
+	{
+		return;
+	}
+
+	typedef std::remove_reference_t<Fnc> tFnc;
+	const detail::tParallelForArgs<tFnc> args = { &job_system, (grain != 0) ? grain : 1, &fnc };
+	detail::ParallelForRange(args, begin, end);
+}
+
+//-------------------------------------------------------------------------
+template <typename T, typename Map, typename Reduce>
+T ParallelReduce(cJobSystem& job_system, size_t begin, size_t end, size_t grain, const T& identity, Map&& map, Reduce&& reduce)
+{
+	if (begin >= end)
+	{
+		return identity;
+	}
+
+	typedef std::remove_reference_t<Map> tMap;
+	typedef std::remove_reference_t<Reduce> tReduce;
+	const detail::tParallelReduceArgs<T, tMap, tReduce> args = { &job_system, (grain != 0) ? grain : 1, &identity, &map, &reduce };
+	return detail::ParallelReduceRange(args, begin, end);
+}
+
+//-------------------------------------------------------------------------
+template <class T, class tPoolAllocator, unsigned flags, typename Fnc>
+void ParallelForEachLive(cJobSystem& job_system, cLockFreePool<T, tPoolAllocator, flags>& pool, size_t grain, Fnc&& fnc)
+{
+	// Chunks of whole words of the bitmap, so no two jobs read the same one
+	typedef cLockFreePool<T, tPoolAllocator, flags> tPool;
+	const size_t chunk_size = (std::max)(grain / tPool::OCCUPANCY_WORD_BITS, size_t(1)) * tPool::OCCUPANCY_WORD_BITS;
+	const size_t num_chunks = (pool.GetCapacity() + chunk_size - 1) / chunk_size;
+
+	ParallelFor(job_system, 0, num_chunks, 1, [&pool, &fnc, chunk_size](size_t chunk_idx)
+	{
+		const unsigned begin = static_cast<unsigned>(chunk_idx * chunk_size);
+		pool.ForEachLiveInRange(begin, static_cast<unsigned>(begin + chunk_size), fnc);
+	});
+}
@@ -0,0 +1,76 @@
+///////////////////////////////////////////////////////////////////////////
+//
+//lfmalloc.h
+//
+// Experimental general purpose allocator built from the lock-free size class pools of cLockFreeSlabAllocator (see src/lfmalloc.cpp).
+// Built with LFMALLOC_REPLACE_MALLOC defined, it also exports the malloc family of the C runtime, so it can be preloaded into a whole
+// binary. Linux only
+//
+/////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <cstddef>
+
+namespace lockfree
+{
+	namespace lfmalloc
+	{
+		/// <summary>
+		///		Allocates at least size bytes, aligned to std::max_align_t
+		/// </summary>
+		/// <return>
+		///		Returns the memory, or nullptr (with errno set to ENOMEM) if it ran out
+		/// </return>
+		void* Malloc(size_t size);
+
+		/// <summary>
+		///		Allocates zeroed memory for num elements of size bytes
+		/// </summary>
+		void* Calloc(size_t num, size_t size);
+
+		/// <summary>
+		///		Resizes an allocation, keeping its contents up to the smallest of both sizes. The memory may move. A nullptr ptr allocates,
+		///		a size of 0 frees
+		/// </summary>
+		/// <return>
+		///		Returns the memory, or nullptr (with ptr still valid) if it ran out
+		/// </return>
+		void* Realloc(void* ptr, size_t size);
+
+		/// <summary>
+		///		Frees memory allocated by any of the functions here. nullptr is ignored
+		/// </summary>
+		void Free(void* ptr);
+
+		/// <summary>
+		///		Allocates at least size bytes aligned to alignment, which needs to be a power of two
+		/// </summary>
+		/// <return>
+		///		Returns the memory, or nullptr with errno set to EINVAL (invalid alignment) or ENOMEM (ran out)
+		/// </return>
+		void* AlignedAlloc(size_t alignment, size_t size);
+
+		/// <summary>
+		///		Like AlignedAlloc, but the alignment also needs to be a multiple of sizeof(void*), and errors are returned instead
+		/// </summary>
+		/// <return>
+		///		Returns 0 and sets ptr on success, EINVAL or ENOMEM otherwise
+		/// </return>
+		int PosixMemalign(void** ptr, size_t alignment, size_t size);
+
+		/// <summary>
+		///		Allocates at least size bytes aligned to the page size
+		/// </summary>
+		void* Valloc(size_t size);
+
+		/// <summary>
+		///		Allocates size bytes rounded up to the page size, aligned to the page size
+		/// </summary>
+		void* Pvalloc(size_t size);
+
+		/// <summary>
+		///		Queries the number of bytes an allocation can actually use, at least as many as requested. 0 for nullptr
+		/// </summary>
+		size_t MallocUsableSize(void* ptr);
+	}
+}
@@ -0,0 +1,114 @@
+///////////////////////////////////////////////////////////////////////////
+//
+//lockfree_arena.h
+//
+/////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "atomic_defs.h"
+#include "utils.h"
+#include "debug.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace lockfree
+{
+/// <summary>
+///     Lockfree bump-pointer arena, for scratch memory that all dies at once (e.g. per-frame allocations). It allocates its storage on
+///		construction, allocations just move an offset forward, and Reset gives everything back by moving it to the start again.
+///
+///		Pros:
+///		- Allocating is a CAS on the offset, and nothing else. Blocks can be of any size and alignment
+///		- Freeing everything is O(1), whatever the number of allocations
+///		- Blocks allocated one after the other are contiguous in memory
+///
+///     Cons:
+///		- Blocks can't be freed one by one, only all at once
+///		- Destructors are never called: objects must be trivially destructible, or destructed by the user before Reset
+///		- Every allocating thread contends on the same offset
+/// </summary>
+template<class tArenaAllocator = std::allocator<uint8_t>>
+class cLockFreeArena
+{
+public:
+	// ***ATOMIC INTERFACE
+
+	/// <summary>
+	///		Allocates a block of memory from the arena
+	/// </summary>
+	/// <param name=alignment>
+	///		Alignment of the block, must be a power of two
+	/// </param>
+	/// <return>
+	///		Returns the block, not initialized, or nullptr if there is not enough room left in the arena
+	/// </return>
+	void* AllocatePtr(size_t size, size_t alignment = alignof(std::max_align_t));
+
+	/// <summary>
+	///		Allocates and constructs an object from the arena
+	/// </summary>
+	/// <return>
+	///		Returns the newly constructed object, or nullptr if there is not enough room left in the arena
+	/// </return>
+	template <typename T, typename... Args>
+	T* Allocate(Args&&... args);
+
+	/// <summary>
+	///		Allocates an array of n objects from the arena, not constructed
+	/// </summary>
+	/// <return>
+	///		Returns the first element of the array, or nullptr if there is not enough room left in the arena
+	/// </return>
+	template <typename T>
+	T* AllocateArray(size_t n);
+
+	// ***NON-ATOMIC INTERFACE
+
+	//-------------------------------------------------------------------------
+	cLockFreeArena(size_t capacity, const tArenaAllocator& allocator = tArenaAllocator());
+	~cLockFreeArena();
+
+	/// <summary>
+	///		Frees every block allocated so far, without destructing anything
+	/// </summary>
+	/// <remarks>
+	///		No other thread can be using the arena meanwhile, and the blocks allocated so far must not be used afterwards
+	/// </remarks>
+	void		Reset();
+
+	/// <summary>
+	///		Queries the size in bytes of the storage of the arena
+	/// </summary>
+	size_t		GetCapacity() const { return mCapacity; }
+
+	/// <summary>
+	///		Queries the number of bytes allocated so far, including the padding needed to align the blocks
+	/// </summary>
+	size_t		GetSize() const { return mOffset.load(memory_order_relaxed); }
+
+	/// <summary>
+	///		Queries if some memory is managed by (i.e., part of) the arena
+	/// </summary>
+	bool		Manages(const void* ptr) const;
+
+private:
+	cLockFreeArena(const cLockFreeArena&) = delete;
+	cLockFreeArena& operator=(const cLockFreeArena&) = delete;
+
+	static_assert(sizeof(typename tArenaAllocator::value_type) == 1, "The tArenaAllocator type argument does not allocate bytes");
+
+	typedef typename tArenaAllocator::value_type tByte;
+
+	// Read-only after construction
+	tByte*				mStorage;
+	size_t				mCapacity;
+	tArenaAllocator		mAlloc;
+
+	// Shared by the allocating threads, in a cache line of its own
+	alignas(CACHE_LINE_SIZE) atomic<size_t> mOffset;
+};
+
+#include "lockfree_arena.inl"
+}
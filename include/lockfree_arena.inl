@@ -0,0 +1,78 @@
+
+//-------------------------------------------------------------------------
+template<class tArenaAllocator>
+cLockFreeArena<tArenaAllocator>::cLockFreeArena(size_t capacity, const tArenaAllocator& allocator)
+	: mStorage(nullptr)
+	, mCapacity(capacity)
+	, mAlloc(allocator)
+	, mOffset(0)
+{
+	mStorage = mAlloc.allocate(mCapacity);
+}
+
+//-------------------------------------------------------------------------
+template<class tArenaAllocator>
+cLockFreeArena<tArenaAllocator>::~cLockFreeArena()
+{
+	mAlloc.deallocate(mStorage, mCapacity);
+}
+
+//-------------------------------------------------------------------------
+template<class tArenaAllocator>
+void* cLockFreeArena<tArenaAllocator>::AllocatePtr(size_t size, size_t alignment)
+{
+	LF_assert((alignment != 0) && ((alignment & (alignment - 1)) == 0), "The alignment must be a power of two");
+
+	// Nothing is published through the offset, the blocks belong to whoever allocates them: relaxed is enough
+	const uintptr_t address = reinterpret_cast<uintptr_t>(mStorage);
+	size_t offset = mOffset.load(memory_order_relaxed);
+	for (;;)
+	{
+		const size_t begin = offset + ((0 - (address + offset)) & (alignment - 1));
+		if ((begin > mCapacity) || (size > mCapacity - begin))
+		{
+			return nullptr;
+		}
+
+		if (mOffset.compare_exchange_weak(offset, begin + size, memory_order_relaxed, memory_order_relaxed))
+		{
+			return mStorage + begin;
+		}
+	}
+}
+
+//-------------------------------------------------------------------------
+template<class tArenaAllocator>
+template <typename T, typename... Args>
+T* cLockFreeArena<tArenaAllocator>::Allocate(Args&&... args)
+{
+	void* const ptr = AllocatePtr(sizeof(T), alignof(T));
+	return ptr ? new (ptr) T(forward<Args>(args)...) : nullptr;
+}
+
+//-------------------------------------------------------------------------
+template<class tArenaAllocator>
+template <typename T>
+T* cLockFreeArena<tArenaAllocator>::AllocateArray(size_t n)
+{
+	if (n > mCapacity / sizeof(T))
+	{
+		return nullptr;
+	}
+	return static_cast<T*>(AllocatePtr(n * sizeof(T), alignof(T)));
+}
+
+//-------------------------------------------------------------------------
+template<class tArenaAllocator>
+void cLockFreeArena<tArenaAllocator>::Reset()
+{
+	mOffset.store(0, memory_order_relaxed);
+}
+
+//-------------------------------------------------------------------------
+template<class tArenaAllocator>
+bool cLockFreeArena<tArenaAllocator>::Manages(const void* ptr) const
+{
+	const tByte* const byte_ptr = static_cast<const tByte*>(ptr);
+	return (byte_ptr >= mStorage) && (byte_ptr < (mStorage + mCapacity));
+}
@@ -0,0 +1,163 @@
+///////////////////////////////////////////////////////////////////////////
+//
+//lockfree_bitmap_pool.h
+//
+/////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "atomic_defs.h"
+#include "utils.h"
+#include "debug.h"
+
+#include <algorithm>
+#include <bitset>
+#include <cstdint>
+#include <memory>
+
+namespace lockfree
+{
+/// <summary>
+///     Lock-free pool that keeps track of its free elements with a two-level atomic bitmap instead of a freelist. Same interface as
+///		cLockFreePool, as an alternative for pools hammered by many threads at once.
+///
+///		The leaf level has one bit per element, set while it is free. The summary level has one bit per leaf word, set while the word may
+///		have free elements. Acquiring finds a free bit with a bit scan and claims it with a fetch_and, releasing is a fetch_or. Threads
+///		start looking at per-thread hints (the last leaf word they acquired from), spread across the storage.
+///
+///		Pros:
+///		- No ABA: bits are claimed with a single RMW, there is no head pointer to tag
+///		- Contention spreads across the words of the bitmap instead of piling up on a single head
+///		- Elements handed out are clustered in memory, threads keep acquiring from the same words while they have free elements
+///		- The bitmap is apart from the elements, so there is no minimum size for T and free elements are never written to
+///
+///     Cons:
+///		- Acquiring is not O(1): when the hinted word runs out, the summary is scanned for another one (64 leaf words per summary word).
+///		  Acquiring from an empty pool scans the whole leaf level before giving up
+///		- No blocking acquire (AcquirePtrWait and the like), nor batch releases
+/// </summary>
+template<class T, class tPoolAllocator = std::allocator<T>>
+class cLockFreeBitmapPool
+{
+public:
+	//-------------------------------------------------------------------------
+	typedef T tElement;
+
+	// ***ATOMIC INTERFACE
+
+	/// <summary>
+	///		Acquires a T-sized block from the pool
+	/// </summary>
+	/// <return>
+	///		Returns a pointer to a T-sized block of memory that has not yet been constructed, or nullptr if the pool is empty
+	/// </return>
+	T* AcquirePtr();
+
+	/// <summary>
+	///		Acquires and constructs one element from the pool
+	/// </summary>
+	/// <return>
+	///		Returns a pointer to the newly acquired and constructed element, or nullptr if the pool is empty
+	/// </return>
+	template <typename... Args>
+	T* Acquire(Args&&... args);
+
+	/// <summary>
+	///		Releases a T-sized block from the pool without destructing it
+	/// </summary>
+	/// <remarks>
+	///		The object must be managed by the pool or the function will fail
+	/// </remarks>
+	void ReleasePtr(const T* ptr);
+
+	/// <summary>
+	///		Releases and destructs a pool element
+	/// </summary>
+	/// <remarks>
+	///		The object must be managed by the pool or the function will fail
+	/// </remarks>
+	void Release(const T* ptr);
+	void Release(T& element);
+
+	// ***NON-ATOMIC INTERFACE
+
+	//-------------------------------------------------------------------------
+	cLockFreeBitmapPool(unsigned n, const tPoolAllocator& allocator = tPoolAllocator());
+	~cLockFreeBitmapPool();
+
+	/// <summary>
+	///		Queries if the pool has no elements left
+	/// </summary>
+	/// <remarks>
+	///		This function's complexity is O(N/64)
+	/// </remarks>
+	bool		Empty() const;
+
+	/// <summary>
+	///		Queries the maximum number of elements the pool can contain
+	/// </summary>
+	unsigned	GetCapacity() const { return mCapacity; }
+
+	/// <summary>
+	///		Queries if the pool has all elements available
+	/// </summary>
+	/// <remarks>
+	///		This function's complexity is O(N/64)
+	/// </remarks>
+	bool		Full() const;
+
+	/// <summary>
+	///		Queries if some memory is managed by (i.e., part of) the pool
+	/// </summary>
+	bool		Manages(const T* ptr) const;
+
+	/// <summary>
+	///		Queries the index of an element within the storage of the pool, in [0, GetCapacity())
+	/// </summary>
+	unsigned	GetElementIndex(const T* ptr) const;
+
+	/// <summary>
+	///		Gets the element stored at some index of the pool, acquired or not
+	/// </summary>
+	T*			GetElement(unsigned index) const;
+
+private:
+	cLockFreeBitmapPool(const cLockFreeBitmapPool&) = delete;
+	cLockFreeBitmapPool& operator=(const cLockFreeBitmapPool&) = delete;
+
+	static_assert(std::is_same<typename tPoolAllocator::value_type, T>::value, "The tPoolAllocator type argument does not allocate elements of type T");
+
+	typedef uint64_t tWord;
+	typedef typename std::allocator_traits<tPoolAllocator>::template rebind_alloc<atomic<tWord>> tWordAllocator;
+
+	static constexpr const unsigned WORD_BITS = 64;
+	static constexpr const unsigned NUM_HINTS = 16;
+	static constexpr const unsigned NULL_IDX = ~0U;
+
+	//-------------------------------------------------------------------------
+	// Each in a cache line of its own, so threads moving their hint don't invalidate the ones of other threads
+	struct alignas(CACHE_LINE_SIZE) tHint
+	{
+		atomic<unsigned>	mLeafIdx;		// leaf word to start looking at
+	};
+
+	static tWord GetBit(unsigned idx) { return tWord(1) << (idx % WORD_BITS); }
+
+	unsigned	AcquireIdx();
+	unsigned	AcquireFromLeaf(unsigned leaf_idx);
+	void		ClearSummary(unsigned leaf_idx);
+	atomic<unsigned>& GetThreadHint();
+
+	unsigned		mCapacity;
+	unsigned		mNumLeaves;
+	unsigned		mNumSummaries;
+	tPoolAllocator	mAlloc;
+	tWordAllocator	mWordAlloc;
+	T*				mStorage;
+	atomic<tWord>*	mLeaves;		// one bit per element, set while free
+	atomic<tWord>*	mSummaries;		// one bit per leaf word, set while it may have free bits
+
+	tHint			mHints[NUM_HINTS];	// per group of threads
+};
+
+#include "lockfree_bitmap_pool.inl"
+}
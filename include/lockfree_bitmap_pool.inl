@@ -0,0 +1,249 @@
+
+//-------------------------------------------------------------------------
+template<class T, class tPoolAllocator>
+cLockFreeBitmapPool<T, tPoolAllocator>::cLockFreeBitmapPool(unsigned n, const tPoolAllocator& allocator)
+	: mCapacity((std::min)(n, NULL_IDX - 1))
+	, mNumLeaves((mCapacity + WORD_BITS - 1) / WORD_BITS)
+	, mNumSummaries((mNumLeaves + WORD_BITS - 1) / WORD_BITS)
+	, mAlloc(allocator)
+	, mWordAlloc(allocator)
+	, mStorage(nullptr)
+	, mLeaves(nullptr)
+	, mSummaries(nullptr)
+{
+	mStorage = mAlloc.allocate(mCapacity);
+	mLeaves = mWordAlloc.allocate(mNumLeaves);
+	mSummaries = mWordAlloc.allocate(mNumSummaries);
+
+	// Everything free, except for the bits past the capacity
+	for (unsigned leaf_idx = 0; leaf_idx != mNumLeaves; ++leaf_idx)
+	{
+		const unsigned num_bits = mCapacity - leaf_idx * WORD_BITS;
+		new (&mLeaves[leaf_idx]) atomic<tWord>((num_bits >= WORD_BITS) ? ~tWord(0) : (GetBit(num_bits) - 1));
+	}
+	for (unsigned summary_idx = 0; summary_idx != mNumSummaries; ++summary_idx)
+	{
+		const unsigned num_bits = mNumLeaves - summary_idx * WORD_BITS;
+		new (&mSummaries[summary_idx]) atomic<tWord>((num_bits >= WORD_BITS) ? ~tWord(0) : (GetBit(num_bits) - 1));
+	}
+
+	// Threads start spread across the storage
+	for (unsigned hint_idx = 0; hint_idx != NUM_HINTS; ++hint_idx)
+	{
+		mHints[hint_idx].mLeafIdx.store(static_cast<unsigned>(uint64_t(hint_idx) * mNumLeaves / NUM_HINTS), memory_order_relaxed);
+	}
+}
+
+//-------------------------------------------------------------------------
+template<class T, class tPoolAllocator>
+cLockFreeBitmapPool<T, tPoolAllocator>::~cLockFreeBitmapPool()
+{
+	mWordAlloc.deallocate(mSummaries, mNumSummaries);
+	mWordAlloc.deallocate(mLeaves, mNumLeaves);
+	mAlloc.deallocate(mStorage, mCapacity);
+}
+
+//-------------------------------------------------------------------------
+template<class T, class tPoolAllocator>
+T* cLockFreeBitmapPool<T, tPoolAllocator>::AcquirePtr()
+{
+	const unsigned idx = AcquireIdx();
+	return (idx != NULL_IDX) ? (mStorage + idx) : nullptr;
+}
+
+//-------------------------------------------------------------------------
+template<class T, class tPoolAllocator>
+template <typename... Args>
+T* cLockFreeBitmapPool<T, tPoolAllocator>::Acquire(Args&&... args)
+{
+	T* const ptr = AcquirePtr();
+	if (ptr)
+	{
+		new (ptr) T(forward<Args>(args)...);
+	}
+	return ptr;
+}
+
+//-------------------------------------------------------------------------
+template<class T, class tPoolAllocator>
+void cLockFreeBitmapPool<T, tPoolAllocator>::ReleasePtr(const T* ptr)
+{
+	const unsigned idx = GetElementIndex(ptr);
+	const unsigned leaf_idx = idx / WORD_BITS;
+
+	const tWord prev_leaf = mLeaves[leaf_idx].fetch_or(GetBit(idx), memory_order_seq_cst);
+	LF_assert((prev_leaf & GetBit(idx)) == 0, "Releasing an element that was not acquired");
+
+	// Only the release that makes the word non-empty needs to flag it in the summary (see ClearSummary)
+	if (prev_leaf == 0)
+	{
+		mSummaries[leaf_idx / WORD_BITS].fetch_or(GetBit(leaf_idx), memory_order_seq_cst);
+	}
+}
+
+//-------------------------------------------------------------------------
+template<class T, class tPoolAllocator>
+void cLockFreeBitmapPool<T, tPoolAllocator>::Release(const T* ptr)
+{
+	if (!std::is_trivially_destructible<T>::value && ptr)
+	{
+		ptr->~T();
+	}
+	ReleasePtr(ptr);
+}
+
+//-------------------------------------------------------------------------
+template<class T, class tPoolAllocator>
+void cLockFreeBitmapPool<T, tPoolAllocator>::Release(T& element)
+{
+	Release(&element);
+}
+
+//-------------------------------------------------------------------------
+template<class T, class tPoolAllocator>
+bool cLockFreeBitmapPool<T, tPoolAllocator>::Empty() const
+{
+	for (unsigned leaf_idx = 0; leaf_idx != mNumLeaves; ++leaf_idx)
+	{
+		if (mLeaves[leaf_idx].load(memory_order_relaxed) != 0)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+//-------------------------------------------------------------------------
+template<class T, class tPoolAllocator>
+bool cLockFreeBitmapPool<T, tPoolAllocator>::Full() const
+{
+	unsigned num_free = 0;
+	for (unsigned leaf_idx = 0; leaf_idx != mNumLeaves; ++leaf_idx)
+	{
+		num_free += static_cast<unsigned>(std::bitset<WORD_BITS>(mLeaves[leaf_idx].load(memory_order_relaxed)).count());
+	}
+	return num_free == mCapacity;
+}
+
+//-------------------------------------------------------------------------
+template<class T, class tPoolAllocator>
+bool cLockFreeBitmapPool<T, tPoolAllocator>::Manages(const T* ptr) const
+{
+	return (ptr >= mStorage) && (ptr < (mStorage + mCapacity));
+}
+
+//-------------------------------------------------------------------------
+template<class T, class tPoolAllocator>
+unsigned cLockFreeBitmapPool<T, tPoolAllocator>::GetElementIndex(const T* ptr) const
+{
+	LF_assert(Manages(ptr), "Trying to release an object not managed by this pool!");
+	return static_cast<unsigned>(ptr - mStorage);
+}
+
+//-------------------------------------------------------------------------
+template<class T, class tPoolAllocator>
+T* cLockFreeBitmapPool<T, tPoolAllocator>::GetElement(unsigned index) const
+{
+	LF_assert(index < mCapacity, "Index out of the storage of the pool");
+	return mStorage + index;
+}
+
+//-------------------------------------------------------------------------
+template<class T, class tPoolAllocator>
+unsigned cLockFreeBitmapPool<T, tPoolAllocator>::AcquireIdx()
+{
+	if (mNumLeaves == 0)
+	{
+		return NULL_IDX;
+	}
+
+	// The hinted word first, most of the time it still has free elements
+	atomic<unsigned>& hint = GetThreadHint();
+	const unsigned hint_leaf_idx = hint.load(memory_order_relaxed);
+
+	unsigned idx = AcquireFromLeaf(hint_leaf_idx);
+	if (idx != NULL_IDX)
+	{
+		return idx;
+	}
+	ClearSummary(hint_leaf_idx);
+
+	// Then the words flagged in the summary, starting from the hinted one
+	const unsigned first_summary_idx = hint_leaf_idx / WORD_BITS;
+	for (unsigned offset = 0; offset != mNumSummaries; ++offset)
+	{
+		const unsigned summary_idx = (first_summary_idx + offset) % mNumSummaries;
+		for (tWord summary = mSummaries[summary_idx].load(memory_order_acquire); summary != 0; summary &= summary - 1)
+		{
+			const unsigned leaf_idx = summary_idx * WORD_BITS + detail::LowestBitIndex(summary);
+			if ((idx = AcquireFromLeaf(leaf_idx)) != NULL_IDX)
+			{
+				hint.store(leaf_idx, memory_order_relaxed);
+				return idx;
+			}
+			ClearSummary(leaf_idx);
+		}
+	}
+
+	// The summary is only a hint, a bit can be missing for a moment while some other thread clears it and sets it again. Make sure
+	// before giving up
+	for (unsigned leaf_idx = 0; leaf_idx != mNumLeaves; ++leaf_idx)
+	{
+		if ((idx = AcquireFromLeaf(leaf_idx)) != NULL_IDX)
+		{
+			hint.store(leaf_idx, memory_order_relaxed);
+			return idx;
+		}
+	}
+
+	return NULL_IDX;
+}
+
+//-------------------------------------------------------------------------
+template<class T, class tPoolAllocator>
+unsigned cLockFreeBitmapPool<T, tPoolAllocator>::AcquireFromLeaf(unsigned leaf_idx)
+{
+	atomic<tWord>& leaf = mLeaves[leaf_idx];
+	tWord word = leaf.load(memory_order_relaxed);
+	while (word != 0)
+	{
+		const unsigned bit_idx = detail::LowestBitIndex(word);
+		const tWord bit = tWord(1) << bit_idx;
+
+		// Claimed if the bit was still set, otherwise someone else got it first: try the next one
+		const tWord prev_word = leaf.fetch_and(~bit, memory_order_acquire);
+		if (prev_word & bit)
+		{
+			return leaf_idx * WORD_BITS + bit_idx;
+		}
+		word = prev_word & ~bit;
+	}
+	return NULL_IDX;
+}
+
+//-------------------------------------------------------------------------
+template<class T, class tPoolAllocator>
+void cLockFreeBitmapPool<T, tPoolAllocator>::ClearSummary(unsigned leaf_idx)
+{
+	// A release could have refilled the word after we saw it empty, before its summary bit was cleared. Either we see its bit in the
+	// word after clearing the summary, or it sees the word empty and sets the summary bit again
+	atomic<tWord>& summary = mSummaries[leaf_idx / WORD_BITS];
+	if ((summary.load(memory_order_relaxed) & GetBit(leaf_idx)) == 0)
+	{
+		return;
+	}
+
+	summary.fetch_and(~GetBit(leaf_idx), memory_order_seq_cst);
+	if (mLeaves[leaf_idx].load(memory_order_seq_cst) != 0)
+	{
+		summary.fetch_or(GetBit(leaf_idx), memory_order_seq_cst);
+	}
+}
+
+//-------------------------------------------------------------------------
+template<class T, class tPoolAllocator>
+atomic<unsigned>& cLockFreeBitmapPool<T, tPoolAllocator>::GetThreadHint()
+{
+	static thread_local const unsigned hint_idx = detail::ThreadLocalRandom() % NUM_HINTS;
+	return mHints[hint_idx].mLeafIdx;
+}
@@ -0,0 +1,184 @@
+///////////////////////////////////////////////////////////////////////////
+//
+//lockfree_hash_map.h
+//
+/////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "atomic_defs.h"
+#include "epoch.h"
+#include "lockfree_pool.h"
+#include "utils.h"
+#include "debug.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <utility>
+
+namespace lockfree {
+
+	namespace detail
+	{
+		struct tSplitOrderedNodeBase;
+
+		template <typename Key, typename T>
+		struct tSplitOrderedNode;
+	}
+
+/// <summary>
+///     Lockfree implementation of a concurrent hash map, based on split-ordered lists ("Split-Ordered Lists: Lock-Free Extensible Hash
+///		Tables", Shalev, Shavit 2006).
+///
+///		All the elements live in a single lock-free sorted linked list (Michael 2002), ordered by the bit-reversed hash of their keys. Buckets
+///		are just shortcuts into that list (dummy nodes), so growing the table never moves an element: doubling the number of buckets only
+///		splits every bucket in two, and the new buckets get their dummy node linked lazily, the first time somebody inserts or erases in them.
+///		The bucket array itself grows in segments of increasing size, allocated on demand, so there are no global rehash pauses either.
+///
+///		Pros:
+///		- Find never writes to shared memory (it doesn't even initialize buckets, it starts from the closest initialized parent instead),
+///		  so lookups scale with the number of cores and finish in a bounded number of steps unless the list is being constantly modified
+///		- Insert and Erase only contend with operations on neighbouring keys
+///		- Zero-allocation for the elements: nodes come from a pool owned by the map. Bucket segments are only allocated while growing
+///
+///     Cons:
+///		- Erased nodes are given back to the pool through epoch-based reclamation (see cEpochDomain), so Insert can fail before the map holds
+///		  as many elements as its capacity if some thread stays too long inside an operation
+///		- Values can't be modified in place once inserted, to change one, erase it and insert it again
+///		- Insert constructs the element before knowing if the key is already there
+///
+///		Requirements for Key and T:
+///		- Key needs to be hashable (Hash) and comparable (KeyEqual), and to support copy construction
+///		- T needs to support move or copy construction
+/// </summary>
+template <typename Key, typename T, class Hash = std::hash<Key>, class KeyEqual = std::equal_to<Key>, class Allocator = std::allocator<std::pair<const Key, T>>>
+class cLockFreeHashMap
+{
+public:
+	typedef Key			tKeyType;
+	typedef T			tMappedType;
+	typedef Hash		tHasher;
+	typedef KeyEqual	tKeyEqual;
+	typedef Allocator	tAllocatorType;
+
+	// Average number of elements per bucket before the number of buckets doubles
+	static constexpr const unsigned LOAD_FACTOR = 2;
+
+	// ***ATOMIC INTERFACE
+
+	/// <summary>
+	///		Inserts a new element with the key passed, unless there is one already
+	/// </summary>
+	/// <return>
+	///		Returns true if the element has been inserted. False if the key was already in the map, or when an error occurs (like the pool
+	///		being full, for example)
+	/// </return>
+	/// <remarks>
+	///		The value will be emplaced with the variadic arguments passed. An empty argument list will insert a default-constructed value
+	/// </remarks>
+	template <typename... Args>
+	bool Insert(const Key& key, Args&&... args);
+
+	/// <summary>
+	///		Looks for the element with the key passed
+	/// </summary>
+	/// <param name="result">
+	///     (Out) the value of the element will be copied to this argument if found
+	/// </param>
+	/// <return>
+	///		Returns true if the key was in the map. False otherwise
+	/// </return>
+	bool Find(const Key& key, T& result);
+
+	/// <summary>
+	///		Same as Find, handing the value in place to fnc(const T&amp;) instead of copying it out
+	/// </summary>
+	/// <remarks>
+	///		The value is guaranteed to stay alive while fnc runs, even if some other thread erases the element meanwhile
+	/// </remarks>
+	template <typename Fnc>
+	bool FindWith(const Key& key, Fnc&& fnc);
+
+	/// <summary>
+	///		Queries if the key passed is in the map
+	/// </summary>
+	bool Contains(const Key& key);
+
+	/// <summary>
+	///		Erases the element with the key passed
+	/// </summary>
+	/// <return>
+	///		Returns true if the key was in the map and this call erased it. False otherwise
+	/// </return>
+	bool Erase(const Key& key);
+
+	/// <summary>
+	///		Queries the number of elements in the map
+	/// </summary>
+	/// <remarks>
+	///		Only a hint in a multithreaded environment, it can be off while other threads insert or erase
+	/// </remarks>
+	unsigned Size() const;
+
+	// ***NON-ATOMIC INTERFACE
+
+	/// <param name="capacity">
+	///		Maximum number of elements the map can hold. Also bounds the number of buckets (capacity / LOAD_FACTOR, rounded up to a power of 2)
+	/// </param>
+	cLockFreeHashMap(unsigned capacity, const Hash& hash = Hash(), const KeyEqual& equal = KeyEqual(), const Allocator& allocator = Allocator());
+	~cLockFreeHashMap();
+
+private:
+	cLockFreeHashMap(const cLockFreeHashMap&) = delete;
+	cLockFreeHashMap& operator=(const cLockFreeHashMap&) = delete;
+
+	typedef detail::tSplitOrderedNodeBase			tNodeBase;
+	typedef detail::tSplitOrderedNode<Key, T>		tNode;
+	typedef atomic<uintptr_t>						tLink;
+	typedef atomic<tNodeBase*>						tBucket;
+
+	typedef typename std::allocator_traits<Allocator>::template rebind_alloc<tNode>		tNodeAllocator;
+	typedef typename std::allocator_traits<Allocator>::template rebind_alloc<tNodeBase>	tDummyAllocator;
+	typedef typename std::allocator_traits<Allocator>::template rebind_alloc<tBucket>		tBucketAllocator;
+
+	// Segment 0 holds buckets [0, 2), segment s > 0 holds buckets [2^s, 2^(s+1))
+	static constexpr const unsigned MAX_SEGMENTS = 32;
+
+	// Set on a link, it flags the node that holds it as erased
+	static constexpr const uintptr_t DELETED_MARK = 1;
+
+	static tNodeBase* GetPtr(uintptr_t link) { return reinterpret_cast<tNodeBase*>(link & ~DELETED_MARK); }
+	static bool IsMarked(uintptr_t link) { return (link & DELETED_MARK) != 0; }
+	static uintptr_t ToLink(tNodeBase* node) { return reinterpret_cast<uintptr_t>(node); }
+
+	static uint64_t GetRegularKey(size_t hash);
+	static uint64_t GetDummyKey(unsigned bucket_idx);
+	static unsigned GetParentBucket(unsigned bucket_idx);
+	static unsigned GetSegmentIdx(unsigned bucket_idx);
+	static unsigned GetSegmentSize(unsigned segment_idx);
+	static unsigned GetMaxBuckets(unsigned capacity);
+	static void ReclaimNode(tEpochNode* node, void* map);
+
+	bool		Search(tNodeBase* head, uint64_t split_key, const Key* key, tLink*& prev, tNodeBase*& curr);
+	tNodeBase*	FindNode(const Key& key, size_t hash);
+	tNodeBase*	GetBucket(unsigned bucket_idx);
+	tNodeBase*	InitializeBucket(unsigned bucket_idx);
+	tBucket*	LoadBucketSlot(unsigned bucket_idx) const;
+	tBucket*	GetBucketSlot(unsigned bucket_idx);
+
+	cLockFreePool<tNode, tNodeAllocator>		mNodePool;
+	cLockFreePool<tNodeBase, tDummyAllocator>	mDummyPool;
+	cEpochDomain								mEpochDomain;	// after the pools, it gives nodes back to them on destruction
+	tBucketAllocator							mBucketAllocator;
+	Hash										mHasher;
+	KeyEqual									mKeyEqual;
+	const unsigned								mMaxBuckets;
+	atomic<tBucket*>							mSegments[MAX_SEGMENTS];
+	alignas(CACHE_LINE_SIZE) atomic<unsigned>	mNumBuckets;
+	alignas(CACHE_LINE_SIZE) atomic<unsigned>	mCount;
+};
+
+#include "lockfree_hash_map.inl"
+
+}
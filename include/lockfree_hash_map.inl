@@ -0,0 +1,484 @@
+
+namespace detail
+{
+	//----------------------------------------------------------------------------
+	// Dummy nodes (bucket heads) are just the base, regular nodes hold an element too
+	struct tSplitOrderedNodeBase
+	{
+		tEpochNode			mEpochNode;		// needs to be the first member, see FromEpochNode
+		atomic<uintptr_t>	mNext;
+		uint64_t			mSplitKey;		// bit-reversed hash. Odd for regular nodes, even for dummy ones
+
+		bool IsDummy() const { return (mSplitKey & 1) == 0; }
+
+		static tSplitOrderedNodeBase* FromEpochNode(tEpochNode* node) { return reinterpret_cast<tSplitOrderedNodeBase*>(node); }
+	};
+
+	//----------------------------------------------------------------------------
+	template <typename Key, typename T>
+	struct tSplitOrderedNode : tSplitOrderedNodeBase
+	{
+		const Key& GetKey() const { return reinterpret_cast<const Key&>(mKey); }
+		T& GetValue() { return reinterpret_cast<T&>(mValue); }
+
+		void Destroy()
+		{
+			reinterpret_cast<Key&>(mKey).~Key();
+			GetValue().~T();
+		}
+
+		tAlignedStorage<Key>	mKey;
+		tAlignedStorage<T>		mValue;
+	};
+
+	//----------------------------------------------------------------------------
+	inline uint64_t ReverseBits(uint64_t value)
+	{
+		value = ((value >> 1) & 0x5555555555555555ULL) | ((value & 0x5555555555555555ULL) << 1);
+		value = ((value >> 2) & 0x3333333333333333ULL) | ((value & 0x3333333333333333ULL) << 2);
+		value = ((value >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((value & 0x0F0F0F0F0F0F0F0FULL) << 4);
+		value = ((value >> 8) & 0x00FF00FF00FF00FFULL) | ((value & 0x00FF00FF00FF00FFULL) << 8);
+		value = ((value >> 16) & 0x0000FFFF0000FFFFULL) | ((value & 0x0000FFFF0000FFFFULL) << 16);
+		return (value >> 32) | (value << 32);
+	}
+}
+
+//----------------------------------------------------------------------------
+template <typename Key, typename T, class Hash, class KeyEqual, class Allocator>
+cLockFreeHashMap<Key, T, Hash, KeyEqual, Allocator>::cLockFreeHashMap(unsigned capacity, const Hash& hash, const KeyEqual& equal, const Allocator& allocator)
+	: mNodePool(capacity, tNodeAllocator(allocator))
+	, mDummyPool(GetMaxBuckets(capacity), tDummyAllocator(allocator))
+	, mEpochDomain(&ReclaimNode, this)
+	, mBucketAllocator(allocator)
+	, mHasher(hash)
+	, mKeyEqual(equal)
+	, mMaxBuckets(GetMaxBuckets(capacity))
+	, mNumBuckets(2)
+	, mCount(0)
+{
+	for (atomic<tBucket*>& segment : mSegments)
+	{
+		segment.store(nullptr, memory_order_relaxed);
+	}
+
+	// Bucket 0 heads the whole list, it is the only one initialized from the start
+	tNodeBase* const head = mDummyPool.AcquirePtr();
+	LF_assert(head, "The dummy pool should always have room for the head");
+	new (&head->mNext) tLink(0);
+	head->mSplitKey = GetDummyKey(0);
+	GetBucketSlot(0)->store(head, memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------------
+template <typename Key, typename T, class Hash, class KeyEqual, class Allocator>
+cLockFreeHashMap<Key, T, Hash, KeyEqual, Allocator>::~cLockFreeHashMap()
+{
+	// Nodes still linked (erased or not) go away with the pools, only their elements need destroying. Retired ones are destroyed by the
+	// epoch domain
+	uintptr_t link = LoadBucketSlot(0)->load(memory_order_relaxed)->mNext.load(memory_order_relaxed);
+	while (tNodeBase* const node = GetPtr(link))
+	{
+		link = node->mNext.load(memory_order_relaxed);
+		if (!node->IsDummy())
+		{
+			static_cast<tNode*>(node)->Destroy();
+		}
+	}
+
+	for (unsigned segment_idx = 0; segment_idx != MAX_SEGMENTS; ++segment_idx)
+	{
+		if (tBucket* const segment = mSegments[segment_idx].load(memory_order_relaxed))
+		{
+			mBucketAllocator.deallocate(segment, GetSegmentSize(segment_idx));
+		}
+	}
+}
+
+//----------------------------------------------------------------------------
+template <typename Key, typename T, class Hash, class KeyEqual, class Allocator>
+template <typename... Args>
+bool cLockFreeHashMap<Key, T, Hash, KeyEqual, Allocator>::Insert(const Key& key, Args&&... args)
+{
+	// Some of the nodes could be waiting to be reclaimed by this thread, the epoch needs to advance twice for the latest ones
+	tNode* node = mNodePool.AcquirePtr();
+	for (unsigned attempt = 0; !node && (attempt != 2); ++attempt)
+	{
+		mEpochDomain.Reclaim();
+		node = mNodePool.AcquirePtr();
+	}
+	if (!node)
+	{
+		return false;
+	}
+
+	const size_t hash = mHasher(key);
+	new (&node->mKey) Key(key);
+	new (&node->mValue) T(forward<Args>(args)...);
+	new (&node->mNext) tLink(0);
+	node->mSplitKey = GetRegularKey(hash);
+
+	// Counted before linking, so an Erase of this very element can't make the count wrap around
+	const unsigned count = mCount.fetch_add(1, memory_order_relaxed) + 1;
+
+	bool inserted = false;
+	unsigned num_buckets = mNumBuckets.load(memory_order_acquire);
+	{
+		cEpochDomain::cGuard guard(mEpochDomain);
+		tNodeBase* const bucket = GetBucket(static_cast<unsigned>(hash & (num_buckets - 1)));
+
+		for (;;)
+		{
+			tLink* prev = nullptr;
+			tNodeBase* curr = nullptr;
+			if (Search(bucket, node->mSplitKey, &key, prev, curr))
+			{
+				break;
+			}
+
+			node->mNext.store(ToLink(curr), memory_order_relaxed);
+			uintptr_t expected = ToLink(curr);
+			if (prev->compare_exchange_strong(expected, ToLink(node), memory_order_release, memory_order_relaxed))
+			{
+				inserted = true;
+				break;
+			}
+		}
+	}
+
+	if (!inserted)
+	{
+		// Never published, it can go straight back to the pool
+		mCount.fetch_sub(1, memory_order_relaxed);
+		node->Destroy();
+		mNodePool.ReleasePtr(node);
+		return false;
+	}
+
+	if ((count > num_buckets * LOAD_FACTOR) && (num_buckets < mMaxBuckets))
+	{
+		// If it fails, somebody else has grown the table already
+		mNumBuckets.compare_exchange_strong(num_buckets, num_buckets * 2, memory_order_release, memory_order_relaxed);
+	}
+	return true;
+}
+
+//----------------------------------------------------------------------------
+template <typename Key, typename T, class Hash, class KeyEqual, class Allocator>
+bool cLockFreeHashMap<Key, T, Hash, KeyEqual, Allocator>::Find(const Key& key, T& result)
+{
+	return FindWith(key, [&result](const T& value) { result = value; });
+}
+
+//----------------------------------------------------------------------------
+template <typename Key, typename T, class Hash, class KeyEqual, class Allocator>
+template <typename Fnc>
+bool cLockFreeHashMap<Key, T, Hash, KeyEqual, Allocator>::FindWith(const Key& key, Fnc&& fnc)
+{
+	cEpochDomain::cGuard guard(mEpochDomain);
+
+	tNodeBase* const node = FindNode(key, mHasher(key));
+	if (!node)
+	{
+		return false;
+	}
+
+	fnc(const_cast<const T&>(static_cast<tNode*>(node)->GetValue()));
+	return true;
+}
+
+//----------------------------------------------------------------------------
+template <typename Key, typename T, class Hash, class KeyEqual, class Allocator>
+bool cLockFreeHashMap<Key, T, Hash, KeyEqual, Allocator>::Contains(const Key& key)
+{
+	cEpochDomain::cGuard guard(mEpochDomain);
+	return FindNode(key, mHasher(key)) != nullptr;
+}
+
+//----------------------------------------------------------------------------
+template <typename Key, typename T, class Hash, class KeyEqual, class Allocator>
+bool cLockFreeHashMap<Key, T, Hash, KeyEqual, Allocator>::Erase(const Key& key)
+{
+	const size_t hash = mHasher(key);
+	const uint64_t split_key = GetRegularKey(hash);
+
+	cEpochDomain::cGuard guard(mEpochDomain);
+	tNodeBase* const bucket = GetBucket(static_cast<unsigned>(hash & (mNumBuckets.load(memory_order_acquire) - 1)));
+
+	for (;;)
+	{
+		tLink* prev = nullptr;
+		tNodeBase* curr = nullptr;
+		if (!Search(bucket, split_key, &key, prev, curr))
+		{
+			return false;
+		}
+
+		// Marking the node is what erases it, whoever succeeds owns the erase
+		uintptr_t next = curr->mNext.load(memory_order_acquire);
+		if (IsMarked(next) || !curr->mNext.compare_exchange_strong(next, next | DELETED_MARK, memory_order_acq_rel, memory_order_relaxed))
+		{
+			continue;
+		}
+		mCount.fetch_sub(1, memory_order_relaxed);
+
+		// Try to unlink it ourselves. If the list changed around it, a search will do it (and retire it) for us
+		uintptr_t expected = ToLink(curr);
+		if (prev->compare_exchange_strong(expected, next, memory_order_acq_rel, memory_order_relaxed))
+		{
+			mEpochDomain.Retire(&curr->mEpochNode);
+		}
+		else
+		{
+			Search(bucket, split_key, &key, prev, curr);
+		}
+		return true;
+	}
+}
+
+//----------------------------------------------------------------------------
+template <typename Key, typename T, class Hash, class KeyEqual, class Allocator>
+unsigned cLockFreeHashMap<Key, T, Hash, KeyEqual, Allocator>::Size() const
+{
+	return mCount.load(memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------------
+template <typename Key, typename T, class Hash, class KeyEqual, class Allocator>
+uint64_t cLockFreeHashMap<Key, T, Hash, KeyEqual, Allocator>::GetRegularKey(size_t hash)
+{
+	// The top bit becomes the lowest one, so regular nodes sort right after the dummy node of the same bucket
+	return detail::ReverseBits(static_cast<uint64_t>(hash) | (1ULL << 63));
+}
+
+//----------------------------------------------------------------------------
+template <typename Key, typename T, class Hash, class KeyEqual, class Allocator>
+uint64_t cLockFreeHashMap<Key, T, Hash, KeyEqual, Allocator>::GetDummyKey(unsigned bucket_idx)
+{
+	return detail::ReverseBits(bucket_idx);
+}
+
+//----------------------------------------------------------------------------
+template <typename Key, typename T, class Hash, class KeyEqual, class Allocator>
+unsigned cLockFreeHashMap<Key, T, Hash, KeyEqual, Allocator>::GetParentBucket(unsigned bucket_idx)
+{
+	// The bucket it was split from: same index without its highest bit
+	unsigned highest_bit = 1U << 31;
+	while (!(bucket_idx & highest_bit))
+	{
+		highest_bit >>= 1;
+	}
+	return bucket_idx & ~highest_bit;
+}
+
+//----------------------------------------------------------------------------
+template <typename Key, typename T, class Hash, class KeyEqual, class Allocator>
+unsigned cLockFreeHashMap<Key, T, Hash, KeyEqual, Allocator>::GetSegmentIdx(unsigned bucket_idx)
+{
+	unsigned segment_idx = 0;
+	while ((bucket_idx >> (segment_idx + 1)) != 0)
+	{
+		++segment_idx;
+	}
+	return segment_idx;
+}
+
+//----------------------------------------------------------------------------
+template <typename Key, typename T, class Hash, class KeyEqual, class Allocator>
+unsigned cLockFreeHashMap<Key, T, Hash, KeyEqual, Allocator>::GetSegmentSize(unsigned segment_idx)
+{
+	return (segment_idx == 0) ? 2 : (1U << segment_idx);
+}
+
+//----------------------------------------------------------------------------
+template <typename Key, typename T, class Hash, class KeyEqual, class Allocator>
+unsigned cLockFreeHashMap<Key, T, Hash, KeyEqual, Allocator>::GetMaxBuckets(unsigned capacity)
+{
+	unsigned max_buckets = 2;
+	while ((max_buckets < (capacity / LOAD_FACTOR)) && (max_buckets < (1U << (MAX_SEGMENTS - 1))))
+	{
+		max_buckets *= 2;
+	}
+	return max_buckets;
+}
+
+//----------------------------------------------------------------------------
+template <typename Key, typename T, class Hash, class KeyEqual, class Allocator>
+void cLockFreeHashMap<Key, T, Hash, KeyEqual, Allocator>::ReclaimNode(tEpochNode* epoch_node, void* map)
+{
+	// Only regular nodes get erased, dummy ones stay until the map is destroyed
+	tNode* const node = static_cast<tNode*>(tNodeBase::FromEpochNode(epoch_node));
+	node->Destroy();
+	static_cast<cLockFreeHashMap*>(map)->mNodePool.ReleasePtr(node);
+}
+
+//----------------------------------------------------------------------------
+template <typename Key, typename T, class Hash, class KeyEqual, class Allocator>
+bool cLockFreeHashMap<Key, T, Hash, KeyEqual, Allocator>::Search(tNodeBase* head, uint64_t split_key, const Key* key, tLink*& prev, tNodeBase*& curr)
+{
+	// Finds the first node not sorted before (split_key, key), unlinking the erased nodes found on the way. Dummy nodes are looked for
+	// with a null key, they are the only ones with an even split key. Must be called inside a critical section
+	for (;;)
+	{
+		prev = &head->mNext;
+		curr = GetPtr(prev->load(memory_order_acquire));
+
+		bool restart = false;
+		while (curr && !restart)
+		{
+			const uintptr_t next = curr->mNext.load(memory_order_acquire);
+			if (IsMarked(next))
+			{
+				uintptr_t expected = ToLink(curr);
+				if (prev->compare_exchange_strong(expected, next & ~DELETED_MARK, memory_order_acq_rel, memory_order_relaxed))
+				{
+					mEpochDomain.Retire(&curr->mEpochNode);
+					curr = GetPtr(next);
+				}
+				else
+				{
+					// prev got erased or something got inserted after it
+					restart = true;
+				}
+				continue;
+			}
+
+			if (curr->mSplitKey > split_key)
+			{
+				return false;
+			}
+			if ((curr->mSplitKey == split_key) && (!key || mKeyEqual(static_cast<tNode*>(curr)->GetKey(), *key)))
+			{
+				return true;
+			}
+
+			prev = &curr->mNext;
+			curr = GetPtr(next);
+		}
+
+		if (!restart)
+		{
+			return false;
+		}
+	}
+}
+
+//----------------------------------------------------------------------------
+template <typename Key, typename T, class Hash, class KeyEqual, class Allocator>
+auto cLockFreeHashMap<Key, T, Hash, KeyEqual, Allocator>::FindNode(const Key& key, size_t hash) -> tNodeBase*
+{
+	// Read-only: buckets not initialized yet are skipped in favour of their closest initialized parent (bucket 0 always is), and erased
+	// nodes are stepped over instead of unlinked
+	unsigned bucket_idx = static_cast<unsigned>(hash & (mNumBuckets.load(memory_order_acquire) - 1));
+	tNodeBase* bucket = nullptr;
+	for (;;)
+	{
+		tBucket* const slot = LoadBucketSlot(bucket_idx);
+		if (slot && ((bucket = slot->load(memory_order_acquire)) != nullptr))
+		{
+			break;
+		}
+		bucket_idx = GetParentBucket(bucket_idx);
+	}
+
+	const uint64_t split_key = GetRegularKey(hash);
+	tNodeBase* curr = GetPtr(bucket->mNext.load(memory_order_acquire));
+	while (curr && (curr->mSplitKey <= split_key))
+	{
+		const uintptr_t next = curr->mNext.load(memory_order_acquire);
+		if ((curr->mSplitKey == split_key) && !IsMarked(next) && mKeyEqual(static_cast<tNode*>(curr)->GetKey(), key))
+		{
+			return curr;
+		}
+		curr = GetPtr(next);
+	}
+	return nullptr;
+}
+
+//----------------------------------------------------------------------------
+template <typename Key, typename T, class Hash, class KeyEqual, class Allocator>
+auto cLockFreeHashMap<Key, T, Hash, KeyEqual, Allocator>::GetBucket(unsigned bucket_idx) -> tNodeBase*
+{
+	tNodeBase* const bucket = GetBucketSlot(bucket_idx)->load(memory_order_acquire);
+	return bucket ? bucket : InitializeBucket(bucket_idx);
+}
+
+//----------------------------------------------------------------------------
+template <typename Key, typename T, class Hash, class KeyEqual, class Allocator>
+auto cLockFreeHashMap<Key, T, Hash, KeyEqual, Allocator>::InitializeBucket(unsigned bucket_idx) -> tNodeBase*
+{
+	// Links the dummy node of the bucket after the one of its parent (initializing it first if needed, recursively). Several threads can
+	// race to do it, they all end up agreeing on the dummy node that made it into the list
+	tNodeBase* const parent = GetBucket(GetParentBucket(bucket_idx));
+	tBucket* const slot = GetBucketSlot(bucket_idx);
+
+	tNodeBase* dummy = nullptr;
+	while ((dummy = mDummyPool.AcquirePtr()) == nullptr)
+	{
+		// There's a dummy node per bucket, so the pool can only be empty while other threads race to initialize this same bucket
+		if (tNodeBase* const bucket = slot->load(memory_order_acquire))
+		{
+			return bucket;
+		}
+		std::this_thread::yield();
+	}
+	new (&dummy->mNext) tLink(0);
+	dummy->mSplitKey = GetDummyKey(bucket_idx);
+
+	tNodeBase* bucket = nullptr;
+	while (!bucket)
+	{
+		tLink* prev = nullptr;
+		tNodeBase* curr = nullptr;
+		if (Search(parent, dummy->mSplitKey, nullptr, prev, curr))
+		{
+			mDummyPool.ReleasePtr(dummy);
+			bucket = curr;
+			break;
+		}
+
+		dummy->mNext.store(ToLink(curr), memory_order_relaxed);
+		uintptr_t expected = ToLink(curr);
+		if (prev->compare_exchange_strong(expected, ToLink(dummy), memory_order_release, memory_order_relaxed))
+		{
+			bucket = dummy;
+		}
+	}
+
+	slot->store(bucket, memory_order_release);
+	return bucket;
+}
+
+//----------------------------------------------------------------------------
+template <typename Key, typename T, class Hash, class KeyEqual, class Allocator>
+auto cLockFreeHashMap<Key, T, Hash, KeyEqual, Allocator>::LoadBucketSlot(unsigned bucket_idx) const -> tBucket*
+{
+	const unsigned segment_idx = GetSegmentIdx(bucket_idx);
+	tBucket* const segment = mSegments[segment_idx].load(memory_order_acquire);
+	return segment ? segment + (bucket_idx - ((segment_idx == 0) ? 0 : GetSegmentSize(segment_idx))) : nullptr;
+}
+
+//----------------------------------------------------------------------------
+template <typename Key, typename T, class Hash, class KeyEqual, class Allocator>
+auto cLockFreeHashMap<Key, T, Hash, KeyEqual, Allocator>::GetBucketSlot(unsigned bucket_idx) -> tBucket*
+{
+	if (tBucket* const slot = LoadBucketSlot(bucket_idx))
+	{
+		return slot;
+	}
+
+	// First bucket of the segment being used, allocate it. Only one of the threads racing to do it gets to publish its segment
+	const unsigned segment_idx = GetSegmentIdx(bucket_idx);
+	const unsigned segment_size = GetSegmentSize(segment_idx);
+	tBucket* const new_segment = mBucketAllocator.allocate(segment_size);
+	for (unsigned i = 0; i != segment_size; ++i)
+	{
+		new (new_segment + i) tBucket(nullptr);
+	}
+
+	tBucket* segment = nullptr;
+	if (!mSegments[segment_idx].compare_exchange_strong(segment, new_segment, memory_order_acq_rel, memory_order_acquire))
+	{
+		mBucketAllocator.deallocate(new_segment, segment_size);
+	}
+	return LoadBucketSlot(bucket_idx);
+}
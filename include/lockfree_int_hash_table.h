@@ -0,0 +1,139 @@
+///////////////////////////////////////////////////////////////////////////
+//
+//lockfree_int_hash_table.h
+//
+/////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "atomic_defs.h"
+#include "utils.h"
+#include "debug.h"
+
+#include <cstdint>
+
+// Group probing compares the 16 control bytes of a group with a single SSE2 instruction when available, and falls back to a scalar loop
+// otherwise. Define LF_SSE2_ENABLED to 0 to force the scalar path
+#if !defined LF_SSE2_ENABLED
+	#if defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2) || defined __SSE2__
+		#define LF_SSE2_ENABLED 1
+	#else
+		#define LF_SSE2_ENABLED 0
+	#endif
+#endif
+
+#if LF_SSE2_ENABLED
+	#include <emmintrin.h>
+#endif
+
+namespace lockfree {
+
+	namespace detail
+	{
+		// Enough groups to keep a table at most 7/8 full, rounded up to a power of 2
+		constexpr size_t GetIntHashTableNumGroups(size_t capacity, size_t group_size, size_t num_groups = 1)
+		{
+			return (num_groups * group_size * 7 / 8 >= capacity) ? num_groups : GetIntHashTableNumGroups(capacity, group_size, num_groups * 2);
+		}
+	}
+
+/// <summary>
+///     Lockfree implementation of a fixed-capacity hash table from 64-bit integer keys to 32-bit integer values, for hot lookups
+///		(id-to-slot tables and the like) where pointer-chasing maps are too slow.
+///
+///		Open addressing over groups of GROUP_SIZE slots. Every slot has a control byte holding a 7-bit fingerprint of its key once it is
+///		full, so probing a group compares all its control bytes at once (one SSE2 instruction) and only looks at the keys whose
+///		fingerprint matches. Groups are probed linearly, a lookup stops at the first group with a slot that was never used.
+///
+///		Insertion claims a slot with a single CAS on its key, then writes the value and publishes the fingerprint. Lookups never write.
+///
+///		Pros:
+///		- Lookups touch one cache line of control bytes and (almost always) one key per group probed
+///		- Zero-allocation: all the slots live in the table itself, sized at compile time (like the local storage of the containers)
+///
+///     Cons:
+///		- Insert-only: elements can't be erased (values can be updated in place, though)
+///		- EMPTY_KEY is reserved and can't be used as a key
+/// </summary>
+template <size_t capacity>
+class cLockFreeIntHashTable
+{
+public:
+	typedef uint64_t tKey;
+	typedef uint32_t tValue;
+
+	static constexpr const size_t GROUP_SIZE = 16;
+	static constexpr const tKey EMPTY_KEY = UINT64_MAX;
+
+	// ***ATOMIC INTERFACE
+
+	/// <summary>
+	///		Inserts the key passed with the value passed, unless the key is in the table already
+	/// </summary>
+	/// <return>
+	///		Returns true if the key has been inserted. False if the key was already in the table or the table is full
+	/// </return>
+	bool Insert(tKey key, tValue value);
+
+	/// <summary>
+	///		Looks for the key passed
+	/// </summary>
+	/// <param name="value">
+	///     (Out) the value of the key, if found
+	/// </param>
+	/// <return>
+	///		Returns true if the key was in the table. False otherwise (keys still being inserted by other threads are not found yet)
+	/// </return>
+	bool Find(tKey key, tValue& value) const;
+
+	/// <summary>
+	///		Queries if the key passed is in the table
+	/// </summary>
+	bool Contains(tKey key) const;
+
+	/// <summary>
+	///		Replaces the value of a key already in the table
+	/// </summary>
+	/// <return>
+	///		Returns true if the key was in the table. False otherwise
+	/// </return>
+	bool Update(tKey key, tValue value);
+
+	// ***NON-ATOMIC INTERFACE
+
+	cLockFreeIntHashTable();
+
+	/// <summary>
+	///		Queries the maximum number of keys the table can hold
+	/// </summary>
+	static constexpr size_t GetCapacity() { return capacity; }
+
+private:
+	cLockFreeIntHashTable(const cLockFreeIntHashTable&) = delete;
+	cLockFreeIntHashTable& operator=(const cLockFreeIntHashTable&) = delete;
+
+	static constexpr const size_t NUM_GROUPS = detail::GetIntHashTableNumGroups(capacity, GROUP_SIZE);
+
+	// Control bytes: 0 for slots whose key is not published yet, FULL_CTRL | fingerprint for the rest
+	static constexpr const uint8_t EMPTY_CTRL = 0;
+	static constexpr const uint8_t FULL_CTRL = 0x80;
+
+	//-------------------------------------------------------------------------
+	struct alignas(GROUP_SIZE) tGroup
+	{
+		atomic<uint8_t>		mCtrl[GROUP_SIZE];
+		atomic<tKey>		mKeys[GROUP_SIZE];
+		atomic<tValue>		mValues[GROUP_SIZE];
+	};
+
+	static uint64_t Hash(tKey key);
+	static uint8_t GetCtrl(uint64_t hash) { return static_cast<uint8_t>(FULL_CTRL | (hash >> 57)); }
+	static void MatchCtrl(const tGroup& group, uint8_t ctrl, uint32_t& matches, uint32_t& unpublished);
+
+	bool FindSlot(tKey key, const tGroup*& group, unsigned& slot) const;
+
+	tGroup mGroups[NUM_GROUPS];
+};
+
+#include "lockfree_int_hash_table.inl"
+
+}
@@ -0,0 +1,184 @@
+
+//----------------------------------------------------------------------------
+template <size_t capacity>
+cLockFreeIntHashTable<capacity>::cLockFreeIntHashTable()
+{
+	for (tGroup& group : mGroups)
+	{
+		for (unsigned slot = 0; slot != GROUP_SIZE; ++slot)
+		{
+			group.mCtrl[slot].store(EMPTY_CTRL, memory_order_relaxed);
+			group.mKeys[slot].store(EMPTY_KEY, memory_order_relaxed);
+			group.mValues[slot].store(0, memory_order_relaxed);
+		}
+	}
+}
+
+//----------------------------------------------------------------------------
+template <size_t capacity>
+bool cLockFreeIntHashTable<capacity>::Insert(tKey key, tValue value)
+{
+	LF_assert(key != EMPTY_KEY, "EMPTY_KEY can't be inserted");
+
+	const uint64_t hash = Hash(key);
+	const uint8_t ctrl = GetCtrl(hash);
+
+	size_t group_idx = hash & (NUM_GROUPS - 1);
+	for (size_t probe = 0; probe != NUM_GROUPS; ++probe, group_idx = (group_idx + 1) & (NUM_GROUPS - 1))
+	{
+		tGroup& group = mGroups[group_idx];
+
+		// Both masks come from the same snapshot of the control bytes: a slot published after it shows up as unpublished, so we'll
+		// find our key there when trying to claim it
+		uint32_t matches = 0;
+		uint32_t unpublished = 0;
+		MatchCtrl(group, ctrl, matches, unpublished);
+
+		for (; matches != 0; matches &= matches - 1)
+		{
+			if (group.mKeys[detail::LowestBitIndex(matches)].load(memory_order_relaxed) == key)
+			{
+				return false;
+			}
+		}
+
+		// Slots are claimed in order, so any thread inserting the same key claims (or fails to claim) the same slots we do
+		for (; unpublished != 0; unpublished &= unpublished - 1)
+		{
+			const unsigned slot = detail::LowestBitIndex(unpublished);
+
+			tKey expected = EMPTY_KEY;
+			if (group.mKeys[slot].compare_exchange_strong(expected, key, memory_order_relaxed, memory_order_relaxed))
+			{
+				group.mValues[slot].store(value, memory_order_relaxed);
+				group.mCtrl[slot].store(ctrl, memory_order_release);
+				return true;
+			}
+
+			if (expected == key)
+			{
+				return false;
+			}
+		}
+	}
+
+	return false;
+}
+
+//----------------------------------------------------------------------------
+template <size_t capacity>
+bool cLockFreeIntHashTable<capacity>::Find(tKey key, tValue& value) const
+{
+	const tGroup* group = nullptr;
+	unsigned slot = 0;
+	if (!FindSlot(key, group, slot))
+	{
+		return false;
+	}
+
+	value = group->mValues[slot].load(memory_order_acquire);
+	return true;
+}
+
+//----------------------------------------------------------------------------
+template <size_t capacity>
+bool cLockFreeIntHashTable<capacity>::Contains(tKey key) const
+{
+	const tGroup* group = nullptr;
+	unsigned slot = 0;
+	return FindSlot(key, group, slot);
+}
+
+//----------------------------------------------------------------------------
+template <size_t capacity>
+bool cLockFreeIntHashTable<capacity>::Update(tKey key, tValue value)
+{
+	const tGroup* group = nullptr;
+	unsigned slot = 0;
+	if (!FindSlot(key, group, slot))
+	{
+		return false;
+	}
+
+	const_cast<tGroup*>(group)->mValues[slot].store(value, memory_order_release);
+	return true;
+}
+
+//----------------------------------------------------------------------------
+template <size_t capacity>
+uint64_t cLockFreeIntHashTable<capacity>::Hash(tKey key)
+{
+	// Finalizer of MurmurHash3, every bit of the key affects both the group (low bits) and the fingerprint (high bits)
+	key ^= key >> 33;
+	key *= 0xFF51AFD7ED558CCDULL;
+	key ^= key >> 33;
+	key *= 0xC4CEB9FE1A85EC53ULL;
+	key ^= key >> 33;
+	return key;
+}
+
+//----------------------------------------------------------------------------
+template <size_t capacity>
+void cLockFreeIntHashTable<capacity>::MatchCtrl(const tGroup& group, uint8_t ctrl, uint32_t& matches, uint32_t& unpublished)
+{
+#if LF_SSE2_ENABLED
+	// The control bytes are only ever written with single byte stores, so a vector load can't see any of them torn. The fence orders it
+	// like an acquire load of every byte
+	const __m128i ctrl_bytes = _mm_load_si128(reinterpret_cast<const __m128i*>(group.mCtrl));
+	std::atomic_thread_fence(memory_order_acquire);
+
+	matches = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl_bytes, _mm_set1_epi8(static_cast<char>(ctrl)))));
+	unpublished = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl_bytes, _mm_setzero_si128())));
+#else
+	matches = 0;
+	unpublished = 0;
+	for (unsigned slot = 0; slot != GROUP_SIZE; ++slot)
+	{
+		const uint8_t slot_ctrl = group.mCtrl[slot].load(memory_order_acquire);
+		matches |= static_cast<uint32_t>(slot_ctrl == ctrl) << slot;
+		unpublished |= static_cast<uint32_t>(slot_ctrl == EMPTY_CTRL) << slot;
+	}
+#endif
+}
+
+//----------------------------------------------------------------------------
+template <size_t capacity>
+bool cLockFreeIntHashTable<capacity>::FindSlot(tKey key, const tGroup*& found_group, unsigned& found_slot) const
+{
+	const uint64_t hash = Hash(key);
+	const uint8_t ctrl = GetCtrl(hash);
+
+	size_t group_idx = hash & (NUM_GROUPS - 1);
+	for (size_t probe = 0; probe != NUM_GROUPS; ++probe, group_idx = (group_idx + 1) & (NUM_GROUPS - 1))
+	{
+		const tGroup& group = mGroups[group_idx];
+
+		uint32_t matches = 0;
+		uint32_t unpublished = 0;
+		MatchCtrl(group, ctrl, matches, unpublished);
+
+		for (; matches != 0; matches &= matches - 1)
+		{
+			const unsigned slot = detail::LowestBitIndex(matches);
+			if (group.mKeys[slot].load(memory_order_relaxed) == key)
+			{
+				found_group = &group;
+				found_slot = slot;
+				return true;
+			}
+		}
+
+		// A slot never claimed means the key didn't need to go any further when inserted. Claimed but unpublished slots don't: the group
+		// could be full already, with our key in one of the next ones
+		for (; unpublished != 0; unpublished &= unpublished - 1)
+		{
+			const tKey slot_key = group.mKeys[detail::LowestBitIndex(unpublished)].load(memory_order_relaxed);
+			if ((slot_key == EMPTY_KEY) || (slot_key == key))
+			{
+				return false;
+			}
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,208 @@
+///////////////////////////////////////////////////////////////////////////
+//
+//lockfree_owned_pool.h
+//
+/////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "atomic_defs.h"
+#include "utils.h"
+#include "debug.h"
+
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+namespace lockfree
+{
+/// <summary>
+///     Pool owned by a single thread, meant for producer/consumer traffic: the owner acquires elements and other threads release them.
+///		Same interface as cLockFreePool, but only the owner can acquire.
+///
+///		The owner acquires from and releases to a local freelist, without atomics. Other threads release onto a remote freelist (a
+///		multiple-producer stack) that the owner takes over all at once, with a single exchange, when its local freelist runs out. This is
+///		the design of the per-thread heaps of mimalloc.
+///
+///		Pros:
+///		- The owner only uses atomics when its local freelist runs out, once per batch of remote releases
+///		- The local freelist never leaves the cache of the owner. Releasing threads only share the head of the remote freelist
+///		- ABA-free: the only one popping from the remote freelist is the owner, and it takes all of it
+///		- Batches of remote releases (see ReleaseBatch) cost a single CAS
+///
+///     Cons:
+///		- Only the owner can acquire. Ownership can be transferred with SetOwner
+///		- Elements released remotely are only available again once the owner runs out of local ones
+///		- Releases compare the calling thread with the owner, to know which freelist the element goes to
+///		- No blocking acquire (AcquirePtrWait and the like)
+/// </summary>
+template<class T, class tPoolAllocator = std::allocator<T>>
+class cLockFreeOwnedPool
+{
+	typedef uint32_t tIndex;
+
+public:
+	//-------------------------------------------------------------------------
+	typedef T tElement;
+
+	/// <summary>
+	///		Elements added to a batch with BatchReleasePtr, pending to be given back to the pool all at once with ReleaseBatch
+	/// </summary>
+	struct tReleaseBatch;
+
+	// ***ATOMIC INTERFACE
+
+	/// <summary>
+	///		Acquires a T-sized block from the pool. Owner only
+	/// </summary>
+	/// <return>
+	///		Returns a pointer to a T-sized block of memory that has not yet been constructed, or nullptr if the pool is empty
+	/// </return>
+	T* AcquirePtr();
+
+	/// <summary>
+	///		Acquires and constructs one element from the pool. Owner only
+	/// </summary>
+	/// <return>
+	///		Returns a pointer to the newly acquired and constructed element, or nullptr if the pool is empty
+	/// </return>
+	template <typename... Args>
+	T* Acquire(Args&&... args);
+
+	/// <summary>
+	///		Releases a T-sized block from the pool without destructing it. Any thread
+	/// </summary>
+	/// <remarks>
+	///		The object must be managed by the pool or the function will fail
+	/// </remarks>
+	void ReleasePtr(const T* ptr);
+
+	/// <summary>
+	///		Releases and destructs a pool element. Any thread
+	/// </summary>
+	/// <remarks>
+	///		The object must be managed by the pool or the function will fail
+	/// </remarks>
+	void Release(const T* ptr);
+	void Release(T& element);
+
+	/// <summary>
+	///		Adds a T-sized block to a batch of blocks pending release, without destructing it
+	/// </summary>
+	/// <param name=batch>
+	///		Batch the block will be added to. Batches are not thread-safe, they are meant to be built locally by one thread
+	/// </param>
+	void BatchReleasePtr(tReleaseBatch& batch, const T* ptr);
+
+	/// <summary>
+	///		Releases all the blocks added to a batch at once (with a single CAS from threads other than the owner), leaving the batch empty
+	/// </summary>
+	void ReleaseBatch(tReleaseBatch& batch);
+
+	// ***NON-ATOMIC INTERFACE
+
+	//-------------------------------------------------------------------------
+	/// <summary>
+	///		The thread constructing the pool becomes its owner
+	/// </summary>
+	cLockFreeOwnedPool(unsigned n, const tPoolAllocator& allocator = tPoolAllocator());
+	~cLockFreeOwnedPool();
+
+	/// <summary>
+	///		Makes the calling thread the owner of the pool, along with the elements in the local freelist
+	/// </summary>
+	/// <remarks>
+	///		No other thread can be using the pool meanwhile
+	/// </remarks>
+	void		SetOwner();
+
+	/// <summary>
+	///		Queries if the calling thread is the owner of the pool
+	/// </summary>
+	bool		IsOwner() const { return std::this_thread::get_id() == mOwner; }
+
+	/// <summary>
+	///		Queries if the pool has no elements left, neither local nor released remotely. Owner only
+	/// </summary>
+	bool		Empty() const;
+
+	/// <summary>
+	///		Queries the maximum number of elements the pool can contain
+	/// </summary>
+	unsigned	GetCapacity() const { return mCapacity; }
+
+	/// <summary>
+	///		Queries if the pool has all elements available. Owner only
+	/// </summary>
+	/// <remarks>
+	///		This function's complexity is O(N)
+	/// </remarks>
+	bool		Full() const;
+
+	/// <summary>
+	///		Queries if some memory is managed by (i.e., part of) the pool
+	/// </summary>
+	bool		Manages(const T* ptr) const;
+
+	/// <summary>
+	///		Queries the index of an element within the storage of the pool, in [0, GetCapacity())
+	/// </summary>
+	unsigned	GetElementIndex(const T* ptr) const;
+
+	/// <summary>
+	///		Gets the element stored at some index of the pool, acquired or not
+	/// </summary>
+	T*			GetElement(unsigned index) const;
+
+	//-------------------------------------------------------------------------
+	struct tReleaseBatch
+	{
+		tReleaseBatch()
+			: mFirst(NULL_IDX)
+			, mLast(NULL_IDX)
+			, mCount(0)
+		{}
+
+		unsigned GetCount() const { return mCount; }
+
+	private:
+		friend class cLockFreeOwnedPool;
+
+		tIndex		mFirst;
+		tIndex		mLast;
+		unsigned	mCount;
+	};
+
+private:
+	cLockFreeOwnedPool(const cLockFreeOwnedPool&) = delete;
+	cLockFreeOwnedPool& operator=(const cLockFreeOwnedPool&) = delete;
+
+	static_assert(sizeof(T) >= sizeof(tIndex), "Elements smaller than 4 bytes are not supported");
+	static_assert(std::is_same<typename tPoolAllocator::value_type, T>::value, "The tPoolAllocator type argument does not allocate elements of type T");
+
+	static constexpr const tIndex NULL_IDX = ~tIndex(0);
+
+	//-------------------------------------------------------------------------
+	// Free elements store the index of the next free one
+	struct tNode
+	{
+		tIndex mNext;
+	};
+
+	tNode*			GetNode(tIndex idx) const { return reinterpret_cast<tNode*>(mStorage + idx); }
+	void			PushLocal(tIndex first, tIndex last);
+	void			PushRemote(tIndex first, tIndex last);
+	unsigned		CountList(tIndex head) const;
+
+	// Owned by the owner
+	T*					mStorage;
+	unsigned			mCapacity;
+	tIndex				mLocalHead;
+	std::thread::id		mOwner;
+	tPoolAllocator		mAlloc;
+
+	// Shared by the releasing threads, in a cache line of its own
+	alignas(CACHE_LINE_SIZE) atomic<tIndex> mRemoteHead;
+};
+
+#include "lockfree_owned_pool.inl"
+}
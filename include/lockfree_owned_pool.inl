@@ -0,0 +1,211 @@
+
+//-------------------------------------------------------------------------
+template<class T, class tPoolAllocator>
+cLockFreeOwnedPool<T, tPoolAllocator>::cLockFreeOwnedPool(unsigned n, const tPoolAllocator& allocator)
+	: mStorage(nullptr)
+	, mCapacity((n < NULL_IDX) ? n : NULL_IDX - 1)
+	, mLocalHead(NULL_IDX)
+	, mOwner(std::this_thread::get_id())
+	, mAlloc(allocator)
+	, mRemoteHead(NULL_IDX)
+{
+	mStorage = mAlloc.allocate(mCapacity);
+
+	// Everything starts in the local freelist, in address order
+	for (tIndex idx = 0; idx != mCapacity; ++idx)
+	{
+		GetNode(idx)->mNext = idx + 1;
+	}
+	if (mCapacity != 0)
+	{
+		GetNode(mCapacity - 1)->mNext = NULL_IDX;
+		mLocalHead = 0;
+	}
+}
+
+//-------------------------------------------------------------------------
+template<class T, class tPoolAllocator>
+cLockFreeOwnedPool<T, tPoolAllocator>::~cLockFreeOwnedPool()
+{
+	mAlloc.deallocate(mStorage, mCapacity);
+}
+
+//-------------------------------------------------------------------------
+template<class T, class tPoolAllocator>
+T* cLockFreeOwnedPool<T, tPoolAllocator>::AcquirePtr()
+{
+	LF_assert(IsOwner(), "Only the owner of the pool can acquire from it");
+
+	// Out of local elements: take over everything released remotely so far
+	if (mLocalHead == NULL_IDX)
+	{
+		if (mRemoteHead.load(memory_order_relaxed) == NULL_IDX)
+		{
+			return nullptr;
+		}
+		mLocalHead = mRemoteHead.exchange(NULL_IDX, memory_order_acquire);
+	}
+
+	const tIndex idx = mLocalHead;
+	mLocalHead = GetNode(idx)->mNext;
+	return mStorage + idx;
+}
+
+//-------------------------------------------------------------------------
+template<class T, class tPoolAllocator>
+template <typename... Args>
+T* cLockFreeOwnedPool<T, tPoolAllocator>::Acquire(Args&&... args)
+{
+	T* const ptr = AcquirePtr();
+	if (ptr)
+	{
+		new (ptr) T(forward<Args>(args)...);
+	}
+	return ptr;
+}
+
+//-------------------------------------------------------------------------
+template<class T, class tPoolAllocator>
+void cLockFreeOwnedPool<T, tPoolAllocator>::ReleasePtr(const T* ptr)
+{
+	const tIndex idx = GetElementIndex(ptr);
+	if (IsOwner())
+	{
+		PushLocal(idx, idx);
+	}
+	else
+	{
+		PushRemote(idx, idx);
+	}
+}
+
+//-------------------------------------------------------------------------
+template<class T, class tPoolAllocator>
+void cLockFreeOwnedPool<T, tPoolAllocator>::Release(const T* ptr)
+{
+	if (!std::is_trivially_destructible<T>::value && ptr)
+	{
+		ptr->~T();
+	}
+	ReleasePtr(ptr);
+}
+
+//-------------------------------------------------------------------------
+template<class T, class tPoolAllocator>
+void cLockFreeOwnedPool<T, tPoolAllocator>::Release(T& element)
+{
+	Release(&element);
+}
+
+//-------------------------------------------------------------------------
+template<class T, class tPoolAllocator>
+void cLockFreeOwnedPool<T, tPoolAllocator>::BatchReleasePtr(tReleaseBatch& batch, const T* ptr)
+{
+	const tIndex idx = GetElementIndex(ptr);
+
+	// Link it at the front of the batch (the batch is local, no need for atomics here)
+	GetNode(idx)->mNext = batch.mFirst;
+	batch.mFirst = idx;
+	if (batch.mLast == NULL_IDX)
+	{
+		batch.mLast = idx;
+	}
+	++batch.mCount;
+}
+
+//-------------------------------------------------------------------------
+template<class T, class tPoolAllocator>
+void cLockFreeOwnedPool<T, tPoolAllocator>::ReleaseBatch(tReleaseBatch& batch)
+{
+	if (batch.mFirst == NULL_IDX)
+	{
+		return;
+	}
+
+	if (IsOwner())
+	{
+		PushLocal(batch.mFirst, batch.mLast);
+	}
+	else
+	{
+		PushRemote(batch.mFirst, batch.mLast);
+	}
+	batch = tReleaseBatch();
+}
+
+//-------------------------------------------------------------------------
+template<class T, class tPoolAllocator>
+void cLockFreeOwnedPool<T, tPoolAllocator>::SetOwner()
+{
+	mOwner = std::this_thread::get_id();
+}
+
+//-------------------------------------------------------------------------
+template<class T, class tPoolAllocator>
+bool cLockFreeOwnedPool<T, tPoolAllocator>::Empty() const
+{
+	return (mLocalHead == NULL_IDX) && (mRemoteHead.load(memory_order_relaxed) == NULL_IDX);
+}
+
+//-------------------------------------------------------------------------
+template<class T, class tPoolAllocator>
+bool cLockFreeOwnedPool<T, tPoolAllocator>::Full() const
+{
+	return CountList(mLocalHead) + CountList(mRemoteHead.load(memory_order_acquire)) == mCapacity;
+}
+
+//-------------------------------------------------------------------------
+template<class T, class tPoolAllocator>
+bool cLockFreeOwnedPool<T, tPoolAllocator>::Manages(const T* ptr) const
+{
+	return (ptr >= mStorage) && (ptr < (mStorage + mCapacity));
+}
+
+//-------------------------------------------------------------------------
+template<class T, class tPoolAllocator>
+unsigned cLockFreeOwnedPool<T, tPoolAllocator>::GetElementIndex(const T* ptr) const
+{
+	LF_assert(Manages(ptr), "Trying to release an object not managed by this pool!");
+	return static_cast<unsigned>(ptr - mStorage);
+}
+
+//-------------------------------------------------------------------------
+template<class T, class tPoolAllocator>
+T* cLockFreeOwnedPool<T, tPoolAllocator>::GetElement(unsigned index) const
+{
+	LF_assert(index < mCapacity, "Index out of the storage of the pool");
+	return mStorage + index;
+}
+
+//-------------------------------------------------------------------------
+template<class T, class tPoolAllocator>
+void cLockFreeOwnedPool<T, tPoolAllocator>::PushLocal(tIndex first, tIndex last)
+{
+	GetNode(last)->mNext = mLocalHead;
+	mLocalHead = first;
+}
+
+//-------------------------------------------------------------------------
+template<class T, class tPoolAllocator>
+void cLockFreeOwnedPool<T, tPoolAllocator>::PushRemote(tIndex first, tIndex last)
+{
+	// Pushers never read the nodes in the list, and the owner takes the whole list at once, so there is no ABA to worry about
+	tNode* const last_node = GetNode(last);
+	tIndex head = mRemoteHead.load(memory_order_relaxed);
+	do
+	{
+		last_node->mNext = head;
+	} while (!mRemoteHead.compare_exchange_weak(head, first, memory_order_release, memory_order_relaxed));
+}
+
+//-------------------------------------------------------------------------
+template<class T, class tPoolAllocator>
+unsigned cLockFreeOwnedPool<T, tPoolAllocator>::CountList(tIndex head) const
+{
+	unsigned count = 0;
+	for (tIndex idx = head; idx != NULL_IDX; idx = GetNode(idx)->mNext)
+	{
+		++count;
+	}
+	return count;
+}
@@ -0,0 +1,139 @@
+///////////////////////////////////////////////////////////////////////////
+//
+//lockfree_payload_queue.h
+//
+/////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "lockfree_pool.h"
+#include "lockfree_queue.h"
+#include "utils.h"
+#include "debug.h"
+
+#include <cstdint>
+#include <memory>
+
+namespace lockfree {
+
+/// <summary>
+///     Lockfree MPMC queue of big objects stored out of line. The objects (payloads) live in a cLockFreePool instantiated externally and
+///		provided by reference on construction, and the queue only links their 32-bit indices within that pool. Built on a cLockFreeQueue
+///		of indices with local storage for N of them, whose nodes are 8 bytes as long as N is below 65535 (they are linked by index then,
+///		see cLockFreeQueue).
+///
+///		Payloads are constructed in place in their slot of the payload pool by Push, and never move until they are consumed: PopWith
+///		hands them over right where they are.
+///
+///		Pros:
+///		- The chain of nodes the consumers walk stays dense whatever the size of T: 8 nodes per cache line, instead of one node spanning
+///		  several cache lines (or pages) when T takes kilobytes
+///		- One payload pool can be shared by several queues with different capacities, so memory for the payloads is budgeted once
+///		  instead of once per queue
+///		- Neither Push nor PopWith copy the payload
+///
+///     Cons:
+///		- Every object takes an acquire and a release from the payload pool, on top of the ones from the pool of nodes
+///		- Reading a payload is one more indirection (i.e., cache miss) than reading the node where it would otherwise live. It pays off
+///		  with big payloads, not with small ones
+///		- Pushes fail whenever either the payload pool or the queue run out of room
+///
+///		Requirements for T:
+///		- Same as cLockFreeQueue's
+/// <summary>
+template <typename T, size_t storage, class PayloadAllocator = std::allocator<T>>
+class cLockFreePayloadQueue
+{
+	static_assert(storage != LFQS_SHARED, "The queue of indices needs local storage, only the payloads can be shared");
+
+public:
+	typedef T										tValueType;
+	typedef cLockFreePool<T, PayloadAllocator>		tPayloadPool;
+
+	// ***ATOMIC INTERFACE
+
+	/// <summary>
+	///		Pushes a new object in the queue atomically
+	/// </summary>
+	/// <return>
+	///		Returns true if object has been pushed successfully. False if either the payload pool or the queue are full
+	/// </return>
+	/// <remarks>
+	///		The object will be emplaced in the payload pool with the variadic arguments passed. An empty argument list will push a
+	///		default-constructed item
+	/// </remarks>
+	template <typename... Args>
+	bool Push(Args&&... args);
+
+	/// <summary>
+	///		Pushes a new object in the queue atomically. If either the payload pool or the queue are full, blocks the calling thread until
+	///		there is room in both
+	/// </summary>
+	template <typename... Args>
+	void PushWait(Args&&... args);
+
+	/// <summary>
+	///		Pops the next object in FIFO ordering atomically
+	/// </summary>
+	/// <param name="result">
+	///     (Out) the pop object will be <b>moved</b> to this argument if pop succeeds
+	/// </param>
+	/// <return>
+	///		Returns true if the queue was not empty and an object could be pop. False otherwise.
+	/// </return>
+	bool Pop(T& result);
+
+	/// <summary>
+	///		Pops the next object in FIFO ordering atomically, handing it to a callable while it still resides in the payload pool
+	/// </summary>
+	/// <param name="fnc">
+	///     Callable invoked as fnc(T&amp;) with the pop object if pop succeeds. The object is destroyed and given back to the payload
+	///		pool right after fnc returns, so it can be moved from, but references to it must not be kept
+	/// </param>
+	/// <return>
+	///		Returns true if the queue was not empty and an object could be pop. False otherwise.
+	/// </return>
+	template <typename Fnc>
+	bool PopWith(Fnc&& fnc);
+
+	/// <summary>
+	///		Pops the next object in FIFO ordering atomically. If the queue is empty, blocks the calling thread until an object is pushed
+	/// </summary>
+	/// <param name="result">
+	///     (Out) the pop object will be <b>moved</b> to this argument
+	/// </param>
+	void PopWait(T& result);
+
+	// ***NON-ATOMIC INTERFACE
+
+	cLockFreePayloadQueue(tPayloadPool& payload_pool);
+
+	/// <summary>
+	///		Destroys the objects left in the queue, giving their payloads back to the payload pool
+	/// </summary>
+	~cLockFreePayloadQueue();
+
+	/// <summary>
+	///		Queries if the queue is empty
+	/// </summary>
+	/// <remarks>
+	///		Same caveats as cLockFreeQueue::Empty
+	/// </remarks>
+	bool			Empty() const { return mIndices.Empty(); }
+
+	/// <summary>
+	///		Gets the pool the payloads of this queue are stored in
+	/// </summary>
+	tPayloadPool&	GetPayloadPool() const { return mPayloadPool; }
+
+private:
+	cLockFreePayloadQueue(const cLockFreePayloadQueue&) = delete;
+	cLockFreePayloadQueue& operator=(const cLockFreePayloadQueue&) = delete;
+
+	void			ReleasePayload(uint32_t payload_idx);
+
+	tPayloadPool&						mPayloadPool;
+	cLockFreeQueue<uint32_t, storage>	mIndices;
+};
+
+#include "lockfree_payload_queue.inl"
+}
@@ -0,0 +1,91 @@
+
+//-------------------------------------------------------------------------
+template <typename T, size_t storage, class PayloadAllocator>
+cLockFreePayloadQueue<T, storage, PayloadAllocator>::cLockFreePayloadQueue(tPayloadPool& payload_pool)
+	: mPayloadPool(payload_pool)
+{
+}
+
+//-------------------------------------------------------------------------
+template <typename T, size_t storage, class PayloadAllocator>
+cLockFreePayloadQueue<T, storage, PayloadAllocator>::~cLockFreePayloadQueue()
+{
+	uint32_t payload_idx;
+	while (mIndices.NonAtomicPop(payload_idx))
+	{
+		ReleasePayload(payload_idx);
+	}
+}
+
+//-------------------------------------------------------------------------
+template <typename T, size_t storage, class PayloadAllocator>
+template <typename... Args>
+bool cLockFreePayloadQueue<T, storage, PayloadAllocator>::Push(Args&&... args)
+{
+	T* const payload = mPayloadPool.Acquire(forward<Args>(args)...);
+	if (!payload)
+	{
+		return false;
+	}
+
+	// The queue publishes the index with release semantics, consumers see the payload constructed
+	if (!mIndices.Push(mPayloadPool.GetElementIndex(payload)))
+	{
+		mPayloadPool.Release(payload);
+		return false;
+	}
+	return true;
+}
+
+//-------------------------------------------------------------------------
+template <typename T, size_t storage, class PayloadAllocator>
+template <typename... Args>
+void cLockFreePayloadQueue<T, storage, PayloadAllocator>::PushWait(Args&&... args)
+{
+	T* const payload = mPayloadPool.AcquirePtrWait();
+	new (payload) T(forward<Args>(args)...);
+	mIndices.PushWait(mPayloadPool.GetElementIndex(payload));
+}
+
+//-------------------------------------------------------------------------
+template <typename T, size_t storage, class PayloadAllocator>
+bool cLockFreePayloadQueue<T, storage, PayloadAllocator>::Pop(T& result)
+{
+	return PopWith([&result](T& payload)
+	{
+		result = move(payload);
+	});
+}
+
+//-------------------------------------------------------------------------
+template <typename T, size_t storage, class PayloadAllocator>
+template <typename Fnc>
+bool cLockFreePayloadQueue<T, storage, PayloadAllocator>::PopWith(Fnc&& fnc)
+{
+	uint32_t payload_idx;
+	if (!mIndices.Pop(payload_idx))
+	{
+		return false;
+	}
+
+	fnc(*mPayloadPool.GetElement(payload_idx));
+	ReleasePayload(payload_idx);
+	return true;
+}
+
+//-------------------------------------------------------------------------
+template <typename T, size_t storage, class PayloadAllocator>
+void cLockFreePayloadQueue<T, storage, PayloadAllocator>::PopWait(T& result)
+{
+	uint32_t payload_idx;
+	mIndices.PopWait(payload_idx);
+	result = move(*mPayloadPool.GetElement(payload_idx));
+	ReleasePayload(payload_idx);
+}
+
+//-------------------------------------------------------------------------
+template <typename T, size_t storage, class PayloadAllocator>
+void cLockFreePayloadQueue<T, storage, PayloadAllocator>::ReleasePayload(uint32_t payload_idx)
+{
+	mPayloadPool.Release(mPayloadPool.GetElement(payload_idx));
+}
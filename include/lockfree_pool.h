@@ -6,11 +6,249 @@
 #pragma once
 
 #include "atomic_defs.h"
+#include "eventcount.h"
 #include "utils.h"
+#include "virtual_memory.h"
 #include "debug.h"
 
+#include <algorithm>
+#include <chrono>
+#include <memory>
+
 namespace lockfree
 {
+	//-------------------------------------------------------------------------
+	// Optional features of a pool, enabled through the flags template argument
+	enum eLockFreePoolFlags : unsigned
+	{
+		LFPF_NONE				= 0,
+		LFPF_TRACK_OCCUPANCY	= 1 << 0,	// Keeps a bitmap of the acquired elements, so they can be iterated (see ForEachLive)
+		LFPF_TRIMMABLE			= 1 << 1,	// Free pages of the storage can be given back to the OS (see Trim)
+	};
+
+	namespace detail
+	{
+		//-------------------------------------------------------------------------
+		// One bit per element of a pool, set while it is acquired. The disabled version does nothing
+		template <bool enabled, class Allocator>
+		class cPoolOccupancy
+		{
+		public:
+			void Allocate(unsigned, const Allocator&) {}
+			void Deallocate(const Allocator&) {}
+			void Set(unsigned) {}
+			void Clear(unsigned) {}
+			void Reset() {}
+		};
+
+		//-------------------------------------------------------------------------
+		template <class Allocator>
+		class cPoolOccupancy<true, Allocator>
+		{
+		public:
+			typedef uint64_t tWord;
+			static constexpr const unsigned WORD_BITS = 64;
+
+			cPoolOccupancy()
+				: mWords(nullptr)
+				, mNumWords(0)
+			{}
+
+			cPoolOccupancy& operator=(cPoolOccupancy&& rhs)
+			{
+				mWords = lockfree::exchange(rhs.mWords, nullptr);
+				mNumWords = lockfree::exchange(rhs.mNumWords, 0U);
+				return *this;
+			}
+
+			void Allocate(unsigned capacity, const Allocator& allocator)
+			{
+				mNumWords = (capacity + WORD_BITS - 1) / WORD_BITS;
+				mWords = tWordAllocator(allocator).allocate(mNumWords);
+				for (unsigned word_idx = 0; word_idx != mNumWords; ++word_idx)
+				{
+					new (&mWords[word_idx]) atomic<tWord>(0);
+				}
+			}
+
+			void Deallocate(const Allocator& allocator)
+			{
+				if (mWords)
+				{
+					tWordAllocator(allocator).deallocate(mWords, mNumWords);
+				}
+			}
+
+			// Set once the element is ready to be visited, cleared before it stops being so
+			void Set(unsigned idx) { mWords[idx / WORD_BITS].fetch_or(tWord(1) << (idx % WORD_BITS), memory_order_release); }
+			void Clear(unsigned idx) { mWords[idx / WORD_BITS].fetch_and(~(tWord(1) << (idx % WORD_BITS)), memory_order_release); }
+
+			tWord GetWord(unsigned word_idx) const { return mWords[word_idx].load(memory_order_acquire); }
+
+			// Clears every bit. Not thread-safe
+			void Reset()
+			{
+				for (unsigned word_idx = 0; word_idx != mNumWords; ++word_idx)
+				{
+					mWords[word_idx].store(0, memory_order_relaxed);
+				}
+			}
+
+		private:
+			typedef typename std::allocator_traits<Allocator>::template rebind_alloc<atomic<tWord>> tWordAllocator;
+
+			atomic<tWord>*	mWords;
+			unsigned		mNumWords;
+		};
+
+		//-------------------------------------------------------------------------
+		// Spans of elements of a pool whose pages were given back to the OS, one bit each. A span is the shortest run of whole elements
+		// that covers whole pages, spans start at the first element that starts at a page boundary. The disabled version has none
+		template <bool enabled, class Allocator>
+		class cPoolTrimmedSpans
+		{
+		public:
+			static constexpr const unsigned NONE = ~0U;
+
+			void Allocate(const void*, size_t, unsigned, const Allocator&) {}
+			void Deallocate(const Allocator&) {}
+			unsigned Claim() { return NONE; }
+			void Reset() {}
+			unsigned GetNumTrimmed() const { return 0; }
+			unsigned GetSpanElements() const { return 0; }
+			unsigned GetFirstElement(unsigned) const { return 0; }
+		};
+
+		//-------------------------------------------------------------------------
+		template <class Allocator>
+		class cPoolTrimmedSpans<true, Allocator>
+		{
+		public:
+			typedef uint64_t tWord;
+			static constexpr const unsigned WORD_BITS = 64;
+			static constexpr const unsigned NONE = ~0U;
+
+			cPoolTrimmedSpans()
+				: mWords(nullptr)
+				, mNumWords(0)
+				, mNumSpans(0)
+				, mFirstElement(0)
+				, mSpanElements(0)
+				, mSpanSize(0)
+				, mNumTrimmed(0)
+			{}
+
+			cPoolTrimmedSpans& operator=(cPoolTrimmedSpans&& rhs)
+			{
+				mWords = lockfree::exchange(rhs.mWords, nullptr);
+				mNumWords = lockfree::exchange(rhs.mNumWords, 0U);
+				mNumSpans = lockfree::exchange(rhs.mNumSpans, 0U);
+				mFirstElement = rhs.mFirstElement;
+				mSpanElements = rhs.mSpanElements;
+				mSpanSize = rhs.mSpanSize;
+				mNumTrimmed.store(rhs.mNumTrimmed.exchange(0, memory_order_relaxed), memory_order_relaxed);
+				return *this;
+			}
+
+			void Allocate(const void* storage, size_t element_size, unsigned capacity, const Allocator& allocator)
+			{
+				// Elements start at the same offset within a page every page_size / gcd(element_size, page_size) elements
+				const size_t page_size = vm::GetPageSize();
+				size_t gcd = element_size;
+				for (size_t rem = page_size; rem != 0;)
+				{
+					gcd = lockfree::exchange(rem, gcd % rem);
+				}
+				mSpanElements = static_cast<unsigned>(page_size / gcd);
+				mSpanSize = mSpanElements * element_size;
+
+				const uintptr_t address = reinterpret_cast<uintptr_t>(storage);
+				mFirstElement = capacity;
+				for (unsigned idx = 0; (idx != mSpanElements) && (idx < capacity); ++idx)
+				{
+					if ((address + idx * element_size) % page_size == 0)
+					{
+						mFirstElement = idx;
+						break;
+					}
+				}
+
+				mNumSpans = (mFirstElement < capacity) ? (capacity - mFirstElement) / mSpanElements : 0;
+				mNumWords = (mNumSpans + WORD_BITS - 1) / WORD_BITS;
+				mWords = tWordAllocator(allocator).allocate(mNumWords);
+				for (unsigned word_idx = 0; word_idx != mNumWords; ++word_idx)
+				{
+					new (&mWords[word_idx]) atomic<tWord>(0);
+				}
+			}
+
+			void Deallocate(const Allocator& allocator)
+			{
+				if (mWords)
+				{
+					tWordAllocator(allocator).deallocate(mWords, mNumWords);
+				}
+			}
+
+			// Counted before the bit is set and after it is cleared, so the count never falls behind the bits
+			void Mark(unsigned span)
+			{
+				mNumTrimmed.fetch_add(1, memory_order_relaxed);
+				mWords[span / WORD_BITS].fetch_or(tWord(1) << (span % WORD_BITS), memory_order_release);
+			}
+
+			// Takes one of the trimmed spans, if any
+			unsigned Claim()
+			{
+				if (mNumTrimmed.load(memory_order_relaxed) == 0)
+				{
+					return NONE;
+				}
+
+				for (unsigned word_idx = 0; word_idx != mNumWords; ++word_idx)
+				{
+					for (tWord word = mWords[word_idx].load(memory_order_relaxed); word != 0; word &= word - 1)
+					{
+						const tWord bit = word & (~word + 1);
+						if (mWords[word_idx].fetch_and(~bit, memory_order_acquire) & bit)
+						{
+							mNumTrimmed.fetch_sub(1, memory_order_relaxed);
+							return word_idx * WORD_BITS + LowestBitIndex(bit);
+						}
+					}
+				}
+				return NONE;
+			}
+
+			// Forgets every trimmed span, their pages come back as soon as they are written to. Not thread-safe
+			void Reset()
+			{
+				for (unsigned word_idx = 0; word_idx != mNumWords; ++word_idx)
+				{
+					mWords[word_idx].store(0, memory_order_relaxed);
+				}
+				mNumTrimmed.store(0, memory_order_relaxed);
+			}
+
+			unsigned GetNumTrimmed() const { return mNumTrimmed.load(memory_order_relaxed); }
+			unsigned GetNumSpans() const { return mNumSpans; }
+			unsigned GetSpanElements() const { return mSpanElements; }
+			size_t GetSpanSize() const { return mSpanSize; }
+			unsigned GetFirstElement(unsigned span) const { return mFirstElement + span * mSpanElements; }
+
+		private:
+			typedef typename std::allocator_traits<Allocator>::template rebind_alloc<atomic<tWord>> tWordAllocator;
+
+			atomic<tWord>*		mWords;
+			unsigned			mNumWords;
+			unsigned			mNumSpans;
+			unsigned			mFirstElement;
+			unsigned			mSpanElements;
+			size_t				mSpanSize;
+			atomic<unsigned>	mNumTrimmed;
+		};
+	}
+
 /// <summary>
 ///     Lock-free implementation of a generic pool. It allocates storage on construction and does not resize it during its lifecycle. It
 ///     uses an allocator provided on construction for allocating said storage. Its type can be specified optionally as the second template argument
@@ -25,16 +263,28 @@ namespace lockfree
 ///				The maximum number of elements contained by the pool depends on the size of its nodes, which in turn depends on the size of T. When T is bigger 
 ///				or equal than 8 bytes, its max capacity would be 2^32. Anything smaller than that will render a max capacity of 2^16
 ///			</item></description>		
+///			<item><description>		
+///				With LFPF_TRACK_OCCUPANCY in flags, every Acquire and Release also sets or clears the bit of the element in an occupancy bitmap
+///				(one more atomic operation), so the acquired elements can be iterated in address order with ForEachLive
+///			</item></description>		
+///			<item><description>		
+///				Elements are carved from the storage in address order the first time they are acquired, and only go to the freelist once
+///				released. Nothing is written to the storage up front, so the pages of a big pool are not touched until they are needed
+///			</item></description>		
 ///		</list>
 ///		
 /// </remarks>
-template<class T, class tPoolAllocator = std::allocator<T>>
+template<class T, class tPoolAllocator = std::allocator<T>, unsigned flags = LFPF_NONE>
 class cLockFreePool
 {
 public:
 	//-------------------------------------------------------------------------
 	typedef T tElement;
 
+	static constexpr const bool TRACKS_OCCUPANCY = (flags & LFPF_TRACK_OCCUPANCY) != 0;
+	static constexpr const unsigned OCCUPANCY_WORD_BITS = 64;
+	static constexpr const bool IS_TRIMMABLE = (flags & LFPF_TRIMMABLE) != 0;
+
 	// ***ATOMIC INTERFACE
 
 	/// <summary> 
@@ -58,6 +308,45 @@ public:
 	template <typename... Args>
 	T* Acquire(Args&&... args);
 
+	/// <summary> 
+	///		Acquires a T-sized block from the pool. If the pool is empty, blocks the calling thread until some other thread releases one
+	/// </summary>
+	/// <return>
+	///		Returns a pointer to a T-sized block of memory that has not yet been constructed, ready for the user to use placement new to construct it
+	/// </return>
+	T* AcquirePtrWait();
+
+	/// <summary> 
+	///		Same as AcquirePtrWait, but gives up if the pool remains empty for longer than the timeout passed
+	/// </summary>
+	/// <return>
+	///		Returns a pointer to a T-sized block of memory that has not yet been constructed, or nullptr if the wait timed out
+	/// </return>
+	template <class Rep, class Period>
+	T* AcquirePtrFor(const std::chrono::duration<Rep, Period>& timeout);
+
+	/// <summary> 
+	///		Calls try_fnc until it returns true, parking the calling thread between failed attempts until some element of the pool is released
+	/// </summary>
+	/// <param name=try_fnc>
+	///		Non-blocking operation that acquires elements from this pool (i.e., the Push of a container using it). Must return true when successful
+	/// </param>
+	/// <remarks>
+	///		This is what containers use to provide back-pressure when their pool gets exhausted. Releases only go to the OS to wake
+	///		threads up when there are threads parked here
+	/// </remarks>
+	template <typename Fnc>
+	void AwaitRelease(Fnc&& try_fnc);
+
+	/// <summary> 
+	///		Same as AwaitRelease, but gives up once the timeout has passed
+	/// </summary>
+	/// <return>
+	///		Returns true if try_fnc succeeded before timing out. False otherwise
+	/// </return>
+	template <typename Fnc, class Rep, class Period>
+	bool AwaitReleaseFor(Fnc&& try_fnc, const std::chrono::duration<Rep, Period>& timeout);
+
 	/// <summary> 
 	///		Releases a T-sized block from the pool without destructing it
 	/// </summary>
@@ -91,6 +380,64 @@ public:
 	/// </remarks>
 	void Release(T& element);
 
+	/// <summary> 
+	///		Elements added to a batch with BatchReleasePtr, pending to be given back to the pool all at once with ReleaseBatch
+	/// </summary>
+	struct tReleaseBatch;
+
+	/// <summary> 
+	///		Adds a T-sized block to a batch of blocks pending release, without destructing it
+	/// </summary>
+	/// <param name=batch>
+	///		Batch the block will be added to. Batches are not thread-safe, they are meant to be built locally by one thread
+	/// </param>
+	/// <param name=ptr>
+	///		Pointer to the memory acquired by the pool that we want to release. The block stays acquired until ReleaseBatch is called
+	/// </param>
+	/// <remarks>
+	///		The object must be managed by the pool or the function will fail
+	/// </remarks>
+	void BatchReleasePtr(tReleaseBatch& batch, const T* ptr);
+
+	/// <summary> 
+	///		Releases all the blocks added to a batch with a single atomic operation, leaving the batch empty
+	/// </summary>
+	void ReleaseBatch(tReleaseBatch& batch);
+
+	/// <summary> 
+	///		Calls fnc(T&amp;) for every acquired element, in address order. Needs LFPF_TRACK_OCCUPANCY
+	/// </summary>
+	/// <return>
+	///		Returns the number of elements visited
+	/// </return>
+	/// <remarks>
+	///		Elements acquired or released meanwhile may or may not be visited. Elements acquired with Acquire are visited once constructed,
+	///		the ones acquired with AcquirePtr as soon as they are acquired (constructed or not). Elements must not be released by other
+	///		threads while they are being visited
+	/// </remarks>
+	template <typename Fnc>
+	unsigned ForEachLive(Fnc&& fnc);
+
+	/// <summary> 
+	///		Same as ForEachLive, but only visiting the elements with an index in [begin, end). Disjoint ranges can be visited in parallel
+	///		(see ParallelForEachLive), ranges aligned to OCCUPANCY_WORD_BITS don't share any word of the bitmap
+	/// </summary>
+	template <typename Fnc>
+	unsigned ForEachLiveInRange(unsigned begin, unsigned end, Fnc&& fnc);
+
+	/// <summary> 
+	///		Gives the pages of the storage that only hold free elements back to the OS. Needs LFPF_TRIMMABLE
+	/// </summary>
+	/// <return>
+	///		Returns the number of bytes given back
+	/// </return>
+	/// <remarks>
+	///		Trimmed elements are held out of the freelist, and put back (touching their pages again) once it runs out. Trimming takes
+	///		the whole freelist for a while: acquires running meanwhile may find the pool empty. Meant to be called now and then, e.g. once
+	///		a burst is over. The freelist ends up in address order, so later acquires keep away from the pages that are left free
+	/// </remarks>
+	size_t Trim();
+
 	// ***NON-ATOMIC INTERFACE
 
 	// TODO: Implement non-atomic versions of the above functions for situations where we know the pool is being used in a serial manner
@@ -132,6 +479,30 @@ public:
 	/// </summary>
 	bool		Manages(const T* ptr) const;
 
+	/// <summary> 
+	///		Queries the index of an element within the storage of the pool, in [0, GetCapacity())
+	/// </summary>
+	/// <remarks>
+	///		The object must be managed by the pool or the function will fail. Indices are stable for the whole life of the pool, so
+	///		they can stand in for pointers where smaller references are needed (see cLockFreeSlotMap)
+	/// </remarks>
+	unsigned	GetElementIndex(const T* ptr) const;
+
+	/// <summary> 
+	///		Gets the element stored at some index of the pool, acquired or not
+	/// </summary>
+	T*			GetElement(unsigned index) const;
+
+	/// <summary> 
+	///		Releases every element of the pool at once, without destructing them, e.g. at the end of a frame whose elements are all dead
+	/// </summary>
+	/// <remarks>
+	///		Empties the freelist and starts carving elements from the start of the storage again, in constant time and with no atomic
+	///		read-modify-writes, instead of one CAS per element. No other thread can be using the pool meanwhile, and the elements
+	///		acquired so far must not be used afterwards. Trimmed spans are forgotten, and the occupancy bitmap is cleared
+	/// </remarks>
+	void		ReleaseAll();
+
 private:
 	static_assert(sizeof(T) >= sizeof(uint32_t), "Elements smaller than 4 bytes are not supported");
 	static_assert(std::is_same<typename tPoolAllocator::value_type, T>::value, "The tPoolAllocator type argument does not allocate elements of type T");
@@ -139,6 +510,9 @@ private:
 	typedef std::conditional_t<sizeof(T) >= sizeof(uint64_t), uint32_t, uint16_t> tIndex;
 	typedef tIndex tTag;
 
+	//-------------------------------------------------------------------------
+	enum { NULL_IDX = std::numeric_limits<tIndex>::max() };
+
 	//-------------------------------------------------------------------------
 	struct tIndexTag
 	{
@@ -169,8 +543,28 @@ private:
 		tIndexTag mNext;
 	};
 
+public:
 	//-------------------------------------------------------------------------
-	enum { NULL_IDX = std::numeric_limits<tIndex>::max() };
+	struct tReleaseBatch
+	{
+		tReleaseBatch()
+			: mFirst(NULL_IDX)
+			, mLast(NULL_IDX)
+			, mCount(0)
+		{}
+
+		unsigned GetCount() const { return mCount; }
+
+	private:
+		friend class cLockFreePool;
+
+		tIndex		mFirst;
+		tIndex		mLast;
+		unsigned	mCount;
+	};
+
+private:
+
 
 	//-------------------------------------------------------------------------
 	bool IsNull(tIndex index) const
@@ -191,16 +585,11 @@ private:
 	}
 
 	//-------------------------------------------------------------------------
-	void ReleaseAllPtrs()
+	tIndex GetIndex(const T* ptr) const
 	{
-		mHead.store(tIndexTag(NULL_IDX, 0), memory_order_relaxed);
-		for (int i = 0; i != mCapacity; ++i)
-		{
-			tNode* const node = GetNode(i);
-			node->mNext.mIdx = NULL_IDX;
-			node->mNext.mTag = 0;
-			ReleasePtr(mStorage + i);
-		}
+		const ptrdiff_t ptr_to_storage_diff = ptr - mStorage;
+		LF_assert((ptr_to_storage_diff >= 0) && (ptr_to_storage_diff < GetCapacity()), "Trying to release an object not managed by this pool!");
+		return static_cast<tIndex>(ptr_to_storage_diff);
 	}
 
 	//-------------------------------------------------------------------------
@@ -215,8 +604,10 @@ private:
 		static constexpr const unsigned max_capacity = std::numeric_limits<tIndex>::max() - 1;
 		mCapacity = (std::min)(requested_capacity, max_capacity);
 		mStorage = mAlloc.allocate(mCapacity);
+		mOccupancy.Allocate(mCapacity, mAlloc);
+		mTrimmedSpans.Allocate(mStorage, sizeof(T), mCapacity, mAlloc);
 
-		ReleaseAllPtrs();
+		ReleaseAll();
 	}
 
 	//-------------------------------------------------------------------------
@@ -228,7 +619,8 @@ private:
 		{
 			if (IsNull(head_tmp.mIdx))
 			{
-				return NULL_IDX;
+				const tIndex revived = ReviveTrimmedSpan();
+				return IsNull(revived) ? CarveIdx() : revived;
 			}
 
 			const tNode* const node = GetNode(head_tmp.mIdx);
@@ -257,14 +649,88 @@ private:
 		do
 		{
 			node->mNext.mIdx = head_tmp.mIdx;
-		} while (!mHead.compare_exchange_weak(head_tmp, tIndexTag(index, head_tmp.mTag), memory_order_acq_rel, memory_order_acquire));
+		} while (!mHead.compare_exchange_weak(head_tmp, tIndexTag(index, head_tmp.mTag), memory_order_seq_cst, memory_order_acquire));
+
+		// The seq_cst CAS orders the release before the check for waiters, no fence needed (and no extra cost on x86)
+		mReleaseEvent.NotifyOneAfterSeqCst();
+	}
+
+	//-------------------------------------------------------------------------
+	// Splices a chain of free elements, linked through their nodes, in front of the freelist
+	void ReleaseChain(tIndex first, tIndex last, unsigned count)
+	{
+		tNode* const last_node = GetNode(last);
+
+		tIndexTag head_tmp = mHead.load(memory_order_relaxed);
+
+		do
+		{
+			last_node->mNext.mIdx = head_tmp.mIdx;
+		} while (!mHead.compare_exchange_weak(head_tmp, tIndexTag(first, head_tmp.mTag), memory_order_seq_cst, memory_order_acquire));
+
+		if (count > 1)
+		{
+			mReleaseEvent.NotifyAllAfterSeqCst();
+		}
+		else
+		{
+			mReleaseEvent.NotifyOneAfterSeqCst();
+		}
 	}
 
+	//-------------------------------------------------------------------------
+	// Out of free elements: hands out the first element that was never acquired, if any
+	tIndex CarveIdx()
+	{
+		// Never touched by anybody, nothing to synchronize with
+		unsigned num_carved = mNumCarved.load(memory_order_relaxed);
+		while (num_carved < mCapacity)
+		{
+			if (mNumCarved.compare_exchange_weak(num_carved, num_carved + 1, memory_order_relaxed, memory_order_relaxed))
+			{
+				return static_cast<tIndex>(num_carved);
+			}
+		}
+		return NULL_IDX;
+	}
+
+	//-------------------------------------------------------------------------
+	// Out of free elements: brings a trimmed span back, if any. Its first element goes to the caller, the rest to the freelist
+	tIndex ReviveTrimmedSpan()
+	{
+		const unsigned span = mTrimmedSpans.Claim();
+		if (span == tTrimmedSpans::NONE)
+		{
+			return NULL_IDX;
+		}
+
+		// Its pages come back zeroed (or undefined), the nodes need to be linked again
+		const tIndex first = static_cast<tIndex>(mTrimmedSpans.GetFirstElement(span));
+		const tIndex last = static_cast<tIndex>(first + mTrimmedSpans.GetSpanElements() - 1);
+		if (last != first)
+		{
+			for (tIndex idx = first + 1; idx != last; ++idx)
+			{
+				GetNode(idx)->mNext.mIdx = idx + 1;
+			}
+			ReleaseChain(first + 1, last, last - first);
+		}
+		return first;
+	}
+
+	//-------------------------------------------------------------------------
+	typedef detail::cPoolOccupancy<TRACKS_OCCUPANCY, tPoolAllocator> tOccupancy;
+	typedef detail::cPoolTrimmedSpans<IS_TRIMMABLE, tPoolAllocator> tTrimmedSpans;
+
 	//-------------------------------------------------------------------------
 	atomic<tIndexTag>	mHead;
+	atomic<unsigned>	mNumCarved;		// Elements from here on were never acquired, and are not in the freelist
 	unsigned int		mCapacity;
 	tPoolAllocator		mAlloc;
 	T*					mStorage;
+	cEventCount			mReleaseEvent;
+	tOccupancy			mOccupancy;
+	tTrimmedSpans		mTrimmedSpans;
 };   
 
 #include "lockfree_pool.inl"
@@ -1,7 +1,8 @@
 //-------------------------------------------------------------------------
-template<class T, class tPoolAllocator>
-cLockFreePool<T, tPoolAllocator>::cLockFreePool(unsigned n, tPoolAllocator&& allocator)
+template<class T, class tPoolAllocator, unsigned flags>
+cLockFreePool<T, tPoolAllocator, flags>::cLockFreePool(unsigned n, tPoolAllocator&& allocator)
 	: mHead(tIndexTag(NULL_IDX, 0))
+	, mNumCarved(0)
 	, mCapacity(0)
 	, mAlloc(move(allocator))
 	, mStorage(nullptr)
@@ -10,52 +11,57 @@ cLockFreePool<T, tPoolAllocator>::cLockFreePool(unsigned n, tPoolAllocator&& all
 }
 
 //-------------------------------------------------------------------------
-template<class T, class tPoolAllocator>
-cLockFreePool<T, tPoolAllocator>::cLockFreePool(unsigned n, const tPoolAllocator& allocator = tPoolAllocator()) : cLockFreePool(n, tPoolAllocator(allocator)) {}
+template<class T, class tPoolAllocator, unsigned flags>
+cLockFreePool<T, tPoolAllocator, flags>::cLockFreePool(unsigned n, const tPoolAllocator& allocator) : cLockFreePool(n, tPoolAllocator(allocator)) {}
 
 //-------------------------------------------------------------------------
-template<class T, class tPoolAllocator>
-cLockFreePool<T, tPoolAllocator>::cLockFreePool(cLockFreePool&& rhs)
+template<class T, class tPoolAllocator, unsigned flags>
+cLockFreePool<T, tPoolAllocator, flags>::cLockFreePool(cLockFreePool&& rhs)
 {
 	*this = move(rhs);
 }
 
 //-------------------------------------------------------------------------
-template<class T, class tPoolAllocator>
-auto cLockFreePool<T, tPoolAllocator>::operator=(cLockFreePool&& rhs) -> cLockFreePool&
+template<class T, class tPoolAllocator, unsigned flags>
+auto cLockFreePool<T, tPoolAllocator, flags>::operator=(cLockFreePool&& rhs) -> cLockFreePool&
 {
 	mHead = rhs.mHead.exchange(tIndexTag(NULL_IDX, 0), memory_order_relaxed);
+	mNumCarved = rhs.mNumCarved.exchange(0, memory_order_relaxed);
 	mCapacity = exchange(rhs.mCapacity, 0);
 	mAlloc = move(rhs.mAlloc);
 	mStorage = exchange(rhs.mStorage, nullptr);
+	mOccupancy = move(rhs.mOccupancy);
+	mTrimmedSpans = move(rhs.mTrimmedSpans);
 
 	return *this;
 }
 
 //-------------------------------------------------------------------------
-template<class T, class tPoolAllocator>
-cLockFreePool<T, tPoolAllocator>::~cLockFreePool()
+template<class T, class tPoolAllocator, unsigned flags>
+cLockFreePool<T, tPoolAllocator, flags>::~cLockFreePool()
 {
+	mTrimmedSpans.Deallocate(mAlloc);
+	mOccupancy.Deallocate(mAlloc);
 	mAlloc.deallocate(mStorage, mCapacity);
 }
 
 //-------------------------------------------------------------------------
-template<class T, class tPoolAllocator>
-bool cLockFreePool<T, tPoolAllocator>::Empty() const
+template<class T, class tPoolAllocator, unsigned flags>
+bool cLockFreePool<T, tPoolAllocator, flags>::Empty() const
 {
-	return IsNull(mHead.load(memory_order_relaxed).mIdx);
+	return IsNull(mHead.load(memory_order_relaxed).mIdx) && (mTrimmedSpans.GetNumTrimmed() == 0) && (mNumCarved.load(memory_order_relaxed) == mCapacity);
 }
 
 //-------------------------------------------------------------------------
-template<class T, class tPoolAllocator>
-unsigned cLockFreePool<T, tPoolAllocator>::GetCapacity() const
+template<class T, class tPoolAllocator, unsigned flags>
+unsigned cLockFreePool<T, tPoolAllocator, flags>::GetCapacity() const
 {
 	return mCapacity;
 }
 
 //-------------------------------------------------------------------------
-template<class T, class tPoolAllocator>
-T* cLockFreePool<T, tPoolAllocator>::AcquirePtr()
+template<class T, class tPoolAllocator, unsigned flags>
+T* cLockFreePool<T, tPoolAllocator, flags>::AcquirePtr()
 {
 	T* ptr = nullptr;
 
@@ -63,58 +69,233 @@ T* cLockFreePool<T, tPoolAllocator>::AcquirePtr()
 	if (idx != NULL_IDX)
 	{
 		ptr = mStorage + idx;
+		mOccupancy.Set(idx);
 	}
 
 	return ptr;
 }
 
 //-------------------------------------------------------------------------
-template<class T, class tPoolAllocator>
+template<class T, class tPoolAllocator, unsigned flags>
 template <typename... Args>
-T* cLockFreePool<T, tPoolAllocator>::Acquire(Args&&... args)
+T* cLockFreePool<T, tPoolAllocator, flags>::Acquire(Args&&... args)
 {
-	T* const ptr = AcquirePtr();
-	if (ptr)
+	T* ptr = nullptr;
+
+	const tIndex idx = AcquireIdx();
+	if (idx != NULL_IDX)
 	{
+		ptr = mStorage + idx;
 		new (ptr) T(forward<Args>(args)...);
+		mOccupancy.Set(idx);
 	}
+
 	return ptr;
 }
 
 //-------------------------------------------------------------------------
-template<class T, class tPoolAllocator>
-void cLockFreePool<T, tPoolAllocator>::ReleasePtr(const T* ptr)
+template<class T, class tPoolAllocator, unsigned flags>
+T* cLockFreePool<T, tPoolAllocator, flags>::AcquirePtrWait()
 {
-	const ptrdiff_t ptr_to_storage_diff = ptr - mStorage;
-	LF_assert((ptr_to_storage_diff >= 0) && (ptr_to_storage_diff < GetCapacity()), "Trying to release an object not managed by this pool!");
-	const tIndex idx = static_cast<tIndex>(ptr_to_storage_diff);
+	T* ptr = nullptr;
+	AwaitRelease([this, &ptr] { return (ptr = AcquirePtr()) != nullptr; });
+	return ptr;
+}
+
+//-------------------------------------------------------------------------
+template<class T, class tPoolAllocator, unsigned flags>
+template <class Rep, class Period>
+T* cLockFreePool<T, tPoolAllocator, flags>::AcquirePtrFor(const std::chrono::duration<Rep, Period>& timeout)
+{
+	T* ptr = nullptr;
+	AwaitReleaseFor([this, &ptr] { return (ptr = AcquirePtr()) != nullptr; }, timeout);
+	return ptr;
+}
+
+//-------------------------------------------------------------------------
+template<class T, class tPoolAllocator, unsigned flags>
+template <typename Fnc>
+void cLockFreePool<T, tPoolAllocator, flags>::AwaitRelease(Fnc&& try_fnc)
+{
+	mReleaseEvent.Await(forward<Fnc>(try_fnc));
+}
+
+//-------------------------------------------------------------------------
+template<class T, class tPoolAllocator, unsigned flags>
+template <typename Fnc, class Rep, class Period>
+bool cLockFreePool<T, tPoolAllocator, flags>::AwaitReleaseFor(Fnc&& try_fnc, const std::chrono::duration<Rep, Period>& timeout)
+{
+	return mReleaseEvent.AwaitFor(forward<Fnc>(try_fnc), timeout);
+}
+
+//-------------------------------------------------------------------------
+template<class T, class tPoolAllocator, unsigned flags>
+void cLockFreePool<T, tPoolAllocator, flags>::ReleasePtr(const T* ptr)
+{
+	const tIndex idx = GetIndex(ptr);
+	mOccupancy.Clear(idx);
 	ReleaseIdx(idx);
 }
 
 //-------------------------------------------------------------------------
-template<class T, class tPoolAllocator>
-void cLockFreePool<T, tPoolAllocator>::Release(T const* ptr)
+template<class T, class tPoolAllocator, unsigned flags>
+void cLockFreePool<T, tPoolAllocator, flags>::Release(T const* ptr)
 {
+	const tIndex idx = GetIndex(ptr);
+	mOccupancy.Clear(idx);
 	if (!std::is_trivially_destructible<T>::value && ptr)
 	{
 		ptr->~T();
 	}
-	ReleasePtr(ptr);
+	ReleaseIdx(idx);
 }
 
 //-------------------------------------------------------------------------
-template<class T, class tPoolAllocator>
-void cLockFreePool<T, tPoolAllocator>::Release(T& element)
+template<class T, class tPoolAllocator, unsigned flags>
+void cLockFreePool<T, tPoolAllocator, flags>::Release(T& element)
 {
 	Release(&element);
 }
 
 //-------------------------------------------------------------------------
-template<class T, class tPoolAllocator>
-bool cLockFreePool<T, tPoolAllocator>::Full() const
+template<class T, class tPoolAllocator, unsigned flags>
+void cLockFreePool<T, tPoolAllocator, flags>::BatchReleasePtr(tReleaseBatch& batch, const T* ptr)
+{
+	const tIndex idx = GetIndex(ptr);
+
+	// Link it at the front of the batch (the batch is local, no need for atomics here)
+	GetNode(idx)->mNext.mIdx = batch.mFirst;
+	batch.mFirst = idx;
+	if (IsNull(batch.mLast))
+	{
+		batch.mLast = idx;
+	}
+	++batch.mCount;
+}
+
+//-------------------------------------------------------------------------
+template<class T, class tPoolAllocator, unsigned flags>
+void cLockFreePool<T, tPoolAllocator, flags>::ReleaseBatch(tReleaseBatch& batch)
 {
+	if (IsNull(batch.mFirst))
+	{
+		return;
+	}
+
+	if (TRACKS_OCCUPANCY)
+	{
+		for (tIndex idx = batch.mFirst; idx != batch.mLast; idx = GetNode(idx)->mNext.mIdx)
+		{
+			mOccupancy.Clear(idx);
+		}
+		mOccupancy.Clear(batch.mLast);
+	}
+
+	// Same as ReleaseIdx, but splicing the whole chain in front of the freelist
+	ReleaseChain(batch.mFirst, batch.mLast, batch.mCount);
+
+	batch = tReleaseBatch();
+}
+
+//-------------------------------------------------------------------------
+template<class T, class tPoolAllocator, unsigned flags>
+size_t cLockFreePool<T, tPoolAllocator, flags>::Trim()
+{
+	static_assert(IS_TRIMMABLE, "Trim needs LFPF_TRIMMABLE");
+
+	// Take the whole freelist, so nobody else touches the free elements while we look at them
+	tIndexTag head_tmp = mHead.load(memory_order_relaxed);
+	while (!mHead.compare_exchange_weak(head_tmp, tIndexTag(NULL_IDX, head_tmp.mTag + 1), memory_order_acq_rel, memory_order_acquire))
+	{
+	}
+
+	// And the elements not carved yet, whose pages may still be in use from before a ReleaseAll. Whatever of them doesn't get trimmed
+	// ends up in the freelist
+	const unsigned num_carved = mNumCarved.exchange(mCapacity, memory_order_relaxed);
+	if (IsNull(head_tmp.mIdx) && (num_carved == mCapacity))
+	{
+		return 0;
+	}
+
+	// Which elements are free, one bit each
+	typedef typename std::allocator_traits<tPoolAllocator>::template rebind_alloc<uint64_t> tWordAllocator;
+	tWordAllocator word_allocator(mAlloc);
+	const unsigned num_words = (mCapacity + 63) / 64;
+	uint64_t* const free_words = word_allocator.allocate(num_words);
+	std::fill(free_words, free_words + num_words, uint64_t(0));
+	for (tIndex idx = head_tmp.mIdx; !IsNull(idx); idx = GetNode(idx)->mNext.mIdx)
+	{
+		free_words[idx / 64] |= uint64_t(1) << (idx % 64);
+	}
+	for (unsigned idx = num_carved; idx != mCapacity; ++idx)
+	{
+		free_words[idx / 64] |= uint64_t(1) << (idx % 64);
+	}
+
+	const auto is_free = [free_words](unsigned idx) { return (free_words[idx / 64] & (uint64_t(1) << (idx % 64))) != 0; };
+
+	// Spans with all their elements free go back to the OS, and stay out of the freelist
+	size_t trimmed_bytes = 0;
+	for (unsigned span = 0; span != mTrimmedSpans.GetNumSpans(); ++span)
+	{
+		const unsigned first = mTrimmedSpans.GetFirstElement(span);
+		const unsigned end = first + mTrimmedSpans.GetSpanElements();
+
+		unsigned idx = first;
+		while ((idx != end) && is_free(idx))
+		{
+			++idx;
+		}
+
+		if ((idx == end) && vm::DiscardPages(mStorage + first, mTrimmedSpans.GetSpanSize()))
+		{
+			for (idx = first; idx != end; ++idx)
+			{
+				free_words[idx / 64] &= ~(uint64_t(1) << (idx % 64));
+			}
+			mTrimmedSpans.Mark(span);
+			trimmed_bytes += mTrimmedSpans.GetSpanSize();
+		}
+	}
+
+	// The rest go back to the freelist, in address order
+	tIndex first = NULL_IDX;
+	tIndex last = NULL_IDX;
+	unsigned count = 0;
+	for (unsigned word_idx = 0; word_idx != num_words; ++word_idx)
+	{
+		for (uint64_t word = free_words[word_idx]; word != 0; word &= word - 1)
+		{
+			const tIndex idx = static_cast<tIndex>(word_idx * 64 + detail::LowestBitIndex(word));
+			if (IsNull(last))
+			{
+				first = idx;
+			}
+			else
+			{
+				GetNode(last)->mNext.mIdx = idx;
+			}
+			last = idx;
+			++count;
+		}
+	}
+	word_allocator.deallocate(free_words, num_words);
+
+	if (count != 0)
+	{
+		ReleaseChain(first, last, count);
+	}
+	return trimmed_bytes;
+}
+
+//-------------------------------------------------------------------------
+template<class T, class tPoolAllocator, unsigned flags>
+bool cLockFreePool<T, tPoolAllocator, flags>::Full() const
+{
+	// Trimmed elements and the ones not carved yet are free too, they are just held out of the freelist
 	tIndexTag cur = mHead.load(memory_order_relaxed);
-	for (unsigned int i = 0; i != mCapacity; ++i)
+	const unsigned num_held_out = mTrimmedSpans.GetNumTrimmed() * mTrimmedSpans.GetSpanElements() + (mCapacity - mNumCarved.load(memory_order_relaxed));
+	for (unsigned int i = num_held_out; i != mCapacity; ++i)
 	{
 		if (IsNull(cur.mIdx))
 		{
@@ -126,8 +307,84 @@ bool cLockFreePool<T, tPoolAllocator>::Full() const
 }
 
 //-------------------------------------------------------------------------
-template<class T, class tPoolAllocator>
-bool cLockFreePool<T, tPoolAllocator>::Manages(const T* ptr) const
+template<class T, class tPoolAllocator, unsigned flags>
+bool cLockFreePool<T, tPoolAllocator, flags>::Manages(const T* ptr) const
 {
 	return (ptr >= mStorage) && (ptr < (mStorage + mCapacity));
 }
+
+//-------------------------------------------------------------------------
+template<class T, class tPoolAllocator, unsigned flags>
+unsigned cLockFreePool<T, tPoolAllocator, flags>::GetElementIndex(const T* ptr) const
+{
+	return GetIndex(ptr);
+}
+
+//-------------------------------------------------------------------------
+template<class T, class tPoolAllocator, unsigned flags>
+T* cLockFreePool<T, tPoolAllocator, flags>::GetElement(unsigned index) const
+{
+	LF_assert(index < mCapacity, "Index out of the storage of the pool");
+	return mStorage + index;
+}
+
+//-------------------------------------------------------------------------
+template<class T, class tPoolAllocator, unsigned flags>
+void cLockFreePool<T, tPoolAllocator, flags>::ReleaseAll()
+{
+	mOccupancy.Reset();
+	mTrimmedSpans.Reset();
+
+	// Nothing to link, every element goes back to being carved when first needed
+	mNumCarved.store(0, memory_order_relaxed);
+	const tIndexTag head_tmp = mHead.load(memory_order_relaxed);
+	mHead.store(tIndexTag(NULL_IDX, head_tmp.mTag + 1), memory_order_release);
+	mReleaseEvent.NotifyAll();
+}
+
+//-------------------------------------------------------------------------
+template<class T, class tPoolAllocator, unsigned flags>
+template <typename Fnc>
+unsigned cLockFreePool<T, tPoolAllocator, flags>::ForEachLive(Fnc&& fnc)
+{
+	return ForEachLiveInRange(0, mCapacity, forward<Fnc>(fnc));
+}
+
+//-------------------------------------------------------------------------
+template<class T, class tPoolAllocator, unsigned flags>
+template <typename Fnc>
+unsigned cLockFreePool<T, tPoolAllocator, flags>::ForEachLiveInRange(unsigned begin, unsigned end, Fnc&& fnc)
+{
+	static_assert(TRACKS_OCCUPANCY, "Iterating the elements of a pool needs LFPF_TRACK_OCCUPANCY");
+
+	end = (std::min)(end, mCapacity);
+	if (begin >= end)
+	{
+		return 0;
+	}
+
+	// Word by word, skipping the bits outside the range in the first and last ones. Free elements cost one bit each, whole empty words
+	// are skipped with a single compare
+	unsigned num_visited = 0;
+	const unsigned last_word_idx = (end - 1) / OCCUPANCY_WORD_BITS;
+	for (unsigned word_idx = begin / OCCUPANCY_WORD_BITS; word_idx <= last_word_idx; ++word_idx)
+	{
+		uint64_t word = mOccupancy.GetWord(word_idx);
+		if (word_idx == begin / OCCUPANCY_WORD_BITS)
+		{
+			word &= ~uint64_t(0) << (begin % OCCUPANCY_WORD_BITS);
+		}
+		if ((word_idx == last_word_idx) && (end % OCCUPANCY_WORD_BITS))
+		{
+			word &= ~(~uint64_t(0) << (end % OCCUPANCY_WORD_BITS));
+		}
+
+		for (; word != 0; word &= word - 1)
+		{
+			fnc(mStorage[word_idx * OCCUPANCY_WORD_BITS + detail::LowestBitIndex(word)]);
+			++num_visited;
+		}
+	}
+
+	return num_visited;
+}
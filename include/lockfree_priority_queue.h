@@ -0,0 +1,152 @@
+///////////////////////////////////////////////////////////////////////////
+//
+//lockfree_priority_queue.h
+//
+/////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "atomic_defs.h"
+#include "epoch.h"
+#include "lockfree_pool.h"
+#include "skiplist_node_pools.h"
+#include "utils.h"
+#include "debug.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+namespace lockfree {
+
+	namespace detail
+	{
+		template <typename T, typename tPriority>
+		struct tSkipListNode;
+	}
+
+/// <summary>
+///     Lockfree implementation of a MPMC (Multiple Producers-Multiple Consumers) priority queue, based on a skiplist with batched deletion
+///		of the minimum ("A Skiplist-Based Concurrent Priority Queue with Minimal Memory Contention", Lindén, Jonsson 2013).
+///		Elements are popped in increasing order of priority (PopMin pops the element with the lowest priority value).
+///
+///		Consumers claim the first element not yet deleted by setting a mark on the lowest-level link pointing to it (one fetch_or), so
+///		deleted elements form a prefix of the list. That prefix is only unlinked once it is longer than BOUND_OFFSET nodes, with a single CAS
+///		on the head, which keeps consumers off each other's cache lines most of the time.
+///
+///		Pros:
+///		- Producers only contend with producers inserting right next to them
+///		- Consumers only need one fetch_or per Pop in the common case
+///		- Zero-allocation: tower nodes come from pools, one per size class of tower heights (1, 2, 4, 8 and 16 levels), owned by the queue
+///
+///     Cons:
+///		- Popped nodes are given back to the pools through epoch-based reclamation (see cEpochDomain), so Push can fail before the queue
+///		  holds as many elements as its capacity if some thread stays too long inside an operation
+///		- Elements with the same priority come out in no particular order
+///		- Consumers walk the deleted prefix, so Pop is O(BOUND_OFFSET) rather than O(1)
+///
+///		Requirements for T:
+///		- T needs to support move or copy construction. tPriority needs operator&lt;, copy construction and a trivial destructor
+/// </summary>
+template <typename T, typename tPriority = uint64_t, class Allocator = std::allocator<T>>
+class cLockFreePriorityQueue
+{
+	// Other threads keep comparing against the priority of nodes already popped, until they are reclaimed
+	static_assert(std::is_trivially_destructible<tPriority>::value, "tPriority needs to be trivially destructible");
+
+public:
+	typedef T			tValueType;
+	typedef tPriority	tPriorityType;
+	typedef Allocator	tAllocatorType;
+
+	static constexpr const unsigned MAX_HEIGHT = detail::SKIPLIST_MAX_HEIGHT;
+
+	// ***ATOMIC INTERFACE
+
+	/// <summary>
+	///		Pushes a new object with the priority passed
+	/// </summary>
+	/// <return>
+	///		Returns true if object has been pushed successfully. False when an error occurs (like the pools being full, for example)
+	/// </return>
+	/// <remarks>
+	///		The object will be emplaced with the variadic arguments passed. An empty argument list will push a default-constructed item
+	/// </remarks>
+	template <typename... Args>
+	bool Push(const tPriority& priority, Args&&... args);
+
+	/// <summary>
+	///		Pops the element with the lowest priority
+	/// </summary>
+	/// <param name="result">
+	///     (Out) the pop element will be moved to this argument if pop succeeds
+	/// </param>
+	/// <return>
+	///		Returns true if the queue was not empty and an element could be pop. False otherwise.
+	/// </return>
+	bool PopMin(T& result);
+
+	/// <summary>
+	///		Same as PopMin(T&amp;), returning the priority of the element pop as well
+	/// </summary>
+	bool PopMin(T& result, tPriority& priority);
+
+	/// <summary>
+	///		Pops the element with the lowest priority, handing it in place to fnc(const tPriority&amp;, T&amp;) instead of moving it out
+	/// </summary>
+	template <typename Fnc>
+	bool PopMinWith(Fnc&& fnc);
+
+	/// <summary>
+	///		Queries if the queue is empty
+	/// </summary>
+	/// <remarks>
+	///		Only a hint in a multithreaded environment, by the time you act on something that was "empty" it could be non-empty already
+	/// </remarks>
+	bool Empty();
+
+	// ***NON-ATOMIC INTERFACE
+
+	/// <param name="capacity">
+	///		Number of elements the queue can hold. Split among the pools of the different size classes following the expected distribution
+	///		of tower heights
+	/// </param>
+	cLockFreePriorityQueue(unsigned capacity, const Allocator& allocator = Allocator());
+	~cLockFreePriorityQueue();
+
+private:
+	cLockFreePriorityQueue(const cLockFreePriorityQueue&) = delete;
+	cLockFreePriorityQueue& operator=(const cLockFreePriorityQueue&) = delete;
+
+	typedef detail::tSkipListNode<T, tPriority>	tNode;
+	typedef atomic<uintptr_t>					tLink;
+
+	static constexpr const unsigned NUM_SIZE_CLASSES = detail::SKIPLIST_NUM_SIZE_CLASSES;
+
+	// Number of deleted nodes at the front of the list before the consumer that finds them unlinks them
+	static constexpr const unsigned BOUND_OFFSET = 32;
+
+	// Set on a link, it flags the node it points to as deleted. Only used on the lowest level
+	static constexpr const uintptr_t DELETED_MARK = 1;
+
+	typedef detail::cSkipListNodePools<tNode, NUM_SIZE_CLASSES, Allocator> tNodePools;
+
+	static tNode* GetPtr(uintptr_t link) { return reinterpret_cast<tNode*>(link & ~DELETED_MARK); }
+	static bool IsMarked(uintptr_t link) { return (link & DELETED_MARK) != 0; }
+	static uintptr_t ToLink(tNode* node) { return reinterpret_cast<uintptr_t>(node); }
+
+	static void ReclaimNode(tEpochNode* node, void* queue);
+
+	void		Insert(tNode* node);
+	tNode*		LocatePreds(const tPriority& priority, tNode** preds, tNode** succs);
+	void		Restructure();
+
+	tNodePools		mPools;
+	cEpochDomain	mEpochDomain;	// after the pools, it gives nodes back to them on destruction
+	tNode*			mHead;			// sentinel with MAX_HEIGHT links, never deleted
+	_if_diagnosing(atomic<unsigned> mCount;)
+};
+
+#include "lockfree_priority_queue.inl"
+
+}
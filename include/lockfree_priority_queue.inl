@@ -0,0 +1,320 @@
+namespace detail
+{
+	//----------------------------------------------------------------------------
+	// Node header. Its links (as many as its height) are allocated right after it
+	template <typename T, typename tPriority>
+	struct tSkipListNode
+	{
+		typedef uintptr_t			tLinkValue;
+		typedef atomic<tLinkValue>	tLink;
+
+		tLink* GetLinks() { return reinterpret_cast<tLink*>(this + 1); }
+		T& GetData() { return reinterpret_cast<T&>(mData); }
+
+		static tSkipListNode* FromEpochNode(tEpochNode* node) { return reinterpret_cast<tSkipListNode*>(node); }
+
+		tEpochNode			mEpochNode;		// needs to be the first member, see FromEpochNode
+		tPriority			mPriority;
+		tAlignedStorage<T>	mData;
+		atomic<bool>		mInserting;		// set while the upper levels are being linked, so the node is not reclaimed under our feet
+		uint8_t				mHeight;
+		uint8_t				mSizeClass;
+	};
+}
+
+//----------------------------------------------------------------------------
+template <typename T, typename tPriority, class Allocator>
+cLockFreePriorityQueue<T, tPriority, Allocator>::cLockFreePriorityQueue(unsigned capacity, const Allocator& allocator)
+	: mPools(detail::GetSkipListClassCapacities(capacity).data(), allocator)
+	, mEpochDomain(&ReclaimNode, this)
+	, mHead(nullptr)
+{
+	_if_diagnosing(mCount.store(0, memory_order_relaxed);)
+
+	mHead = mPools.Acquire(NUM_SIZE_CLASSES - 1);
+	LF_assert(mHead, "The last size class should always have room for the head");
+
+	new (&mHead->mPriority) tPriority();
+	new (&mHead->mInserting) atomic<bool>(false);
+	mHead->mHeight = MAX_HEIGHT;
+	mHead->mSizeClass = NUM_SIZE_CLASSES - 1;
+	for (unsigned level = 0; level != MAX_HEIGHT; ++level)
+	{
+		new (&mHead->GetLinks()[level]) tLink(0);
+	}
+}
+
+//----------------------------------------------------------------------------
+template <typename T, typename tPriority, class Allocator>
+cLockFreePriorityQueue<T, tPriority, Allocator>::~cLockFreePriorityQueue()
+{
+	// Nodes still linked (popped or not) go away with the pools, only the elements not popped need destroying
+	while (PopMinWith([](const tPriority&, T&) {}))
+	{
+	}
+}
+
+//----------------------------------------------------------------------------
+template <typename T, typename tPriority, class Allocator>
+template <typename... Args>
+bool cLockFreePriorityQueue<T, tPriority, Allocator>::Push(const tPriority& priority, Args&&... args)
+{
+	const unsigned height = detail::RandomSkipListHeight();
+
+	tNode* node = detail::AllocateSkipListNode(mPools, height);
+	if (!node)
+	{
+		// Some of the nodes could be waiting to be reclaimed by this thread
+		mEpochDomain.Reclaim();
+		node = detail::AllocateSkipListNode(mPools, height);
+		if (!node)
+		{
+			return false;
+		}
+	}
+
+	new (&node->mPriority) tPriority(priority);
+	new (&node->mData) T(forward<Args>(args)...);
+	new (&node->mInserting) atomic<bool>(true);
+
+	{
+		cEpochDomain::cGuard guard(mEpochDomain);
+		Insert(node);
+	}
+
+	_if_diagnosing(mCount.fetch_add(1, memory_order_relaxed);)
+
+	return true;
+}
+
+//----------------------------------------------------------------------------
+template <typename T, typename tPriority, class Allocator>
+bool cLockFreePriorityQueue<T, tPriority, Allocator>::PopMin(T& result)
+{
+	return PopMinWith([&result](const tPriority&, T& data) { result = move(data); });
+}
+
+//----------------------------------------------------------------------------
+template <typename T, typename tPriority, class Allocator>
+bool cLockFreePriorityQueue<T, tPriority, Allocator>::PopMin(T& result, tPriority& priority)
+{
+	return PopMinWith([&result, &priority](const tPriority& node_priority, T& data)
+	{
+		priority = node_priority;
+		result = move(data);
+	});
+}
+
+//----------------------------------------------------------------------------
+template <typename T, typename tPriority, class Allocator>
+template <typename Fnc>
+bool cLockFreePriorityQueue<T, tPriority, Allocator>::PopMinWith(Fnc&& fnc)
+{
+	cEpochDomain::cGuard guard(mEpochDomain);
+
+	const uintptr_t observed_head_link = mHead->GetLinks()[0].load(memory_order_acquire);
+
+	// Walk the deleted prefix, marking links until we mark one that wasn't marked yet: the node it points to is ours
+	tNode* node = mHead;
+	tNode* new_first = nullptr;
+	unsigned offset = 0;
+	uintptr_t next_link = 0;
+	do
+	{
+		next_link = node->GetLinks()[0].load(memory_order_acquire);
+		if (!GetPtr(next_link))
+		{
+			return false;
+		}
+
+		// Nodes from the first one still being inserted on can't be reclaimed yet
+		if (!new_first && node->mInserting.load(memory_order_acquire))
+		{
+			new_first = node;
+		}
+
+		next_link = node->GetLinks()[0].fetch_or(DELETED_MARK, memory_order_acq_rel);
+		++offset;
+		node = GetPtr(next_link);
+	}
+	while (IsMarked(next_link));
+
+	fnc(node->mPriority, node->GetData());
+	node->GetData().~T();
+
+	_if_diagnosing(mCount.fetch_sub(1, memory_order_relaxed);)
+
+	if (!new_first)
+	{
+		new_first = node;
+	}
+
+	// Unlink the deleted prefix once it gets too long. Only one consumer can succeed for a given head
+	if ((offset >= BOUND_OFFSET) && (mHead->GetLinks()[0].load(memory_order_relaxed) == observed_head_link))
+	{
+		uintptr_t expected = observed_head_link;
+		if (mHead->GetLinks()[0].compare_exchange_strong(expected, ToLink(new_first) | DELETED_MARK, memory_order_acq_rel, memory_order_relaxed))
+		{
+			Restructure();
+
+			tNode* unlinked = GetPtr(observed_head_link);
+			while (unlinked != new_first)
+			{
+				tNode* const next = GetPtr(unlinked->GetLinks()[0].load(memory_order_relaxed));
+				mEpochDomain.Retire(&unlinked->mEpochNode);
+				unlinked = next;
+			}
+		}
+	}
+
+	return true;
+}
+
+//----------------------------------------------------------------------------
+template <typename T, typename tPriority, class Allocator>
+bool cLockFreePriorityQueue<T, tPriority, Allocator>::Empty()
+{
+	cEpochDomain::cGuard guard(mEpochDomain);
+
+	tNode* node = mHead;
+	for (;;)
+	{
+		const uintptr_t next_link = node->GetLinks()[0].load(memory_order_acquire);
+		if (!GetPtr(next_link))
+		{
+			return true;
+		}
+		else if (!IsMarked(next_link))
+		{
+			return false;
+		}
+		node = GetPtr(next_link);
+	}
+}
+
+//----------------------------------------------------------------------------
+template <typename T, typename tPriority, class Allocator>
+void cLockFreePriorityQueue<T, tPriority, Allocator>::ReclaimNode(tEpochNode* epoch_node, void* queue)
+{
+	tNode* const node = tNode::FromEpochNode(epoch_node);
+	static_cast<cLockFreePriorityQueue*>(queue)->mPools.Release(node->mSizeClass, node);
+}
+
+//----------------------------------------------------------------------------
+template <typename T, typename tPriority, class Allocator>
+void cLockFreePriorityQueue<T, tPriority, Allocator>::Insert(tNode* node)
+{
+	tNode* preds[MAX_HEIGHT];
+	tNode* succs[MAX_HEIGHT];
+	tLink* const links = node->GetLinks();
+
+	// The node is in the queue as soon as it is linked on the lowest level
+	tNode* deleted = nullptr;
+	for (;;)
+	{
+		deleted = LocatePreds(node->mPriority, preds, succs);
+		links[0].store(ToLink(succs[0]), memory_order_relaxed);
+
+		uintptr_t expected = ToLink(succs[0]);
+		if (preds[0]->GetLinks()[0].compare_exchange_strong(expected, ToLink(node), memory_order_release, memory_order_relaxed))
+		{
+			break;
+		}
+	}
+
+	// Upper levels are only shortcuts. Give up on them if the node or its successor get deleted meanwhile
+	for (unsigned level = 1; level < node->mHeight; )
+	{
+		links[level].store(ToLink(succs[level]), memory_order_relaxed);
+
+		if (IsMarked(links[0].load(memory_order_acquire))
+			|| (succs[level] && IsMarked(succs[level]->GetLinks()[0].load(memory_order_acquire)))
+			|| (deleted && (deleted == succs[level])))
+		{
+			break;
+		}
+
+		uintptr_t expected = ToLink(succs[level]);
+		if (preds[level]->GetLinks()[level].compare_exchange_strong(expected, ToLink(node), memory_order_release, memory_order_relaxed))
+		{
+			++level;
+		}
+		else
+		{
+			deleted = LocatePreds(node->mPriority, preds, succs);
+			if (succs[0] != node)
+			{
+				break;
+			}
+		}
+	}
+
+	node->mInserting.store(false, memory_order_release);
+}
+
+//----------------------------------------------------------------------------
+template <typename T, typename tPriority, class Allocator>
+auto cLockFreePriorityQueue<T, tPriority, Allocator>::LocatePreds(const tPriority& priority, tNode** preds, tNode** succs) -> tNode*
+{
+	// Finds, on every level, the last node with lower priority that is not deleted, and its successor. Returns the last deleted node
+	// found on the lowest level
+	tNode* pred = mHead;
+	tNode* deleted = nullptr;
+	for (unsigned level = MAX_HEIGHT; level-- != 0; )
+	{
+		uintptr_t next_link = pred->GetLinks()[level].load(memory_order_acquire);
+		bool is_deleted = IsMarked(next_link);
+		tNode* cur = GetPtr(next_link);
+
+		while (cur && ((cur->mPriority < priority) || IsMarked(cur->GetLinks()[0].load(memory_order_acquire)) || ((level == 0) && is_deleted)))
+		{
+			if ((level == 0) && is_deleted)
+			{
+				deleted = cur;
+			}
+
+			pred = cur;
+			next_link = pred->GetLinks()[level].load(memory_order_acquire);
+			is_deleted = IsMarked(next_link);
+			cur = GetPtr(next_link);
+		}
+
+		preds[level] = pred;
+		succs[level] = cur;
+	}
+
+	return deleted;
+}
+
+//----------------------------------------------------------------------------
+template <typename T, typename tPriority, class Allocator>
+void cLockFreePriorityQueue<T, tPriority, Allocator>::Restructure()
+{
+	// Moves the upper levels of the head past the deleted prefix just unlinked from the lowest level
+	tNode* pred = mHead;
+	for (unsigned level = MAX_HEIGHT - 1; level > 0; )
+	{
+		uintptr_t head_link = mHead->GetLinks()[level].load(memory_order_acquire);
+		tNode* const first = GetPtr(head_link);
+		if (!first || !IsMarked(first->GetLinks()[0].load(memory_order_acquire)))
+		{
+			--level;
+			continue;
+		}
+
+		uintptr_t cur_link = pred->GetLinks()[level].load(memory_order_acquire);
+		tNode* cur = GetPtr(cur_link);
+		while (cur && IsMarked(cur->GetLinks()[0].load(memory_order_acquire)))
+		{
+			pred = cur;
+			cur_link = pred->GetLinks()[level].load(memory_order_acquire);
+			cur = GetPtr(cur_link);
+		}
+
+		if (mHead->GetLinks()[level].compare_exchange_strong(head_link, cur_link, memory_order_acq_rel, memory_order_relaxed))
+		{
+			--level;
+		}
+	}
+}
+
@@ -6,16 +6,24 @@
 #pragma once
 
 #include "lockfree_pool.h"
+#include "eventcount.h"
 #include "tagged_ptr.h"
 #include "utils.h"
 
+#include <chrono>
+#include <limits>
+
 namespace lockfree {
 
 	namespace detail 
 	{
-		template <typename T>
+		template <typename T, template <typename> class tLink = tTaggedPtr, bool trivial = tIsTriviallyStorable<T>::value>
 		struct tLockFreeQueueNode;
 
+		// Nodes of queues with local storage for N of them. Linked by pool index (8 bytes less per node, and 32-bit mFront/mBack) when they fit
+		template <typename T, size_t N>
+		using tLockFreeQueueNodeFor = std::conditional_t<(N <= TAGGED_INDEX_MAX_ELEMENTS), tLockFreeQueueNode<T, tTaggedIndex>, tLockFreeQueueNode<T>>;
+
 		template <size_t N, class Allocator>
 		class cLockFreeQueueLocalStorage;
 	}
@@ -47,6 +55,12 @@ namespace lockfree {
 ///		Requirements for T:
 ///		- T needs to support move or copy construction (the former will be chosen over the second if available), and move or copy assignment
 ///		- T's move or copy assignment and move or copy construction need to be thread-safe and lock-free
+///
+///		Nodes are linked with tagged pointers by default. An allocator of detail::tLockFreeQueueNode&lt;T, tTaggedIndex&gt; links them by
+///		index within the pool instead, which needs the pool to have 65535 nodes at most. Queues with local storage do so whenever it fits
+///
+///		Trivial T (see detail::tIsTriviallyStorable) is stored in the nodes as is, with no destructor to run: PopBulk copies it out and
+///		gives all the nodes back to the pool at once
 /// <summary>
 template <typename T, size_t storage = LFQS_SHARED, class Allocator = std::allocator<detail::tLockFreeQueueNode<T>>>
 class cLockFreeQueue;
@@ -55,10 +69,12 @@ template <typename T, class Allocator>
 class cLockFreeQueue<T, LFQS_SHARED, Allocator>
 {
 protected:
-	typedef detail::tLockFreeQueueNode<T>	tElement;
-	typedef typename tElement::tNodePtr		tNodePtr;
+	typedef typename Allocator::value_type		tElement;
+	typedef typename tElement::tNodePtr			tNodePtr;
+	typedef detail::tNodeLinkTraits<tNodePtr>	tNodeLinks;
 
-	static_assert(std::is_same<typename Allocator::value_type, tElement>::value, "The allocator provided does not allocate the right type");
+	static_assert(std::is_same<tElement, detail::tLockFreeQueueNode<T, tTaggedPtr, tElement::IS_TRIVIAL>>::value || std::is_same<tElement, detail::tLockFreeQueueNode<T, tTaggedIndex, tElement::IS_TRIVIAL>>::value, 
+		"The allocator provided does not allocate the right type");
 
 public:
 	typedef T										tValueType;
@@ -79,6 +95,26 @@ public:
 	template <typename... Args>
 	bool Push(Args&&... args);
 
+	/// <summary> 
+	///		Pushes a new object in the queue atomically. If the pool is exhausted, blocks the calling thread until some node is released to it
+	/// </summary>
+	/// <remarks>
+	///		The object will be emplaced with the variadic arguments passed. They are only consumed by the attempt that succeeds.
+	///		Parked producers don't compete with the consumers that are freeing nodes, and releasing nodes only goes to the OS when
+	///		there are producers parked
+	/// </remarks>
+	template <typename... Args>
+	void PushWait(Args&&... args);
+
+	/// <summary> 
+	///		Same as PushWait, but gives up if the pool remains exhausted for longer than the timeout passed
+	/// </summary>
+	/// <return>
+	///		Returns true if object has been pushed successfully before timing out. False otherwise
+	/// </return>
+	template <class Rep, class Period, typename... Args>
+	bool PushFor(const std::chrono::duration<Rep, Period>& timeout, Args&&... args);
+
 	/// <summary> 
 	///		Pops the next object in FIFO ordering atomically
 	/// </summary>
@@ -90,6 +126,66 @@ public:
 	/// </return>
 	bool Pop(T& result);
 
+	/// <summary> 
+	///		Pops the next object in FIFO ordering atomically, handing it to a callable while it still resides in the queue's storage
+	/// </summary>
+	/// <param name="fnc">
+	///     Callable invoked as fnc(T&amp;) with the pop object if pop succeeds. The object is destroyed right after fnc returns, so it 
+	///		can be moved from, but references to it must not be kept
+	/// </param>
+	/// <return>
+	///		Returns true if the queue was not empty and an object could be pop. False otherwise.
+	/// </return>
+	/// <remarks>
+	///		Saves the copy (or move) of the object out of the node that Pop needs, which adds up with big objects
+	/// </remarks>
+	template <typename Fnc>
+	bool PopWith(Fnc&& fnc);
+
+	/// <summary> 
+	///		Pops the next object in FIFO ordering atomically. If the queue is empty, blocks the calling thread until an object is pushed
+	/// </summary>
+	/// <param name="result">
+	///     (Out) the pop object will be <b>moved</b> to this argument
+	/// </param>
+	/// <remarks>
+	///		Spins for a little while before parking the thread, so waiting on an idle queue doesn't burn any CPU. Producers only go to 
+	///		the OS to wake consumers up when there are consumers parked
+	/// </remarks>
+	void PopWait(T& result);
+
+	/// <summary> 
+	///		Same as PopWait, but gives up if the queue remains empty for longer than the timeout passed
+	/// </summary>
+	/// <param name="result">
+	///     (Out) the pop object will be <b>moved</b> to this argument if pop succeeds
+	/// </param>
+	/// <return>
+	///		Returns true if an object could be pop before timing out. False otherwise.
+	/// </return>
+	template <class Rep, class Period>
+	bool PopFor(T& result, const std::chrono::duration<Rep, Period>& timeout);
+
+	/// <summary> 
+	///		Pushes a number of objects, copied from an array, atomically as a whole. They get linked among themselves first, and then 
+	///		at the back of the queue with a single XCHG, so they are never interleaved with objects pushed by other threads
+	/// </summary>
+	/// <return>
+	///		Returns the number of objects pushed, fewer than count if the pool runs out of nodes
+	/// </return>
+	unsigned PushBulk(const T* values, unsigned count);
+
+	/// <summary> 
+	///		Pops up to max_count objects in FIFO ordering atomically as a whole, unlinking all of them from the queue with a single CAS
+	/// </summary>
+	/// <param name="results">
+	///     (Out) array the pop objects will be <b>moved</b> to, in the order they are popped
+	/// </param>
+	/// <return>
+	///		Returns the number of objects popped, 0 if the queue was empty
+	/// </return>
+	unsigned PopBulk(T* results, unsigned max_count);
+
 	// ***NON-ATOMIC INTERFACE
 
 	cLockFreeQueue(tLockFreePool& pool);
@@ -130,6 +226,18 @@ public:
 	/// </return>
 	bool NonAtomicPop(T& result);
 
+	/// <summary> 
+	///		Pops the next object in FIFO ordering non atomically, handing it to a callable while it still resides in the queue's storage
+	/// </summary>
+	/// <param name="fnc">
+	///     Callable invoked as fnc(T&amp;) with the pop object if pop succeeds. The object is destroyed right after fnc returns
+	/// </param>
+	/// <return>
+	///		Returns true if the queue was not empty and an object could be pop. False otherwise.
+	/// </return>
+	template <typename Fnc>
+	bool NonAtomicPopWith(Fnc&& fnc);
+
 private:
 	// TODO: Implement copy/move
 	cLockFreeQueue(const cLockFreeQueue&) = delete;
@@ -143,9 +251,13 @@ private:
 
 	tElement* AcquireNewNode();
 
+	tElement* GetNode(const tNodePtr& link) const { return tNodeLinks::GetNode(link, mNodePool); }
+	tNodePtr GetLink(tElement* node, typename tNodePtr::tTag tag) const { return tNodeLinks::GetLink(node, tag, mNodePool); }
+
 	tLockFreePool&		mNodePool;
 	atomic<tNodePtr>	mFront;
 	atomic<tNodePtr>	mBack;
+	cEventCount			mNotEmptyEvent;
 
 	_if_diagnosing(atomic<unsigned> mCount;)
 };
@@ -156,11 +268,11 @@ private:
 template <typename T, size_t storage, class Allocator>
 class cLockFreeQueue 
 	// the order in which we inherit from these is important, don't change it
-	: protected detail::cLockFreeQueueLocalStorage<storage + 1, detail::local_storage_allocator<detail::tLockFreeQueueNode<T>, storage + 1>>
-	, public cLockFreeQueue<T, LFSS_SHARED, detail::local_storage_allocator<detail::tLockFreeQueueNode<T>, storage + 1>>
+	: protected detail::cLockFreeQueueLocalStorage<storage + 1, detail::local_storage_allocator<detail::tLockFreeQueueNodeFor<T, storage + 1>, storage + 1>>
+	, public cLockFreeQueue<T, LFQS_SHARED, detail::local_storage_allocator<detail::tLockFreeQueueNodeFor<T, storage + 1>, storage + 1>>
 {
-	typedef detail::cLockFreeQueueLocalStorage<storage + 1, detail::local_storage_allocator<detail::tLockFreeQueueNode<T>, storage + 1>> tStorage;
-	typedef cLockFreeQueue<T, LFSS_SHARED, detail::local_storage_allocator<detail::tLockFreeQueueNode<T>, storage + 1>> tBaseQueue;
+	typedef detail::cLockFreeQueueLocalStorage<storage + 1, detail::local_storage_allocator<detail::tLockFreeQueueNodeFor<T, storage + 1>, storage + 1>> tStorage;
+	typedef cLockFreeQueue<T, LFQS_SHARED, detail::local_storage_allocator<detail::tLockFreeQueueNodeFor<T, storage + 1>, storage + 1>> tBaseQueue;
 
 public:
 	cLockFreeQueue()
@@ -233,6 +345,26 @@ public:
 	template <typename... Args>
 	bool Push(Args&&... args);
 
+	/// <summary> 
+	///		Pushes a new object in the queue atomically. If the pool is exhausted, blocks the calling thread until some node is released to it
+	/// </summary>
+	/// <remarks>
+	///		The object will be emplaced with the variadic arguments passed. They are only consumed by the attempt that succeeds.
+	///		Parked producers don't compete with the consumers that are freeing nodes, and releasing nodes only goes to the OS when
+	///		there are producers parked
+	/// </remarks>
+	template <typename... Args>
+	void PushWait(Args&&... args);
+
+	/// <summary> 
+	///		Same as PushWait, but gives up if the pool remains exhausted for longer than the timeout passed
+	/// </summary>
+	/// <return>
+	///		Returns true if object has been pushed successfully before timing out. False otherwise
+	/// </return>
+	template <class Rep, class Period, typename... Args>
+	bool PushFor(const std::chrono::duration<Rep, Period>& timeout, Args&&... args);
+
 	/// <summary> 
 	///		Pops the next object in FIFO ordering atomically
 	/// </summary>
@@ -244,8 +376,70 @@ public:
 	/// </return>
 	bool Pop(T& result);
 
+	/// <summary> 
+	///		Pops the next object in FIFO ordering atomically, handing it to a callable while it still resides in the queue's storage
+	/// </summary>
+	/// <param name="fnc">
+	///     Callable invoked as fnc(T&amp;) with the pop object if pop succeeds. The object is destroyed right after fnc returns, so it 
+	///		can be moved from, but references to it must not be kept
+	/// </param>
+	/// <return>
+	///		Returns true if the queue was not empty and an object could be pop. False otherwise.
+	/// </return>
+	/// <remarks>
+	///		Saves the copy (or move) of the object out of the node that Pop needs, which adds up with big objects
+	/// </remarks>
+	template <typename Fnc>
+	bool PopWith(Fnc&& fnc);
+
+	/// <summary> 
+	///		Pops the next object in FIFO ordering atomically. If the queue is empty, blocks the calling thread until an object is pushed
+	/// </summary>
+	/// <param name="result">
+	///     (Out) the pop object will be <b>moved</b> to this argument
+	/// </param>
+	/// <remarks>
+	///		Spins for a little while before parking the thread, so waiting on an idle queue doesn't burn any CPU. Producers only go to 
+	///		the OS to wake consumers up when there are consumers parked
+	/// </remarks>
+	void PopWait(T& result);
+
+	/// <summary> 
+	///		Same as PopWait, but gives up if the queue remains empty for longer than the timeout passed
+	/// </summary>
+	/// <param name="result">
+	///     (Out) the pop object will be <b>moved</b> to this argument if pop succeeds
+	/// </param>
+	/// <return>
+	///		Returns true if an object could be pop before timing out. False otherwise.
+	/// </return>
+	template <class Rep, class Period>
+	bool PopFor(T& result, const std::chrono::duration<Rep, Period>& timeout);
+
+	/// <summary> 
+	///		Consumes, in FIFO ordering, all the objects that are ready to be popped (up to a maximum), in a single go
+	/// </summary>
+	/// <param name="fnc">
+	///     Callable invoked as fnc(T&amp;) with every consumed object, while it still resides in the queue's storage. The object is
+	///		destroyed right after fnc returns, so it can be moved from but references to it must not be kept
+	/// </param>
+	/// <param name="max_elements">
+	///     Maximum number of objects that will be consumed
+	/// </param>
+	/// <return>
+	///		Returns the number of objects consumed
+	/// </return>
+	/// <remarks>
+	///		Since there is only one consumer, it can walk the chain of ready nodes without synchronizing with anybody but the producers
+	///		that linked them. All the nodes consumed are returned to the pool with a single atomic operation at the end, so this is 
+	///		considerably cheaper than popping the same objects one by one
+	/// </remarks>
+	template <typename Fnc>
+	unsigned ConsumeAll(Fnc&& fnc, unsigned max_elements = (std::numeric_limits<unsigned>::max)());
+
 	// ***NON-ATOMIC INTERFACE
 	cMPSCLockFreeQueue(tLockFreePool& pool);
+	~cMPSCLockFreeQueue();
 
 	/// <summary> 
 	///		Queries if the queue is empty
@@ -282,6 +476,18 @@ public:
 	/// </return>
 	bool NonAtomicPop(T& result);
 
+	/// <summary> 
+	///		Pops the next object in FIFO ordering non atomically, handing it to a callable while it still resides in the queue's storage
+	/// </summary>
+	/// <param name="fnc">
+	///     Callable invoked as fnc(T&amp;) with the pop object if pop succeeds. The object is destroyed right after fnc returns
+	/// </param>
+	/// <return>
+	///		Returns true if the queue was not empty and an object could be pop. False otherwise.
+	/// </return>
+	template <typename Fnc>
+	bool NonAtomicPopWith(Fnc&& fnc);
+
 private:
 	// TODO: Implement copy/move
 	cMPSCLockFreeQueue(const cMPSCLockFreeQueue&) = delete;
@@ -290,6 +496,8 @@ private:
 	template <typename... Args>
 	tElement* AcquireNewNode(Args&&... args);
 
+	tElement* AcquireNewSentinelNode();
+
 	template <typename... Args>
 	bool LinkBackNodeAtomically(Args&&... args);
 
@@ -300,6 +508,7 @@ private:
 	tLockFreePool&		mNodePool;
 	atomic<tElement*>	mBack;
 	tElement*			mFront;
+	cEventCount			mNotEmptyEvent;
 
 	_if_diagnosing(atomic<unsigned> mCount;)
 };
@@ -311,10 +520,10 @@ template <typename T, size_t storage, class Allocator>
 class cMPSCLockFreeQueue 
 	// the order in which we inherit from these is important, don't change it
 	: protected detail::cLockFreeQueueLocalStorage<storage + 1, detail::local_storage_allocator<detail::tMPSCLockFreeQueueNode<T>, storage + 1>>
-	, public cMPSCLockFreeQueue<T, LFSS_SHARED, detail::local_storage_allocator<detail::tMPSCLockFreeQueueNode<T>, storage + 1>>
+	, public cMPSCLockFreeQueue<T, LFQS_SHARED, detail::local_storage_allocator<detail::tMPSCLockFreeQueueNode<T>, storage + 1>>
 {
 	typedef detail::cLockFreeQueueLocalStorage<storage + 1, detail::local_storage_allocator<detail::tMPSCLockFreeQueueNode<T>, storage + 1>> tStorage;
-	typedef cMPSCLockFreeQueue<T, LFSS_SHARED, detail::local_storage_allocator<detail::tMPSCLockFreeQueueNode<T>, storage + 1>> tBaseQueue;
+	typedef cMPSCLockFreeQueue<T, LFQS_SHARED, detail::local_storage_allocator<detail::tMPSCLockFreeQueueNode<T>, storage + 1>> tBaseQueue;
 
 public:
 	cMPSCLockFreeQueue()
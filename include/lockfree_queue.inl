@@ -1,10 +1,12 @@
 namespace detail
 {
 	//----------------------------------------------------------------------------
-	template <typename T>
+	template <typename T, template <typename> class tLink, bool trivial>
 	struct tLockFreeQueueNode
 	{
-		typedef tTaggedPtr<tLockFreeQueueNode> tNodePtr;
+		typedef tLink<tLockFreeQueueNode> tNodePtr;
+
+		static constexpr const bool IS_TRIVIAL = false;
 
 		tLockFreeQueueNode()
 			: mPrev(nullptr)
@@ -61,9 +63,61 @@ namespace detail
 	};
 
 	//----------------------------------------------------------------------------
+	// Trivial T lives in the node as is. Setting it is a plain copy and nodes have nothing to destroy, so the pool skips their destructor
+	template <typename T, template <typename> class tLink>
+	struct tLockFreeQueueNode<T, tLink, true>
+	{
+		static_assert(tIsTriviallyStorable<T>::value, "Only trivial types can be stored as they are");
+
+		typedef tLink<tLockFreeQueueNode> tNodePtr;
+
+		static constexpr const bool IS_TRIVIAL = true;
+
+		tLockFreeQueueNode()
+			: mPrev(nullptr)
+		{
+		}
+
+		tLockFreeQueueNode(const tLockFreeQueueNode& other)
+			: mData(other.mData)
+			, mPrev(other.mPrev.load(memory_order_acquire))
+		{
+		}
+
+		tLockFreeQueueNode& operator = (const tLockFreeQueueNode& other)
+		{
+			mData = other.mData;
+			mPrev = other.mPrev.load(memory_order_acquire);
+
+			return *this;
+		}
+
+		template <typename... Args>
+		void SetData(Args&&... args)
+		{
+			mData = T(forward<Args>(args)...);
+		}
+
+		T& GetData() { return mData; }
+		const T& GetData() const { return mData; }
+
+		T					mData;
+		atomic<tNodePtr>	mPrev;
+	};
+
+	//----------------------------------------------------------------------------
+	// The data of these nodes is destroyed explicitly by the queue as soon as it is consumed, the node that ends up being the 
+	// sentinel never holds a live object
 	template <typename T>
 	struct tMPSCLockFreeQueueNode
 	{
+		struct tSentinelTag {};
+
+		explicit tMPSCLockFreeQueueNode(tSentinelTag)
+			: mPrev(nullptr)
+		{
+		}
+
 		template <typename... Args>
 		tMPSCLockFreeQueueNode(Args&&... args)
 			: mPrev(nullptr)
@@ -71,7 +125,7 @@ namespace detail
 			new (&mData) T(forward<Args>(args)...);
 		}
 
-		~tMPSCLockFreeQueueNode()
+		void DestroyData()
 		{
 			if (!std::is_trivially_destructible<T>::value)
 			{
@@ -110,9 +164,38 @@ bool cLockFreeQueue<T, LFQS_SHARED, Allocator>::Push(Args&&... args)
 	return LinkBackNodeAtomically(forward<Args>(args)...);
 }
 
+//----------------------------------------------------------------------------
+template <typename T, class Allocator>
+template <typename... Args>
+void cLockFreeQueue<T, LFQS_SHARED, Allocator>::PushWait(Args&&... args)
+{
+	// A failed Push doesn't touch the arguments, so it is fine to forward them on every attempt
+	mNodePool.AwaitRelease([&] { return Push(forward<Args>(args)...); });
+}
+
+//----------------------------------------------------------------------------
+template <typename T, class Allocator>
+template <class Rep, class Period, typename... Args>
+bool cLockFreeQueue<T, LFQS_SHARED, Allocator>::PushFor(const std::chrono::duration<Rep, Period>& timeout, Args&&... args)
+{
+	return mNodePool.AwaitReleaseFor([&] { return Push(forward<Args>(args)...); }, timeout);
+}
+
 //----------------------------------------------------------------------------
 template <typename T, class Allocator>
 bool cLockFreeQueue<T, LFQS_SHARED, Allocator>::Pop(T& result)
+{
+	// If you get a compilation error here T's move assignment is deleted/private AND T's copy assignment
+	// parameter is non-const T& (so it can't bind to a r-value reference), so fix that. If there is a good
+	// reason for it to be that way this code can be changed to selectively copy instead of move data in 
+	// those situations (but I don't think there is a good reason for that)
+	return PopWith([&result](T& data) { result = move(data); });
+}
+
+//----------------------------------------------------------------------------
+template <typename T, class Allocator>
+template <typename Fnc>
+bool cLockFreeQueue<T, LFQS_SHARED, Allocator>::PopWith(Fnc&& fnc)
 {
 	// Explanation for memory ordering:
 	// we only need to synchronize-with the writing to the mPrev pointer of the node we are going to pop so 
@@ -120,19 +203,17 @@ bool cLockFreeQueue<T, LFQS_SHARED, Allocator>::Pop(T& result)
 	// thread will access the element that has been popped after mFront is CAS'ed
 
 	tNodePtr old_front(mFront.load(memory_order_relaxed));
-	tNodePtr old_front_prev(old_front->mPrev.load(memory_order_acquire));
+	tNodePtr old_front_prev(GetNode(old_front)->mPrev.load(memory_order_acquire));
 
 	while (old_front_prev)
 	{
-		tNodePtr new_front(old_front_prev.GetPtr(), old_front.GetTag() + 1);
+		tNodePtr new_front(old_front_prev.WithTag(old_front.GetTag() + 1));
 		if (mFront.compare_exchange_weak(old_front, new_front, memory_order_relaxed, memory_order_relaxed))
 		{
-			// If you get a compilation error here T's move assignment is deleted/private AND T's copy assignment
-			// parameter is non-const T& (so it can't bind to a r-value reference), so fix that. If there is a good
-			// reason for it to be that way this code can be changed to selectively copy instead of move data in 
-			// those situations (but I don't think there is a good reason for that)
-			result = move(old_front->GetData());
-			mNodePool.Release(*old_front);
+			// The node is ours now. Other consumers might still read its mPrev, but nobody else touches its data
+			tElement* const old_front_node = GetNode(old_front);
+			fnc(old_front_node->GetData());
+			mNodePool.Release(*old_front_node);
 
 			_if_diagnosing(mCount.fetch_sub(1, memory_order_relaxed);)
 
@@ -140,13 +221,149 @@ bool cLockFreeQueue<T, LFQS_SHARED, Allocator>::Pop(T& result)
 		}
 		else
 		{
-			old_front_prev = old_front->mPrev.load(memory_order_acquire);
+			old_front_prev = GetNode(old_front)->mPrev.load(memory_order_acquire);
 		}
 	}
 
 	return false;
 }
 
+//----------------------------------------------------------------------------
+template <typename T, class Allocator>
+void cLockFreeQueue<T, LFQS_SHARED, Allocator>::PopWait(T& result)
+{
+	mNotEmptyEvent.Await([this, &result] { return Pop(result); });
+}
+
+//----------------------------------------------------------------------------
+template <typename T, class Allocator>
+template <class Rep, class Period>
+bool cLockFreeQueue<T, LFQS_SHARED, Allocator>::PopFor(T& result, const std::chrono::duration<Rep, Period>& timeout)
+{
+	return mNotEmptyEvent.AwaitFor([this, &result] { return Pop(result); }, timeout);
+}
+
+//----------------------------------------------------------------------------
+template <typename T, class Allocator>
+unsigned cLockFreeQueue<T, LFQS_SHARED, Allocator>::PushBulk(const T* values, unsigned count)
+{
+	if (count == 0)
+	{
+		return 0;
+	}
+
+	// The first value goes to the current back node, same as in Push. The rest go to a local chain of new nodes, whose last node will be 
+	// the new back. Every node but the new back holds a value. Links are stored with release even in the chain: consumers popping from 
+	// the middle of it synchronize with the link of the node they pop, not with the one publishing the whole chain
+	tElement* const first_new_node = AcquireNewNode();
+	if (!first_new_node)
+	{
+		return 0;
+	}
+
+	tElement* last_new_node = first_new_node;
+	unsigned pushed = 1;
+	for (; pushed != count; ++pushed)
+	{
+		tElement* const new_node = AcquireNewNode();
+		if (!new_node)
+		{
+			break;
+		}
+
+		last_new_node->SetData(values[pushed]);
+		last_new_node->mPrev.store(GetLink(new_node, 0), memory_order_release);
+		last_new_node = new_node;
+	}
+
+	// 1. Move back to the last new (sentinel) node
+	tElement* const old_back = GetNode(mBack.exchange(GetLink(last_new_node, 0), memory_order_acq_rel));
+
+	// 2. Construct the first object in the old back node
+	old_back->SetData(values[0]);
+
+	// 3. Point the old node's prev pointer to the chain, publishing all of it
+	old_back->mPrev.store(GetLink(first_new_node, 0), memory_order_release);
+
+	// 4. Wake up consumers blocked in PopWait/PopFor, if any
+	if (pushed > 1)
+	{
+		mNotEmptyEvent.NotifyAll();
+	}
+	else
+	{
+		mNotEmptyEvent.NotifyOne();
+	}
+
+	_if_diagnosing(mCount.fetch_add(pushed, memory_order_relaxed);)
+	return pushed;
+}
+
+//----------------------------------------------------------------------------
+template <typename T, class Allocator>
+unsigned cLockFreeQueue<T, LFQS_SHARED, Allocator>::PopBulk(T* results, unsigned max_count)
+{
+	if (max_count == 0)
+	{
+		return 0;
+	}
+
+	tNodePtr old_front(mFront.load(memory_order_relaxed));
+	tNodePtr new_front(GetNode(old_front)->mPrev.load(memory_order_acquire));
+	while (new_front)
+	{
+		// Walk to the node that will be the new front. Unlike PopWith, we follow the links we read, so each one is only trusted if mFront
+		// didn't change meanwhile (i.e., nothing was popped, so the node holding it was still in the queue when we read it)
+		unsigned count = 1;
+		while (count != max_count)
+		{
+			if (mFront.load(memory_order_relaxed) != old_front)
+			{
+				break;
+			}
+
+			const tNodePtr next = GetNode(new_front)->mPrev.load(memory_order_acquire);
+			if (!next)
+			{
+				break;
+			}
+			new_front = next;
+			++count;
+		}
+
+		if (mFront.compare_exchange_weak(old_front, new_front.WithTag(old_front.GetTag() + 1), memory_order_relaxed, memory_order_relaxed))
+		{
+			// The nodes are ours now, each one holds the value of one of the objects popped. Trivial nodes have nothing to destroy, so
+			// they go back to the pool all at once
+			typename tLockFreePool::tReleaseBatch batch;
+			tElement* node = GetNode(old_front);
+			for (unsigned i = 0; i != count; ++i)
+			{
+				tElement* const prev_node = GetNode(node->mPrev.load(memory_order_relaxed));
+				results[i] = move(node->GetData());
+				if (tElement::IS_TRIVIAL)
+				{
+					mNodePool.BatchReleasePtr(batch, node);
+				}
+				else
+				{
+					mNodePool.Release(*node);
+				}
+				node = prev_node;
+			}
+			mNodePool.ReleaseBatch(batch);
+
+			_if_diagnosing(mCount.fetch_sub(count, memory_order_relaxed);)
+
+			return count;
+		}
+
+		new_front = GetNode(old_front)->mPrev.load(memory_order_acquire);
+	}
+
+	return 0;
+}
+
 //----------------------------------------------------------------------------
 template <typename T, class Allocator>
 cLockFreeQueue<T, LFQS_SHARED, Allocator>::cLockFreeQueue(tLockFreePool& pool)
@@ -154,9 +371,11 @@ cLockFreeQueue<T, LFQS_SHARED, Allocator>::cLockFreeQueue(tLockFreePool& pool)
 	, mFront(nullptr)
 	, mBack(nullptr)
 {
+	LF_assert(tNodeLinks::CanLink(pool), "The pool has too many nodes to link them by index");
+
 	tElement* const dummy_node = AcquireNewNode();
-	mFront.store(tNodePtr(dummy_node, 0), memory_order_relaxed);
-	mBack.store(tNodePtr(dummy_node, 0), memory_order_release);
+	mFront.store(GetLink(dummy_node, 0), memory_order_relaxed);
+	mBack.store(GetLink(dummy_node, 0), memory_order_release);
 
 	_if_diagnosing(mCount.store(0, memory_order_relaxed);)
 }
@@ -165,20 +384,19 @@ cLockFreeQueue<T, LFQS_SHARED, Allocator>::cLockFreeQueue(tLockFreePool& pool)
 template <typename T, class Allocator>
 cLockFreeQueue<T, LFQS_SHARED, Allocator>::~cLockFreeQueue()
 {
-	T dummy = T();
-	while (NonAtomicPop(dummy));
+	while (NonAtomicPopWith([](T&) {}));
 
 	// TODO: Find a better way to do this. This is intentional so we don't invoke the tNode destructor
 	// on the sentinel node, which will try to destroy the data (that is still not instantiated there)
 	LF_assert(mFront.load(memory_order_relaxed), "Front should not be nullptr");
-	mNodePool.ReleasePtr(mFront.load(memory_order_relaxed).GetPtr());
+	mNodePool.ReleasePtr(GetNode(mFront.load(memory_order_relaxed)));
 }
 
 //----------------------------------------------------------------------------
 template <typename T, class Allocator>
 bool cLockFreeQueue<T, LFQS_SHARED, Allocator>::Empty() const
 {
-	return !mFront.load(memory_order_relaxed)->mPrev.load(memory_order_relaxed);
+	return !GetNode(mFront.load(memory_order_relaxed))->mPrev.load(memory_order_relaxed);
 }
 
 //----------------------------------------------------------------------------
@@ -192,19 +410,25 @@ bool cLockFreeQueue<T, LFQS_SHARED, Allocator>::NonAtomicPush(Args&&... args)
 //----------------------------------------------------------------------------
 template <typename T, class Allocator>
 bool cLockFreeQueue<T, LFQS_SHARED, Allocator>::NonAtomicPop(T& result)
+{
+	// See the comment in Pop if you get a compilation error here
+	return NonAtomicPopWith([&result](T& data) { result = move(data); });
+}
+
+//----------------------------------------------------------------------------
+template <typename T, class Allocator>
+template <typename Fnc>
+bool cLockFreeQueue<T, LFQS_SHARED, Allocator>::NonAtomicPopWith(Fnc&& fnc)
 {
 	tNodePtr old_front(mFront.load(memory_order_relaxed));
-	tNodePtr old_front_prev(old_front->mPrev.load(memory_order_relaxed));
+	tElement* const old_front_node = GetNode(old_front);
+	tNodePtr old_front_prev(old_front_node->mPrev.load(memory_order_relaxed));
 	if (old_front_prev)
 	{
-		mFront.store(tNodePtr(old_front_prev.GetPtr(), old_front.GetTag() + 1), memory_order_relaxed);
+		mFront.store(old_front_prev.WithTag(old_front.GetTag() + 1), memory_order_relaxed);
 
-		// If you get a compilation error here T's move assignment is deleted/private AND T's copy assignment
-		// parameter is non-const T& (so it can't bind to a r-value reference), so fix that. If there is a good
-		// reason for it to be that way this code can be changed to selectively copy instead of move data in 
-		// those situations (but I don't think there is a good reason for that)
-		result = move(old_front->GetData());
-		mNodePool.Release(*old_front);
+		fnc(old_front_node->GetData());
+		mNodePool.Release(*old_front_node);
 
 		_if_diagnosing(mCount.fetch_sub(1, memory_order_relaxed);)
 
@@ -225,11 +449,11 @@ bool cLockFreeQueue<T, LFQS_SHARED, Allocator>::LinkBackNodeAtomically(Args&&...
 		return false;
 	}
 
-	LF_assert(new_node->mPrev.load(memory_order_relaxed).GetPtr() == nullptr, "Previous must be nullptr.");
+	LF_assert(!new_node->mPrev.load(memory_order_relaxed), "Previous must be nullptr.");
 
 	// 1. Move back to the new (sentinel) node
-	tNodePtr new_back(new_node);
-	tNodePtr old_back = mBack.exchange(new_back, memory_order_acq_rel);
+	tNodePtr new_back(GetLink(new_node, 0));
+	tElement* const old_back = GetNode(mBack.exchange(new_back, memory_order_acq_rel));
 
 	// 2. Construct the pushed object in the old back node
 	old_back->SetData(forward<Args>(args)...);
@@ -237,6 +461,9 @@ bool cLockFreeQueue<T, LFQS_SHARED, Allocator>::LinkBackNodeAtomically(Args&&...
 	// 3. Point the old node's prev pointer to the new node
 	old_back->mPrev.store(new_back, memory_order_release);
 
+	// 4. Wake up a consumer blocked in PopWait/PopFor, if any (no syscall unless there are consumers waiting)
+	mNotEmptyEvent.NotifyOne();
+
 	_if_diagnosing(mCount.fetch_add(1, memory_order_relaxed);)
 	return true;
 }
@@ -252,11 +479,11 @@ bool cLockFreeQueue<T, LFQS_SHARED, Allocator>::LinkBackNodeNonAtomically(Args&&
 		return false;
 	}
 
-	LF_assert(new_node->mPrev.load(memory_order_relaxed).GetPtr() == nullptr, "Previous must be nullptr.");
+	LF_assert(!new_node->mPrev.load(memory_order_relaxed), "Previous must be nullptr.");
 
 	// 1. Move back to the new (sentinel) node
-	tNodePtr new_back(new_node);
-	tNodePtr old_back = mBack.exchange(new_back, memory_order_relaxed);
+	tNodePtr new_back(GetLink(new_node, 0));
+	tElement* const old_back = GetNode(mBack.exchange(new_back, memory_order_relaxed));
 
 	// 2. Construct the pushed object in the old back node
 	old_back->SetData(forward<Args>(args)...);
@@ -285,19 +512,45 @@ bool cMPSCLockFreeQueue<T, LFQS_SHARED, Allocator>::Push(Args&&... args)
 	return LinkBackNodeAtomically(forward<Args>(args)...);
 }
 
+//----------------------------------------------------------------------------
+template <typename T, class Allocator>
+template <typename... Args>
+void cMPSCLockFreeQueue<T, LFQS_SHARED, Allocator>::PushWait(Args&&... args)
+{
+	// A failed Push doesn't touch the arguments, so it is fine to forward them on every attempt
+	mNodePool.AwaitRelease([&] { return Push(forward<Args>(args)...); });
+}
+
+//----------------------------------------------------------------------------
+template <typename T, class Allocator>
+template <class Rep, class Period, typename... Args>
+bool cMPSCLockFreeQueue<T, LFQS_SHARED, Allocator>::PushFor(const std::chrono::duration<Rep, Period>& timeout, Args&&... args)
+{
+	return mNodePool.AwaitReleaseFor([&] { return Push(forward<Args>(args)...); }, timeout);
+}
+
 //----------------------------------------------------------------------------
 template <typename T, class Allocator>
 bool cMPSCLockFreeQueue<T, LFQS_SHARED, Allocator>::Pop(T& result)
+{
+	return PopWith([&result](T& data) { result = move(data); });
+}
+
+//----------------------------------------------------------------------------
+template <typename T, class Allocator>
+template <typename Fnc>
+bool cMPSCLockFreeQueue<T, LFQS_SHARED, Allocator>::PopWith(Fnc&& fnc)
 {
 	tElement* const old_front = mFront;
 	tElement* const node_to_pop = old_front->mPrev.load(memory_order_acquire);
 	if (node_to_pop)
 	{
 		mFront = node_to_pop;
-		result = move(node_to_pop->GetData());
+		fnc(node_to_pop->GetData());
+		node_to_pop->DestroyData();
 
 		// Release the old mFront
-		mNodePool.Release(*old_front);
+		mNodePool.ReleasePtr(old_front);
 
 		_if_diagnosing(mCount.fetch_sub(1, memory_order_relaxed);)
 
@@ -307,12 +560,60 @@ bool cMPSCLockFreeQueue<T, LFQS_SHARED, Allocator>::Pop(T& result)
 	return false; // empty
 }
 
+//----------------------------------------------------------------------------
+template <typename T, class Allocator>
+void cMPSCLockFreeQueue<T, LFQS_SHARED, Allocator>::PopWait(T& result)
+{
+	mNotEmptyEvent.Await([this, &result] { return Pop(result); });
+}
+
+//----------------------------------------------------------------------------
+template <typename T, class Allocator>
+template <class Rep, class Period>
+bool cMPSCLockFreeQueue<T, LFQS_SHARED, Allocator>::PopFor(T& result, const std::chrono::duration<Rep, Period>& timeout)
+{
+	return mNotEmptyEvent.AwaitFor([this, &result] { return Pop(result); }, timeout);
+}
+
+//----------------------------------------------------------------------------
+template <typename T, class Allocator>
+template <typename Fnc>
+unsigned cMPSCLockFreeQueue<T, LFQS_SHARED, Allocator>::ConsumeAll(Fnc&& fnc, unsigned max_elements)
+{
+	typename tLockFreePool::tReleaseBatch released_nodes;
+
+	tElement* front = mFront;
+	unsigned consumed = 0;
+	for (; consumed != max_elements; ++consumed)
+	{
+		tElement* const node_to_consume = front->mPrev.load(memory_order_acquire);
+		if (!node_to_consume)
+		{
+			break;
+		}
+
+		fnc(node_to_consume->GetData());
+		node_to_consume->DestroyData();
+
+		// The node to consume becomes the new sentinel, the old one goes to the batch
+		mNodePool.BatchReleasePtr(released_nodes, front);
+		front = node_to_consume;
+	}
+
+	mFront = front;
+	mNodePool.ReleaseBatch(released_nodes);
+
+	_if_diagnosing(mCount.fetch_sub(consumed, memory_order_relaxed);)
+
+	return consumed;
+}
+
 //----------------------------------------------------------------------------
 template <typename T, class Allocator>
 cMPSCLockFreeQueue<T, LFQS_SHARED, Allocator>::cMPSCLockFreeQueue(tLockFreePool& pool)
 	: mNodePool(pool)
 {
-	tElement* const sentinel_node = AcquireNewNode();
+	tElement* const sentinel_node = AcquireNewSentinelNode();
 
 	mFront = sentinel_node;
 	mBack.store(sentinel_node, memory_order_relaxed);
@@ -320,6 +621,16 @@ cMPSCLockFreeQueue<T, LFQS_SHARED, Allocator>::cMPSCLockFreeQueue(tLockFreePool&
 	_if_diagnosing(mCount.store(0, memory_order_relaxed);)
 }
 
+//----------------------------------------------------------------------------
+template <typename T, class Allocator>
+cMPSCLockFreeQueue<T, LFQS_SHARED, Allocator>::~cMPSCLockFreeQueue()
+{
+	ConsumeAll([](T&) {});
+
+	LF_assert(mFront, "Front should not be nullptr");
+	mNodePool.ReleasePtr(mFront);
+}
+
 //----------------------------------------------------------------------------
 template <typename T, class Allocator>
 template <typename... Args>
@@ -338,16 +649,25 @@ bool cMPSCLockFreeQueue<T, LFQS_SHARED, Allocator>::Empty() const
 //----------------------------------------------------------------------------
 template <typename T, class Allocator>
 bool cMPSCLockFreeQueue<T, LFQS_SHARED, Allocator>::NonAtomicPop(T& result)
+{
+	return NonAtomicPopWith([&result](T& data) { result = move(data); });
+}
+
+//----------------------------------------------------------------------------
+template <typename T, class Allocator>
+template <typename Fnc>
+bool cMPSCLockFreeQueue<T, LFQS_SHARED, Allocator>::NonAtomicPopWith(Fnc&& fnc)
 {
 	tElement* const old_front = mFront;
 	tElement* const node_to_pop = old_front->mPrev.load(memory_order_relaxed);
 	if (node_to_pop)
 	{
 		mFront = node_to_pop;
-		result = move(node_to_pop->GetData());
+		fnc(node_to_pop->GetData());
+		node_to_pop->DestroyData();
 
 		// Release the old mFront
-		mNodePool.Release(*old_front);
+		mNodePool.ReleasePtr(old_front);
 
 		_if_diagnosing(mCount.fetch_sub(1, memory_order_relaxed);)
 
@@ -365,6 +685,13 @@ auto cMPSCLockFreeQueue<T, LFQS_SHARED, Allocator>::AcquireNewNode(Args&&... arg
 	return mNodePool.Acquire(forward<Args>(args)...);
 }
 
+//----------------------------------------------------------------------------
+template <typename T, class Allocator>
+auto cMPSCLockFreeQueue<T, LFQS_SHARED, Allocator>::AcquireNewSentinelNode() -> tElement*
+{
+	return mNodePool.Acquire(typename tElement::tSentinelTag());
+}
+
 //----------------------------------------------------------------------------
 template <typename T, class Allocator>
 template <typename... Args>
@@ -376,6 +703,9 @@ bool cMPSCLockFreeQueue<T, LFQS_SHARED, Allocator>::LinkBackNodeAtomically(Args&
 		tElement* const old_back = mBack.exchange(new_node, memory_order_acq_rel);
 		old_back->mPrev.store(new_node, memory_order_release);
 
+		// Wake up the consumer if it is blocked in PopWait/PopFor (no syscall unless it is)
+		mNotEmptyEvent.NotifyOne();
+
 		_if_diagnosing(mCount.fetch_add(1, memory_order_relaxed);)
 
 			return true;
@@ -0,0 +1,140 @@
+///////////////////////////////////////////////////////////////////////////
+//
+//lockfree_recycling_pool.h
+//
+/////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "atomic_defs.h"
+#include "lockfree_pool.h"
+#include "utils.h"
+#include "debug.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace lockfree {
+
+namespace detail
+{
+	//-------------------------------------------------------------------------
+	// Default reset hook of cLockFreeRecyclingPool: objects are recycled as they were released
+	struct tNoRecycleReset
+	{
+		template <typename T>
+		void operator()(T&) const {}
+	};
+}
+
+/// <summary>
+///     Lockfree pool of objects that stay constructed while they are in the pool. The first time a slot is acquired its object is default
+///		constructed. Releasing it only runs the reset hook, and acquiring the slot again hands out the same object, so members holding
+///		heap memory (std::vector, std::string...) keep their capacity from one use to the next.
+///
+///		Built on a cLockFreePool of slots, each one with room for the freelist link of the pool in front of the object, so the links
+///		of free slots don't overwrite their objects.
+///
+///		Pros:
+///		- No constructor or destructor calls, nor the allocations they'd do, once every slot has been used once
+///		- The reset hook runs on the releasing thread, out of the way of the next acquire
+///
+///     Cons:
+///		- Every slot is 8 bytes (plus padding up to the alignment of T) bigger than T
+///		- T must be default constructible. Whatever state the reset hook leaves behind is what the next acquire gets
+///		- Memory held by the objects is only given back when the pool is destructed
+/// </summary>
+/// <param name="Reset">
+///		Functor called as reset(T&amp;) on every released object, e.g. to clear() containers without freeing their memory
+/// </param>
+template <typename T, class Reset = detail::tNoRecycleReset, class Allocator = std::allocator<T>>
+class cLockFreeRecyclingPool
+{
+public:
+	typedef T tElement;
+
+	// ***ATOMIC INTERFACE
+
+	/// <summary>
+	///		Acquires an object, constructed the first time its slot is used and recycled afterwards
+	/// </summary>
+	/// <return>
+	///		Returns the object, or nullptr if the pool is empty
+	/// </return>
+	T* Acquire();
+
+	/// <summary>
+	///		Same as Acquire, but blocks the calling thread while the pool is empty
+	/// </summary>
+	T* AcquireWait();
+
+	/// <summary>
+	///		Resets an object and gives it back to the pool, without destructing it
+	/// </summary>
+	/// <remarks>
+	///		The object must be managed by the pool or the function will fail
+	/// </remarks>
+	void Release(T* object);
+
+	// ***NON-ATOMIC INTERFACE
+
+	//-------------------------------------------------------------------------
+	cLockFreeRecyclingPool(unsigned n, const Reset& reset = Reset(), const Allocator& allocator = Allocator());
+
+	/// <summary>
+	///		Destructs every object the pool constructed, released or not
+	/// </summary>
+	~cLockFreeRecyclingPool();
+
+	/// <summary>
+	///		Queries if the pool has no objects left
+	/// </summary>
+	bool		Empty() const { return mPool.Empty(); }
+
+	/// <summary>
+	///		Queries the maximum number of objects the pool can contain
+	/// </summary>
+	unsigned	GetCapacity() const { return mPool.GetCapacity(); }
+
+	/// <summary>
+	///		Queries if the pool has all objects available
+	/// </summary>
+	/// <remarks>
+	///		This function's complexity is O(N)
+	/// </remarks>
+	bool		Full() const { return mPool.Full(); }
+
+	/// <summary>
+	///		Queries if an object is managed by (i.e., part of) the pool
+	/// </summary>
+	bool		Manages(const T* object) const;
+
+	/// <summary>
+	///		Queries the number of objects constructed so far (i.e., the slots used at least once)
+	/// </summary>
+	unsigned	GetNumConstructed() const;
+
+private:
+	cLockFreeRecyclingPool(const cLockFreeRecyclingPool&) = delete;
+	cLockFreeRecyclingPool& operator=(const cLockFreeRecyclingPool&) = delete;
+
+	//-------------------------------------------------------------------------
+	struct tSlot
+	{
+		uint64_t	mLink;			// where the pool keeps its freelist node while the slot is free
+		bool		mConstructed;
+		alignas(T) unsigned char mObject[sizeof(T)];
+	};
+
+	typedef typename std::allocator_traits<Allocator>::template rebind_alloc<tSlot> tSlotAllocator;
+
+	static T*		GetObject(tSlot* slot) { return reinterpret_cast<T*>(slot->mObject); }
+	static tSlot*	GetSlot(const T* object);
+	T*				PrepareSlot(tSlot* slot);
+
+	cLockFreePool<tSlot, tSlotAllocator>	mPool;
+	Reset									mReset;
+};
+
+#include "lockfree_recycling_pool.inl"
+}
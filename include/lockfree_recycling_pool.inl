@@ -0,0 +1,89 @@
+
+//-------------------------------------------------------------------------
+template <typename T, class Reset, class Allocator>
+cLockFreeRecyclingPool<T, Reset, Allocator>::cLockFreeRecyclingPool(unsigned n, const Reset& reset, const Allocator& allocator)
+	: mPool(n, tSlotAllocator(allocator))
+	, mReset(reset)
+{
+	// The pool only writes the links of the slots
+	for (unsigned idx = 0; idx != mPool.GetCapacity(); ++idx)
+	{
+		mPool.GetElement(idx)->mConstructed = false;
+	}
+}
+
+//-------------------------------------------------------------------------
+template <typename T, class Reset, class Allocator>
+cLockFreeRecyclingPool<T, Reset, Allocator>::~cLockFreeRecyclingPool()
+{
+	for (unsigned idx = 0; idx != mPool.GetCapacity(); ++idx)
+	{
+		tSlot* const slot = mPool.GetElement(idx);
+		if (slot->mConstructed)
+		{
+			GetObject(slot)->~T();
+		}
+	}
+}
+
+//-------------------------------------------------------------------------
+template <typename T, class Reset, class Allocator>
+T* cLockFreeRecyclingPool<T, Reset, Allocator>::Acquire()
+{
+	tSlot* const slot = mPool.AcquirePtr();
+	return slot ? PrepareSlot(slot) : nullptr;
+}
+
+//-------------------------------------------------------------------------
+template <typename T, class Reset, class Allocator>
+T* cLockFreeRecyclingPool<T, Reset, Allocator>::AcquireWait()
+{
+	return PrepareSlot(mPool.AcquirePtrWait());
+}
+
+//-------------------------------------------------------------------------
+template <typename T, class Reset, class Allocator>
+void cLockFreeRecyclingPool<T, Reset, Allocator>::Release(T* object)
+{
+	mReset(*object);
+	mPool.ReleasePtr(GetSlot(object));
+}
+
+//-------------------------------------------------------------------------
+template <typename T, class Reset, class Allocator>
+bool cLockFreeRecyclingPool<T, Reset, Allocator>::Manages(const T* object) const
+{
+	return mPool.Manages(GetSlot(object));
+}
+
+//-------------------------------------------------------------------------
+template <typename T, class Reset, class Allocator>
+unsigned cLockFreeRecyclingPool<T, Reset, Allocator>::GetNumConstructed() const
+{
+	unsigned num_constructed = 0;
+	for (unsigned idx = 0; idx != mPool.GetCapacity(); ++idx)
+	{
+		num_constructed += mPool.GetElement(idx)->mConstructed ? 1 : 0;
+	}
+	return num_constructed;
+}
+
+//-------------------------------------------------------------------------
+template <typename T, class Reset, class Allocator>
+auto cLockFreeRecyclingPool<T, Reset, Allocator>::GetSlot(const T* object) -> tSlot*
+{
+	return reinterpret_cast<tSlot*>(reinterpret_cast<uintptr_t>(object) - offsetof(tSlot, mObject));
+}
+
+//-------------------------------------------------------------------------
+template <typename T, class Reset, class Allocator>
+T* cLockFreeRecyclingPool<T, Reset, Allocator>::PrepareSlot(tSlot* slot)
+{
+	// The slot is ours until released, nobody else looks at the flag meanwhile
+	if (!slot->mConstructed)
+	{
+		new (slot->mObject) T();
+		slot->mConstructed = true;
+	}
+	return GetObject(slot);
+}
@@ -0,0 +1,146 @@
+///////////////////////////////////////////////////////////////////////////
+//
+//lockfree_relaxed_queue.h
+//
+/////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "lockfree_pool.h"
+#include "lockfree_queue.h"
+#include "utils.h"
+
+namespace lockfree {
+
+/// <summary>
+///     Lockfree implementation of a MPMC (Multiple Producers-Multiple Consumers) non-intrusive pool-based queue with relaxed FIFO ordering
+///		(a.k.a. MultiQueue). It is made of a number of cLockFreeQueue lanes sharing the same pool. Producers push to a lane chosen per thread,
+///		consumers pick two lanes at random and pop from the fullest one (power of two choices). Elements pushed by the same thread to the same
+///		queue are popped in FIFO order with respect to each other, but elements pushed by different threads can be popped somewhat out of order.
+///
+///		Pros:
+///		- Scalable: producers and consumers are spread across lanes, so there is no single mFront/mBack every thread needs to CAS/XCHG.
+///		  Throughput grows with the number of lanes as long as there are enough threads to keep them busy
+///     - Same flexibility and zero-allocation as cLockFreeQueue (it is made of them)
+///
+///     Cons:
+///     - Only approximately FIFO. How far the order drifts depends on the number of lanes and on how balanced the producers are
+///		- Pop can return false while there are elements in the queue, if they are pushed concurrently to lanes already checked
+///		- The pool needs to account for one sentinel node per lane (local storage queues account for them internally)
+///		- Each lane keeps an approximate size counter, which costs one relaxed RMW on the lane's cache line per Push and Pop
+/// </summary>
+template <typename T, size_t lanes, size_t storage = LFQS_SHARED, class Allocator = std::allocator<detail::tLockFreeQueueNode<T>>>
+class cRelaxedLockFreeQueue;
+
+template <typename T, size_t lanes, class Allocator>
+class cRelaxedLockFreeQueue<T, lanes, LFQS_SHARED, Allocator>
+{
+	static_assert(lanes > 0, "At least one lane is required");
+
+protected:
+	typedef cLockFreeQueue<T, LFQS_SHARED, Allocator> tLaneQueue;
+
+public:
+	typedef T									tValueType;
+	typedef Allocator							tAllocatorType;
+	typedef typename tLaneQueue::tLockFreePool	tLockFreePool;
+
+	static const constexpr size_t NUM_LANES = lanes;
+
+	// ***ATOMIC INTERFACE
+
+	/// <summary>
+	///		Pushes a new object in the calling thread's lane atomically
+	/// </summary>
+	/// <return>
+	///		Returns true if object has been pushed successfully. False when an error occurs (like the pool being full, for example)
+	/// </return>
+	/// <remarks>
+	///		The object will be emplaced with the variadic arguments passed. An empty argument list will push a default-constructed item
+	/// </remarks>
+	template <typename... Args>
+	bool Push(Args&&... args);
+
+	/// <summary>
+	///		Pops an object in approximate FIFO ordering atomically
+	/// </summary>
+	/// <param name="result">
+	///     (Out) the pop object will be <b>moved</b> to this argument if pop succeeds
+	/// </param>
+	/// <return>
+	///		Returns true if an object could be pop. False otherwise.
+	/// </return>
+	bool Pop(T& result);
+
+	/// <summary>
+	///		Pops an object in approximate FIFO ordering atomically, handing it to a callable while it still resides in the queue's storage
+	/// </summary>
+	/// <param name="fnc">
+	///     Callable invoked as fnc(T&amp;) with the pop object if pop succeeds. The object is destroyed right after fnc returns
+	/// </param>
+	/// <return>
+	///		Returns true if an object could be pop. False otherwise.
+	/// </return>
+	template <typename Fnc>
+	bool PopWith(Fnc&& fnc);
+
+	// ***NON-ATOMIC INTERFACE
+
+	cRelaxedLockFreeQueue(tLockFreePool& pool);
+	~cRelaxedLockFreeQueue();
+
+	/// <summary>
+	///		Queries if all the lanes of the queue are empty
+	/// </summary>
+	/// <remarks>
+	///		Same caveats as cLockFreeQueue::Empty apply
+	/// </remarks>
+	bool Empty() const;
+
+private:
+	cRelaxedLockFreeQueue(const cRelaxedLockFreeQueue&) = delete;
+	cRelaxedLockFreeQueue& operator=(const cRelaxedLockFreeQueue&) = delete;
+
+	//-------------------------------------------------------------------------
+	struct alignas(CACHE_LINE_SIZE) tLane
+	{
+		tLane(tLockFreePool& pool)
+			: mQueue(pool)
+			, mApproxSize(0)
+		{}
+
+		tLaneQueue		mQueue;
+		atomic<int>		mApproxSize;
+	};
+
+	static size_t GetThreadLaneIdx();
+
+	template <typename Fnc>
+	bool PopWithFromLane(tLane& lane, Fnc& fnc);
+
+	tLane& GetLane(size_t idx) { return reinterpret_cast<tLane&>(mLanes[idx]); }
+	const tLane& GetLane(size_t idx) const { return reinterpret_cast<const tLane&>(mLanes[idx]); }
+
+	tAlignedStorage<tLane>	mLanes[lanes];
+};
+
+//----------------------------------------------------------------------------
+// This specialization uses a fixed-size local storage for the pool shared by the lanes
+template <typename T, size_t lanes, size_t storage, class Allocator>
+class cRelaxedLockFreeQueue
+	// the order in which we inherit from these is important, don't change it
+	: protected detail::cLockFreeQueueLocalStorage<storage + lanes, detail::local_storage_allocator<detail::tLockFreeQueueNodeFor<T, storage + lanes>, storage + lanes>>
+	, public cRelaxedLockFreeQueue<T, lanes, LFQS_SHARED, detail::local_storage_allocator<detail::tLockFreeQueueNodeFor<T, storage + lanes>, storage + lanes>>
+{
+	typedef detail::cLockFreeQueueLocalStorage<storage + lanes, detail::local_storage_allocator<detail::tLockFreeQueueNodeFor<T, storage + lanes>, storage + lanes>> tStorage;
+	typedef cRelaxedLockFreeQueue<T, lanes, LFQS_SHARED, detail::local_storage_allocator<detail::tLockFreeQueueNodeFor<T, storage + lanes>, storage + lanes>> tBaseQueue;
+
+public:
+	cRelaxedLockFreeQueue()
+		: tStorage()
+		, tBaseQueue(tStorage::mLocalPool)
+	{}
+};
+
+#include "lockfree_relaxed_queue.inl"
+
+}
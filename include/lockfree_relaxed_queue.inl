@@ -0,0 +1,113 @@
+
+//----------------------------------------------------------------------------
+template <typename T, size_t lanes, class Allocator>
+cRelaxedLockFreeQueue<T, lanes, LFQS_SHARED, Allocator>::cRelaxedLockFreeQueue(tLockFreePool& pool)
+{
+	for (size_t i = 0; i != lanes; ++i)
+	{
+		new (&mLanes[i]) tLane(pool);
+	}
+}
+
+//----------------------------------------------------------------------------
+template <typename T, size_t lanes, class Allocator>
+cRelaxedLockFreeQueue<T, lanes, LFQS_SHARED, Allocator>::~cRelaxedLockFreeQueue()
+{
+	for (size_t i = 0; i != lanes; ++i)
+	{
+		GetLane(i).~tLane();
+	}
+}
+
+//----------------------------------------------------------------------------
+template <typename T, size_t lanes, class Allocator>
+template <typename... Args>
+bool cRelaxedLockFreeQueue<T, lanes, LFQS_SHARED, Allocator>::Push(Args&&... args)
+{
+	tLane& lane = GetLane(GetThreadLaneIdx());
+	if (lane.mQueue.Push(forward<Args>(args)...))
+	{
+		lane.mApproxSize.fetch_add(1, memory_order_relaxed);
+		return true;
+	}
+
+	return false;
+}
+
+//----------------------------------------------------------------------------
+template <typename T, size_t lanes, class Allocator>
+bool cRelaxedLockFreeQueue<T, lanes, LFQS_SHARED, Allocator>::Pop(T& result)
+{
+	// See the comment in cLockFreeQueue::Pop if you get a compilation error here
+	return PopWith([&result](T& data) { result = move(data); });
+}
+
+//----------------------------------------------------------------------------
+template <typename T, size_t lanes, class Allocator>
+template <typename Fnc>
+bool cRelaxedLockFreeQueue<T, lanes, LFQS_SHARED, Allocator>::PopWith(Fnc&& fnc)
+{
+	// Power of two choices: of two lanes picked at random, the fullest is the one most likely to have the oldest elements
+	const uint32_t random = detail::ThreadLocalRandom();
+	const size_t first_idx = random % lanes;
+	const size_t second_idx = (random >> 16) % lanes;
+
+	tLane& first = GetLane(first_idx);
+	tLane& second = GetLane(second_idx);
+	const bool first_is_fullest = first.mApproxSize.load(memory_order_relaxed) >= second.mApproxSize.load(memory_order_relaxed);
+
+	if (PopWithFromLane(first_is_fullest ? first : second, fnc) || PopWithFromLane(first_is_fullest ? second : first, fnc))
+	{
+		return true;
+	}
+
+	// Both empty, so the queue is probably (nearly) empty: sweep the rest of the lanes before giving up
+	for (size_t i = 1; i != lanes; ++i)
+	{
+		const size_t idx = (first_idx + i) % lanes;
+		if ((idx != second_idx) && PopWithFromLane(GetLane(idx), fnc))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+//----------------------------------------------------------------------------
+template <typename T, size_t lanes, class Allocator>
+bool cRelaxedLockFreeQueue<T, lanes, LFQS_SHARED, Allocator>::Empty() const
+{
+	for (size_t i = 0; i != lanes; ++i)
+	{
+		if (!GetLane(i).mQueue.Empty())
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+//----------------------------------------------------------------------------
+template <typename T, size_t lanes, class Allocator>
+size_t cRelaxedLockFreeQueue<T, lanes, LFQS_SHARED, Allocator>::GetThreadLaneIdx()
+{
+	// Threads stick to one lane, so the elements they push are kept in FIFO order and their pushes don't bounce cache lines around
+	static thread_local const size_t lane_idx = detail::ThreadLocalRandom() % lanes;
+	return lane_idx;
+}
+
+//----------------------------------------------------------------------------
+template <typename T, size_t lanes, class Allocator>
+template <typename Fnc>
+bool cRelaxedLockFreeQueue<T, lanes, LFQS_SHARED, Allocator>::PopWithFromLane(tLane& lane, Fnc& fnc)
+{
+	if (lane.mQueue.PopWith(fnc))
+	{
+		lane.mApproxSize.fetch_sub(1, memory_order_relaxed);
+		return true;
+	}
+
+	return false;
+}
@@ -0,0 +1,182 @@
+///////////////////////////////////////////////////////////////////////////
+//
+//lockfree_skiplist_map.h
+//
+/////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "atomic_defs.h"
+#include "epoch.h"
+#include "lockfree_pool.h"
+#include "skiplist_node_pools.h"
+#include "utils.h"
+#include "debug.h"
+#include "tagged_ptr.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
+
+namespace lockfree {
+
+	namespace detail
+	{
+		template <typename Key, typename T>
+		struct tSkipListMapNode;
+	}
+
+/// <summary>
+///     Lockfree implementation of an ordered map, based on a skiplist ("A Pragmatic Implementation of Non-Blocking Linked-Lists", Harris
+///		2001, extended to skiplists as in "The Art of Multiprocessor Programming", Herlihy, Shavit 2008).
+///
+///		Links are tTaggedPtrs, the lowest bit of their tag marks the node that holds them as erased. Erasing a node marks its links from the
+///		top level down, the thread that marks the lowest level is the one that erased it. Marked nodes are unlinked by whoever finds them
+///		on their way (inserts and erases), and given back to the pools through epoch-based reclamation (see cEpochDomain).
+///
+///		Pros:
+///		- Find and range scans (ForEach, ForEachInRange) never write to shared memory, so they don't block or slow down writers
+///		- Insert and Erase only contend with operations on neighbouring keys
+///		- Zero-allocation: tower nodes come from pools, one per size class of tower heights (1, 2, 4, 8 and 16 levels), owned by the map
+///
+///     Cons:
+///		- Erased nodes are given back to the pools through epoch-based reclamation, so Insert can fail before the map holds as many
+///		  elements as its capacity if some thread stays too long inside an operation
+///		- Range scans are weakly consistent: they see every element present during the whole scan, and may or may not see the ones
+///		  inserted or erased meanwhile
+///		- Values can't be modified in place once inserted, to change one, erase it and insert it again
+///
+///		Requirements for Key and T:
+///		- Key needs to be ordered by Compare (a strict weak ordering) and to support copy construction
+///		- T needs to support move or copy construction
+/// </summary>
+template <typename Key, typename T, class Compare = std::less<Key>, class Allocator = std::allocator<std::pair<const Key, T>>>
+class cLockFreeSkipListMap
+{
+public:
+	typedef Key			tKeyType;
+	typedef T			tMappedType;
+	typedef Compare		tKeyCompare;
+	typedef Allocator	tAllocatorType;
+
+	static constexpr const unsigned MAX_HEIGHT = detail::SKIPLIST_MAX_HEIGHT;
+
+	// ***ATOMIC INTERFACE
+
+	/// <summary>
+	///		Inserts a new element with the key passed, unless there is one already
+	/// </summary>
+	/// <return>
+	///		Returns true if the element has been inserted. False if the key was already in the map, or when an error occurs (like the pools
+	///		being full, for example)
+	/// </return>
+	/// <remarks>
+	///		The value will be emplaced with the variadic arguments passed. An empty argument list will insert a default-constructed value
+	/// </remarks>
+	template <typename... Args>
+	bool Insert(const Key& key, Args&&... args);
+
+	/// <summary>
+	///		Looks for the element with the key passed
+	/// </summary>
+	/// <param name="result">
+	///     (Out) the value of the element will be copied to this argument if found
+	/// </param>
+	/// <return>
+	///		Returns true if the key was in the map. False otherwise
+	/// </return>
+	bool Find(const Key& key, T& result);
+
+	/// <summary>
+	///		Same as Find, handing the value in place to fnc(const T&amp;) instead of copying it out
+	/// </summary>
+	/// <remarks>
+	///		The value is guaranteed to stay alive while fnc runs, even if some other thread erases the element meanwhile
+	/// </remarks>
+	template <typename Fnc>
+	bool FindWith(const Key& key, Fnc&& fnc);
+
+	/// <summary>
+	///		Queries if the key passed is in the map
+	/// </summary>
+	bool Contains(const Key& key);
+
+	/// <summary>
+	///		Erases the element with the key passed
+	/// </summary>
+	/// <return>
+	///		Returns true if the key was in the map and this call erased it. False otherwise
+	/// </return>
+	bool Erase(const Key& key);
+
+	/// <summary>
+	///		Calls fnc(const Key&amp;, const T&amp;) for every element, in increasing order of key
+	/// </summary>
+	/// <return>
+	///		Returns the number of elements visited
+	/// </return>
+	template <typename Fnc>
+	unsigned ForEach(Fnc&& fnc);
+
+	/// <summary>
+	///		Calls fnc(const Key&amp;, const T&amp;) for every element with a key in [first, last), in increasing order of key
+	/// </summary>
+	/// <return>
+	///		Returns the number of elements visited
+	/// </return>
+	template <typename Fnc>
+	unsigned ForEachInRange(const Key& first, const Key& last, Fnc&& fnc);
+
+	/// <summary>
+	///		Queries if the map is empty
+	/// </summary>
+	/// <remarks>
+	///		Only a hint in a multithreaded environment, by the time you act on something that was "empty" it could be non-empty already
+	/// </remarks>
+	bool Empty();
+
+	// ***NON-ATOMIC INTERFACE
+
+	/// <param name="capacity">
+	///		Number of elements the map can hold. Split among the pools of the different size classes following the expected distribution
+	///		of tower heights
+	/// </param>
+	cLockFreeSkipListMap(unsigned capacity, const Compare& compare = Compare(), const Allocator& allocator = Allocator());
+	~cLockFreeSkipListMap();
+
+private:
+	cLockFreeSkipListMap(const cLockFreeSkipListMap&) = delete;
+	cLockFreeSkipListMap& operator=(const cLockFreeSkipListMap&) = delete;
+
+	typedef detail::tSkipListMapNode<Key, T>	tNode;
+	typedef typename tNode::tLinkValue			tLinkValue;
+	typedef typename tNode::tLink				tLink;
+
+	static constexpr const unsigned NUM_SIZE_CLASSES = detail::SKIPLIST_NUM_SIZE_CLASSES;
+
+	// Set on the tag of a link, it flags the node that holds it as erased
+	static constexpr const typename tLinkValue::tTag DELETED_MARK = 1;
+
+	// Node states. An erased node is unlinked and retired by whoever clears or sets the last of them
+	enum eNodeState : uint8_t { NS_INSERTING = 1, NS_ERASED = 2 };
+
+	typedef detail::cSkipListNodePools<tNode, NUM_SIZE_CLASSES, Allocator> tNodePools;
+
+	static bool IsMarked(const tLinkValue& link) { return (link.GetTag() & DELETED_MARK) != 0; }
+	static void ReclaimNode(tEpochNode* node, void* map);
+
+	bool	Less(const Key& lhs, const Key& rhs) const { return mCompare(lhs, rhs); }
+	bool	Locate(const Key& key, tNode** preds, tNode** succs);
+	tNode*	LowerBound(const Key& key) const;
+	tNode*	FindNode(const Key& key) const;
+	void	Unlink(tNode* node);
+
+	tNodePools		mPools;
+	cEpochDomain	mEpochDomain;	// after the pools, it gives nodes back to them on destruction
+	Compare			mCompare;
+	tNode*			mHead;			// sentinel with MAX_HEIGHT links, never erased
+};
+
+#include "lockfree_skiplist_map.inl"
+
+}
@@ -0,0 +1,410 @@
+
+namespace detail
+{
+	//----------------------------------------------------------------------------
+	// Header of a tower, followed by as many links as its height (see cSkipListNodePools)
+	template <typename Key, typename T>
+	struct tSkipListMapNode
+	{
+		typedef tTaggedPtr<tSkipListMapNode>	tLinkValue;
+		typedef atomic<tLinkValue>				tLink;
+
+		tLink* GetLinks() { return reinterpret_cast<tLink*>(this + 1); }
+		const Key& GetKey() const { return reinterpret_cast<const Key&>(mKey); }
+		T& GetValue() { return reinterpret_cast<T&>(mValue); }
+
+		void Destroy()
+		{
+			reinterpret_cast<Key&>(mKey).~Key();
+			GetValue().~T();
+		}
+
+		static tSkipListMapNode* FromEpochNode(tEpochNode* node) { return reinterpret_cast<tSkipListMapNode*>(node); }
+
+		tEpochNode				mEpochNode;		// needs to be the first member, see FromEpochNode
+		tAlignedStorage<Key>	mKey;
+		tAlignedStorage<T>		mValue;
+		atomic<uint8_t>			mState;
+		uint8_t					mHeight;
+		uint8_t					mSizeClass;
+	};
+}
+
+//----------------------------------------------------------------------------
+template <typename Key, typename T, class Compare, class Allocator>
+cLockFreeSkipListMap<Key, T, Compare, Allocator>::cLockFreeSkipListMap(unsigned capacity, const Compare& compare, const Allocator& allocator)
+	: mPools(detail::GetSkipListClassCapacities(capacity).data(), allocator)
+	, mEpochDomain(&ReclaimNode, this)
+	, mCompare(compare)
+	, mHead(nullptr)
+{
+	// The head never holds an element, its key and value are left unconstructed
+	mHead = mPools.Acquire(NUM_SIZE_CLASSES - 1);
+	LF_assert(mHead, "The last size class should always have room for the head");
+
+	new (&mHead->mState) atomic<uint8_t>(0);
+	mHead->mHeight = MAX_HEIGHT;
+	mHead->mSizeClass = NUM_SIZE_CLASSES - 1;
+	for (unsigned level = 0; level != MAX_HEIGHT; ++level)
+	{
+		new (&mHead->GetLinks()[level]) tLink(tLinkValue());
+	}
+}
+
+//----------------------------------------------------------------------------
+template <typename Key, typename T, class Compare, class Allocator>
+cLockFreeSkipListMap<Key, T, Compare, Allocator>::~cLockFreeSkipListMap()
+{
+	// Nodes still linked go away with the pools, only their elements need destroying. Erased ones have been retired already, they are
+	// destroyed by the epoch domain
+	tNode* node = mHead->GetLinks()[0].load(memory_order_relaxed).GetPtr();
+	while (node)
+	{
+		const tLinkValue next = node->GetLinks()[0].load(memory_order_relaxed);
+		if (!IsMarked(next))
+		{
+			node->Destroy();
+		}
+		node = next.GetPtr();
+	}
+}
+
+//----------------------------------------------------------------------------
+template <typename Key, typename T, class Compare, class Allocator>
+template <typename... Args>
+bool cLockFreeSkipListMap<Key, T, Compare, Allocator>::Insert(const Key& key, Args&&... args)
+{
+	// Some of the nodes could be waiting to be reclaimed by this thread, the epoch needs to advance twice for the latest ones
+	const unsigned height = detail::RandomSkipListHeight();
+	tNode* node = detail::AllocateSkipListNode(mPools, height);
+	for (unsigned attempt = 0; !node && (attempt != 2); ++attempt)
+	{
+		mEpochDomain.Reclaim();
+		node = detail::AllocateSkipListNode(mPools, height);
+	}
+	if (!node)
+	{
+		return false;
+	}
+
+	new (&node->mKey) Key(key);
+	new (&node->mValue) T(forward<Args>(args)...);
+	new (&node->mState) atomic<uint8_t>(NS_INSERTING);
+
+	tNode* preds[MAX_HEIGHT];
+	tNode* succs[MAX_HEIGHT];
+	tLink* const links = node->GetLinks();
+
+	cEpochDomain::cGuard guard(mEpochDomain);
+
+	// Linking the lowest level inserts the element, the upper ones are just shortcuts
+	for (;;)
+	{
+		if (Locate(key, preds, succs))
+		{
+			// Never published, it can go straight back to its pool
+			node->Destroy();
+			mPools.Release(node->mSizeClass, node);
+			return false;
+		}
+
+		for (unsigned level = 0; level != node->mHeight; ++level)
+		{
+			links[level].store(tLinkValue(succs[level]), memory_order_relaxed);
+		}
+
+		tLinkValue expected(succs[0]);
+		if (preds[0]->GetLinks()[0].compare_exchange_strong(expected, tLinkValue(node), memory_order_release, memory_order_relaxed))
+		{
+			break;
+		}
+	}
+
+	for (unsigned level = 1; level < node->mHeight; )
+	{
+		// A marked link means the element has been erased meanwhile, there's no point in linking it any further. The link is updated
+		// with a CAS so that a mark set meanwhile is not overwritten
+		tLinkValue link = links[level].load(memory_order_acquire);
+		if (IsMarked(link))
+		{
+			break;
+		}
+		if ((link.GetPtr() != succs[level]) &&
+			!links[level].compare_exchange_strong(link, tLinkValue(succs[level]), memory_order_acq_rel, memory_order_acquire))
+		{
+			break;
+		}
+
+		tLinkValue expected(succs[level]);
+		if (preds[level]->GetLinks()[level].compare_exchange_strong(expected, tLinkValue(node), memory_order_release, memory_order_relaxed))
+		{
+			++level;
+			continue;
+		}
+
+		// The neighbourhood changed, find it again. If our node is gone from the lowest level, it has been erased
+		Locate(key, preds, succs);
+		if (succs[0] != node)
+		{
+			break;
+		}
+	}
+
+	// If it was erased while we were linking it, it's up to us to unlink it for good and retire it
+	if (node->mState.fetch_and(static_cast<uint8_t>(~NS_INSERTING), memory_order_acq_rel) & NS_ERASED)
+	{
+		Unlink(node);
+		mEpochDomain.Retire(&node->mEpochNode);
+	}
+
+	return true;
+}
+
+//----------------------------------------------------------------------------
+template <typename Key, typename T, class Compare, class Allocator>
+bool cLockFreeSkipListMap<Key, T, Compare, Allocator>::Find(const Key& key, T& result)
+{
+	return FindWith(key, [&result](const T& value) { result = value; });
+}
+
+//----------------------------------------------------------------------------
+template <typename Key, typename T, class Compare, class Allocator>
+template <typename Fnc>
+bool cLockFreeSkipListMap<Key, T, Compare, Allocator>::FindWith(const Key& key, Fnc&& fnc)
+{
+	cEpochDomain::cGuard guard(mEpochDomain);
+	if (tNode* const node = FindNode(key))
+	{
+		fnc(const_cast<const T&>(node->GetValue()));
+		return true;
+	}
+	return false;
+}
+
+//----------------------------------------------------------------------------
+template <typename Key, typename T, class Compare, class Allocator>
+bool cLockFreeSkipListMap<Key, T, Compare, Allocator>::Contains(const Key& key)
+{
+	cEpochDomain::cGuard guard(mEpochDomain);
+	return FindNode(key) != nullptr;
+}
+
+//----------------------------------------------------------------------------
+template <typename Key, typename T, class Compare, class Allocator>
+bool cLockFreeSkipListMap<Key, T, Compare, Allocator>::Erase(const Key& key)
+{
+	tNode* preds[MAX_HEIGHT];
+	tNode* succs[MAX_HEIGHT];
+
+	cEpochDomain::cGuard guard(mEpochDomain);
+	if (!Locate(key, preds, succs))
+	{
+		return false;
+	}
+
+	tNode* const node = succs[0];
+	tLink* const links = node->GetLinks();
+
+	// Upper levels first, so that once the lowest one is marked no thread can link the node anywhere
+	for (unsigned level = node->mHeight; --level != 0; )
+	{
+		tLinkValue link = links[level].load(memory_order_acquire);
+		while (!IsMarked(link) &&
+			!links[level].compare_exchange_weak(link, tLinkValue(link.GetPtr(), DELETED_MARK), memory_order_acq_rel, memory_order_acquire))
+		{
+		}
+	}
+
+	// Whoever marks the lowest level erased the element
+	tLinkValue link = links[0].load(memory_order_acquire);
+	do
+	{
+		if (IsMarked(link))
+		{
+			return false;
+		}
+	} while (!links[0].compare_exchange_weak(link, tLinkValue(link.GetPtr(), DELETED_MARK), memory_order_acq_rel, memory_order_acquire));
+
+	// If the inserter is still linking it, it will unlink it and retire it once done
+	if (!(node->mState.fetch_or(NS_ERASED, memory_order_acq_rel) & NS_INSERTING))
+	{
+		Unlink(node);
+		mEpochDomain.Retire(&node->mEpochNode);
+	}
+
+	return true;
+}
+
+//----------------------------------------------------------------------------
+template <typename Key, typename T, class Compare, class Allocator>
+template <typename Fnc>
+unsigned cLockFreeSkipListMap<Key, T, Compare, Allocator>::ForEach(Fnc&& fnc)
+{
+	cEpochDomain::cGuard guard(mEpochDomain);
+
+	unsigned num_visited = 0;
+	tNode* node = mHead->GetLinks()[0].load(memory_order_acquire).GetPtr();
+	while (node)
+	{
+		const tLinkValue next = node->GetLinks()[0].load(memory_order_acquire);
+		if (!IsMarked(next))
+		{
+			fnc(node->GetKey(), const_cast<const T&>(node->GetValue()));
+			++num_visited;
+		}
+		node = next.GetPtr();
+	}
+
+	return num_visited;
+}
+
+//----------------------------------------------------------------------------
+template <typename Key, typename T, class Compare, class Allocator>
+template <typename Fnc>
+unsigned cLockFreeSkipListMap<Key, T, Compare, Allocator>::ForEachInRange(const Key& first, const Key& last, Fnc&& fnc)
+{
+	cEpochDomain::cGuard guard(mEpochDomain);
+
+	unsigned num_visited = 0;
+	tNode* node = LowerBound(first);
+	while (node && Less(node->GetKey(), last))
+	{
+		// The links of erased nodes don't change anymore, so walking through them never leads back to keys sorted before
+		const tLinkValue next = node->GetLinks()[0].load(memory_order_acquire);
+		if (!IsMarked(next))
+		{
+			fnc(node->GetKey(), const_cast<const T&>(node->GetValue()));
+			++num_visited;
+		}
+		node = next.GetPtr();
+	}
+
+	return num_visited;
+}
+
+//----------------------------------------------------------------------------
+template <typename Key, typename T, class Compare, class Allocator>
+bool cLockFreeSkipListMap<Key, T, Compare, Allocator>::Empty()
+{
+	cEpochDomain::cGuard guard(mEpochDomain);
+
+	tNode* node = mHead->GetLinks()[0].load(memory_order_acquire).GetPtr();
+	while (node)
+	{
+		const tLinkValue next = node->GetLinks()[0].load(memory_order_acquire);
+		if (!IsMarked(next))
+		{
+			return false;
+		}
+		node = next.GetPtr();
+	}
+
+	return true;
+}
+
+//----------------------------------------------------------------------------
+template <typename Key, typename T, class Compare, class Allocator>
+void cLockFreeSkipListMap<Key, T, Compare, Allocator>::ReclaimNode(tEpochNode* epoch_node, void* map)
+{
+	tNode* const node = tNode::FromEpochNode(epoch_node);
+	node->Destroy();
+	static_cast<cLockFreeSkipListMap*>(map)->mPools.Release(node->mSizeClass, node);
+}
+
+//----------------------------------------------------------------------------
+template <typename Key, typename T, class Compare, class Allocator>
+bool cLockFreeSkipListMap<Key, T, Compare, Allocator>::Locate(const Key& key, tNode** preds, tNode** succs)
+{
+	// Finds, on every level, the last node sorted before key and the one after it, unlinking the erased nodes found on the way. Returns
+	// whether the one after it on the lowest level holds key. Must be called inside a critical section
+retry:
+	tNode* pred = mHead;
+	for (unsigned level = MAX_HEIGHT; level-- != 0; )
+	{
+		tNode* curr = pred->GetLinks()[level].load(memory_order_acquire).GetPtr();
+		while (curr)
+		{
+			tLinkValue next = curr->GetLinks()[level].load(memory_order_acquire);
+			while (IsMarked(next))
+			{
+				// Only the predecessor link is changed, the erased node keeps pointing forward for any thread still walking through it
+				tLinkValue expected(curr);
+				if (!pred->GetLinks()[level].compare_exchange_strong(expected, tLinkValue(next.GetPtr()), memory_order_acq_rel, memory_order_relaxed))
+				{
+					goto retry;
+				}
+
+				curr = next.GetPtr();
+				if (!curr)
+				{
+					break;
+				}
+				next = curr->GetLinks()[level].load(memory_order_acquire);
+			}
+
+			if (!curr || !Less(curr->GetKey(), key))
+			{
+				break;
+			}
+
+			pred = curr;
+			curr = next.GetPtr();
+		}
+
+		preds[level] = pred;
+		succs[level] = curr;
+	}
+
+	return succs[0] && !Less(key, succs[0]->GetKey());
+}
+
+//----------------------------------------------------------------------------
+template <typename Key, typename T, class Compare, class Allocator>
+typename cLockFreeSkipListMap<Key, T, Compare, Allocator>::tNode* cLockFreeSkipListMap<Key, T, Compare, Allocator>::LowerBound(const Key& key) const
+{
+	// Read-only version of Locate: walks through erased nodes instead of unlinking them, so the node returned (the first one of the lowest
+	// level not sorted before key) might be an erased one. Must be called inside a critical section
+	tNode* pred = mHead;
+	tNode* curr = nullptr;
+	for (unsigned level = MAX_HEIGHT; level-- != 0; )
+	{
+		curr = pred->GetLinks()[level].load(memory_order_acquire).GetPtr();
+		while (curr && Less(curr->GetKey(), key))
+		{
+			pred = curr;
+			curr = curr->GetLinks()[level].load(memory_order_acquire).GetPtr();
+		}
+	}
+
+	return curr;
+}
+
+//----------------------------------------------------------------------------
+template <typename Key, typename T, class Compare, class Allocator>
+typename cLockFreeSkipListMap<Key, T, Compare, Allocator>::tNode* cLockFreeSkipListMap<Key, T, Compare, Allocator>::FindNode(const Key& key) const
+{
+	// An erased node and the one inserted again after it can both be linked for a while, skip any erased node with the same key. Must be
+	// called inside a critical section
+	tNode* node = LowerBound(key);
+	while (node && !Less(key, node->GetKey()))
+	{
+		const tLinkValue next = node->GetLinks()[0].load(memory_order_acquire);
+		if (!IsMarked(next))
+		{
+			return node;
+		}
+		node = next.GetPtr();
+	}
+
+	return nullptr;
+}
+
+//----------------------------------------------------------------------------
+template <typename Key, typename T, class Compare, class Allocator>
+void cLockFreeSkipListMap<Key, T, Compare, Allocator>::Unlink(tNode* node)
+{
+	// Every level of the node is marked already, looking for its key unlinks it from all of them
+	tNode* preds[MAX_HEIGHT];
+	tNode* succs[MAX_HEIGHT];
+	Locate(node->GetKey(), preds, succs);
+}
@@ -0,0 +1,278 @@
+///////////////////////////////////////////////////////////////////////////
+//
+//lockfree_slab_allocator.h
+//
+/////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "atomic_defs.h"
+#include "lockfree_pool.h"
+#include "utils.h"
+#include "debug.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// The std::pmr::memory_resource adapter needs C++17 and <memory_resource>. Define LF_PMR_ENABLED to 0 to leave it out anyway
+#if !defined LF_PMR_ENABLED
+	#if defined __has_include
+		#if __has_include(<memory_resource>) && ((defined _MSVC_LANG && _MSVC_LANG >= 201703L) || __cplusplus >= 201703L)
+			#define LF_PMR_ENABLED 1
+		#endif
+	#endif
+	#if !defined LF_PMR_ENABLED
+		#define LF_PMR_ENABLED 0
+	#endif
+#endif
+
+#if LF_PMR_ENABLED
+	#include <memory_resource>
+#endif
+
+namespace lockfree
+{
+	namespace detail
+	{
+		//----------------------------------------------------------------------------
+		template <size_t size, size_t alignment>
+		struct alignas(alignment) tSlabBlock
+		{
+			unsigned char mBytes[size];
+		};
+
+		//----------------------------------------------------------------------------
+		// One pool per size class, class c holds blocks of min_block_size << c bytes. Each level of the hierarchy adds the pool of the
+		// biggest class. Blocks are aligned to their size, up to the alignment of std::max_align_t
+		template <size_t min_block_size, unsigned num_classes, class Allocator>
+		class cSlabClassPools : public cSlabClassPools<min_block_size, num_classes - 1, Allocator>
+		{
+			typedef cSlabClassPools<min_block_size, num_classes - 1, Allocator> tBase;
+
+			static constexpr const unsigned SIZE_CLASS = num_classes - 1;
+			static constexpr const size_t BLOCK_SIZE = min_block_size << SIZE_CLASS;
+			static constexpr const size_t BLOCK_ALIGNMENT = (BLOCK_SIZE < alignof(std::max_align_t)) ? BLOCK_SIZE : alignof(std::max_align_t);
+
+			typedef tSlabBlock<BLOCK_SIZE, BLOCK_ALIGNMENT> tBlock;
+			typedef typename std::allocator_traits<Allocator>::template rebind_alloc<tBlock> tBlockAllocator;
+
+		public:
+			cSlabClassPools(size_t bytes_per_class, const Allocator& allocator)
+				: tBase(bytes_per_class, allocator)
+				, mPool(static_cast<unsigned>((std::max)(bytes_per_class / BLOCK_SIZE, size_t(1))), tBlockAllocator(allocator))
+			{}
+
+			void* Acquire(unsigned size_class)
+			{
+				return (size_class == SIZE_CLASS) ? mPool.AcquirePtr() : tBase::Acquire(size_class);
+			}
+
+			void Release(unsigned size_class, void* ptr)
+			{
+				if (size_class == SIZE_CLASS)
+				{
+					mPool.ReleasePtr(static_cast<tBlock*>(ptr));
+				}
+				else
+				{
+					tBase::Release(size_class, ptr);
+				}
+			}
+
+			void ReleaseBatch(unsigned size_class, void* const* ptrs, unsigned count)
+			{
+				if (size_class == SIZE_CLASS)
+				{
+					typename cLockFreePool<tBlock, tBlockAllocator>::tReleaseBatch batch;
+					for (unsigned i = 0; i != count; ++i)
+					{
+						mPool.BatchReleasePtr(batch, static_cast<tBlock*>(ptrs[i]));
+					}
+					mPool.ReleaseBatch(batch);
+				}
+				else
+				{
+					tBase::ReleaseBatch(size_class, ptrs, count);
+				}
+			}
+
+			// Size class of the pool that manages ptr, or ~0U if none does
+			unsigned FindSizeClass(const void* ptr) const
+			{
+				return mPool.Manages(static_cast<const tBlock*>(ptr)) ? SIZE_CLASS : tBase::FindSizeClass(ptr);
+			}
+
+			unsigned GetCapacity(unsigned size_class) const
+			{
+				return (size_class == SIZE_CLASS) ? mPool.GetCapacity() : tBase::GetCapacity(size_class);
+			}
+
+		private:
+			cLockFreePool<tBlock, tBlockAllocator> mPool;
+		};
+
+		//----------------------------------------------------------------------------
+		template <size_t min_block_size, class Allocator>
+		class cSlabClassPools<min_block_size, 0, Allocator>
+		{
+		public:
+			cSlabClassPools(size_t, const Allocator&) {}
+
+			void* Acquire(unsigned) { return nullptr; }
+			void Release(unsigned, void*) { LF_assert(false, "Invalid size class"); }
+			void ReleaseBatch(unsigned, void* const*, unsigned) { LF_assert(false, "Invalid size class"); }
+			unsigned FindSizeClass(const void*) const { return ~0U; }
+			unsigned GetCapacity(unsigned) const { return 0; }
+		};
+	}
+
+/// <summary>
+///     Lock-free slab allocator for variable-size allocations: one cLockFreePool per power-of-two size class, from MIN_BLOCK_SIZE to
+///		MAX_BLOCK_SIZE bytes. Requests are rounded up to the size class that fits them.
+///
+///		Pros:
+///		- Allocating and deallocating cost what acquiring and releasing from a cLockFreePool cost, plus picking the class
+///		- Zero-allocation: all the storage is allocated on construction. The pools carve it lazily, so the storage of a class is only
+///		  touched as far as it gets used, and big classes cost addresses rather than memory
+///
+///     Cons:
+///		- Up to half of every block is wasted by the rounding up to powers of two
+///		- Every class has its own fixed storage, a class running out doesn't borrow from the others
+///		- Requests bigger than MAX_BLOCK_SIZE, or aligned beyond std::max_align_t, can't be served (see cLockFreeSlabMemoryResource for
+///		  a memory resource that falls back to some other one for those)
+///
+///		num_size_classes sets MAX_BLOCK_SIZE, 4KB by default
+/// </summary>
+template <class Allocator = std::allocator<unsigned char>, unsigned num_size_classes = 10>
+class cLockFreeSlabAllocator
+{
+	static_assert(num_size_classes > 0, "At least one size class is required");
+
+public:
+	static constexpr const size_t MIN_BLOCK_SIZE = 8;
+	static constexpr const unsigned NUM_SIZE_CLASSES = num_size_classes;
+	static constexpr const size_t MAX_BLOCK_SIZE = MIN_BLOCK_SIZE << (NUM_SIZE_CLASSES - 1);
+
+	// ***ATOMIC INTERFACE
+
+	/// <summary>
+	///		Allocates a block of at least size bytes
+	/// </summary>
+	/// <return>
+	///		Returns the block, or nullptr if the request can't be served (too big, too aligned, or its size class ran out of blocks)
+	/// </return>
+	void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+	/// <summary>
+	///		Deallocates a block, given the size (and alignment) it was allocated with
+	/// </summary>
+	void Deallocate(void* ptr, size_t size, size_t alignment = alignof(std::max_align_t));
+
+	/// <summary>
+	///		Deallocates a block without knowing its size. Slower than the sized version, it has to look for the pool that manages it
+	/// </summary>
+	void Deallocate(void* ptr);
+
+	/// <summary>
+	///		Allocates a block straight from the pool of a size class
+	/// </summary>
+	/// <return>
+	///		Returns the block, or nullptr if the class ran out of blocks
+	/// </return>
+	void* AllocateFromClass(unsigned size_class);
+
+	/// <summary>
+	///		Deallocates a number of blocks of the same size class with a single atomic operation
+	/// </summary>
+	void DeallocateBatch(unsigned size_class, void* const* ptrs, unsigned count);
+
+	// ***NON-ATOMIC INTERFACE
+
+	/// <param name="bytes_per_class">
+	///		Storage for each of the size classes. Each class gets at least one block
+	/// </param>
+	cLockFreeSlabAllocator(size_t bytes_per_class, const Allocator& allocator = Allocator());
+
+	/// <summary>
+	///		Queries if some memory is managed by (i.e., was allocated from) the allocator
+	/// </summary>
+	bool Manages(const void* ptr) const;
+
+	/// <summary>
+	///		Queries the size class (index of the pool) a request would be served from, or NUM_SIZE_CLASSES if it can't be served
+	/// </summary>
+	static unsigned GetSizeClass(size_t size, size_t alignment = alignof(std::max_align_t));
+
+	/// <summary>
+	///		Queries the size of the blocks of a size class
+	/// </summary>
+	static constexpr size_t GetBlockSize(unsigned size_class) { return MIN_BLOCK_SIZE << size_class; }
+
+	/// <summary>
+	///		Queries the size class some memory was allocated from, or NUM_SIZE_CLASSES if it is not managed by the allocator
+	/// </summary>
+	unsigned FindSizeClass(const void* ptr) const;
+
+	/// <summary>
+	///		Queries the number of blocks of a size class
+	/// </summary>
+	unsigned GetCapacity(unsigned size_class) const { return mPools.GetCapacity(size_class); }
+
+private:
+	cLockFreeSlabAllocator(const cLockFreeSlabAllocator&) = delete;
+	cLockFreeSlabAllocator& operator=(const cLockFreeSlabAllocator&) = delete;
+
+	detail::cSlabClassPools<MIN_BLOCK_SIZE, NUM_SIZE_CLASSES, Allocator> mPools;
+};
+
+#if LF_PMR_ENABLED
+/// <summary>
+///     std::pmr::memory_resource serving allocations from a cLockFreeSlabAllocator, so pmr containers can allocate from lock-free pools.
+///		Requests the slab allocator can't serve go to the upstream resource
+/// </summary>
+template <class Allocator = std::allocator<unsigned char>, unsigned num_size_classes = 10>
+class cLockFreeSlabMemoryResource : public std::pmr::memory_resource
+{
+public:
+	/// <param name="slab_allocator">
+	///		Not owned, needs to outlive the resource
+	/// </param>
+	cLockFreeSlabMemoryResource(cLockFreeSlabAllocator<Allocator, num_size_classes>& slab_allocator, std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+		: mSlabAllocator(slab_allocator)
+		, mUpstream(upstream)
+	{}
+
+	std::pmr::memory_resource* GetUpstream() const { return mUpstream; }
+
+private:
+	void* do_allocate(size_t bytes, size_t alignment) override
+	{
+		void* const ptr = mSlabAllocator.Allocate(bytes, alignment);
+		return ptr ? ptr : mUpstream->allocate(bytes, alignment);
+	}
+
+	void do_deallocate(void* ptr, size_t bytes, size_t alignment) override
+	{
+		if (mSlabAllocator.Manages(ptr))
+		{
+			mSlabAllocator.Deallocate(ptr, bytes, alignment);
+		}
+		else
+		{
+			mUpstream->deallocate(ptr, bytes, alignment);
+		}
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+	{
+		return this == &other;
+	}
+
+	cLockFreeSlabAllocator<Allocator, num_size_classes>&	mSlabAllocator;
+	std::pmr::memory_resource*			mUpstream;
+};
+#endif
+
+#include "lockfree_slab_allocator.inl"
+}
@@ -0,0 +1,95 @@
+
+//----------------------------------------------------------------------------
+template <class Allocator, unsigned num_size_classes>
+cLockFreeSlabAllocator<Allocator, num_size_classes>::cLockFreeSlabAllocator(size_t bytes_per_class, const Allocator& allocator)
+	: mPools(bytes_per_class, allocator)
+{
+}
+
+//----------------------------------------------------------------------------
+template <class Allocator, unsigned num_size_classes>
+void* cLockFreeSlabAllocator<Allocator, num_size_classes>::Allocate(size_t size, size_t alignment)
+{
+	const unsigned size_class = GetSizeClass(size, alignment);
+	return (size_class != NUM_SIZE_CLASSES) ? mPools.Acquire(size_class) : nullptr;
+}
+
+//----------------------------------------------------------------------------
+template <class Allocator, unsigned num_size_classes>
+void cLockFreeSlabAllocator<Allocator, num_size_classes>::Deallocate(void* ptr, size_t size, size_t alignment)
+{
+	if (!ptr)
+	{
+		return;
+	}
+
+	const unsigned size_class = GetSizeClass(size, alignment);
+	LF_assert(size_class == mPools.FindSizeClass(ptr), "Deallocating with a size (or alignment) different than the allocation's");
+	mPools.Release(size_class, ptr);
+}
+
+//----------------------------------------------------------------------------
+template <class Allocator, unsigned num_size_classes>
+void cLockFreeSlabAllocator<Allocator, num_size_classes>::Deallocate(void* ptr)
+{
+	if (!ptr)
+	{
+		return;
+	}
+
+	const unsigned size_class = mPools.FindSizeClass(ptr);
+	LF_assert(size_class < NUM_SIZE_CLASSES, "Trying to deallocate memory not managed by this allocator!");
+	mPools.Release(size_class, ptr);
+}
+
+//----------------------------------------------------------------------------
+template <class Allocator, unsigned num_size_classes>
+void* cLockFreeSlabAllocator<Allocator, num_size_classes>::AllocateFromClass(unsigned size_class)
+{
+	LF_assert(size_class < NUM_SIZE_CLASSES, "Invalid size class");
+	return mPools.Acquire(size_class);
+}
+
+//----------------------------------------------------------------------------
+template <class Allocator, unsigned num_size_classes>
+void cLockFreeSlabAllocator<Allocator, num_size_classes>::DeallocateBatch(unsigned size_class, void* const* ptrs, unsigned count)
+{
+	if (count != 0)
+	{
+		mPools.ReleaseBatch(size_class, ptrs, count);
+	}
+}
+
+//----------------------------------------------------------------------------
+template <class Allocator, unsigned num_size_classes>
+bool cLockFreeSlabAllocator<Allocator, num_size_classes>::Manages(const void* ptr) const
+{
+	return mPools.FindSizeClass(ptr) < NUM_SIZE_CLASSES;
+}
+
+//----------------------------------------------------------------------------
+template <class Allocator, unsigned num_size_classes>
+unsigned cLockFreeSlabAllocator<Allocator, num_size_classes>::FindSizeClass(const void* ptr) const
+{
+	const unsigned size_class = mPools.FindSizeClass(ptr);
+	return (size_class < NUM_SIZE_CLASSES) ? size_class : NUM_SIZE_CLASSES;
+}
+
+//----------------------------------------------------------------------------
+template <class Allocator, unsigned num_size_classes>
+unsigned cLockFreeSlabAllocator<Allocator, num_size_classes>::GetSizeClass(size_t size, size_t alignment)
+{
+	// Blocks are aligned to their size (up to std::max_align_t), so a class big enough for the alignment is aligned enough too
+	if (alignment > alignof(std::max_align_t))
+	{
+		return NUM_SIZE_CLASSES;
+	}
+
+	const size_t needed = (std::max)(size, alignment);
+	unsigned size_class = 0;
+	for (size_t block_size = MIN_BLOCK_SIZE; (block_size < needed) && (size_class != NUM_SIZE_CLASSES); block_size <<= 1)
+	{
+		++size_class;
+	}
+	return size_class;
+}
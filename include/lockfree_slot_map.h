@@ -0,0 +1,143 @@
+///////////////////////////////////////////////////////////////////////////
+//
+//lockfree_slot_map.h
+//
+/////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "atomic_defs.h"
+#include "lockfree_pool.h"
+#include "utils.h"
+#include "debug.h"
+
+#include <cstdint>
+#include <memory>
+
+namespace lockfree {
+
+/// <summary>
+///     Lockfree slot map: a cLockFreePool whose elements are referred to by 32-bit handles instead of pointers.
+///
+///		A handle packs the index of the element in the pool (its lowest index_bits bits) and the generation of its slot (the rest). Every
+///		slot has a generation counter, odd while the slot is live and even while it is free, bumped by both Acquire and Release. A handle
+///		only resolves while the generation of its slot still matches the one it was created with, so handles to released elements (or to
+///		elements released and acquired again) are detected as stale instead of silently aliasing whatever lives in their slot now.
+///
+///		Pros:
+///		- Handles are half the size of a pointer and resolve in O(1), with an index and a compare
+///		- Releasing is safe against stale and duplicated handles: only one Release of the same element succeeds
+///		- Zero-allocation, besides the pool and the generation counters allocated on construction
+///
+///     Cons:
+///		- Generations wrap around after 2^(31 - index_bits) reuses of the same slot, a handle kept that long could resolve again
+///		- Resolving a handle gives a plain pointer: it's up to the user not to release the element while some other thread uses it
+///		- Capacity is limited to 2^index_bits - 1 elements (and to what the pool allows for T, see cLockFreePool)
+/// </summary>
+template <typename T, unsigned index_bits = 20, class Allocator = std::allocator<T>>
+class cLockFreeSlotMap
+{
+	static_assert((index_bits > 0) && (index_bits < 31), "There must be room for both the index and the generation in a handle");
+
+public:
+	typedef T tElement;
+
+	static constexpr const unsigned INDEX_BITS = index_bits;
+	static constexpr const unsigned MAX_CAPACITY = (1U << index_bits) - 1;
+
+	//-------------------------------------------------------------------------
+	struct tHandle
+	{
+		static constexpr const uint32_t INVALID = UINT32_MAX;
+
+		tHandle() : mValue(INVALID) {}
+		tHandle(uint32_t index, uint32_t generation) : mValue((generation << index_bits) | index) {}
+
+		bool		IsValid() const { return mValue != INVALID; }
+		uint32_t	GetIndex() const { return mValue & MAX_CAPACITY; }
+		uint32_t	GetGeneration() const { return mValue >> index_bits; }
+
+		bool operator==(const tHandle& rhs) const { return mValue == rhs.mValue; }
+		bool operator!=(const tHandle& rhs) const { return mValue != rhs.mValue; }
+
+		uint32_t mValue;
+	};
+
+	// ***ATOMIC INTERFACE
+
+	/// <summary>
+	///		Acquires and constructs one element
+	/// </summary>
+	/// <return>
+	///		Returns the handle of the new element, or an invalid handle if the map is full
+	/// </return>
+	template <typename... Args>
+	tHandle Acquire(Args&&... args);
+
+	/// <summary>
+	///		Destructs and releases the element of a handle
+	/// </summary>
+	/// <return>
+	///		Returns true if the handle was live and this call released it. False if it was stale (or invalid)
+	/// </return>
+	bool Release(tHandle handle);
+
+	/// <summary>
+	///		Gets the element of a handle
+	/// </summary>
+	/// <return>
+	///		Returns a pointer to the element, or nullptr if the handle is stale (or invalid)
+	/// </return>
+	T* Resolve(tHandle handle) const;
+
+	/// <summary>
+	///		Queries if the element of a handle is still live
+	/// </summary>
+	bool IsLive(tHandle handle) const;
+
+	/// <summary>
+	///		Calls fnc(tHandle, T&amp;) for every live element, in storage order
+	/// </summary>
+	/// <return>
+	///		Returns the number of elements visited
+	/// </return>
+	/// <remarks>
+	///		Elements acquired or released meanwhile may or may not be visited. Elements must not be released by other threads while they
+	///		are being visited
+	/// </remarks>
+	template <typename Fnc>
+	unsigned ForEach(Fnc&& fnc);
+
+	// ***NON-ATOMIC INTERFACE
+
+	cLockFreeSlotMap(unsigned capacity, const Allocator& allocator = Allocator());
+	~cLockFreeSlotMap();
+
+	/// <summary>
+	///		Queries the maximum number of elements the map can contain
+	/// </summary>
+	unsigned GetCapacity() const { return mPool.GetCapacity(); }
+
+	/// <summary>
+	///		Gets the handle of a live element from a pointer to it
+	/// </summary>
+	tHandle GetHandle(const T* element) const;
+
+private:
+	cLockFreeSlotMap(const cLockFreeSlotMap&) = delete;
+	cLockFreeSlotMap& operator=(const cLockFreeSlotMap&) = delete;
+
+	typedef atomic<uint32_t> tGeneration;
+	typedef typename std::allocator_traits<Allocator>::template rebind_alloc<tGeneration> tGenerationAllocator;
+
+	static constexpr const uint32_t GENERATION_MASK = UINT32_MAX >> index_bits;
+
+	static bool IsLiveGeneration(uint32_t generation) { return (generation & 1) != 0; }
+
+	cLockFreePool<T, Allocator>	mPool;
+	tGenerationAllocator		mGenerationAllocator;
+	tGeneration*				mGenerations;	// one per slot of the pool, full 32-bit counters, handles only keep their lowest bits
+};
+
+#include "lockfree_slot_map.inl"
+
+}
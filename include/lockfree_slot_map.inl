@@ -0,0 +1,119 @@
+
+//----------------------------------------------------------------------------
+template <typename T, unsigned index_bits, class Allocator>
+cLockFreeSlotMap<T, index_bits, Allocator>::cLockFreeSlotMap(unsigned capacity, const Allocator& allocator)
+	: mPool((std::min)(capacity, MAX_CAPACITY), allocator)
+	, mGenerationAllocator(allocator)
+	, mGenerations(nullptr)
+{
+	mGenerations = mGenerationAllocator.allocate(mPool.GetCapacity());
+	for (unsigned idx = 0; idx != mPool.GetCapacity(); ++idx)
+	{
+		new (&mGenerations[idx]) tGeneration(0);
+	}
+}
+
+//----------------------------------------------------------------------------
+template <typename T, unsigned index_bits, class Allocator>
+cLockFreeSlotMap<T, index_bits, Allocator>::~cLockFreeSlotMap()
+{
+	for (unsigned idx = 0; idx != mPool.GetCapacity(); ++idx)
+	{
+		if (IsLiveGeneration(mGenerations[idx].load(memory_order_relaxed)))
+		{
+			mPool.GetElement(idx)->~T();
+		}
+	}
+
+	mGenerationAllocator.deallocate(mGenerations, mPool.GetCapacity());
+}
+
+//----------------------------------------------------------------------------
+template <typename T, unsigned index_bits, class Allocator>
+template <typename... Args>
+auto cLockFreeSlotMap<T, index_bits, Allocator>::Acquire(Args&&... args) -> tHandle
+{
+	T* const element = mPool.Acquire(forward<Args>(args)...);
+	if (!element)
+	{
+		return tHandle();
+	}
+
+	// Only bumped once the element is constructed, so whoever resolves the new handle sees it constructed
+	const unsigned idx = mPool.GetElementIndex(element);
+	const uint32_t generation = mGenerations[idx].fetch_add(1, memory_order_release) + 1;
+	LF_assert(IsLiveGeneration(generation), "Acquired a slot that was live already");
+
+	return tHandle(idx, generation & GENERATION_MASK);
+}
+
+//----------------------------------------------------------------------------
+template <typename T, unsigned index_bits, class Allocator>
+bool cLockFreeSlotMap<T, index_bits, Allocator>::Release(tHandle handle)
+{
+	const uint32_t idx = handle.GetIndex();
+	if (!handle.IsValid() || (idx >= mPool.GetCapacity()))
+	{
+		return false;
+	}
+
+	// Whoever moves the generation from live to free owns the element, any other Release of the same handle fails
+	uint32_t generation = mGenerations[idx].load(memory_order_relaxed);
+	do
+	{
+		if (!IsLiveGeneration(generation) || ((generation & GENERATION_MASK) != handle.GetGeneration()))
+		{
+			return false;
+		}
+	} while (!mGenerations[idx].compare_exchange_weak(generation, generation + 1, memory_order_acquire, memory_order_relaxed));
+
+	mPool.Release(mPool.GetElement(idx));
+	return true;
+}
+
+//----------------------------------------------------------------------------
+template <typename T, unsigned index_bits, class Allocator>
+T* cLockFreeSlotMap<T, index_bits, Allocator>::Resolve(tHandle handle) const
+{
+	return IsLive(handle) ? mPool.GetElement(handle.GetIndex()) : nullptr;
+}
+
+//----------------------------------------------------------------------------
+template <typename T, unsigned index_bits, class Allocator>
+bool cLockFreeSlotMap<T, index_bits, Allocator>::IsLive(tHandle handle) const
+{
+	// Live generations are odd, so a handle that matches its slot is live too
+	const uint32_t idx = handle.GetIndex();
+	return handle.IsValid() && (idx < mPool.GetCapacity()) && IsLiveGeneration(handle.GetGeneration()) &&
+		((mGenerations[idx].load(memory_order_acquire) & GENERATION_MASK) == handle.GetGeneration());
+}
+
+//----------------------------------------------------------------------------
+template <typename T, unsigned index_bits, class Allocator>
+template <typename Fnc>
+unsigned cLockFreeSlotMap<T, index_bits, Allocator>::ForEach(Fnc&& fnc)
+{
+	unsigned num_visited = 0;
+	for (unsigned idx = 0; idx != mPool.GetCapacity(); ++idx)
+	{
+		const uint32_t generation = mGenerations[idx].load(memory_order_acquire);
+		if (IsLiveGeneration(generation))
+		{
+			fnc(tHandle(idx, generation & GENERATION_MASK), *mPool.GetElement(idx));
+			++num_visited;
+		}
+	}
+
+	return num_visited;
+}
+
+//----------------------------------------------------------------------------
+template <typename T, unsigned index_bits, class Allocator>
+auto cLockFreeSlotMap<T, index_bits, Allocator>::GetHandle(const T* element) const -> tHandle
+{
+	const unsigned idx = mPool.GetElementIndex(element);
+	const uint32_t generation = mGenerations[idx].load(memory_order_acquire);
+	LF_assert(IsLiveGeneration(generation), "The element is not live");
+
+	return tHandle(idx, generation & GENERATION_MASK);
+}
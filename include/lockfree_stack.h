@@ -9,12 +9,18 @@
 #include "tagged_ptr.h"
 #include "utils.h"
 
+#include <chrono>
+
 namespace lockfree {
 
 	namespace detail
 	{
-		template <typename T>
+		template <typename T, template <typename> class tLink = tTaggedPtr, bool trivial = tIsTriviallyStorable<T>::value>
 		struct tLockFreeStackNode;
+
+		// Nodes of stacks with local storage for N of them. Linked by pool index (8 bytes less per node, and a 32-bit mTop) when they fit
+		template <typename T, size_t N>
+		using tLockFreeStackNodeFor = std::conditional_t<(N <= TAGGED_INDEX_MAX_ELEMENTS), tLockFreeStackNode<T, tTaggedIndex>, tLockFreeStackNode<T>>;
 	}
 
 	enum eLockFreeStackStorage : size_t { LFSS_SHARED = 0 };
@@ -40,6 +46,12 @@ namespace lockfree {
 ///		Requirements for T:
 ///		- T needs to support move or copy construction (the former will be chosen over the second if available), and move or copy assignment
 ///		- T's move or copy assignment and move or copy construction need to be thread-safe and lock-free
+///
+///		Nodes are linked with tagged pointers by default. An allocator of detail::tLockFreeStackNode&lt;T, tTaggedIndex&gt; links them by
+///		index within the pool instead, which needs the pool to have 65535 nodes at most. Stacks with local storage do so whenever it fits
+///
+///		Nodes of trivial T (see detail::tIsTriviallyStorable) have nothing to destroy: PopBulk copies their objects out and gives all the
+///		nodes back to the pool at once
 /// </summary>
 /// <remarks>
 ///		Note on the choice for naming the "mPrev" pointer: many other implementations seem to prefer to use "next", as the next element that 
@@ -54,10 +66,12 @@ template <typename T, class Allocator>
 class cLockFreeStack<T, LFSS_SHARED, Allocator>
 {
 protected:
-	typedef detail::tLockFreeStackNode<T>	tElement;
-	typedef typename tElement::tNodePtr		tNodePtr;
+	typedef typename Allocator::value_type		tElement;
+	typedef typename tElement::tNodePtr			tNodePtr;
+	typedef detail::tNodeLinkTraits<tNodePtr>	tNodeLinks;
 
-	static_assert(std::is_same<typename Allocator::value_type, tElement>::value, "The allocator provided does not allocate the right type");
+	static_assert(std::is_same<tElement, detail::tLockFreeStackNode<T, tTaggedPtr, tElement::IS_TRIVIAL>>::value || std::is_same<tElement, detail::tLockFreeStackNode<T, tTaggedIndex, tElement::IS_TRIVIAL>>::value, 
+		"The allocator provided does not allocate the right type");
 
 public:
 	typedef T										tValueType;
@@ -78,6 +92,26 @@ public:
 	template <typename... Args>
 	bool Push(Args&&... args);
 
+	/// <summary> 
+	///		Pushes a new object in the stack atomically. If the pool is exhausted, blocks the calling thread until some node is released to it
+	/// </summary>
+	/// <remarks>
+	///		The object will be emplaced with the variadic arguments passed. They are only consumed by the attempt that succeeds.
+	///		Parked producers don't compete with the consumers that are freeing nodes, and releasing nodes only goes to the OS when
+	///		there are producers parked
+	/// </remarks>
+	template <typename... Args>
+	void PushWait(Args&&... args);
+
+	/// <summary> 
+	///		Same as PushWait, but gives up if the pool remains exhausted for longer than the timeout passed
+	/// </summary>
+	/// <return>
+	///		Returns true if object has been pushed successfully before timing out. False otherwise
+	/// </return>
+	template <class Rep, class Period, typename... Args>
+	bool PushFor(const std::chrono::duration<Rep, Period>& timeout, Args&&... args);
+
 	/// <summary> 
 	///		Pops the next object in LIFO ordering atomically.
 	/// </summary>
@@ -89,6 +123,42 @@ public:
 	/// </return>
 	bool Pop(T& result);
 
+	/// <summary> 
+	///		Pops the next object in LIFO ordering atomically, handing it to a callable while it still resides in the stack's storage
+	/// </summary>
+	/// <param name="fnc">
+	///     Callable invoked as fnc(T&amp;) with the pop object if pop succeeds. The object is destroyed right after fnc returns, so it 
+	///		can be moved from, but references to it must not be kept
+	/// </param>
+	/// <return>
+	///		Returns true if the stack was not empty and an object could be pop. False otherwise.
+	/// </return>
+	/// <remarks>
+	///		Saves the copy (or move) of the object out of the node that Pop needs, which adds up with big objects
+	/// </remarks>
+	template <typename Fnc>
+	bool PopWith(Fnc&& fnc);
+
+	/// <summary> 
+	///		Pushes a number of objects, copied from an array, atomically as a whole. They get linked among themselves first, and then 
+	///		on top of the stack with a single CAS. The last one ends up on top
+	/// </summary>
+	/// <return>
+	///		Returns the number of objects pushed, fewer than count if the pool runs out of nodes
+	/// </return>
+	unsigned PushBulk(const T* values, unsigned count);
+
+	/// <summary> 
+	///		Pops up to max_count objects in LIFO ordering atomically as a whole, unlinking all of them from the stack with a single CAS
+	/// </summary>
+	/// <param name="results">
+	///     (Out) array the pop objects will be <b>moved</b> to, in the order they are popped
+	/// </param>
+	/// <return>
+	///		Returns the number of objects popped, 0 if the stack was empty
+	/// </return>
+	unsigned PopBulk(T* results, unsigned max_count);
+
 	// ***NON-ATOMIC INTERFACE
 	cLockFreeStack(tLockFreePool& pool);
 	~cLockFreeStack();
@@ -128,14 +198,30 @@ public:
 	/// </return>
 	bool NonAtomicPop(T& result);
 
+	/// <summary> 
+	///		Pops the next object in LIFO ordering non atomically, handing it to a callable while it still resides in the stack's storage
+	/// </summary>
+	/// <param name="fnc">
+	///     Callable invoked as fnc(T&amp;) with the pop object if pop succeeds. The object is destroyed right after fnc returns
+	/// </param>
+	/// <return>
+	///		Returns true if the stack was not empty and an object could be pop. False otherwise.
+	/// </return>
+	template <typename Fnc>
+	bool NonAtomicPopWith(Fnc&& fnc);
+
 private:
 	// TODO: Implement copy/move 
 	cLockFreeStack(const cLockFreeStack&) = delete;
 	cLockFreeStack& operator=(const cLockFreeStack&) = delete;
 
 	void LinkTopNodeAtomically(tElement* new_node);
+	void LinkTopChainAtomically(tElement* first_node, tElement* last_node, unsigned count);
 	void LinkTopNodeNonAtomically(tElement* new_node);
 
+	tElement* GetNode(const tNodePtr& link) const { return tNodeLinks::GetNode(link, mNodePool); }
+	tNodePtr GetLink(tElement* node, typename tNodePtr::tTag tag) const { return tNodeLinks::GetLink(node, tag, mNodePool); }
+
 	tLockFreePool&		mNodePool;
 	atomic<tNodePtr>	mTop;
 	_if_diagnosing(atomic<unsigned> mCount;)
@@ -145,11 +231,11 @@ private:
 // This specialization uses a fixed-size local storage for the pool used by the stack
 // TODO: In local-storage stacks, NonAtomic Pushes and Pops could be optimized to use a non-atomic version of the lockfree pool's Acquire/Release member functions. Implement this
 template <typename T, size_t storage, class Allocator>
-class cLockFreeStack : public cLockFreeStack<T, LFSS_SHARED, detail::local_storage_allocator<detail::tLockFreeStackNode<T>, storage>>
+class cLockFreeStack : public cLockFreeStack<T, LFSS_SHARED, detail::local_storage_allocator<detail::tLockFreeStackNodeFor<T, storage>, storage>>
 {
 	static const constexpr size_t CAPACITY = storage;
 
-	typedef cLockFreeStack<T, LFSS_SHARED, detail::local_storage_allocator<detail::tLockFreeStackNode<T>, storage>> tBase;
+	typedef cLockFreeStack<T, LFSS_SHARED, detail::local_storage_allocator<detail::tLockFreeStackNodeFor<T, storage>, storage>> tBase;
 	using typename tBase::tAllocatorType;
 	using typename tBase::tElement;
 	using typename tBase::tLockFreePool;
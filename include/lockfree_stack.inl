@@ -1,22 +1,19 @@
 namespace detail
 {
 	//----------------------------------------------------------------------------
-	template <typename T>
+	// T lives in the node as is whatever it is. Trivial T has nothing to destroy, which lets PopBulk give the nodes back all at once
+	template <typename T, template <typename> class tLink, bool trivial>
 	struct tLockFreeStackNode
 	{
-		typedef tTaggedPtr<tLockFreeStackNode> tNodePtr;
+		static_assert(!trivial || tIsTriviallyStorable<T>::value, "Only trivial types can skip their destructor");
 
-		tLockFreeStackNode()
-		{
-		}
+		typedef tLink<tLockFreeStackNode> tNodePtr;
 
-		tLockFreeStackNode(const T& data)
-			: mData(data)
-		{
-		}
+		static constexpr const bool IS_TRIVIAL = trivial;
 
-		tLockFreeStackNode(T&& data)
-			: mData(move(data))
+		template <typename... Args>
+		tLockFreeStackNode(Args&&... args)
+			: mData(forward<Args>(args)...)
 		{
 		}
 
@@ -29,9 +26,10 @@ namespace detail
 template <typename T, class Allocator>
 cLockFreeStack<T, LFSS_SHARED, Allocator>::cLockFreeStack(tLockFreePool& pool)
 	: mNodePool(pool)
-	, mTop(tNodePtr(nullptr, 0))
+	, mTop(tNodePtr(nullptr))
 {
-	mTop.store(tNodePtr(nullptr, 0), memory_order_relaxed);
+	LF_assert(tNodeLinks::CanLink(pool), "The pool has too many nodes to link them by index");
+	mTop.store(tNodePtr(nullptr), memory_order_relaxed);
 
 	_if_diagnosing(mCount.store(0, memory_order_relaxed);)
 }
@@ -40,15 +38,14 @@ cLockFreeStack<T, LFSS_SHARED, Allocator>::cLockFreeStack(tLockFreePool& pool)
 template <typename T, class Allocator>
 cLockFreeStack<T, LFSS_SHARED, Allocator>::~cLockFreeStack()
 {
-	T dummy = T();
-	while (NonAtomicPop(dummy));
+	while (NonAtomicPopWith([](T&) {}));
 }
 
 //----------------------------------------------------------------------------
 template <typename T, class Allocator>
 bool cLockFreeStack<T, LFSS_SHARED, Allocator>::Empty() const
 {
-	return (mTop.load(memory_order_relaxed).GetPtr() == nullptr);
+	return !mTop.load(memory_order_relaxed);
 }
 
 //----------------------------------------------------------------------------
@@ -66,25 +63,51 @@ bool cLockFreeStack<T, LFSS_SHARED, Allocator>::Push(Args&&... args)
 	return false;
 }
 
+//----------------------------------------------------------------------------
+template <typename T, class Allocator>
+template <typename... Args>
+void cLockFreeStack<T, LFSS_SHARED, Allocator>::PushWait(Args&&... args)
+{
+	// A failed Push doesn't touch the arguments, so it is fine to forward them on every attempt
+	mNodePool.AwaitRelease([&] { return Push(forward<Args>(args)...); });
+}
+
+//----------------------------------------------------------------------------
+template <typename T, class Allocator>
+template <class Rep, class Period, typename... Args>
+bool cLockFreeStack<T, LFSS_SHARED, Allocator>::PushFor(const std::chrono::duration<Rep, Period>& timeout, Args&&... args)
+{
+	return mNodePool.AwaitReleaseFor([&] { return Push(forward<Args>(args)...); }, timeout);
+}
+
 //----------------------------------------------------------------------------
 template <typename T, class Allocator>
 bool cLockFreeStack<T, LFSS_SHARED, Allocator>::Pop(T& result)
+{
+	return PopWith([&result](T& data) { result = move(data); });
+}
+
+//----------------------------------------------------------------------------
+template <typename T, class Allocator>
+template <typename Fnc>
+bool cLockFreeStack<T, LFSS_SHARED, Allocator>::PopWith(Fnc&& fnc)
 {
 	tNodePtr old_top(mTop.load(memory_order_acquire));
-	for (bool empty = (old_top.GetPtr() == nullptr); !empty; empty = (old_top.GetPtr() == nullptr))
+	for (bool empty = !old_top; !empty; empty = !old_top)
 	{
 		// ABA gets solved by just changing the tag on pop calls, no need to do this in push too
 		// Note that old_top at this point could have been released from the pool already (by a concurrent Pop call). 
 		// But because it is pool-managed we can still do old_top->mPrev "safely" (the memory is still allocated). 
 		// *old_top can contain anything at this point, though. Is the compare_exchange (with ABA tag) on mTop below 
 		// which will tell us if the object is still the one we want... juggling with razor blades indeed
-		tNodePtr new_top(old_top->mPrev.GetPtr(), old_top.GetTag() + 1);
+		tElement* const old_top_node = GetNode(old_top);
+		tNodePtr new_top(old_top_node->mPrev.WithTag(old_top.GetTag() + 1));
 
 		if (mTop.compare_exchange_weak(old_top, new_top, memory_order_acq_rel, memory_order_acquire))
 		{
-			result = move(old_top->mData);
+			fnc(old_top_node->mData);
 
-			mNodePool.Release(*old_top);
+			mNodePool.Release(*old_top_node);
 
 			_if_diagnosing(mCount.fetch_sub(1, memory_order_relaxed);)
 
@@ -95,6 +118,87 @@ bool cLockFreeStack<T, LFSS_SHARED, Allocator>::Pop(T& result)
 	return false;
 }
 
+//----------------------------------------------------------------------------
+template <typename T, class Allocator>
+unsigned cLockFreeStack<T, LFSS_SHARED, Allocator>::PushBulk(const T* values, unsigned count)
+{
+	// The chain is local until linked, no need for atomics to build it
+	tElement* first_node = nullptr;
+	tElement* last_node = nullptr;
+	unsigned pushed = 0;
+	for (; pushed != count; ++pushed)
+	{
+		tElement* const new_node = mNodePool.Acquire(values[pushed]);
+		if (!new_node)
+		{
+			break;
+		}
+
+		if (last_node)
+		{
+			new_node->mPrev = GetLink(last_node, 0);
+		}
+		else
+		{
+			first_node = new_node;
+		}
+		last_node = new_node;
+	}
+
+	if (pushed != 0)
+	{
+		LinkTopChainAtomically(first_node, last_node, pushed);
+	}
+
+	return pushed;
+}
+
+//----------------------------------------------------------------------------
+template <typename T, class Allocator>
+unsigned cLockFreeStack<T, LFSS_SHARED, Allocator>::PopBulk(T* results, unsigned max_count)
+{
+	tNodePtr old_top(mTop.load(memory_order_acquire));
+	while (old_top && (max_count != 0))
+	{
+		// Walk down to the last node we'll take. Unlike PopWith, we follow the links we read, so each one is only trusted if mTop 
+		// didn't change meanwhile (i.e., nothing was popped, so the node holding it was still in the stack when we read it)
+		unsigned count = 1;
+		tNodePtr new_top(GetNode(old_top)->mPrev);
+		while ((count != max_count) && new_top && (mTop.load(memory_order_acquire) == old_top))
+		{
+			new_top = GetNode(new_top)->mPrev;
+			++count;
+		}
+
+		if (mTop.compare_exchange_weak(old_top, new_top.WithTag(old_top.GetTag() + 1), memory_order_acq_rel, memory_order_acquire))
+		{
+			typename tLockFreePool::tReleaseBatch batch;
+			tElement* node = GetNode(old_top);
+			for (unsigned i = 0; i != count; ++i)
+			{
+				tElement* const prev_node = GetNode(node->mPrev);
+				results[i] = move(node->mData);
+				if (tElement::IS_TRIVIAL)
+				{
+					mNodePool.BatchReleasePtr(batch, node);
+				}
+				else
+				{
+					mNodePool.Release(*node);
+				}
+				node = prev_node;
+			}
+			mNodePool.ReleaseBatch(batch);
+
+			_if_diagnosing(mCount.fetch_sub(count, memory_order_relaxed);)
+
+			return count;
+		}
+	}
+
+	return 0;
+}
+
 //----------------------------------------------------------------------------
 template <typename T, class Allocator>
 template <typename... Args>
@@ -113,17 +217,26 @@ bool cLockFreeStack<T, LFSS_SHARED, Allocator>::NonAtomicPush(Args&&... args)
 //----------------------------------------------------------------------------
 template <typename T, class Allocator>
 bool cLockFreeStack<T, LFSS_SHARED, Allocator>::NonAtomicPop(T& result)
+{
+	return NonAtomicPopWith([&result](T& data) { result = move(data); });
+}
+
+//----------------------------------------------------------------------------
+template <typename T, class Allocator>
+template <typename Fnc>
+bool cLockFreeStack<T, LFSS_SHARED, Allocator>::NonAtomicPopWith(Fnc&& fnc)
 {
 	tNodePtr old_top(mTop.load(memory_order_relaxed));
-	const bool empty = (old_top.GetPtr() == nullptr);
+	const bool empty = !old_top;
 	if (!empty)
 	{
-		tNodePtr new_top(old_top->mPrev.GetPtr(), old_top.GetTag() + 1);
+		tElement* const old_top_node = GetNode(old_top);
+		tNodePtr new_top(old_top_node->mPrev.WithTag(old_top.GetTag() + 1));
 		mTop.store(new_top, memory_order_relaxed);
 
-		result = move(old_top->mData);
+		fnc(old_top_node->mData);
 
-		mNodePool.Release(*old_top);
+		mNodePool.Release(*old_top_node);
 
 		_if_diagnosing(mCount.fetch_sub(1, memory_order_relaxed);)
 	}
@@ -135,17 +248,26 @@ bool cLockFreeStack<T, LFSS_SHARED, Allocator>::NonAtomicPop(T& result)
 template <typename T, class Allocator>
 void cLockFreeStack<T, LFSS_SHARED, Allocator>::LinkTopNodeAtomically(tElement* new_node)
 {
-	LF_assert(new_node, "Invalid new_node.");
+	LinkTopChainAtomically(new_node, new_node, 1);
+}
 
-	new_node->mPrev = mTop.load(memory_order_relaxed);
+//----------------------------------------------------------------------------
+template <typename T, class Allocator>
+void cLockFreeStack<T, LFSS_SHARED, Allocator>::LinkTopChainAtomically(tElement* first_node, tElement* last_node, unsigned count)
+{
+	LF_assert(first_node && last_node, "Invalid chain.");
 
-	tNodePtr new_node_ptr;
+	// The bottom of the chain links to the old top, the top of the chain becomes the new one
+	first_node->mPrev = mTop.load(memory_order_relaxed);
+
+	const tNodePtr last_node_link = GetLink(last_node, 0);
+	tNodePtr new_top;
 	do
 	{
-		new_node_ptr.Set(new_node, new_node->mPrev.GetTag());
-	} while (!mTop.compare_exchange_weak(new_node->mPrev, new_node_ptr, memory_order_acq_rel, memory_order_acquire));
+		new_top = last_node_link.WithTag(first_node->mPrev.GetTag());
+	} while (!mTop.compare_exchange_weak(first_node->mPrev, new_top, memory_order_acq_rel, memory_order_acquire));
 
-	_if_diagnosing(mCount.fetch_add(1, memory_order_relaxed);)
+	_if_diagnosing(mCount.fetch_add(count, memory_order_relaxed);)
 }
 
 //----------------------------------------------------------------------------
@@ -155,7 +277,7 @@ void cLockFreeStack<T, LFSS_SHARED, Allocator>::LinkTopNodeNonAtomically(tElemen
 	LF_assert(new_node, "Invalid new_node.");
 
 	new_node->mPrev = mTop.load(memory_order_relaxed);
-	mTop.store(tNodePtr(new_node, new_node->mPrev.GetTag()), memory_order_relaxed);
+	mTop.store(GetLink(new_node, new_node->mPrev.GetTag()), memory_order_relaxed);
 
 	_if_diagnosing(mCount.fetch_add(1, memory_order_relaxed);)
 }
@@ -0,0 +1,173 @@
+///////////////////////////////////////////////////////////////////////////
+//
+//lockfree_work_stealing_deque.h
+//
+/////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "atomic_defs.h"
+#include "utils.h"
+#include "debug.h"
+
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+namespace lockfree {
+
+	enum eLockFreeWorkStealingDequeStorage : size_t { LFWSDS_DYNAMIC = 0 };
+
+/// <summary>
+///     Lockfree implementation of a Chase-Lev work-stealing deque. One thread (the owner) pushes and pops elements at the bottom in LIFO
+///		order, any number of other threads (thieves) steal elements from the top in FIFO order. Storage is a circular array that grows when
+///		it gets full. Based on "Dynamic Circular Work-Stealing Deque" (Chase, Lev 2005) with the memory orderings from "Correct and Efficient
+///		Work-Stealing for Weak Memory Models" (Le, Pop, Cohen, Zappa Nardelli 2013)
+///
+///		Pros:
+///		- Owner operations are very cheap: Push is a couple of plain stores and a release store, Pop a store, a full fence and a load. Only
+///		  popping the very last element (racing with thieves for it) needs a CAS
+///		- Thieves take the oldest elements, which in fork-join workloads are usually the biggest chunks of work
+///		- Unbounded: the circular array grows as needed
+///
+///     Cons:
+///		- Push and Pop can only be called by the owner thread
+///		- Growing allocates (through the allocator provided). Old arrays can't be freed until the deque is destroyed, since thieves could still
+///		  be reading from them, so peak memory usage is up to twice the size of the biggest array. Local storage deques only allocate when they
+///		  outgrow their local array
+///
+///		Requirements for T:
+///		- T needs to be trivially copyable, since thieves read elements before knowing whether they'll win the race for them. It is meant for
+///		  pointers, indices or handles to tasks. Bigger types work, but atomic&lt;T&gt; will likely not be lock-free for them
+/// </summary>
+/// <remarks>
+///		storage works as in the rest of containers: LFWSDS_DYNAMIC (0) means the initial array is allocated on construction with the capacity
+///		requested, any other value is the capacity of an initial array embedded in the deque. Capacities must be powers of two
+/// </remarks>
+template <typename T, size_t storage = LFWSDS_DYNAMIC, class Allocator = std::allocator<T>>
+class cLockFreeWorkStealingDeque;
+
+template <typename T, class Allocator>
+class cLockFreeWorkStealingDeque<T, LFWSDS_DYNAMIC, Allocator>
+{
+	static_assert(std::is_trivially_copyable<T>::value, "T needs to be trivially copyable");
+
+public:
+	typedef T			tValueType;
+	typedef Allocator	tAllocatorType;
+
+	// ***OWNER INTERFACE (only the thread owning the deque can call these)
+
+	/// <summary>
+	///		Pushes an element at the bottom of the deque, growing it if it is full
+	/// </summary>
+	void Push(const T& value);
+
+	/// <summary>
+	///		Pops the last element pushed (LIFO ordering)
+	/// </summary>
+	/// <param name="result">
+	///     (Out) the pop element will be copied to this argument if pop succeeds
+	/// </param>
+	/// <return>
+	///		Returns true if the deque was not empty and an element could be pop. False otherwise.
+	/// </return>
+	bool Pop(T& result);
+
+	// ***THIEF INTERFACE (any thread can call these)
+
+	/// <summary>
+	///		Steals the oldest element in the deque (FIFO ordering)
+	/// </summary>
+	/// <param name="result">
+	///     (Out) the stolen element will be copied to this argument if steal succeeds
+	/// </param>
+	/// <return>
+	///		Returns true if an element could be stolen. False if the deque was empty, or another thread (thief or owner) won the race for the
+	///		element
+	/// </return>
+	bool Steal(T& result);
+
+	/// <summary>
+	///		Queries if the deque is empty
+	/// </summary>
+	/// <remarks>
+	///		Only a hint in a multithreaded environment, by the time you act on something that was "empty" it could be non-empty already
+	/// </remarks>
+	bool Empty() const;
+
+	/// <summary>
+	///		Queries the (approximate) number of elements in the deque
+	/// </summary>
+	size_t GetSize() const;
+
+	// ***NON-ATOMIC INTERFACE
+
+	cLockFreeWorkStealingDeque(unsigned initial_capacity, const Allocator& allocator = Allocator());
+	~cLockFreeWorkStealingDeque();
+
+	/// <summary>
+	///		Queries the capacity of the current array (it will grow when this is exceeded)
+	/// </summary>
+	size_t GetCapacity() const;
+
+protected:
+	typedef atomic<T> tSlot;
+
+	// Used by the local storage specialization, that provides the initial array
+	cLockFreeWorkStealingDeque(tSlot* local_slots, size_t local_capacity, const Allocator& allocator);
+
+private:
+	cLockFreeWorkStealingDeque(const cLockFreeWorkStealingDeque&) = delete;
+	cLockFreeWorkStealingDeque& operator=(const cLockFreeWorkStealingDeque&) = delete;
+
+	typedef typename std::allocator_traits<Allocator>::template rebind_alloc<unsigned char> tByteAllocator;
+
+	//-------------------------------------------------------------------------
+	// Aligned so slots can be allocated right after the header
+	struct alignas(alignof(tSlot)) alignas(int64_t) tArray
+	{
+		T Get(int64_t idx) const { return mSlots[idx & mMask].load(memory_order_relaxed); }
+		void Put(int64_t idx, const T& value) { mSlots[idx & mMask].store(value, memory_order_relaxed); }
+
+		tSlot*		mSlots;
+		int64_t		mMask;
+		tArray*		mRetired;	// array this one replaced. Kept around until destruction, thieves could still be reading from it
+	};
+
+	tArray* Grow(tArray* array, int64_t top, int64_t bottom);
+	tArray* AllocateArray(size_t capacity);
+	void FreeArray(tArray* array);
+
+	static bool IsPowerOfTwo(size_t value) { return (value != 0) && ((value & (value - 1)) == 0); }
+
+	// top and bottom are written by different threads, keep them apart
+	alignas(CACHE_LINE_SIZE) atomic<int64_t>	mTop;
+	alignas(CACHE_LINE_SIZE) atomic<int64_t>	mBottom;
+	atomic<tArray*>								mArray;
+	tArray										mInitialArray;
+	bool										mOwnsInitialSlots;
+	tByteAllocator								mAlloc;
+};
+
+//----------------------------------------------------------------------------
+// This specialization embeds the initial array in the deque. It only allocates if it outgrows it
+template <typename T, size_t storage, class Allocator>
+class cLockFreeWorkStealingDeque : public cLockFreeWorkStealingDeque<T, LFWSDS_DYNAMIC, Allocator>
+{
+	static_assert((storage & (storage - 1)) == 0, "Local storage capacity must be a power of two");
+
+	typedef cLockFreeWorkStealingDeque<T, LFWSDS_DYNAMIC, Allocator> tBase;
+	using typename tBase::tSlot;
+
+public:
+	cLockFreeWorkStealingDeque(const Allocator& allocator = Allocator())
+		: tBase(mLocalSlots, storage, allocator)
+	{}
+
+private:
+	tSlot mLocalSlots[storage];
+};
+
+#include "lockfree_work_stealing_deque.inl"
+
+}
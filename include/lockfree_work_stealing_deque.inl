@@ -0,0 +1,195 @@
+
+//----------------------------------------------------------------------------
+template <typename T, class Allocator>
+cLockFreeWorkStealingDeque<T, LFWSDS_DYNAMIC, Allocator>::cLockFreeWorkStealingDeque(unsigned initial_capacity, const Allocator& allocator)
+	: mTop(0)
+	, mBottom(0)
+	, mArray(nullptr)
+	, mOwnsInitialSlots(true)
+	, mAlloc(allocator)
+{
+	LF_assert(IsPowerOfTwo(initial_capacity), "Capacity must be a power of two");
+
+	tSlot* const slots = reinterpret_cast<tSlot*>(mAlloc.allocate(sizeof(tSlot) * initial_capacity));
+	mInitialArray.mSlots = slots;
+	mInitialArray.mMask = static_cast<int64_t>(initial_capacity) - 1;
+	mInitialArray.mRetired = nullptr;
+	mArray.store(&mInitialArray, memory_order_release);
+}
+
+//----------------------------------------------------------------------------
+template <typename T, class Allocator>
+cLockFreeWorkStealingDeque<T, LFWSDS_DYNAMIC, Allocator>::cLockFreeWorkStealingDeque(tSlot* local_slots, size_t local_capacity, const Allocator& allocator)
+	: mTop(0)
+	, mBottom(0)
+	, mArray(nullptr)
+	, mOwnsInitialSlots(false)
+	, mAlloc(allocator)
+{
+	LF_assert(IsPowerOfTwo(local_capacity), "Capacity must be a power of two");
+
+	mInitialArray.mSlots = local_slots;
+	mInitialArray.mMask = static_cast<int64_t>(local_capacity) - 1;
+	mInitialArray.mRetired = nullptr;
+	mArray.store(&mInitialArray, memory_order_release);
+}
+
+//----------------------------------------------------------------------------
+template <typename T, class Allocator>
+cLockFreeWorkStealingDeque<T, LFWSDS_DYNAMIC, Allocator>::~cLockFreeWorkStealingDeque()
+{
+	tArray* array = mArray.load(memory_order_relaxed);
+	while (array)
+	{
+		tArray* const retired = array->mRetired;
+		FreeArray(array);
+		array = retired;
+	}
+}
+
+//----------------------------------------------------------------------------
+template <typename T, class Allocator>
+void cLockFreeWorkStealingDeque<T, LFWSDS_DYNAMIC, Allocator>::Push(const T& value)
+{
+	const int64_t bottom = mBottom.load(memory_order_relaxed);
+	const int64_t top = mTop.load(memory_order_acquire);
+	tArray* array = mArray.load(memory_order_relaxed);
+
+	if ((bottom - top) > array->mMask)
+	{
+		array = Grow(array, top, bottom);
+	}
+
+	array->Put(bottom, value);
+
+	// The element needs to be visible before the new bottom is
+	std::atomic_thread_fence(memory_order_release);
+	mBottom.store(bottom + 1, memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------------
+template <typename T, class Allocator>
+bool cLockFreeWorkStealingDeque<T, LFWSDS_DYNAMIC, Allocator>::Pop(T& result)
+{
+	const int64_t bottom = mBottom.load(memory_order_relaxed) - 1;
+	tArray* const array = mArray.load(memory_order_relaxed);
+
+	// Reserve the bottom element before looking at top. The full fence pairs with the one in Steal, so either we see a thief's
+	// increment of top or the thief sees our decrement of bottom
+	mBottom.store(bottom, memory_order_relaxed);
+	std::atomic_thread_fence(memory_order_seq_cst);
+	int64_t top = mTop.load(memory_order_relaxed);
+
+	bool popped = false;
+	if (top <= bottom)
+	{
+		result = array->Get(bottom);
+		popped = true;
+
+		if (top == bottom)
+		{
+			// Last element: race with the thieves for it
+			popped = mTop.compare_exchange_strong(top, top + 1, memory_order_seq_cst, memory_order_relaxed);
+			mBottom.store(bottom + 1, memory_order_relaxed);
+		}
+	}
+	else
+	{
+		// Was empty, restore bottom
+		mBottom.store(bottom + 1, memory_order_relaxed);
+	}
+
+	return popped;
+}
+
+//----------------------------------------------------------------------------
+template <typename T, class Allocator>
+bool cLockFreeWorkStealingDeque<T, LFWSDS_DYNAMIC, Allocator>::Steal(T& result)
+{
+	int64_t top = mTop.load(memory_order_acquire);
+	std::atomic_thread_fence(memory_order_seq_cst);
+	const int64_t bottom = mBottom.load(memory_order_acquire);
+
+	if (top < bottom)
+	{
+		// The element is read before claiming it. If the CAS fails it could have been overwritten already, but we discard it then
+		tArray* const array = mArray.load(memory_order_acquire);
+		const T value = array->Get(top);
+		if (mTop.compare_exchange_strong(top, top + 1, memory_order_seq_cst, memory_order_relaxed))
+		{
+			result = value;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+//----------------------------------------------------------------------------
+template <typename T, class Allocator>
+bool cLockFreeWorkStealingDeque<T, LFWSDS_DYNAMIC, Allocator>::Empty() const
+{
+	return GetSize() == 0;
+}
+
+//----------------------------------------------------------------------------
+template <typename T, class Allocator>
+size_t cLockFreeWorkStealingDeque<T, LFWSDS_DYNAMIC, Allocator>::GetSize() const
+{
+	const int64_t bottom = mBottom.load(memory_order_relaxed);
+	const int64_t top = mTop.load(memory_order_relaxed);
+	return (bottom > top) ? static_cast<size_t>(bottom - top) : 0;
+}
+
+//----------------------------------------------------------------------------
+template <typename T, class Allocator>
+size_t cLockFreeWorkStealingDeque<T, LFWSDS_DYNAMIC, Allocator>::GetCapacity() const
+{
+	return static_cast<size_t>(mArray.load(memory_order_relaxed)->mMask + 1);
+}
+
+//----------------------------------------------------------------------------
+template <typename T, class Allocator>
+auto cLockFreeWorkStealingDeque<T, LFWSDS_DYNAMIC, Allocator>::Grow(tArray* array, int64_t top, int64_t bottom) -> tArray*
+{
+	tArray* const new_array = AllocateArray(static_cast<size_t>(array->mMask + 1) * 2);
+	for (int64_t idx = top; idx != bottom; ++idx)
+	{
+		new_array->Put(idx, array->Get(idx));
+	}
+	new_array->mRetired = array;
+
+	// Thieves that load the new array need to see the elements copied to it
+	mArray.store(new_array, memory_order_release);
+	return new_array;
+}
+
+//----------------------------------------------------------------------------
+template <typename T, class Allocator>
+auto cLockFreeWorkStealingDeque<T, LFWSDS_DYNAMIC, Allocator>::AllocateArray(size_t capacity) -> tArray*
+{
+	// Header and slots are allocated in one go, slots right after the header
+	static_assert((sizeof(tArray) % alignof(tSlot)) == 0, "Slots would be misaligned after the header");
+	unsigned char* const memory = mAlloc.allocate(sizeof(tArray) + sizeof(tSlot) * capacity);
+
+	tArray* const array = new (memory) tArray();
+	array->mSlots = reinterpret_cast<tSlot*>(memory + sizeof(tArray));
+	array->mMask = static_cast<int64_t>(capacity) - 1;
+	array->mRetired = nullptr;
+	return array;
+}
+
+//----------------------------------------------------------------------------
+template <typename T, class Allocator>
+void cLockFreeWorkStealingDeque<T, LFWSDS_DYNAMIC, Allocator>::FreeArray(tArray* array)
+{
+	const size_t capacity = static_cast<size_t>(array->mMask + 1);
+	if (array != &mInitialArray)
+	{
+		mAlloc.deallocate(reinterpret_cast<unsigned char*>(array), sizeof(tArray) + sizeof(tSlot) * capacity);
+	}
+	else if (mOwnsInitialSlots)
+	{
+		mAlloc.deallocate(reinterpret_cast<unsigned char*>(array->mSlots), sizeof(tSlot) * capacity);
+	}
+}
@@ -0,0 +1,162 @@
+///////////////////////////////////////////////////////////////////////////
+//
+//skiplist_node_pools.h
+//
+// Tower storage shared by the skiplist-based containers. Nodes are a header followed by as many links as their height, allocated from
+// one pool per size class of tower heights
+//
+/////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "atomic_defs.h"
+#include "lockfree_pool.h"
+#include "utils.h"
+#include "debug.h"
+
+#include <algorithm>
+#include <array>
+#include <memory>
+
+namespace lockfree
+{
+	namespace detail
+	{
+		// Heights 1, 2, 4, 8 and 16
+		static constexpr const unsigned SKIPLIST_NUM_SIZE_CLASSES = 5;
+		static constexpr const unsigned SKIPLIST_MAX_HEIGHT = 1U << (SKIPLIST_NUM_SIZE_CLASSES - 1);
+
+		//----------------------------------------------------------------------------
+		template <size_t size, size_t alignment>
+		struct alignas(alignment) tSkipListBlock
+		{
+			unsigned char mBytes[size];
+		};
+
+		//----------------------------------------------------------------------------
+		// One pool per size class. Class c holds towers of up to 2^c levels. Each level of the hierarchy adds the pool of the biggest class.
+		// tNode needs a tLink typedef (the type of its links) and to hold its links right after itself
+		template <typename tNode, unsigned num_classes, class Allocator>
+		class cSkipListNodePools : public cSkipListNodePools<tNode, num_classes - 1, Allocator>
+		{
+			typedef cSkipListNodePools<tNode, num_classes - 1, Allocator> tBase;
+
+			static constexpr const unsigned SIZE_CLASS = num_classes - 1;
+			static constexpr const size_t HEIGHT = size_t(1) << SIZE_CLASS;
+
+			typedef tSkipListBlock<sizeof(tNode) + HEIGHT * sizeof(typename tNode::tLink), alignof(tNode)> tBlock;
+			typedef typename std::allocator_traits<Allocator>::template rebind_alloc<tBlock> tBlockAllocator;
+
+		public:
+			cSkipListNodePools(const unsigned* capacities, const Allocator& allocator)
+				: tBase(capacities, allocator)
+				, mPool(capacities[SIZE_CLASS], tBlockAllocator(allocator))
+			{}
+
+			tNode* Acquire(unsigned size_class)
+			{
+				return (size_class == SIZE_CLASS) ? reinterpret_cast<tNode*>(mPool.AcquirePtr()) : tBase::Acquire(size_class);
+			}
+
+			void Release(unsigned size_class, tNode* node)
+			{
+				if (size_class == SIZE_CLASS)
+				{
+					mPool.ReleasePtr(reinterpret_cast<tBlock*>(node));
+				}
+				else
+				{
+					tBase::Release(size_class, node);
+				}
+			}
+
+		private:
+			cLockFreePool<tBlock, tBlockAllocator> mPool;
+		};
+
+		//----------------------------------------------------------------------------
+		template <typename tNode, class Allocator>
+		class cSkipListNodePools<tNode, 0, Allocator>
+		{
+		public:
+			cSkipListNodePools(const unsigned*, const Allocator&) {}
+
+			tNode* Acquire(unsigned) { return nullptr; }
+			void Release(unsigned, tNode*) { LF_assert(false, "Invalid size class"); }
+		};
+
+		//----------------------------------------------------------------------------
+		// Splits the capacity of a container among the size classes following the expected distribution of tower heights
+		inline std::array<unsigned, SKIPLIST_NUM_SIZE_CLASSES> GetSkipListClassCapacities(unsigned capacity)
+		{
+			// Expected share of each class is 1/2, 1/4, 3/16 and 1/16. The last one gets the rest, plus the head. Classes that run out borrow
+			// from the others, so the whole capacity is always usable
+			std::array<unsigned, SKIPLIST_NUM_SIZE_CLASSES> capacities = {{ capacity / 2, capacity / 4, capacity * 3 / 16, capacity / 16, 0 }};
+
+			unsigned assigned = 0;
+			for (unsigned& class_capacity : capacities)
+			{
+				class_capacity = (std::max)(1U, class_capacity);
+				assigned += class_capacity;
+			}
+			capacities[SKIPLIST_NUM_SIZE_CLASSES - 1] += capacity - (std::min)(capacity, assigned) + 1;
+
+			return capacities;
+		}
+
+		//----------------------------------------------------------------------------
+		// Geometric distribution, each level has half the nodes of the one below
+		inline unsigned RandomSkipListHeight()
+		{
+			uint32_t random = ThreadLocalRandom();
+			unsigned height = 1;
+			while ((random & 1U) && (height < SKIPLIST_MAX_HEIGHT))
+			{
+				++height;
+				random >>= 1;
+			}
+			return height;
+		}
+
+		//----------------------------------------------------------------------------
+		// Acquires a node with room for the height requested. If its class is exhausted, tries the bigger ones first (same tower, more room),
+		// then the smaller ones (shorter tower). Sets mSizeClass and mHeight, and constructs the links as null ones (tNode::tLinkValue())
+		template <typename tNode, class Allocator>
+		tNode* AllocateSkipListNode(cSkipListNodePools<tNode, SKIPLIST_NUM_SIZE_CLASSES, Allocator>& pools, unsigned height)
+		{
+			unsigned size_class = 0;
+			while ((1U << size_class) < height)
+			{
+				++size_class;
+			}
+
+			tNode* node = nullptr;
+			for (unsigned candidate = size_class; !node && (candidate != SKIPLIST_NUM_SIZE_CLASSES); ++candidate)
+			{
+				if ((node = pools.Acquire(candidate)) != nullptr)
+				{
+					node->mSizeClass = static_cast<uint8_t>(candidate);
+				}
+			}
+
+			for (unsigned candidate = size_class; !node && (candidate-- != 0); )
+			{
+				if ((node = pools.Acquire(candidate)) != nullptr)
+				{
+					node->mSizeClass = static_cast<uint8_t>(candidate);
+					height = 1U << candidate;
+				}
+			}
+
+			if (node)
+			{
+				node->mHeight = static_cast<uint8_t>(height);
+				for (unsigned level = 0; level != height; ++level)
+				{
+					new (&node->GetLinks()[level]) typename tNode::tLink(typename tNode::tLinkValue());
+				}
+			}
+
+			return node;
+		}
+	}
+}
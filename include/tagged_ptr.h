@@ -60,6 +60,21 @@ public:
 		PackTaggedPtr(ptr, tag);
 	}
 
+	tTaggedPtr WithTag(tTag tag) const
+	{
+		return tTaggedPtr(GetPtr(), tag);
+	}
+
+	bool operator==(const tTaggedPtr& rhs) const
+	{
+		return mPackedPtr == rhs.mPackedPtr;
+	}
+
+	bool operator!=(const tTaggedPtr& rhs) const
+	{
+		return mPackedPtr != rhs.mPackedPtr;
+	}
+
 	T& operator *() const
 	{
 		return *GetPtr();
@@ -82,6 +97,113 @@ private:
 		mTag = tag;
 	}
 };
-   
+
+//-------------------------------------------------------------------------
+// Index of a T within the storage it comes from (e.g. the pool of a container) with a tag, packed in 32 bits. Half the size of a
+// tTaggedPtr, for nodes of containers whose pools are small enough to be addressed with 16 bits. The storage is needed to get to the T
+template <typename T>
+struct tTaggedIndex
+{
+public:
+	typedef uint16_t tIndex;
+	typedef uint16_t tTag;
+
+	static constexpr const tIndex NULL_IDX = 0xFFFF;
+
+	tTaggedIndex(std::nullptr_t = nullptr)
+		: mIdx(NULL_IDX)
+		, mTag(0)
+	{
+		static_assert(sizeof(tTaggedIndex) == 4, "tTaggedIndex not properly packed");
+	}
+
+	tTaggedIndex(tIndex idx, tTag tag = 0U)
+		: mIdx(idx)
+		, mTag(tag)
+	{
+	}
+
+	tIndex GetIdx() const
+	{
+		return mIdx;
+	}
+
+	tTag GetTag() const
+	{
+		return mTag;
+	}
+
+	void Set(tIndex idx, tTag tag)
+	{
+		mIdx = idx;
+		mTag = tag;
+	}
+
+	tTaggedIndex WithTag(tTag tag) const
+	{
+		return tTaggedIndex(mIdx, tag);
+	}
+
+	bool operator==(const tTaggedIndex& rhs) const
+	{
+		return (mIdx == rhs.mIdx) && (mTag == rhs.mTag);
+	}
+
+	bool operator!=(const tTaggedIndex& rhs) const
+	{
+		return !(*this == rhs);
+	}
+
+	operator bool() const
+	{
+		return mIdx != NULL_IDX;
+	}
+
+private:
+	tIndex	mIdx;
+	tTag	mTag;
+};
+
+namespace detail
+{
+	//-------------------------------------------------------------------------
+	// Containers link their nodes with either of the above, these go from links to nodes and back. Nodes linked by index are looked up
+	// in the pool they come from, which can't have more than TAGGED_INDEX_MAX_ELEMENTS elements
+	static constexpr const size_t TAGGED_INDEX_MAX_ELEMENTS = 0xFFFF;
+
+	template <class tLink>
+	struct tNodeLinkTraits;
+
+	template <typename T>
+	struct tNodeLinkTraits<tTaggedPtr<T>>
+	{
+		template <class tPool>
+		static T* GetNode(const tTaggedPtr<T>& link, const tPool&) { return link.GetPtr(); }
+
+		template <class tPool>
+		static tTaggedPtr<T> GetLink(T* node, typename tTaggedPtr<T>::tTag tag, const tPool&) { return tTaggedPtr<T>(node, tag); }
+
+		template <class tPool>
+		static bool CanLink(const tPool&) { return true; }
+	};
+
+	template <typename T>
+	struct tNodeLinkTraits<tTaggedIndex<T>>
+	{
+		template <class tPool>
+		static T* GetNode(const tTaggedIndex<T>& link, const tPool& pool) { return link ? pool.GetElement(link.GetIdx()) : nullptr; }
+
+		template <class tPool>
+		static tTaggedIndex<T> GetLink(T* node, typename tTaggedIndex<T>::tTag tag, const tPool& pool)
+		{
+			typedef typename tTaggedIndex<T>::tIndex tIndex;
+			return tTaggedIndex<T>(node ? static_cast<tIndex>(pool.GetElementIndex(node)) : tIndex(tTaggedIndex<T>::NULL_IDX), tag);
+		}
+
+		template <class tPool>
+		static bool CanLink(const tPool& pool) { return pool.GetCapacity() <= TAGGED_INDEX_MAX_ELEMENTS; }
+	};
+}
+
 }
 
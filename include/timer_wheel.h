@@ -0,0 +1,167 @@
+///////////////////////////////////////////////////////////////////////////
+//
+//timer_wheel.h
+//
+/////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "atomic_defs.h"
+#include "inline_task.h"
+#include "lockfree_pool.h"
+#include "utils.h"
+
+#include <chrono>
+#include <cstdint>
+
+namespace lockfree
+{
+/// <summary>
+///     Hierarchical timing wheel (Varghese, Lauck 1987) with lock-free arming. Any thread can arm or cancel timers, a single ticker thread
+///		expires them by calling Advance periodically, which runs the callbacks of the timers due.
+///
+///		- Arming acquires a node from a cLockFreePool and links it in an intrusive MPSC inbox with one atomic exchange (same linking
+///		  discipline as cMPSCLockFreeQueue). The ticker moves the inbox to the wheel on every Advance
+///		- The wheel has NUM_LEVELS levels of NUM_SLOTS slots. Timers are placed in the level whose range covers their deadline and cascade
+///		  down to the level below when the ticker gets to their slot, so both arming and expiring are O(1)
+///		- Cancelling is O(1) and lock-free through the handle returned when arming: a CAS on the timer's state. The node stays in the wheel
+///		  until the ticker finds it (on cascade or expiry) and gives it back to the pool
+///		- Callbacks are cInlineTasks stored in the node itself, so nothing allocates
+/// </summary>
+/// <remarks>
+///		Deadlines are rounded up to the next tick. Timers further away than 2^32 ticks are cascaded down again until they are due
+/// </remarks>
+class cTimerWheel
+{
+	struct tTimerNode;
+
+public:
+	typedef cInlineTask<void()>			tCallback;
+	typedef std::chrono::steady_clock	tClock;
+
+	//-------------------------------------------------------------------------
+	// Identifies an armed timer, to cancel it. Stays safe to use after the timer expires, cancelling does nothing then
+	struct tTimerHandle
+	{
+		tTimerHandle() : mNode(nullptr), mId(0) {}
+
+		bool IsValid() const { return mNode != nullptr; }
+
+	private:
+		friend class cTimerWheel;
+
+		tTimerNode*	mNode;
+		uint32_t	mId;
+	};
+
+	// ***ATOMIC INTERFACE
+
+	/// <summary>
+	///		Arms a timer that will run fnc from the ticker thread once delay has passed
+	/// </summary>
+	/// <return>
+	///		Returns true if the timer was armed. False if the pool of timers is exhausted
+	/// </return>
+	template <typename Fnc, class Rep, class Period>
+	bool Arm(const std::chrono::duration<Rep, Period>& delay, Fnc&& fnc);
+
+	/// <summary>
+	///		Same as Arm, returning the handle to cancel the timer in handle
+	/// </summary>
+	template <typename Fnc, class Rep, class Period>
+	bool Arm(const std::chrono::duration<Rep, Period>& delay, Fnc&& fnc, tTimerHandle& handle);
+
+	/// <summary>
+	///		Same as Arm, with an absolute deadline instead of a delay
+	/// </summary>
+	template <typename Fnc>
+	bool ArmAt(tClock::time_point deadline, Fnc&& fnc);
+
+	template <typename Fnc>
+	bool ArmAt(tClock::time_point deadline, Fnc&& fnc, tTimerHandle& handle);
+
+	/// <summary>
+	///		Cancels the timer identified by handle
+	/// </summary>
+	/// <return>
+	///		Returns true if the timer was cancelled before starting to run its callback. False if it had already run (or started running),
+	///		or had already been cancelled
+	/// </return>
+	bool Cancel(const tTimerHandle& handle);
+
+	// ***TICKER INTERFACE (only one thread at a time can call these)
+
+	/// <summary>
+	///		Moves the timers armed since the last call to the wheel, then expires every tick up to now, running the callbacks of the timers
+	///		due (from the calling thread)
+	/// </summary>
+	/// <return>
+	///		Returns the number of callbacks run
+	/// </return>
+	unsigned Advance(tClock::time_point now = tClock::now());
+
+	// ***NON-ATOMIC INTERFACE
+
+	/// <param name="max_timers">
+	///		Maximum number of timers armed at the same time (cancelled ones count until the ticker gets rid of them)
+	/// </param>
+	/// <param name="tick">
+	///		Resolution of the wheel
+	/// </param>
+	cTimerWheel(unsigned max_timers, tClock::duration tick = std::chrono::milliseconds(1));
+
+	/// <remarks>
+	///		Timers still armed are discarded without running their callbacks
+	/// </remarks>
+	~cTimerWheel();
+
+	tClock::duration GetTickDuration() const { return mTickDuration; }
+
+private:
+	cTimerWheel(const cTimerWheel&) = delete;
+	cTimerWheel& operator=(const cTimerWheel&) = delete;
+
+	static constexpr const unsigned SLOT_BITS = 8;
+	static constexpr const unsigned NUM_SLOTS = 1U << SLOT_BITS;
+	static constexpr const unsigned NUM_LEVELS = 4;
+
+	// Timer states, in the lowest bits of mState. The rest hold the id of the timer, so stale handles can't cancel a reused node
+	enum eTimerState : uint32_t { TS_ARMED, TS_CANCELLED, TS_FIRED, TS_NUM_STATES };
+	static constexpr const unsigned STATE_BITS = 2;
+
+	static uint32_t MakeState(uint32_t id, eTimerState state) { return (id << STATE_BITS) | state; }
+
+	//-------------------------------------------------------------------------
+	struct tTimerNode
+	{
+		tCallback					mCallback;		// first, the pool reuses the beginning of free nodes for its freelist
+		atomic<uint32_t>			mState;
+		uint64_t					mDeadline;		// in ticks since construction
+		atomic<tTimerNode*>			mInboxNext;
+		tTimerNode*					mNext;			// next in the wheel slot, only touched by the ticker
+	};
+
+	uint64_t	GetDeadlineTick(tClock::time_point deadline) const;
+	void		PushToInbox(tTimerNode* node);
+	tTimerNode*	PopFromInbox();
+	void		DrainInbox();
+	void		Place(tTimerNode* node);
+	void		Cascade(unsigned level);
+	unsigned	ExpireCurrentTick();
+	void		ReleaseNode(tTimerNode* node);
+
+	cLockFreePool<tTimerNode>	mNodePool;
+	const tClock::time_point	mStartTime;
+	const tClock::duration		mTickDuration;
+
+	// Inbox. Producers only touch the back, the ticker only the front
+	alignas(CACHE_LINE_SIZE) atomic<tTimerNode*>	mInboxBack;
+	alignas(CACHE_LINE_SIZE) tTimerNode*			mInboxFront;
+	tTimerNode										mInboxStub;
+
+	// Ticker state
+	uint64_t		mCurrentTick;	// next tick to expire
+	tTimerNode*		mSlots[NUM_LEVELS][NUM_SLOTS];
+};
+
+#include "timer_wheel.inl"
+}
@@ -0,0 +1,51 @@
+
+//-------------------------------------------------------------------------
+template <typename Fnc, class Rep, class Period>
+bool cTimerWheel::Arm(const std::chrono::duration<Rep, Period>& delay, Fnc&& fnc)
+{
+	tTimerHandle handle;
+	return Arm(delay, forward<Fnc>(fnc), handle);
+}
+
+//-------------------------------------------------------------------------
+template <typename Fnc, class Rep, class Period>
+bool cTimerWheel::Arm(const std::chrono::duration<Rep, Period>& delay, Fnc&& fnc, tTimerHandle& handle)
+{
+	return ArmAt(tClock::now() + std::chrono::duration_cast<tClock::duration>(delay), forward<Fnc>(fnc), handle);
+}
+
+//-------------------------------------------------------------------------
+template <typename Fnc>
+bool cTimerWheel::ArmAt(tClock::time_point deadline, Fnc&& fnc)
+{
+	tTimerHandle handle;
+	return ArmAt(deadline, forward<Fnc>(fnc), handle);
+}
+
+//-------------------------------------------------------------------------
+template <typename Fnc>
+bool cTimerWheel::ArmAt(tClock::time_point deadline, Fnc&& fnc, tTimerHandle& handle)
+{
+	static_assert(tCallback::FitsInline<std::decay_t<Fnc>>(), "Callable too big to fit in a timer, capture by reference or through a pointer");
+
+	// Only the callback gets constructed: a stale handle could be cancelling through mState right now, it just needs to see a new id
+	tTimerNode* const node = mNodePool.AcquirePtr();
+	if (!node)
+	{
+		return false;
+	}
+	new (&node->mCallback) tCallback(forward<Fnc>(fnc));
+
+	// The node is ours now, and its last id survived in it while it was free: the next one is enough to tell this timer from the
+	// ones that used the node before. A node never armed holds whatever was in the storage, no handle can refer to it anyway
+	const uint32_t id = ((node->mState.load(memory_order_relaxed) >> STATE_BITS) + 1) & (UINT32_MAX >> STATE_BITS);
+	node->mState.store(MakeState(id, TS_ARMED), memory_order_relaxed);
+	node->mDeadline = GetDeadlineTick(deadline);
+	node->mInboxNext.store(nullptr, memory_order_relaxed);
+
+	handle.mNode = node;
+	handle.mId = id;
+
+	PushToInbox(node);
+	return true;
+}
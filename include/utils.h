@@ -1,8 +1,23 @@
 #pragma once
 
+#include "atomic_defs.h"
 #include "debug.h"
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
 #include <utility>
 
+#if defined _M_IX86 || defined _M_X64 || defined __i386__ || defined __x86_64__
+	#include <immintrin.h>
+	#define LF_cpu_pause() _mm_pause()
+#else
+	#define LF_cpu_pause() ((void)0)
+#endif
+
+#if defined _MSC_VER
+	#include <intrin.h>
+#endif
+
 #if !defined _MSC_VER || (_MSC_VER < 1900)
 	#pragma message("WARNING: This code has not really been tested under compilers different than MSVC 14.0")
 #endif
@@ -36,9 +51,66 @@ namespace lockfree
 	template <typename T>
 	using tAlignedStorage = std::aligned_storage_t<sizeof(T), alignof(T)>;
 
+	//-------------------------------------------------------------------------
+	// Used to keep data written by different threads on different cache lines, to avoid false sharing
+	static constexpr const size_t CACHE_LINE_SIZE = 64;
+
 	//-------------------------------------------------------------------------
 	namespace detail
 	{
+		//-------------------------------------------------------------------------
+		// Types containers can store as they are in their nodes: copied around as plain memory, and never destroyed
+		template <typename T>
+		using tIsTriviallyStorable = std::integral_constant<bool, std::is_trivial<T>::value && std::is_trivially_copy_assignable<T>::value>;
+
+		//-------------------------------------------------------------------------
+		// Cheap (xorshift) per-thread pseudo-random numbers, for things like picking queues or victims at random without contending on 
+		// any shared state. Not suitable for anything where the quality of the randomness matters
+		inline uint32_t ThreadLocalRandom()
+		{
+			static thread_local uint32_t state = 0;
+			if (state == 0)
+			{
+				static atomic<uint32_t> seed_source(0x9E3779B9U);
+				state = seed_source.fetch_add(0x9E3779B9U, memory_order_relaxed) | 1U;
+			}
+
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+			return state;
+		}
+
+		//-------------------------------------------------------------------------
+		// Index of the lowest bit set (tzcnt/bsf), mask can't be 0
+		inline unsigned LowestBitIndex(uint32_t mask)
+		{
+			LF_assert(mask != 0, "No bits set");
+#if defined _MSC_VER
+			unsigned long idx = 0;
+			_BitScanForward(&idx, mask);
+			return static_cast<unsigned>(idx);
+#else
+			return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+		}
+
+		//-------------------------------------------------------------------------
+		inline unsigned LowestBitIndex(uint64_t mask)
+		{
+			LF_assert(mask != 0, "No bits set");
+#if defined _M_X64
+			unsigned long idx = 0;
+			_BitScanForward64(&idx, mask);
+			return static_cast<unsigned>(idx);
+#elif defined _MSC_VER
+			const uint32_t low = static_cast<uint32_t>(mask);
+			return (low != 0) ? LowestBitIndex(low) : 32 + LowestBitIndex(static_cast<uint32_t>(mask >> 32));
+#else
+			return static_cast<unsigned>(__builtin_ctzll(mask));
+#endif
+		}
+
 		// Simple allocator that simulates allocations from some specified storage
 		// For situations where we know the allocator is going to be used once to allocate a buffer of some size and we want to provide the storage for it (on the stack, or in some object's space)
 		// The storage is still owned externally
@@ -0,0 +1,33 @@
+///////////////////////////////////////////////////////////////////////////
+//
+//virtual_memory.h
+//
+// Thin platform layer for giving the physical memory behind a range of pages back to the OS (madvise on Linux, MEM_RESET on Windows)
+//
+/////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <cstddef>
+
+namespace lockfree
+{
+	namespace vm
+	{
+		/// <summary>
+		///		Queries the size of the pages of the OS
+		/// </summary>
+		size_t GetPageSize();
+
+		/// <summary>
+		///		Gives the physical memory behind the pages in [ptr, ptr + size) back to the OS, keeping the range of addresses valid.
+		///		The contents of the pages are lost, touching them again maps them back in (zeroed on Linux, undefined on Windows)
+		/// </summary>
+		/// <remarks>
+		///		The range must be aligned to the page size
+		/// </remarks>
+		/// <return>
+		///		Returns false if the OS didn't take the pages (or the platform doesn't support it). Their contents are kept then
+		/// </return>
+		bool DiscardPages(void* ptr, size_t size);
+	}
+}
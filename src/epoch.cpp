@@ -0,0 +1,169 @@
+#include "epoch.h"
+
+#include <cstdlib>
+
+namespace lockfree {
+
+namespace
+{
+	static constexpr const unsigned BITS_PER_WORD = 64;
+	static constexpr const unsigned NUM_INDEX_WORDS = (detail::MAX_EPOCH_THREADS + BITS_PER_WORD - 1) / BITS_PER_WORD;
+
+	// One bit per thread index, set while some thread owns it
+	atomic<uint64_t>	gUsedThreadIndices[NUM_INDEX_WORDS];
+	atomic<unsigned>	gThreadIndexHighWater(0);
+
+	//-------------------------------------------------------------------------
+	unsigned AcquireThreadIndex()
+	{
+		for (unsigned word_idx = 0; word_idx != NUM_INDEX_WORDS; ++word_idx)
+		{
+			uint64_t used = gUsedThreadIndices[word_idx].load(memory_order_relaxed);
+			while (~used != 0)
+			{
+				unsigned bit = 0;
+				while (used & (1ULL << bit))
+				{
+					++bit;
+				}
+
+				if (gUsedThreadIndices[word_idx].compare_exchange_weak(used, used | (1ULL << bit), memory_order_acquire, memory_order_relaxed))
+				{
+					const unsigned thread_idx = word_idx * BITS_PER_WORD + bit;
+					unsigned high_water = gThreadIndexHighWater.load(memory_order_relaxed);
+					while ((high_water <= thread_idx)
+						&& !gThreadIndexHighWater.compare_exchange_weak(high_water, thread_idx + 1, memory_order_release, memory_order_relaxed))
+					{
+					}
+					return thread_idx;
+				}
+			}
+		}
+
+		LF_assert(false, "Too many threads using epoch-based reclamation at the same time, increase MAX_EPOCH_THREADS");
+		std::abort();
+	}
+
+	//-------------------------------------------------------------------------
+	void ReleaseThreadIndex(unsigned thread_idx)
+	{
+		gUsedThreadIndices[thread_idx / BITS_PER_WORD].fetch_and(~(1ULL << (thread_idx % BITS_PER_WORD)), memory_order_release);
+	}
+
+	//-------------------------------------------------------------------------
+	// Gives the index back when the thread finishes
+	struct tThreadIndexOwner
+	{
+		tThreadIndexOwner() : mIdx(AcquireThreadIndex()) {}
+		~tThreadIndexOwner() { ReleaseThreadIndex(mIdx); }
+
+		const unsigned mIdx;
+	};
+}
+
+namespace detail
+{
+	//-------------------------------------------------------------------------
+	unsigned GetThreadIndex()
+	{
+		static thread_local const tThreadIndexOwner owner;
+		return owner.mIdx;
+	}
+
+	//-------------------------------------------------------------------------
+	unsigned GetThreadIndexHighWater()
+	{
+		return gThreadIndexHighWater.load(memory_order_acquire);
+	}
+}
+
+//-------------------------------------------------------------------------
+cEpochDomain::cEpochDomain(tReclaimFnc reclaim, void* context)
+	: mGlobalEpoch(EPOCH_STEP)
+	, mReclaimFnc(reclaim)
+	, mReclaimContext(context)
+{
+	for (tThreadRecord& record : mRecords)
+	{
+		record.mEpoch.store(0, memory_order_relaxed);
+		record.mNesting = 0;
+		record.mNumRetired = 0;
+		record.mRetired = nullptr;
+	}
+}
+
+//-------------------------------------------------------------------------
+cEpochDomain::~cEpochDomain()
+{
+	for (tThreadRecord& record : mRecords)
+	{
+		LF_assert(record.mNesting == 0, "Destroying an epoch domain with threads inside critical sections");
+
+		tEpochNode* node = record.mRetired;
+		while (node)
+		{
+			tEpochNode* const next = node->mNextRetired;
+			mReclaimFnc(node, mReclaimContext);
+			node = next;
+		}
+	}
+}
+
+//-------------------------------------------------------------------------
+void cEpochDomain::Reclaim()
+{
+	TryAdvance();
+	ReclaimRetired(mRecords[detail::GetThreadIndex()], mGlobalEpoch.load(memory_order_acquire));
+}
+
+//-------------------------------------------------------------------------
+bool cEpochDomain::TryAdvance()
+{
+	uint64_t global_epoch = mGlobalEpoch.load(memory_order_relaxed);
+
+	// Pairs with the fence in Enter: a thread we don't see as active will see the unlinking of whatever got retired
+	std::atomic_thread_fence(memory_order_seq_cst);
+
+	const unsigned num_records = detail::GetThreadIndexHighWater();
+	for (unsigned idx = 0; idx != num_records; ++idx)
+	{
+		const uint64_t thread_epoch = mRecords[idx].mEpoch.load(memory_order_relaxed);
+		if ((thread_epoch & ACTIVE_FLAG) && ((thread_epoch & ~ACTIVE_FLAG) != global_epoch))
+		{
+			return false;
+		}
+	}
+
+	std::atomic_thread_fence(memory_order_acquire);
+	return mGlobalEpoch.compare_exchange_strong(global_epoch, global_epoch + EPOCH_STEP, memory_order_release, memory_order_relaxed);
+}
+
+//-------------------------------------------------------------------------
+void cEpochDomain::ReclaimRetired(tThreadRecord& record, uint64_t global_epoch)
+{
+	// Nodes retired two epochs ago can't be referenced anymore: every thread has left the critical sections it was in back then
+	if (global_epoch < 2 * EPOCH_STEP)
+	{
+		return;
+	}
+	const uint64_t safe_epoch = global_epoch - 2 * EPOCH_STEP;
+
+	// The list goes from newest to oldest, so once a node is safe, all the ones after it are too
+	tEpochNode** link = &record.mRetired;
+	while (*link && ((*link)->mRetireEpoch > safe_epoch))
+	{
+		link = &(*link)->mNextRetired;
+	}
+
+	tEpochNode* node = *link;
+	*link = nullptr;
+	while (node)
+	{
+		tEpochNode* const next = node->mNextRetired;
+		mReclaimFnc(node, mReclaimContext);
+		--record.mNumRetired;
+		node = next;
+	}
+}
+
+}
@@ -0,0 +1,109 @@
+#include "futex.h"
+
+#include <algorithm>
+#include <limits>
+
+#if defined _WIN32
+	#include <windows.h>
+	#pragma comment(lib, "Synchronization.lib")
+#elif defined __linux__
+	#include <linux/futex.h>
+	#include <sys/syscall.h>
+	#include <unistd.h>
+	#include <time.h>
+	#include <errno.h>
+#else
+	#include <thread>
+#endif
+
+namespace lockfree { namespace futex {
+
+namespace
+{
+	// The word is accessed by the OS as a plain 32-bit integer. std::atomic<uint32_t> is guaranteed to be lock-free on all the
+	// platforms we support, which means it has the same size and representation than the underlying integer
+	static_assert(sizeof(atomic<uint32_t>) == sizeof(uint32_t), "atomic<uint32_t> can not be used as a futex word in this platform");
+
+	//-------------------------------------------------------------------------
+	void* GetAddress(const atomic<uint32_t>& word)
+	{
+		return const_cast<atomic<uint32_t>*>(&word);
+	}
+
+#if defined __linux__
+	//-------------------------------------------------------------------------
+	long FutexSyscall(const atomic<uint32_t>& word, int op, uint32_t val, const timespec* timeout)
+	{
+		return syscall(SYS_futex, GetAddress(word), op | FUTEX_PRIVATE_FLAG, val, timeout, nullptr, 0);
+	}
+#endif
+}
+
+//-------------------------------------------------------------------------
+void Wait(const atomic<uint32_t>& word, uint32_t expected)
+{
+#if defined _WIN32
+	::WaitOnAddress(GetAddress(word), &expected, sizeof(expected), INFINITE);
+#elif defined __linux__
+	FutexSyscall(word, FUTEX_WAIT, expected, nullptr);
+#else
+	if (word.load(memory_order_relaxed) == expected)
+	{
+		std::this_thread::yield();
+	}
+#endif
+}
+
+//-------------------------------------------------------------------------
+bool WaitFor(const atomic<uint32_t>& word, uint32_t expected, std::chrono::nanoseconds timeout)
+{
+	if (timeout <= std::chrono::nanoseconds::zero())
+	{
+		return false;
+	}
+
+#if defined _WIN32
+	// Round up, so short timeouts don't turn into busy loops
+	const auto timeout_ms = std::chrono::duration_cast<std::chrono::milliseconds>(timeout + std::chrono::milliseconds(1) - std::chrono::nanoseconds(1)).count();
+	const DWORD timeout_dw = static_cast<DWORD>((std::min<long long>)(timeout_ms, INFINITE - 1));
+	return ::WaitOnAddress(GetAddress(word), &expected, sizeof(expected), timeout_dw) || (::GetLastError() != ERROR_TIMEOUT);
+#elif defined __linux__
+	const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(timeout);
+	timespec relative_timeout;
+	relative_timeout.tv_sec = static_cast<time_t>(seconds.count());
+	relative_timeout.tv_nsec = static_cast<long>((timeout - seconds).count());
+	return (FutexSyscall(word, FUTEX_WAIT, expected, &relative_timeout) == 0) || (errno != ETIMEDOUT);
+#else
+	if (word.load(memory_order_relaxed) == expected)
+	{
+		std::this_thread::sleep_for((std::min)(timeout, std::chrono::nanoseconds(std::chrono::microseconds(50))));
+	}
+	return true;
+#endif
+}
+
+//-------------------------------------------------------------------------
+void WakeOne(const atomic<uint32_t>& word)
+{
+#if defined _WIN32
+	::WakeByAddressSingle(GetAddress(word));
+#elif defined __linux__
+	FutexSyscall(word, FUTEX_WAKE, 1, nullptr);
+#else
+	(void)word;
+#endif
+}
+
+//-------------------------------------------------------------------------
+void WakeAll(const atomic<uint32_t>& word)
+{
+#if defined _WIN32
+	::WakeByAddressAll(GetAddress(word));
+#elif defined __linux__
+	FutexSyscall(word, FUTEX_WAKE, (std::numeric_limits<int>::max)(), nullptr);
+#else
+	(void)word;
+#endif
+}
+
+} }
@@ -0,0 +1,291 @@
+#include "job_system.h"
+
+namespace lockfree {
+
+namespace
+{
+	// Lets workers find their own deque when they submit or wait, so they don't need to go through the inboxes
+	thread_local const cJobSystem*	tls_job_system = nullptr;
+	thread_local unsigned			tls_worker_idx = 0;
+
+	//-------------------------------------------------------------------------
+	unsigned ResolveNumWorkers(unsigned requested)
+	{
+		if (requested != 0)
+		{
+			return requested;
+		}
+
+		const unsigned hardware_threads = std::thread::hardware_concurrency();
+		return (hardware_threads > 1) ? hardware_threads - 1 : 1;
+	}
+
+	//-------------------------------------------------------------------------
+	unsigned RoundUpToPowerOfTwo(unsigned value)
+	{
+		unsigned power = 1;
+		while (power < value)
+		{
+			power <<= 1;
+		}
+		return power;
+	}
+}
+
+//-------------------------------------------------------------------------
+cJobSystem::cJobSystem(unsigned num_workers, unsigned max_jobs)
+	: mJobPool(max_jobs)
+	, mInboxPool(max_jobs + ResolveNumWorkers(num_workers))	// + 1 sentinel node per inbox
+	, mParkedWorkers(0)
+	, mNextInbox(0)
+	, mStop(false)
+{
+	static_assert(sizeof(tJob) <= CACHE_LINE_SIZE, "Jobs are expected to fit in one cache line");
+
+	num_workers = ResolveNumWorkers(num_workers);
+
+	// Every job a deque holds comes from the pool, so a deque as big as the pool never needs to grow (i.e., allocate) on Push.
+	// All the workers need to exist before any of them starts stealing from the others
+	const unsigned deque_capacity = RoundUpToPowerOfTwo(mJobPool.GetCapacity());
+	mWorkers.reserve(num_workers);
+	for (unsigned idx = 0; idx != num_workers; ++idx)
+	{
+		mWorkers.emplace_back(new tWorker(deque_capacity, mInboxPool));
+	}
+
+	for (unsigned idx = 0; idx != num_workers; ++idx)
+	{
+		mWorkers[idx]->mThread = std::thread([this, idx] { WorkerMain(idx); });
+	}
+}
+
+//-------------------------------------------------------------------------
+cJobSystem::~cJobSystem()
+{
+	mStop.store(true, memory_order_seq_cst);
+	for (auto& worker : mWorkers)
+	{
+		worker->mWakeEvent.NotifyAll();
+	}
+
+	for (auto& worker : mWorkers)
+	{
+		worker->mThread.join();
+	}
+}
+
+//-------------------------------------------------------------------------
+void cJobSystem::Wait(cJobCounter& counter)
+{
+	const unsigned worker_idx = GetCurrentWorkerIdx();
+	if (worker_idx != NOT_A_WORKER)
+	{
+		// Workers can't park here: the jobs we are waiting for could be sitting in our own deque or inbox
+		while (!counter.IsDone())
+		{
+			tJob* job = nullptr;
+			if (TryAcquireJob(worker_idx, job))
+			{
+				RunJob(job);
+			}
+			else
+			{
+				std::this_thread::yield();
+			}
+		}
+	}
+	else
+	{
+		// Help while there is something to steal, park until some counter gets to zero otherwise
+		mJobDoneEvent.Await([this, &counter]
+		{
+			tJob* job = nullptr;
+			if (TryStealJob(NOT_A_WORKER, job))
+			{
+				RunJob(job);
+			}
+			return counter.IsDone();
+		});
+	}
+}
+
+//-------------------------------------------------------------------------
+void cJobSystem::Enqueue(tJob* job)
+{
+	const unsigned worker_idx = GetCurrentWorkerIdx();
+	if (worker_idx != NOT_A_WORKER)
+	{
+		mWorkers[worker_idx]->mJobs.Push(job);
+		WakeIdleWorker();
+	}
+	else
+	{
+		// A parked worker picks the job up right away, a busy one only once it runs out of jobs of its own. Round-robin when all are
+		// busy. Parked workers are claimed, so a burst of submissions wakes several of them rather than piling on one. Whoever gets
+		// the job is notified after the push, so picking a worker that is just parking or waking up is only slower
+		const unsigned num_workers = static_cast<unsigned>(mWorkers.size());
+		const unsigned first_worker = mNextInbox.fetch_add(1, memory_order_relaxed) % num_workers;
+		unsigned worker_idx = first_worker;
+		if (mParkedWorkers.load(memory_order_relaxed) != 0)
+		{
+			for (unsigned offset = 0; offset != num_workers; ++offset)
+			{
+				const unsigned idx = (first_worker + offset) % num_workers;
+				atomic<bool>& parked = mWorkers[idx]->mParked;
+				if (parked.load(memory_order_relaxed) && parked.exchange(false, memory_order_relaxed))
+				{
+					worker_idx = idx;
+					break;
+				}
+			}
+		}
+
+		tWorker& worker = *mWorkers[worker_idx];
+		if (worker.mInbox.Push(job))
+		{
+			worker.mWakeEvent.NotifyOne();
+		}
+		else
+		{
+			RunJob(job);
+		}
+	}
+}
+
+//-------------------------------------------------------------------------
+void cJobSystem::RunJob(tJob* job)
+{
+	job->mTask();
+
+	cJobCounter* const counter = job->mCounter;
+	mJobPool.Release(job);
+
+	// The counter can go away as soon as it gets to zero, don't touch it after that
+	if (counter && (counter->mPending.fetch_sub(1, memory_order_acq_rel) == 1))
+	{
+		mJobDoneEvent.NotifyAll();
+	}
+}
+
+//-------------------------------------------------------------------------
+bool cJobSystem::TryAcquireJob(unsigned worker_idx, tJob*& job)
+{
+	tWorker& worker = *mWorkers[worker_idx];
+	if (worker.mJobs.Pop(job))
+	{
+		return true;
+	}
+
+	// Move whatever was submitted from the outside to our deque, so others can steal it
+	const unsigned moved = worker.mInbox.ConsumeAll([&worker](tJob*& inbox_job) { worker.mJobs.Push(inbox_job); });
+	if (moved != 0)
+	{
+		if (moved > 1)
+		{
+			WakeIdleWorker();
+		}
+
+		if (worker.mJobs.Pop(job))
+		{
+			return true;
+		}
+	}
+
+	return TryStealJob(worker_idx, job);
+}
+
+//-------------------------------------------------------------------------
+bool cJobSystem::TryStealJob(unsigned worker_idx, tJob*& job)
+{
+	const unsigned num_workers = static_cast<unsigned>(mWorkers.size());
+	const unsigned first_victim = detail::ThreadLocalRandom() % num_workers;
+	for (unsigned offset = 0; offset != num_workers; ++offset)
+	{
+		const unsigned victim_idx = (first_victim + offset) % num_workers;
+		if ((victim_idx != worker_idx) && mWorkers[victim_idx]->mJobs.Steal(job))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+//-------------------------------------------------------------------------
+void cJobSystem::WakeIdleWorker()
+{
+	// Pairs with the increment of mParkedWorkers in WorkerMain: either we see the worker parking, or it sees the job we just pushed
+	std::atomic_thread_fence(memory_order_seq_cst);
+	if (mParkedWorkers.load(memory_order_relaxed) == 0)
+	{
+		return;
+	}
+
+	const unsigned num_workers = static_cast<unsigned>(mWorkers.size());
+	const unsigned first_worker = detail::ThreadLocalRandom() % num_workers;
+	for (unsigned offset = 0; offset != num_workers; ++offset)
+	{
+		if (mWorkers[(first_worker + offset) % num_workers]->mWakeEvent.NotifyOne())
+		{
+			return;
+		}
+	}
+}
+
+//-------------------------------------------------------------------------
+void cJobSystem::WorkerMain(unsigned worker_idx)
+{
+	tls_job_system = this;
+	tls_worker_idx = worker_idx;
+
+	tWorker& worker = *mWorkers[worker_idx];
+	for (;;)
+	{
+		tJob* job = nullptr;
+		if (TryAcquireJob(worker_idx, job))
+		{
+			RunJob(job);
+			continue;
+		}
+
+		if (mStop.load(memory_order_acquire))
+		{
+			break;
+		}
+
+		// Register as parked before re-checking for work, see WakeIdleWorker
+		const cEventCount::tKey key = worker.mWakeEvent.PrepareWait();
+		mParkedWorkers.fetch_add(1, memory_order_seq_cst);
+		worker.mParked.store(true, memory_order_relaxed);
+
+		if (TryAcquireJob(worker_idx, job))
+		{
+			worker.mWakeEvent.CancelWait();
+			worker.mParked.store(false, memory_order_relaxed);
+			mParkedWorkers.fetch_sub(1, memory_order_relaxed);
+			RunJob(job);
+		}
+		else if (mStop.load(memory_order_acquire))
+		{
+			worker.mWakeEvent.CancelWait();
+			worker.mParked.store(false, memory_order_relaxed);
+			mParkedWorkers.fetch_sub(1, memory_order_relaxed);
+		}
+		else
+		{
+			worker.mWakeEvent.CommitWait(key);
+			worker.mParked.store(false, memory_order_relaxed);
+			mParkedWorkers.fetch_sub(1, memory_order_relaxed);
+		}
+	}
+
+	tls_job_system = nullptr;
+}
+
+//-------------------------------------------------------------------------
+unsigned cJobSystem::GetCurrentWorkerIdx() const
+{
+	return (tls_job_system == this) ? tls_worker_idx : NOT_A_WORKER;
+}
+
+}
@@ -0,0 +1,583 @@
+///////////////////////////////////////////////////////////////////////////
+//
+//lfmalloc.cpp
+//
+// Experimental general purpose allocator built from the lock-free size class pools of cLockFreeSlabAllocator. With
+// LFMALLOC_REPLACE_MALLOC defined it replaces malloc, meant to be preloaded into a whole binary to compare it against the allocator
+// of the C runtime:
+//
+//	g++ -std=c++14 -O2 -shared -fPIC -fvisibility=hidden -DLFMALLOC_REPLACE_MALLOC -Iinclude src/lfmalloc.cpp src/futex.cpp -o liblfmalloc.so -pthread
+//	LD_PRELOAD=./liblfmalloc.so ./binary
+//
+// - Small requests (up to 128KB, where glibc starts mapping requests on their own by default) come from thread-local caches of blocks
+//   of each size class. Caches refill from the pools, and spill half of their blocks back in a single atomic operation when they get
+//   full
+// - Frees from threads other than the one that allocated the block (remote frees) don't touch the allocating thread at all: the
+//   block goes to the cache of the freeing thread, and from there back to the shared pool. Producer/consumer pairs end up moving
+//   blocks in batches from the cache of the consumer to the cache of the producer through the pools
+// - Large requests, requests aligned beyond a page, and small ones whose size class (and the bigger ones) ran out of blocks, get their
+//   own mapping
+//
+// The storage of every size class is mapped on first use, without reserving swap for it. The pools carve blocks from it lazily, so
+// it costs addresses rather than memory until blocks get used. Its size can be set through the LFMALLOC_BYTES_PER_CLASS environment
+// variable. Linux only, it compiles to nothing on other platforms.
+/////////////////////////////////////////////////////////////////////////////
+#if defined __linux__
+
+#include "lfmalloc.h"
+#include "lockfree_slab_allocator.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <new>
+
+#include <malloc.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace lockfree {
+
+namespace
+{
+	static constexpr const size_t DEFAULT_BYTES_PER_CLASS = size_t(1) << 30;
+	static constexpr const size_t CACHE_BYTES_PER_CLASS = 64 << 10;
+	static constexpr const size_t MIN_ALIGNMENT = alignof(std::max_align_t);
+	static constexpr const size_t PAGE_SIZE = 4096;
+
+	//-------------------------------------------------------------------------
+	// The storage of the pools can not come from malloc. Mappings are page aligned, so the power of two blocks of the slab allocator
+	// are aligned to their size, or to the page size for the blocks bigger than a page
+	static constexpr const int STORAGE_PROTECTION = PROT_READ | PROT_WRITE;
+	static constexpr const int STORAGE_FLAGS = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE;
+
+	template <class T>
+	struct tMmapAllocator
+	{
+		typedef T value_type;
+
+		tMmapAllocator() {}
+		template <class U> tMmapAllocator(const tMmapAllocator<U>&) {}
+
+		T* allocate(size_t n)
+		{
+			void* const ptr = mmap(nullptr, n * sizeof(T), STORAGE_PROTECTION, STORAGE_FLAGS, -1, 0);
+			if (ptr == MAP_FAILED)
+			{
+				std::abort();
+			}
+			return static_cast<T*>(ptr);
+		}
+
+		void deallocate(T* ptr, size_t n)
+		{
+			munmap(ptr, n * sizeof(T));
+		}
+
+		template <class U> bool operator==(const tMmapAllocator<U>&) const { return true; }
+		template <class U> bool operator!=(const tMmapAllocator<U>&) const { return false; }
+	};
+
+	// Size classes from 8 bytes to 128KB
+	typedef cLockFreeSlabAllocator<tMmapAllocator<unsigned char>, 15> tSlabAllocator;
+	static_assert(tSlabAllocator::MAX_BLOCK_SIZE == (128 << 10), "Size classes don't go up to 128KB");
+
+	//-------------------------------------------------------------------------
+	// Blocks of each size class owned by one thread, up to CACHE_BYTES_PER_CLASS of them (but at least a couple). Trivial, so accessing
+	// it never runs constructors nor registers destructors (both could call malloc). Flushed by the destructor of a pthread key when
+	// the thread finishes
+	struct tThreadCache
+	{
+		static constexpr const unsigned CAPACITY = 64;
+		static constexpr const unsigned MIN_CAPACITY = 2;
+
+		enum eState { TCS_UNREGISTERED, TCS_REGISTERED, TCS_FINISHED };
+
+		void*		mBlocks[tSlabAllocator::NUM_SIZE_CLASSES][CAPACITY];
+		unsigned	mNumBlocks[tSlabAllocator::NUM_SIZE_CLASSES];
+		eState		mState;
+	};
+
+	// Large allocations keep their mapping right before the pointer handed out
+	struct tLargeHeader
+	{
+		void*	mMapping;
+		size_t	mMappingSize;
+	};
+	static_assert(sizeof(tLargeHeader) <= MIN_ALIGNMENT, "The header must fit in the minimum alignment");
+
+	enum eInitState { IS_NONE, IS_INITIALIZING, IS_READY };
+
+	alignas(tSlabAllocator) unsigned char	gSlabAllocatorStorage[sizeof(tSlabAllocator)];
+	atomic<int>								gInitState(IS_NONE);
+	pthread_key_t							gThreadCacheKey;
+
+	// Initial-exec: the library is loaded with the program, so its TLS is in the static block and accessing it never allocates
+	__attribute__((tls_model("initial-exec"))) thread_local tThreadCache tCache;
+
+	//-------------------------------------------------------------------------
+	tSlabAllocator& GetSlabAllocator()
+	{
+		return *reinterpret_cast<tSlabAllocator*>(gSlabAllocatorStorage);
+	}
+
+	//-------------------------------------------------------------------------
+	unsigned GetCacheCapacity(unsigned size_class)
+	{
+		const size_t capacity = CACHE_BYTES_PER_CLASS / tSlabAllocator::GetBlockSize(size_class);
+		return static_cast<unsigned>((std::min)((std::max)(capacity, size_t(tThreadCache::MIN_CAPACITY)), size_t(tThreadCache::CAPACITY)));
+	}
+
+	//-------------------------------------------------------------------------
+	// Bytes per class the OS lets us map, starting from the requested ones and halving them on failure
+	size_t ProbeBytesPerClass(size_t bytes_per_class)
+	{
+		for (; bytes_per_class > tSlabAllocator::MAX_BLOCK_SIZE; bytes_per_class /= 2)
+		{
+			const size_t total_bytes = bytes_per_class * tSlabAllocator::NUM_SIZE_CLASSES;
+			void* const ptr = mmap(nullptr, total_bytes, STORAGE_PROTECTION, STORAGE_FLAGS, -1, 0);
+			if (ptr != MAP_FAILED)
+			{
+				munmap(ptr, total_bytes);
+				break;
+			}
+		}
+		return bytes_per_class;
+	}
+
+	//-------------------------------------------------------------------------
+	void FlushThreadCache(void*)
+	{
+		for (unsigned size_class = 0; size_class != tSlabAllocator::NUM_SIZE_CLASSES; ++size_class)
+		{
+			GetSlabAllocator().DeallocateBatch(size_class, tCache.mBlocks[size_class], tCache.mNumBlocks[size_class]);
+			tCache.mNumBlocks[size_class] = 0;
+		}
+
+		// Whatever the remaining destructors of the thread free goes straight to the pools
+		tCache.mState = tThreadCache::TCS_FINISHED;
+	}
+
+	//-------------------------------------------------------------------------
+	// Never destroyed: memory can be freed until the very end of the process
+	void Initialize()
+	{
+		int state = IS_NONE;
+		if (gInitState.compare_exchange_strong(state, IS_INITIALIZING, memory_order_acquire, memory_order_acquire))
+		{
+			size_t bytes_per_class = DEFAULT_BYTES_PER_CLASS;
+			if (const char* const env_bytes = getenv("LFMALLOC_BYTES_PER_CLASS"))
+			{
+				bytes_per_class = (std::max)(static_cast<size_t>(strtoull(env_bytes, nullptr, 10)), PAGE_SIZE);
+			}
+
+			new (gSlabAllocatorStorage) tSlabAllocator(ProbeBytesPerClass(bytes_per_class));
+			pthread_key_create(&gThreadCacheKey, &FlushThreadCache);
+			gInitState.store(IS_READY, memory_order_release);
+		}
+		else
+		{
+			while (state != IS_READY)
+			{
+				state = gInitState.load(memory_order_acquire);
+			}
+		}
+	}
+
+	//-------------------------------------------------------------------------
+	bool IsInitialized()
+	{
+		return gInitState.load(memory_order_acquire) == IS_READY;
+	}
+
+	//-------------------------------------------------------------------------
+	// The destructor of the key only runs for threads that set a value for it
+	bool UsesThreadCache()
+	{
+		if (tCache.mState == tThreadCache::TCS_UNREGISTERED)
+		{
+			// Set first, pthread_setspecific may allocate
+			tCache.mState = tThreadCache::TCS_REGISTERED;
+			pthread_setspecific(gThreadCacheKey, &tCache);
+		}
+		return tCache.mState == tThreadCache::TCS_REGISTERED;
+	}
+
+	//-------------------------------------------------------------------------
+	void* AllocateSmall(unsigned size_class)
+	{
+		tSlabAllocator& slab_allocator = GetSlabAllocator();
+		if (!UsesThreadCache())
+		{
+			return slab_allocator.AllocateFromClass(size_class);
+		}
+
+		unsigned& num_blocks = tCache.mNumBlocks[size_class];
+		if (num_blocks == 0)
+		{
+			// Half the cache, so frees right after don't spill it straight away
+			const unsigned num_refill = GetCacheCapacity(size_class) / 2;
+			while (num_blocks != num_refill)
+			{
+				void* const block = slab_allocator.AllocateFromClass(size_class);
+				if (!block)
+				{
+					break;
+				}
+				tCache.mBlocks[size_class][num_blocks++] = block;
+			}
+
+			if (num_blocks == 0)
+			{
+				return nullptr;
+			}
+		}
+		return tCache.mBlocks[size_class][--num_blocks];
+	}
+
+	//-------------------------------------------------------------------------
+	void DeallocateSmall(void* ptr, unsigned size_class)
+	{
+		tSlabAllocator& slab_allocator = GetSlabAllocator();
+		if (!UsesThreadCache())
+		{
+			slab_allocator.DeallocateBatch(size_class, &ptr, 1);
+			return;
+		}
+
+		unsigned& num_blocks = tCache.mNumBlocks[size_class];
+		const unsigned capacity = GetCacheCapacity(size_class);
+		if (num_blocks == capacity)
+		{
+			// The oldest half goes back, the blocks freed last are the most likely to still be in the cache of the CPU
+			const unsigned num_spilled = capacity / 2;
+			slab_allocator.DeallocateBatch(size_class, tCache.mBlocks[size_class], num_spilled);
+			memmove(tCache.mBlocks[size_class], tCache.mBlocks[size_class] + num_spilled, (capacity - num_spilled) * sizeof(void*));
+			num_blocks = capacity - num_spilled;
+		}
+		tCache.mBlocks[size_class][num_blocks++] = ptr;
+	}
+
+	//-------------------------------------------------------------------------
+	tLargeHeader* GetLargeHeader(void* ptr)
+	{
+		return static_cast<tLargeHeader*>(ptr) - 1;
+	}
+
+	//-------------------------------------------------------------------------
+	void* AllocateLarge(size_t size, size_t alignment)
+	{
+		// Alignments up to the minimum one are already met by the header, right at the start of the (page aligned) mapping
+		const size_t padding = (alignment > MIN_ALIGNMENT) ? alignment : MIN_ALIGNMENT;
+		if (size > (std::numeric_limits<size_t>::max)() - padding - PAGE_SIZE)
+		{
+			return nullptr;
+		}
+
+		const size_t mapping_size = (size + padding + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+		void* const mapping = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (mapping == MAP_FAILED)
+		{
+			return nullptr;
+		}
+
+		const uintptr_t address = reinterpret_cast<uintptr_t>(mapping) + sizeof(tLargeHeader);
+		void* const ptr = reinterpret_cast<void*>((address + padding - 1) & ~(uintptr_t(padding) - 1));
+		GetLargeHeader(ptr)->mMapping = mapping;
+		GetLargeHeader(ptr)->mMappingSize = mapping_size;
+		return ptr;
+	}
+
+	//-------------------------------------------------------------------------
+	void DeallocateLarge(void* ptr)
+	{
+		const tLargeHeader header = *GetLargeHeader(ptr);
+		munmap(header.mMapping, header.mMappingSize);
+	}
+
+	//-------------------------------------------------------------------------
+	// Size class big enough for the request, or NUM_SIZE_CLASSES if it is too big (or too aligned). Blocks are aligned to their size, up
+	// to the page size
+	unsigned GetSizeClass(size_t size, size_t alignment)
+	{
+		return (alignment <= PAGE_SIZE) ? tSlabAllocator::GetSizeClass((std::max)(size, alignment)) : tSlabAllocator::NUM_SIZE_CLASSES;
+	}
+
+	//-------------------------------------------------------------------------
+	void* Allocate(size_t size, size_t alignment)
+	{
+		if (!IsInitialized())
+		{
+			Initialize();
+		}
+
+		// A class that runs out borrows from the bigger ones before going to the OS
+		for (unsigned size_class = GetSizeClass(size, alignment); size_class < tSlabAllocator::NUM_SIZE_CLASSES; ++size_class)
+		{
+			if (void* const ptr = AllocateSmall(size_class))
+			{
+				return ptr;
+			}
+		}
+
+		void* const ptr = AllocateLarge(size, alignment);
+		if (!ptr)
+		{
+			errno = ENOMEM;
+		}
+		return ptr;
+	}
+
+	//-------------------------------------------------------------------------
+	void Deallocate(void* ptr)
+	{
+		if (!ptr)
+		{
+			return;
+		}
+
+		// Nothing could have been allocated before initializing
+		const unsigned size_class = GetSlabAllocator().FindSizeClass(ptr);
+		if (size_class != tSlabAllocator::NUM_SIZE_CLASSES)
+		{
+			DeallocateSmall(ptr, size_class);
+		}
+		else
+		{
+			DeallocateLarge(ptr);
+		}
+	}
+
+	//-------------------------------------------------------------------------
+	size_t GetUsableSize(void* ptr)
+	{
+		const unsigned size_class = GetSlabAllocator().FindSizeClass(ptr);
+		if (size_class != tSlabAllocator::NUM_SIZE_CLASSES)
+		{
+			return tSlabAllocator::GetBlockSize(size_class);
+		}
+
+		const tLargeHeader& header = *GetLargeHeader(ptr);
+		return header.mMappingSize - (static_cast<unsigned char*>(ptr) - static_cast<unsigned char*>(header.mMapping));
+	}
+
+	//-------------------------------------------------------------------------
+	void* Reallocate(void* ptr, size_t size)
+	{
+		const size_t usable_size = GetUsableSize(ptr);
+		const unsigned size_class = GetSlabAllocator().FindSizeClass(ptr);
+		const bool is_large = size_class == tSlabAllocator::NUM_SIZE_CLASSES;
+
+		// Shrinking in place, unless a smaller block would do
+		if ((size <= usable_size) && ((size > usable_size / 2) || (GetSizeClass(size, MIN_ALIGNMENT) == size_class)))
+		{
+			return ptr;
+		}
+
+		// Large blocks with no alignment padding can be moved by the kernel, without copying
+		tLargeHeader* const header = is_large ? GetLargeHeader(ptr) : nullptr;
+		if (is_large && (header->mMapping == static_cast<void*>(header)) && (size > tSlabAllocator::MAX_BLOCK_SIZE))
+		{
+			if (size > (std::numeric_limits<size_t>::max)() - MIN_ALIGNMENT - PAGE_SIZE)
+			{
+				errno = ENOMEM;
+				return nullptr;
+			}
+
+			const size_t mapping_size = (size + MIN_ALIGNMENT + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+			void* const mapping = mremap(header->mMapping, header->mMappingSize, mapping_size, MREMAP_MAYMOVE);
+			if (mapping == MAP_FAILED)
+			{
+				errno = ENOMEM;
+				return nullptr;
+			}
+
+			tLargeHeader* const new_header = static_cast<tLargeHeader*>(mapping);
+			new_header->mMapping = mapping;
+			new_header->mMappingSize = mapping_size;
+			return new_header + 1;
+		}
+
+		void* const new_ptr = Allocate(size, MIN_ALIGNMENT);
+		if (new_ptr)
+		{
+			memcpy(new_ptr, ptr, (std::min)(size, usable_size));
+			Deallocate(ptr);
+		}
+		return new_ptr;
+	}
+
+	//-------------------------------------------------------------------------
+	bool IsValidAlignment(size_t alignment)
+	{
+		return (alignment != 0) && ((alignment & (alignment - 1)) == 0);
+	}
+}
+
+}
+
+namespace lockfree { namespace lfmalloc {
+
+//-------------------------------------------------------------------------
+void* Malloc(size_t size)
+{
+	return Allocate(size, MIN_ALIGNMENT);
+}
+
+//-------------------------------------------------------------------------
+void Free(void* ptr)
+{
+	Deallocate(ptr);
+}
+
+//-------------------------------------------------------------------------
+void* Calloc(size_t num, size_t size)
+{
+	if ((size != 0) && (num > (std::numeric_limits<size_t>::max)() / size))
+	{
+		errno = ENOMEM;
+		return nullptr;
+	}
+
+	// Fresh mappings are zeroed already, pool blocks may not be
+	void* const ptr = Allocate(num * size, MIN_ALIGNMENT);
+	if (ptr && GetSlabAllocator().Manages(ptr))
+	{
+		memset(ptr, 0, num * size);
+	}
+	return ptr;
+}
+
+//-------------------------------------------------------------------------
+void* Realloc(void* ptr, size_t size)
+{
+	if (!ptr)
+	{
+		return Allocate(size, MIN_ALIGNMENT);
+	}
+	if (size == 0)
+	{
+		Deallocate(ptr);
+		return nullptr;
+	}
+	return Reallocate(ptr, size);
+}
+
+//-------------------------------------------------------------------------
+void* AlignedAlloc(size_t alignment, size_t size)
+{
+	if (!IsValidAlignment(alignment))
+	{
+		errno = EINVAL;
+		return nullptr;
+	}
+	return Allocate(size, alignment);
+}
+
+//-------------------------------------------------------------------------
+int PosixMemalign(void** ptr, size_t alignment, size_t size)
+{
+	if (!IsValidAlignment(alignment) || (alignment % sizeof(void*) != 0))
+	{
+		return EINVAL;
+	}
+
+	void* const new_ptr = Allocate(size, alignment);
+	if (!new_ptr)
+	{
+		return ENOMEM;
+	}
+	*ptr = new_ptr;
+	return 0;
+}
+
+//-------------------------------------------------------------------------
+void* Valloc(size_t size)
+{
+	return Allocate(size, PAGE_SIZE);
+}
+
+//-------------------------------------------------------------------------
+void* Pvalloc(size_t size)
+{
+	return Allocate((size + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1), PAGE_SIZE);
+}
+
+//-------------------------------------------------------------------------
+size_t MallocUsableSize(void* ptr)
+{
+	return ptr ? GetUsableSize(ptr) : 0;
+}
+
+} }
+
+#if defined LFMALLOC_REPLACE_MALLOC
+
+#define LFMALLOC_EXPORT extern "C" __attribute__((visibility("default")))
+
+//-------------------------------------------------------------------------
+LFMALLOC_EXPORT void* malloc(size_t size) noexcept
+{
+	return lockfree::lfmalloc::Malloc(size);
+}
+
+//-------------------------------------------------------------------------
+LFMALLOC_EXPORT void free(void* ptr) noexcept
+{
+	lockfree::lfmalloc::Free(ptr);
+}
+
+//-------------------------------------------------------------------------
+LFMALLOC_EXPORT void* calloc(size_t num, size_t size) noexcept
+{
+	return lockfree::lfmalloc::Calloc(num, size);
+}
+
+//-------------------------------------------------------------------------
+LFMALLOC_EXPORT void* realloc(void* ptr, size_t size) noexcept
+{
+	return lockfree::lfmalloc::Realloc(ptr, size);
+}
+
+//-------------------------------------------------------------------------
+LFMALLOC_EXPORT void* aligned_alloc(size_t alignment, size_t size) noexcept
+{
+	return lockfree::lfmalloc::AlignedAlloc(alignment, size);
+}
+
+//-------------------------------------------------------------------------
+LFMALLOC_EXPORT void* memalign(size_t alignment, size_t size) noexcept
+{
+	return lockfree::lfmalloc::AlignedAlloc(alignment, size);
+}
+
+//-------------------------------------------------------------------------
+LFMALLOC_EXPORT int posix_memalign(void** ptr, size_t alignment, size_t size) noexcept
+{
+	return lockfree::lfmalloc::PosixMemalign(ptr, alignment, size);
+}
+
+//-------------------------------------------------------------------------
+LFMALLOC_EXPORT void* valloc(size_t size) noexcept
+{
+	return lockfree::lfmalloc::Valloc(size);
+}
+
+//-------------------------------------------------------------------------
+LFMALLOC_EXPORT void* pvalloc(size_t size) noexcept
+{
+	return lockfree::lfmalloc::Pvalloc(size);
+}
+
+//-------------------------------------------------------------------------
+LFMALLOC_EXPORT size_t malloc_usable_size(void* ptr) noexcept
+{
+	return lockfree::lfmalloc::MallocUsableSize(ptr);
+}
+
+#endif
+
+#endif
@@ -0,0 +1,251 @@
+#include "timer_wheel.h"
+
+#include <algorithm>
+
+namespace lockfree {
+
+//-------------------------------------------------------------------------
+cTimerWheel::cTimerWheel(unsigned max_timers, tClock::duration tick)
+	: mNodePool(max_timers)
+	, mStartTime(tClock::now())
+	, mTickDuration(tick)
+	, mInboxBack(&mInboxStub)
+	, mInboxFront(&mInboxStub)
+	, mCurrentTick(0)
+{
+	LF_assert(tick.count() > 0, "The tick of a timer wheel needs to be positive");
+
+	mInboxStub.mInboxNext.store(nullptr, memory_order_relaxed);
+	for (auto& level : mSlots)
+	{
+		for (tTimerNode*& slot : level)
+		{
+			slot = nullptr;
+		}
+	}
+}
+
+//-------------------------------------------------------------------------
+cTimerWheel::~cTimerWheel()
+{
+	DrainInbox();
+	for (auto& level : mSlots)
+	{
+		for (tTimerNode* node : level)
+		{
+			while (node)
+			{
+				tTimerNode* const next = node->mNext;
+				ReleaseNode(node);
+				node = next;
+			}
+		}
+	}
+}
+
+//-------------------------------------------------------------------------
+bool cTimerWheel::Cancel(const tTimerHandle& handle)
+{
+	if (!handle.mNode)
+	{
+		return false;
+	}
+
+	// Nodes are never given back to the OS while the wheel lives, so the node is always there. The id tells if it is still our timer
+	uint32_t expected = MakeState(handle.mId, TS_ARMED);
+	return handle.mNode->mState.compare_exchange_strong(expected, MakeState(handle.mId, TS_CANCELLED), memory_order_relaxed, memory_order_relaxed);
+}
+
+//-------------------------------------------------------------------------
+unsigned cTimerWheel::Advance(tClock::time_point now)
+{
+	if (now < mStartTime)
+	{
+		return 0;
+	}
+	const uint64_t target_tick = static_cast<uint64_t>((now - mStartTime) / mTickDuration);
+
+	unsigned num_fired = 0;
+	while (mCurrentTick <= target_tick)
+	{
+		// Every tick, so timers armed from callbacks can still fire within this call
+		DrainInbox();
+
+		for (unsigned level = NUM_LEVELS - 1; level != 0; --level)
+		{
+			// Higher levels first, their timers may land in the slots of the lower levels cascading on this same tick
+			const uint64_t level_mask = (1ULL << (level * SLOT_BITS)) - 1;
+			if ((mCurrentTick & level_mask) == 0)
+			{
+				Cascade(level);
+			}
+		}
+
+		num_fired += ExpireCurrentTick();
+		++mCurrentTick;
+	}
+	return num_fired;
+}
+
+//-------------------------------------------------------------------------
+uint64_t cTimerWheel::GetDeadlineTick(tClock::time_point deadline) const
+{
+	if (deadline <= mStartTime)
+	{
+		return 0;
+	}
+
+	// Rounded up, a timer never fires early
+	const tClock::duration elapsed = deadline - mStartTime;
+	return static_cast<uint64_t>((elapsed + mTickDuration - tClock::duration(1)) / mTickDuration);
+}
+
+//-------------------------------------------------------------------------
+void cTimerWheel::PushToInbox(tTimerNode* node)
+{
+	// Same discipline as cMPSCLockFreeQueue: one exchange claims the back, then the previous back gets linked to us
+	tTimerNode* const prev_back = mInboxBack.exchange(node, memory_order_acq_rel);
+	prev_back->mInboxNext.store(node, memory_order_release);
+}
+
+//-------------------------------------------------------------------------
+cTimerWheel::tTimerNode* cTimerWheel::PopFromInbox()
+{
+	// Intrusive version of the queue (Vyukov): the front node is only popped once it has a successor, since producers may be linking
+	// to it. The stub gets pushed back when it is needed as that successor, so the last real node can be popped too
+	tTimerNode* front = mInboxFront;
+	tTimerNode* next = front->mInboxNext.load(memory_order_acquire);
+
+	if (front == &mInboxStub)
+	{
+		if (!next)
+		{
+			return nullptr;
+		}
+		mInboxFront = front = next;
+		next = next->mInboxNext.load(memory_order_acquire);
+	}
+
+	if (next)
+	{
+		mInboxFront = next;
+		return front;
+	}
+
+	if (front != mInboxBack.load(memory_order_acquire))
+	{
+		// A producer has claimed the back but is yet to link it, we'll get both on the next drain
+		return nullptr;
+	}
+
+	mInboxStub.mInboxNext.store(nullptr, memory_order_relaxed);
+	PushToInbox(&mInboxStub);
+
+	next = front->mInboxNext.load(memory_order_acquire);
+	if (next)
+	{
+		mInboxFront = next;
+		return front;
+	}
+	return nullptr;
+}
+
+//-------------------------------------------------------------------------
+void cTimerWheel::DrainInbox()
+{
+	while (tTimerNode* const node = PopFromInbox())
+	{
+		if ((node->mState.load(memory_order_relaxed) & ((1U << STATE_BITS) - 1)) == TS_CANCELLED)
+		{
+			ReleaseNode(node);
+		}
+		else
+		{
+			Place(node);
+		}
+	}
+}
+
+//-------------------------------------------------------------------------
+void cTimerWheel::Place(tTimerNode* node)
+{
+	// Overdue timers fire on the next tick processed. Timers out of range wait in the last level and cascade down again until due
+	static constexpr const uint64_t MAX_DELTA = (1ULL << (NUM_LEVELS * SLOT_BITS)) - 1;
+	const uint64_t delta = (std::min)((node->mDeadline > mCurrentTick) ? node->mDeadline - mCurrentTick : 0, MAX_DELTA);
+	const uint64_t deadline = mCurrentTick + delta;
+
+	unsigned level = 0;
+	while ((delta >> ((level + 1) * SLOT_BITS)) != 0)
+	{
+		++level;
+	}
+
+	tTimerNode*& slot = mSlots[level][(deadline >> (level * SLOT_BITS)) & (NUM_SLOTS - 1)];
+	node->mNext = slot;
+	slot = node;
+}
+
+//-------------------------------------------------------------------------
+void cTimerWheel::Cascade(unsigned level)
+{
+	tTimerNode*& slot = mSlots[level][(mCurrentTick >> (level * SLOT_BITS)) & (NUM_SLOTS - 1)];
+	tTimerNode* node = slot;
+	slot = nullptr;
+
+	while (node)
+	{
+		tTimerNode* const next = node->mNext;
+		if ((node->mState.load(memory_order_relaxed) & ((1U << STATE_BITS) - 1)) == TS_CANCELLED)
+		{
+			ReleaseNode(node);
+		}
+		else
+		{
+			Place(node);
+		}
+		node = next;
+	}
+}
+
+//-------------------------------------------------------------------------
+unsigned cTimerWheel::ExpireCurrentTick()
+{
+	tTimerNode*& slot = mSlots[0][mCurrentTick & (NUM_SLOTS - 1)];
+	tTimerNode* node = slot;
+	slot = nullptr;
+
+	unsigned num_fired = 0;
+	while (node)
+	{
+		tTimerNode* const next = node->mNext;
+		if (node->mDeadline > mCurrentTick)
+		{
+			// Was out of range when placed, still not due
+			Place(node);
+		}
+		else
+		{
+			// Whoever wins the CAS decides: either Cancel returns true or the callback runs
+			uint32_t state = node->mState.load(memory_order_relaxed);
+			const uint32_t id = state >> STATE_BITS;
+			if ((state == MakeState(id, TS_ARMED))
+				&& node->mState.compare_exchange_strong(state, MakeState(id, TS_FIRED), memory_order_relaxed, memory_order_relaxed))
+			{
+				node->mCallback();
+				++num_fired;
+			}
+			ReleaseNode(node);
+		}
+		node = next;
+	}
+	return num_fired;
+}
+
+//-------------------------------------------------------------------------
+void cTimerWheel::ReleaseNode(tTimerNode* node)
+{
+	node->mCallback.~tCallback();
+	mNodePool.ReleasePtr(node);
+}
+
+}
@@ -0,0 +1,57 @@
+#include "virtual_memory.h"
+
+#if defined _WIN32
+	#include <windows.h>
+#elif defined __linux__
+	#include <sys/mman.h>
+	#include <unistd.h>
+#endif
+
+namespace lockfree { namespace vm {
+
+//-------------------------------------------------------------------------
+size_t GetPageSize()
+{
+#if defined _WIN32
+	static const size_t page_size = []
+	{
+		SYSTEM_INFO system_info;
+		::GetSystemInfo(&system_info);
+		return static_cast<size_t>(system_info.dwPageSize);
+	}();
+	return page_size;
+#elif defined __linux__
+	static const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	return page_size;
+#else
+	return 4096;
+#endif
+}
+
+//-------------------------------------------------------------------------
+bool DiscardPages(void* ptr, size_t size)
+{
+	if (size == 0)
+	{
+		return true;
+	}
+
+#if defined _WIN32
+	// MEM_RESET alone only lets the OS drop the pages lazily. Unlocking pages that are not locked takes them out of the working set
+	// straight away
+	if (!::VirtualAlloc(ptr, size, MEM_RESET, PAGE_READWRITE))
+	{
+		return false;
+	}
+	::VirtualUnlock(ptr, size);
+	return true;
+#elif defined __linux__
+	// MADV_DONTNEED rather than MADV_FREE, so the resident set goes down right away instead of under memory pressure
+	return madvise(ptr, size, MADV_DONTNEED) == 0;
+#else
+	(void)ptr;
+	return false;
+#endif
+}
+
+} }
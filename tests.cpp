@@ -11,13 +11,40 @@
 #include "external\catch.hpp"
 
 #define _ENABLE_ATOMIC_ALIGNMENT_FIX
+#include <algorithm>
 #include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
 #include <future>
 #include <numeric>
+#include <random>
+#include <string>
+#include <thread>
 
 #include "lockfree_pool.h"
 #include "lockfree_stack.h"
 #include "lockfree_queue.h"
+#include "lockfree_relaxed_queue.h"
+#include "lockfree_work_stealing_deque.h"
+#include "lockfree_priority_queue.h"
+#include "lockfree_hash_map.h"
+#include "lockfree_int_hash_table.h"
+#include "lockfree_skiplist_map.h"
+#include "lockfree_slot_map.h"
+#include "lockfree_bitmap_pool.h"
+#include "lockfree_slab_allocator.h"
+#include "lockfree_owned_pool.h"
+#include "lockfree_recycling_pool.h"
+#include "lockfree_arena.h"
+#include "lockfree_payload_queue.h"
+#include "inline_task.h"
+#include "job_system.h"
+#include "timer_wheel.h"
+#include "lfmalloc.h"
 
 //-------------------------------------------------------------------------
 template <typename Fnc, typename... Args>
@@ -164,6 +191,15 @@ TEST_CASE("cLockfreeStack single thread test", "[lockfreestack]")
 
 		test_stack(test_lockfreestack);
 	}
+
+	SECTION("cLockFreeStack using a shared pool of index-linked nodes")
+	{
+		typedef lockfree::cLockFreeStack<int, lockfree::LFSS_SHARED, std::allocator<lockfree::detail::tLockFreeStackNode<int, lockfree::tTaggedIndex>>> tTestLockFreeStack;
+		tTestLockFreeStack::tLockFreePool pool(3);
+		tTestLockFreeStack test_lockfreestack(pool);
+
+		test_stack(test_lockfreestack);
+	}
 }
 
 //-------------------------------------------------------------------------
@@ -259,6 +295,15 @@ TEST_CASE("cLockfreeQueue single thread test", "[lockfreequeue]")
 
 		test_queue(test_lockfreequeue);
 	}
+
+	SECTION("cLockFreeQueue using a shared pool of index-linked nodes")
+	{
+		typedef lockfree::cLockFreeQueue<int, lockfree::LFQS_SHARED, std::allocator<lockfree::detail::tLockFreeQueueNode<int, lockfree::tTaggedIndex>>> tTestLockFreeQueue;
+		tTestLockFreeQueue::tLockFreePool pool(3 + 1);
+		tTestLockFreeQueue test_lockfreequeue(pool);
+
+		test_queue(test_lockfreequeue);
+	}
 }
 
 //-------------------------------------------------------------------------
@@ -405,3 +450,3421 @@ TEST_CASE("cMPSCLockFreeQueue concurrent test", "[mpsclockfreequeue]")
 	unsigned dummy = 0;
 	REQUIRE(!test_lockfree_queue.Pop(dummy));
 }
+
+//-------------------------------------------------------------------------
+TEST_CASE("Lockfree queues blocking pop test", "[lockfreequeue][mpsclockfreequeue]")
+{
+	static constexpr const unsigned NUM_ELEMENTS = 1000;
+
+	const auto test_queue = [](auto& test_lockfreequeue, unsigned num_consumers)
+	{
+		unsigned dummy = 0;
+		REQUIRE(!test_lockfreequeue.PopFor(dummy, std::chrono::milliseconds(10)));
+
+		// Consumers will be parked most of the time, since the producer takes its time to push the elements
+		std::atomic<unsigned> sum(0);
+		std::vector<std::future<void>> consumers;
+		for (unsigned i = 0; i != num_consumers; ++i)
+		{
+			consumers.push_back(LaunchParallelTask(
+				[&test_lockfreequeue, &sum, num_consumers]
+				{
+					for (unsigned pops = 0; pops != NUM_ELEMENTS / num_consumers; ++pops)
+					{
+						unsigned value = 0;
+						test_lockfreequeue.PopWait(value);
+						sum.fetch_add(value, std::memory_order_relaxed);
+					}
+				}));
+		}
+
+		for (unsigned i = 1; i <= NUM_ELEMENTS; ++i)
+		{
+			while (!test_lockfreequeue.Push(i))
+			{
+				std::this_thread::yield();
+			}
+
+			if ((i % 100) == 0)
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+		}
+
+		WaitForAll(consumers);
+
+		REQUIRE(sum.load() == (NUM_ELEMENTS * (NUM_ELEMENTS + 1)) / 2);
+		REQUIRE(test_lockfreequeue.Empty());
+	};
+
+	SECTION("cLockFreeQueue")
+	{
+		lockfree::cLockFreeQueue<unsigned, 64> test_lockfreequeue;
+		test_queue(test_lockfreequeue, 4);
+	}
+
+	SECTION("cMPSCLockFreeQueue")
+	{
+		lockfree::cMPSCLockFreeQueue<unsigned, 64> test_lockfreequeue;
+		test_queue(test_lockfreequeue, 1);
+	}
+}
+
+//-------------------------------------------------------------------------
+TEST_CASE("Lockfree containers blocking push test", "[lockfreepool][lockfreestack][lockfreequeue][mpsclockfreequeue]")
+{
+	SECTION("cLockFreePool")
+	{
+		typedef lockfree::cLockFreePool<int> tTestLockFreePool;
+		tTestLockFreePool test_lockfreepool(1);
+
+		int* const element = test_lockfreepool.AcquirePtrWait();
+		REQUIRE(element != nullptr);
+		REQUIRE(test_lockfreepool.AcquirePtrFor(std::chrono::milliseconds(10)) == nullptr);
+
+		auto releaser = LaunchParallelTask([&test_lockfreepool, element] 
+		{ 
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			test_lockfreepool.ReleasePtr(element); 
+		});
+		REQUIRE(test_lockfreepool.AcquirePtrWait() == element);
+		releaser.wait();
+	}
+
+	// Several producers push many more elements than what the containers can hold, throttled by a single consumer
+	static constexpr const unsigned NUM_PRODUCERS = 4;
+	static constexpr const unsigned PUSHES_PER_PRODUCER = 500;
+
+	const auto test_container = [](auto& test_container)
+	{
+		unsigned dummy = 0;
+		while (test_container.PushFor(std::chrono::milliseconds(1), 0U));
+		while (test_container.Pop(dummy));
+
+		std::vector<std::future<void>> producers;
+		for (unsigned i = 0; i != NUM_PRODUCERS; ++i)
+		{
+			producers.push_back(LaunchParallelTask(
+				[&test_container]
+				{
+					for (unsigned push = 1; push <= PUSHES_PER_PRODUCER; ++push)
+					{
+						test_container.PushWait(push);
+					}
+				}));
+		}
+
+		unsigned sum = 0;
+		for (unsigned pops = 0; pops != NUM_PRODUCERS * PUSHES_PER_PRODUCER; ++pops)
+		{
+			unsigned value = 0;
+			while (!test_container.Pop(value))
+			{
+				std::this_thread::yield();
+			}
+			sum += value;
+		}
+
+		WaitForAll(producers);
+
+		REQUIRE(sum == NUM_PRODUCERS * (PUSHES_PER_PRODUCER * (PUSHES_PER_PRODUCER + 1)) / 2);
+		REQUIRE(test_container.Empty());
+	};
+
+	SECTION("cLockFreeStack")
+	{
+		lockfree::cLockFreeStack<unsigned, 8> test_lockfreestack;
+		test_container(test_lockfreestack);
+	}
+
+	SECTION("cLockFreeQueue")
+	{
+		lockfree::cLockFreeQueue<unsigned, 8> test_lockfreequeue;
+		test_container(test_lockfreequeue);
+	}
+
+	SECTION("cMPSCLockFreeQueue")
+	{
+		lockfree::cMPSCLockFreeQueue<unsigned, 8> test_lockfreequeue;
+		test_container(test_lockfreequeue);
+	}
+}
+
+//-------------------------------------------------------------------------
+TEST_CASE("cMPSCLockFreeQueue ConsumeAll test", "[mpsclockfreequeue]")
+{
+	SECTION("Single thread")
+	{
+		typedef lockfree::cMPSCLockFreeQueue<std::unique_ptr<int>> tTestLockFreeQueue;
+		tTestLockFreeQueue::tLockFreePool pool(5 + 1);
+		tTestLockFreeQueue test_lockfreequeue(pool);
+
+		for (int i = 0; i != 5; ++i)
+		{
+			REQUIRE(test_lockfreequeue.Push(std::make_unique<int>(i)));
+		}
+		REQUIRE(pool.Empty());
+
+		std::vector<int> consumed;
+		const auto consume = [&consumed](std::unique_ptr<int>& value) { consumed.push_back(*value); };
+
+		REQUIRE(test_lockfreequeue.ConsumeAll(consume, 2) == 2);
+		REQUIRE(!pool.Empty());
+		REQUIRE(test_lockfreequeue.ConsumeAll(consume) == 3);
+		REQUIRE(test_lockfreequeue.ConsumeAll(consume) == 0);
+
+		REQUIRE(consumed == std::vector<int>({ 0, 1, 2, 3, 4 }));
+		REQUIRE(test_lockfreequeue.Empty());
+	}
+
+	SECTION("Concurrent producers")
+	{
+		static constexpr const unsigned NUM_PRODUCERS = 8;
+		static constexpr const unsigned PUSHES_PER_PRODUCER = 1000;
+		lockfree::cMPSCLockFreeQueue<unsigned, 64> test_lockfreequeue;
+
+		std::vector<std::future<void>> producers;
+		for (unsigned producer = 0; producer != NUM_PRODUCERS; ++producer)
+		{
+			producers.push_back(LaunchParallelTask(
+				[&test_lockfreequeue, producer]
+				{
+					for (unsigned push = 0; push != PUSHES_PER_PRODUCER; ++push)
+					{
+						test_lockfreequeue.PushWait(producer * PUSHES_PER_PRODUCER + push);
+					}
+				}));
+		}
+
+		// Elements pushed by each producer must be consumed in the same order they were pushed
+		std::vector<unsigned> next_expected(NUM_PRODUCERS, 0);
+		unsigned total_consumed = 0;
+		bool in_order = true;
+		while (total_consumed != NUM_PRODUCERS * PUSHES_PER_PRODUCER)
+		{
+			total_consumed += test_lockfreequeue.ConsumeAll(
+				[&next_expected, &in_order](unsigned value)
+				{
+					const unsigned producer = value / PUSHES_PER_PRODUCER;
+					in_order &= (next_expected[producer]++ == (value % PUSHES_PER_PRODUCER));
+				});
+		}
+
+		WaitForAll(producers);
+
+		REQUIRE(in_order);
+		REQUIRE(test_lockfreequeue.Empty());
+	}
+}
+
+//-------------------------------------------------------------------------
+TEST_CASE("Lockfree containers PopWith test", "[lockfreestack][lockfreequeue][mpsclockfreequeue]")
+{
+	// Payloads are only visited in place, never copied nor moved
+	struct tPayload
+	{
+		tPayload(int value) : mValue(value) {}
+		tPayload(const tPayload&) = delete;
+		tPayload& operator=(const tPayload&) = delete;
+
+		int mValue;
+		char mPadding[252];
+	};
+
+	const auto test_container = [](auto& test_container, const std::vector<int>& expected_order)
+	{
+		int dummy = 0;
+		REQUIRE(!test_container.PopWith([&dummy](tPayload& payload) { dummy = payload.mValue; }));
+
+		REQUIRE(test_container.Push(1));
+		REQUIRE(test_container.Push(2));
+		REQUIRE(test_container.Push(3));
+
+		std::vector<int> popped;
+		while (test_container.PopWith([&popped](tPayload& payload) { popped.push_back(payload.mValue); }));
+
+		REQUIRE(popped == expected_order);
+		REQUIRE(test_container.Empty());
+	};
+
+	SECTION("cLockFreeStack")
+	{
+		lockfree::cLockFreeStack<tPayload, 3> test_lockfreestack;
+		test_container(test_lockfreestack, { 3, 2, 1 });
+	}
+
+	SECTION("cLockFreeQueue")
+	{
+		lockfree::cLockFreeQueue<tPayload, 3> test_lockfreequeue;
+		test_container(test_lockfreequeue, { 1, 2, 3 });
+	}
+
+	SECTION("cMPSCLockFreeQueue")
+	{
+		lockfree::cMPSCLockFreeQueue<tPayload, 3> test_lockfreequeue;
+		test_container(test_lockfreequeue, { 1, 2, 3 });
+	}
+}
+
+//-------------------------------------------------------------------------
+TEST_CASE("cRelaxedLockFreeQueue test", "[relaxedlockfreequeue]")
+{
+	SECTION("Single thread")
+	{
+		// A single thread always pushes to the same lane, so its elements keep their FIFO ordering
+		typedef lockfree::cRelaxedLockFreeQueue<int, 4> tTestLockFreeQueue;
+		tTestLockFreeQueue::tLockFreePool pool(3 + tTestLockFreeQueue::NUM_LANES);
+		tTestLockFreeQueue test_lockfreequeue(pool);
+
+		REQUIRE(test_lockfreequeue.Empty());
+
+		REQUIRE(test_lockfreequeue.Push(42));
+		REQUIRE(test_lockfreequeue.Push(666));
+		REQUIRE(test_lockfreequeue.Push(1337));
+		REQUIRE(test_lockfreequeue.Push(1138) == false);
+
+		int result = 0;
+		REQUIRE(test_lockfreequeue.Pop(result));
+		REQUIRE(result == 42);
+		REQUIRE(test_lockfreequeue.Pop(result));
+		REQUIRE(result == 666);
+		REQUIRE(test_lockfreequeue.Pop(result));
+		REQUIRE(result == 1337);
+		REQUIRE(test_lockfreequeue.Pop(result) == false);
+
+		REQUIRE(test_lockfreequeue.Empty());
+	}
+
+	SECTION("Concurrent")
+	{
+		static constexpr const unsigned NUM_PRODUCERS = 8;
+		static constexpr const unsigned PUSHES_PER_PRODUCER = 1000;
+		lockfree::cRelaxedLockFreeQueue<unsigned, 4, 256> test_lockfreequeue;
+
+		std::vector<std::future<void>> producers;
+		for (unsigned producer = 0; producer != NUM_PRODUCERS; ++producer)
+		{
+			producers.push_back(LaunchParallelTask(
+				[&test_lockfreequeue, producer]
+				{
+					for (unsigned push = 0; push != PUSHES_PER_PRODUCER; ++push)
+					{
+						while (!test_lockfreequeue.Push(producer * PUSHES_PER_PRODUCER + push))
+						{
+							std::this_thread::yield();
+						}
+					}
+				}));
+		}
+
+		std::atomic<unsigned> total_pops(0);
+		std::vector<std::future<std::vector<unsigned>>> consumers;
+		for (unsigned consumer = 0; consumer != 4; ++consumer)
+		{
+			consumers.push_back(LaunchParallelTask(
+				[&test_lockfreequeue, &total_pops]
+				{
+					std::vector<unsigned> popped;
+					while (total_pops.load(std::memory_order_relaxed) < NUM_PRODUCERS * PUSHES_PER_PRODUCER)
+					{
+						unsigned value = 0;
+						if (test_lockfreequeue.Pop(value))
+						{
+							popped.push_back(value);
+							total_pops.fetch_add(1, std::memory_order_relaxed);
+						}
+					}
+					return popped;
+				}));
+		}
+
+		WaitForAll(producers);
+
+		std::vector<unsigned> all_popped;
+		for (auto& consumer : consumers)
+		{
+			const std::vector<unsigned> popped = consumer.get();
+			all_popped.insert(all_popped.end(), popped.begin(), popped.end());
+		}
+
+		std::sort(all_popped.begin(), all_popped.end());
+		std::vector<unsigned> all_pushed(NUM_PRODUCERS * PUSHES_PER_PRODUCER);
+		std::iota(all_pushed.begin(), all_pushed.end(), 0U);
+		REQUIRE(all_popped == all_pushed);
+		REQUIRE(test_lockfreequeue.Empty());
+	}
+}
+
+//-------------------------------------------------------------------------
+TEST_CASE("Lockfree containers node layout test", "[lockfreestack][lockfreequeue][relaxedlockfreequeue]")
+{
+	using namespace lockfree::detail;
+
+	// Local storage for up to 65535 nodes links them by index, more than that needs pointers
+	static_assert(sizeof(tLockFreeStackNode<int>) == 16, "Pointer-linked stack nodes of int should take 16 bytes");
+	static_assert(sizeof(tLockFreeStackNodeFor<int, 300>) == 8, "Index-linked stack nodes of int should take 8 bytes");
+	static_assert(sizeof(tLockFreeQueueNodeFor<int, 300>) == 8, "Index-linked queue nodes of int should take 8 bytes");
+	static_assert(std::is_same<tLockFreeStackNodeFor<int, 65535>, tLockFreeStackNode<int, lockfree::tTaggedIndex>>::value, "");
+	static_assert(std::is_same<tLockFreeStackNodeFor<int, 65536>, tLockFreeStackNode<int>>::value, "");
+	static_assert(std::is_same<tLockFreeQueueNodeFor<int, 65536>, tLockFreeQueueNode<int>>::value, "");
+
+	// The biggest stacks and queues that still link their nodes by index, filled up and emptied
+	static constexpr const size_t CAPACITY = 65535;
+	auto test_lockfreestack = std::make_unique<lockfree::cLockFreeStack<unsigned, CAPACITY>>();
+	auto test_lockfreequeue = std::make_unique<lockfree::cLockFreeQueue<unsigned, CAPACITY - 1>>();
+	auto test_relaxedqueue = std::make_unique<lockfree::cRelaxedLockFreeQueue<unsigned, 4, CAPACITY - 4>>();
+	for (unsigned i = 0; i != CAPACITY; ++i)
+	{
+		REQUIRE(test_lockfreestack->Push(i));
+	}
+	for (unsigned i = 0; i != CAPACITY - 1; ++i)
+	{
+		REQUIRE(test_lockfreequeue->Push(i));
+	}
+	for (unsigned i = 0; i != CAPACITY - 4; ++i)
+	{
+		REQUIRE(test_relaxedqueue->Push(i));
+	}
+	REQUIRE(!test_lockfreestack->Push(0U));
+	REQUIRE(!test_lockfreequeue->Push(0U));
+	REQUIRE(!test_relaxedqueue->Push(0U));
+
+	bool in_order = true;
+	unsigned result = 0;
+	for (unsigned i = CAPACITY; i != 0; --i)
+	{
+		in_order = in_order && test_lockfreestack->Pop(result) && (result == i - 1);
+	}
+	for (unsigned i = 0; i != CAPACITY - 1; ++i)
+	{
+		in_order = in_order && test_lockfreequeue->Pop(result) && (result == i);
+	}
+	REQUIRE(in_order);
+
+	unsigned num_popped = 0;
+	while (test_relaxedqueue->Pop(result))
+	{
+		++num_popped;
+	}
+	REQUIRE(num_popped == CAPACITY - 4);
+	REQUIRE(test_lockfreestack->Empty());
+	REQUIRE(test_lockfreequeue->Empty());
+}
+
+//-------------------------------------------------------------------------
+TEST_CASE("cLockFreeWorkStealingDeque single thread test", "[lockfreeworkstealingdeque]")
+{
+	const auto test_deque = [](auto& test_deque)
+	{
+		REQUIRE(test_deque.Empty());
+
+		// Push past the initial capacity so it needs to grow
+		for (int i = 0; i != 10; ++i)
+		{
+			test_deque.Push(i);
+		}
+		REQUIRE(test_deque.GetSize() == 10);
+		REQUIRE(test_deque.GetCapacity() == 16);
+
+		// Owner pops newest, thieves steal oldest
+		int result = 0;
+		REQUIRE(test_deque.Pop(result));
+		REQUIRE(result == 9);
+		REQUIRE(test_deque.Steal(result));
+		REQUIRE(result == 0);
+		REQUIRE(test_deque.Steal(result));
+		REQUIRE(result == 1);
+
+		for (int expected = 8; expected != 1; --expected)
+		{
+			REQUIRE(test_deque.Pop(result));
+			REQUIRE(result == expected);
+		}
+
+		REQUIRE(!test_deque.Pop(result));
+		REQUIRE(!test_deque.Steal(result));
+		REQUIRE(test_deque.Empty());
+	};
+
+	SECTION("Dynamic storage")
+	{
+		lockfree::cLockFreeWorkStealingDeque<int> test_lockfreedeque(4);
+		test_deque(test_lockfreedeque);
+	}
+
+	SECTION("Local storage")
+	{
+		lockfree::cLockFreeWorkStealingDeque<int, 4> test_lockfreedeque;
+		test_deque(test_lockfreedeque);
+	}
+}
+
+//-------------------------------------------------------------------------
+TEST_CASE("cLockFreeWorkStealingDeque concurrent test", "[lockfreeworkstealingdeque]")
+{
+	static constexpr const unsigned NUM_ELEMENTS = 100000;
+	static constexpr const unsigned NUM_THIEVES = 4;
+
+	lockfree::cLockFreeWorkStealingDeque<unsigned, 64> test_lockfreedeque;
+
+	// Every element must be taken exactly once, either by the owner or by one of the thieves
+	std::vector<std::atomic<unsigned>> taken(NUM_ELEMENTS);
+	for (auto& count : taken)
+	{
+		count.store(0, std::memory_order_relaxed);
+	}
+
+	std::atomic<bool> done(false);
+	std::vector<std::future<void>> thieves;
+	for (unsigned thief = 0; thief != NUM_THIEVES; ++thief)
+	{
+		thieves.push_back(LaunchParallelTask(
+			[&test_lockfreedeque, &taken, &done]
+			{
+				while (!done.load(std::memory_order_acquire) || !test_lockfreedeque.Empty())
+				{
+					unsigned value = 0;
+					if (test_lockfreedeque.Steal(value))
+					{
+						taken[value].fetch_add(1, std::memory_order_relaxed);
+					}
+				}
+			}));
+	}
+
+	// Owner pushes everything, popping some of them along the way
+	for (unsigned i = 0; i != NUM_ELEMENTS; ++i)
+	{
+		test_lockfreedeque.Push(i);
+
+		unsigned value = 0;
+		if ((i % 3 == 0) && test_lockfreedeque.Pop(value))
+		{
+			taken[value].fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	unsigned value = 0;
+	while (test_lockfreedeque.Pop(value))
+	{
+		taken[value].fetch_add(1, std::memory_order_relaxed);
+	}
+
+	done.store(true, std::memory_order_release);
+	WaitForAll(thieves);
+
+	REQUIRE(std::all_of(taken.begin(), taken.end(), [](const std::atomic<unsigned>& count) { return count.load() == 1; }));
+}
+
+//-------------------------------------------------------------------------
+TEST_CASE("cInlineTask test", "[inlinetask]")
+{
+	// Counts the live instances, to check that every callable stored gets destroyed exactly once
+	struct tTracked
+	{
+		tTracked(std::atomic<int>& live) : mLive(&live) { mLive->fetch_add(1); }
+		tTracked(const tTracked& other) : mLive(other.mLive) { mLive->fetch_add(1); }
+		~tTracked() { mLive->fetch_sub(1); }
+
+		std::atomic<int>* mLive;
+	};
+
+	std::atomic<int> live(0);
+
+	SECTION("Invocation, moves and reset")
+	{
+		lockfree::cInlineTask<int(int, int)> empty_task;
+		REQUIRE(!empty_task);
+
+		const int offset = 5;
+		lockfree::cInlineTask<int(int, int)> task([offset](int lhs, int rhs) { return lhs + rhs + offset; });
+		REQUIRE(task);
+		REQUIRE(task(1, 2) == 8);
+
+		// Move-only captures
+		std::unique_ptr<int> value(new int(42));
+		lockfree::cInlineTask<int()> move_only_task([value = std::move(value)] { return *value; });
+		lockfree::cInlineTask<int()> moved_task(std::move(move_only_task));
+		REQUIRE(!move_only_task);
+		REQUIRE(moved_task() == 42);
+
+		move_only_task = std::move(moved_task);
+		REQUIRE(!moved_task);
+		REQUIRE(move_only_task() == 42);
+
+		{
+			lockfree::cInlineTask<void()> tracked_task([tracked = tTracked(live)] {});
+			REQUIRE(live.load() == 1);
+
+			lockfree::cInlineTask<void()> other_task(std::move(tracked_task));
+			REQUIRE(live.load() == 1);
+
+			other_task = nullptr;
+			REQUIRE(live.load() == 0);
+
+			tracked_task = [tracked = tTracked(live)] {};
+			REQUIRE(live.load() == 1);
+		}
+		REQUIRE(live.load() == 0);
+	}
+
+	SECTION("Heap fallback")
+	{
+		char big_capture[256] = {};
+		big_capture[255] = 7;
+
+		REQUIRE(!lockfree::cInlineTask<int()>::FitsInline<decltype(big_capture)>());
+
+		lockfree::cInlineTask<int(), lockfree::INLINE_TASK_DEFAULT_CAPACITY, true> task([big_capture, tracked = tTracked(live)] { return big_capture[255]; });
+		lockfree::cInlineTask<int(), lockfree::INLINE_TASK_DEFAULT_CAPACITY, true> moved_task(std::move(task));
+		REQUIRE(moved_task() == 7);
+		REQUIRE(live.load() == 1);
+
+		moved_task.Reset();
+		REQUIRE(live.load() == 0);
+	}
+
+	SECTION("Command queues")
+	{
+		static constexpr const unsigned NUM_COMMANDS = 100;
+		typedef lockfree::cInlineTask<void(unsigned&)> tCommand;
+
+		lockfree::cLockFreeQueue<tCommand, NUM_COMMANDS> queue;
+		lockfree::cMPSCLockFreeQueue<tCommand, NUM_COMMANDS> mpsc_queue;
+
+		for (unsigned i = 0; i != NUM_COMMANDS; ++i)
+		{
+			REQUIRE(queue.Push([i, tracked = tTracked(live)](unsigned& sum) { sum += i; }));
+			REQUIRE(mpsc_queue.Push([i, tracked = tTracked(live)](unsigned& sum) { sum += i; }));
+		}
+		REQUIRE(live.load() == 2 * NUM_COMMANDS);
+
+		unsigned sum = 0;
+		while (queue.PopWith([&sum](tCommand& command) { command(sum); }))
+		{
+		}
+		REQUIRE(sum == NUM_COMMANDS * (NUM_COMMANDS - 1) / 2);
+		REQUIRE(live.load() == NUM_COMMANDS);
+
+		sum = 0;
+		REQUIRE(mpsc_queue.ConsumeAll([&sum](tCommand& command) { command(sum); }) == NUM_COMMANDS);
+		REQUIRE(sum == NUM_COMMANDS * (NUM_COMMANDS - 1) / 2);
+		REQUIRE(live.load() == 0);
+	}
+}
+
+//-------------------------------------------------------------------------
+TEST_CASE("cJobSystem test", "[jobsystem]")
+{
+	static constexpr const unsigned NUM_JOBS = 10000;
+	static constexpr const unsigned NUM_SUBMITTERS = 4;
+
+	// Small job pool, so some of the jobs have to run inline
+	lockfree::cJobSystem job_system(4, 256);
+
+	SECTION("Jobs submitted from outside and from other jobs run exactly once")
+	{
+		std::vector<std::atomic<unsigned>> runs(NUM_JOBS * 2);
+		for (auto& count : runs)
+		{
+			count.store(0, std::memory_order_relaxed);
+		}
+
+		std::vector<std::future<void>> submitters;
+		for (unsigned submitter = 0; submitter != NUM_SUBMITTERS; ++submitter)
+		{
+			submitters.push_back(LaunchParallelTask(
+				[&job_system, &runs, submitter]
+				{
+					lockfree::cJobCounter counter;
+					for (unsigned i = submitter; i < NUM_JOBS; i += NUM_SUBMITTERS)
+					{
+						job_system.Submit(counter, [&job_system, &runs, &counter, i]
+						{
+							runs[i].fetch_add(1, std::memory_order_relaxed);
+
+							// Nested job, submitted from a worker
+							job_system.Submit(counter, [&runs, i] { runs[NUM_JOBS + i].fetch_add(1, std::memory_order_relaxed); });
+						});
+					}
+					job_system.Wait(counter);
+				}));
+		}
+		WaitForAll(submitters);
+
+		REQUIRE(std::all_of(runs.begin(), runs.end(), [](const std::atomic<unsigned>& count) { return count.load() == 1; }));
+	}
+
+	SECTION("Jobs run inline because the pool is exhausted wake up threads waiting for them")
+	{
+		// One job keeps the only slot of the pool busy, so the job submitted against the counter runs inline in its submitter, while
+		// another thread is parked waiting on that counter
+		lockfree::cJobSystem tiny_job_system(1, 1);
+		std::atomic<bool> release_blocker(false);
+		tiny_job_system.Submit([&release_blocker]
+		{
+			while (!release_blocker.load(std::memory_order_acquire))
+			{
+				std::this_thread::yield();
+			}
+		});
+
+		lockfree::cJobCounter counter;
+		std::atomic<bool> started(false);
+		std::atomic<bool> waiting(false);
+		unsigned result = 0;
+		auto waiter = LaunchParallelTask([&tiny_job_system, &counter, &started, &waiting]
+		{
+			while (!started.load(std::memory_order_acquire))
+			{
+				std::this_thread::yield();
+			}
+			waiting.store(true, std::memory_order_release);
+			tiny_job_system.Wait(counter);
+		});
+
+		tiny_job_system.Submit(counter, [&started, &waiting, &result]
+		{
+			started.store(true, std::memory_order_release);
+			while (!waiting.load(std::memory_order_acquire))
+			{
+				std::this_thread::yield();
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(20));
+			result = 42;
+		});
+
+		const bool woken_up = (waiter.wait_for(std::chrono::seconds(10)) == std::future_status::ready);
+		release_blocker.store(true, std::memory_order_release);
+		REQUIRE(woken_up);
+		REQUIRE(result == 42);
+	}
+
+	SECTION("ParallelFor")
+	{
+		std::vector<unsigned> values(NUM_JOBS * 10, 0);
+		lockfree::ParallelFor(job_system, 0, values.size(), 64, [&values](size_t idx) { values[idx] = static_cast<unsigned>(idx) + 1; });
+
+		bool all_set = true;
+		for (size_t idx = 0; idx != values.size(); ++idx)
+		{
+			all_set = all_set && (values[idx] == idx + 1);
+		}
+		REQUIRE(all_set);
+
+		// Empty range, and grain bigger than the range
+		unsigned calls = 0;
+		lockfree::ParallelFor(job_system, 10, 10, 64, [&calls](size_t) { ++calls; });
+		REQUIRE(calls == 0);
+		lockfree::ParallelFor(job_system, 0, 10, 1000, [&calls](size_t) { ++calls; });
+		REQUIRE(calls == 10);
+	}
+
+	SECTION("ParallelReduce")
+	{
+		static constexpr const size_t NUM_VALUES = NUM_JOBS * 10;
+		const uint64_t sum = lockfree::ParallelReduce(job_system, 0, NUM_VALUES, 100, uint64_t(0),
+			[](size_t begin, size_t end)
+			{
+				uint64_t partial_sum = 0;
+				for (size_t idx = begin; idx != end; ++idx)
+				{
+					partial_sum += idx;
+				}
+				return partial_sum;
+			},
+			[](uint64_t lhs, uint64_t rhs) { return lhs + rhs; });
+		REQUIRE(sum == uint64_t(NUM_VALUES) * (NUM_VALUES - 1) / 2);
+
+		// Empty range reduces to the identity
+		REQUIRE(lockfree::ParallelReduce(job_system, 5, 5, 100, 42, [](size_t, size_t) { return 0; }, [](int lhs, int rhs) { return lhs + rhs; }) == 42);
+	}
+}
+
+//-------------------------------------------------------------------------
+TEST_CASE("cLockFreePriorityQueue single thread test", "[lockfreepriorityqueue]")
+{
+	static constexpr const unsigned CAPACITY = 1000;
+
+	lockfree::cLockFreePriorityQueue<unsigned> test_lockfreepriorityqueue(CAPACITY);
+	REQUIRE(test_lockfreepriorityqueue.Empty());
+
+	unsigned value = 0;
+	REQUIRE(!test_lockfreepriorityqueue.PopMin(value));
+
+	// Priorities in scrambled order, the value is the priority
+	for (unsigned i = 0; i != CAPACITY; ++i)
+	{
+		const unsigned priority = (i * 7919) % CAPACITY;
+		REQUIRE(test_lockfreepriorityqueue.Push(priority, priority));
+	}
+	REQUIRE(!test_lockfreepriorityqueue.Empty());
+
+	// Pools can't hold more than the capacity requested
+	unsigned extra_pushed = 0;
+	while (test_lockfreepriorityqueue.Push(0, 0U))
+	{
+		++extra_pushed;
+	}
+	REQUIRE(extra_pushed <= 1);
+
+	for (unsigned i = 0; i != extra_pushed; ++i)
+	{
+		REQUIRE(test_lockfreepriorityqueue.PopMin(value));
+		REQUIRE(value == 0);
+	}
+
+	for (unsigned i = 0; i != CAPACITY; ++i)
+	{
+		uint64_t priority = 0;
+		REQUIRE(test_lockfreepriorityqueue.PopMin(value, priority));
+		REQUIRE(value == i);
+		REQUIRE(priority == i);
+	}
+	REQUIRE(test_lockfreepriorityqueue.Empty());
+	REQUIRE(!test_lockfreepriorityqueue.PopMin(value));
+
+	// Popped nodes need to be reusable
+	for (unsigned round = 0; round != 10; ++round)
+	{
+		for (unsigned i = 0; i != CAPACITY / 2; ++i)
+		{
+			REQUIRE(test_lockfreepriorityqueue.Push(CAPACITY - i, i));
+		}
+		for (unsigned i = CAPACITY / 2; i-- != 0; )
+		{
+			REQUIRE(test_lockfreepriorityqueue.PopMin(value));
+			REQUIRE(value == i);
+		}
+	}
+
+	// Non-trivial elements left in the queue are destroyed with it
+	std::shared_ptr<int> shared_value = std::make_shared<int>(42);
+	{
+		lockfree::cLockFreePriorityQueue<std::shared_ptr<int>, float> test_sharedptrqueue(100);
+		for (unsigned i = 0; i != 50; ++i)
+		{
+			REQUIRE(test_sharedptrqueue.Push(static_cast<float>(i), shared_value));
+		}
+
+		REQUIRE(test_sharedptrqueue.PopMinWith([](const float& priority, std::shared_ptr<int>& data) { REQUIRE(priority == 0.0f); REQUIRE(*data == 42); }));
+		REQUIRE(shared_value.use_count() == 50);
+	}
+	REQUIRE(shared_value.use_count() == 1);
+}
+
+//-------------------------------------------------------------------------
+TEST_CASE("cLockFreePriorityQueue concurrent test", "[lockfreepriorityqueue]")
+{
+	static constexpr const unsigned NUM_ELEMENTS = 20000;
+	static constexpr const unsigned NUM_PRODUCERS = 4;
+	static constexpr const unsigned NUM_CONSUMERS = 4;
+
+	lockfree::cLockFreePriorityQueue<unsigned> test_lockfreepriorityqueue(NUM_ELEMENTS);
+
+	std::vector<std::atomic<unsigned>> popped(NUM_ELEMENTS);
+	for (auto& count : popped)
+	{
+		count.store(0, std::memory_order_relaxed);
+	}
+
+	// Consumers pop while producers push
+	std::atomic<unsigned> num_popped(0);
+	std::vector<std::future<void>> tasks;
+	for (unsigned consumer = 0; consumer != NUM_CONSUMERS; ++consumer)
+	{
+		tasks.push_back(LaunchParallelTask(
+			[&test_lockfreepriorityqueue, &popped, &num_popped]
+			{
+				while (num_popped.load(std::memory_order_relaxed) < NUM_ELEMENTS / 2)
+				{
+					unsigned value = 0;
+					if (test_lockfreepriorityqueue.PopMin(value))
+					{
+						popped[value].fetch_add(1, std::memory_order_relaxed);
+						num_popped.fetch_add(1, std::memory_order_relaxed);
+					}
+				}
+			}));
+	}
+
+	for (unsigned producer = 0; producer != NUM_PRODUCERS; ++producer)
+	{
+		tasks.push_back(LaunchParallelTask(
+			[&test_lockfreepriorityqueue, producer]
+			{
+				for (unsigned i = producer; i < NUM_ELEMENTS; i += NUM_PRODUCERS)
+				{
+					while (!test_lockfreepriorityqueue.Push((i * 7919) % 1000, i))
+					{
+						std::this_thread::yield();
+					}
+				}
+			}));
+	}
+	WaitForAll(tasks);
+
+	// What is left comes out in order
+	uint64_t last_priority = 0;
+	bool in_order = true;
+	unsigned value = 0;
+	uint64_t priority = 0;
+	while (test_lockfreepriorityqueue.PopMin(value, priority))
+	{
+		in_order = in_order && (priority >= last_priority);
+		last_priority = priority;
+		popped[value].fetch_add(1, std::memory_order_relaxed);
+	}
+
+	REQUIRE(in_order);
+	REQUIRE(std::all_of(popped.begin(), popped.end(), [](const std::atomic<unsigned>& count) { return count.load() == 1; }));
+}
+
+//-------------------------------------------------------------------------
+TEST_CASE("cTimerWheel single thread test", "[timerwheel]")
+{
+	typedef lockfree::cTimerWheel::tClock tClock;
+	static constexpr const unsigned MAX_TIMERS = 64;
+
+	// Explicit time points and 1 second ticks, so nothing depends on how long the test takes to run
+	lockfree::cTimerWheel test_timerwheel(MAX_TIMERS, std::chrono::seconds(1));
+	REQUIRE(test_timerwheel.GetTickDuration() == std::chrono::seconds(1));
+	const tClock::time_point start = tClock::now();
+
+	// Deadlines spread across all levels of the wheel, armed in scrambled order
+	const unsigned deadlines[] = { 300, 1, 70000, 255, 0, 256, 65536, 2, 1000, 65535, 257, 17000000 };
+	unsigned current_second = 0;
+	std::vector<unsigned> fired;
+	for (unsigned deadline : deadlines)
+	{
+		REQUIRE(test_timerwheel.ArmAt(start + std::chrono::seconds(deadline), [deadline, &fired, &current_second]
+		{
+			// Deadlines are rounded up to the next tick, so the timer can fire up to one tick late, never early
+			REQUIRE(current_second >= deadline);
+			REQUIRE(current_second <= deadline + 1);
+			fired.push_back(deadline);
+		}));
+	}
+
+	unsigned num_fired = 0;
+	for (current_second = 0; current_second <= 70001; ++current_second)
+	{
+		num_fired += test_timerwheel.Advance(start + std::chrono::seconds(current_second));
+	}
+	REQUIRE(num_fired == fired.size());
+	REQUIRE(fired.size() == std::extent<decltype(deadlines)>::value - 1);
+	REQUIRE(std::is_sorted(fired.begin(), fired.end()));
+
+	// Time can jump forward: every tick in between gets processed
+	current_second = 17000001;
+	REQUIRE(test_timerwheel.Advance(start + std::chrono::seconds(current_second)) == 1);
+	REQUIRE(fired.back() == 17000000);
+
+	// Cancelling
+	lockfree::cTimerWheel::tTimerHandle handle;
+	REQUIRE(!handle.IsValid());
+	REQUIRE(!test_timerwheel.Cancel(handle));
+
+	bool cancelled_fired = false;
+	REQUIRE(test_timerwheel.ArmAt(start + std::chrono::seconds(current_second + 10), [&cancelled_fired] { cancelled_fired = true; }, handle));
+	REQUIRE(handle.IsValid());
+	REQUIRE(test_timerwheel.Cancel(handle));
+	REQUIRE(!test_timerwheel.Cancel(handle));
+
+	// Handles of expired timers can't cancel the timers reusing their nodes
+	lockfree::cTimerWheel::tTimerHandle expired_handle;
+	REQUIRE(test_timerwheel.ArmAt(start + std::chrono::seconds(current_second - 1), [] {}, expired_handle));
+	current_second += 20;
+	REQUIRE(test_timerwheel.Advance(start + std::chrono::seconds(current_second)) == 1);
+	REQUIRE(!cancelled_fired);
+	REQUIRE(!test_timerwheel.Cancel(expired_handle));
+
+	// Cancelled timers give their node back to the pool once the ticker gets to them
+	std::vector<lockfree::cTimerWheel::tTimerHandle> handles(MAX_TIMERS);
+	unsigned num_armed = 0;
+	while (test_timerwheel.ArmAt(start + std::chrono::seconds(current_second + 1000), [] {}, handles[num_armed]))
+	{
+		++num_armed;
+	}
+	REQUIRE(num_armed == MAX_TIMERS);
+	REQUIRE(!test_timerwheel.Arm(std::chrono::seconds(1), [] {}));
+	REQUIRE(!test_timerwheel.Cancel(expired_handle));
+
+	for (const auto& armed_handle : handles)
+	{
+		REQUIRE(test_timerwheel.Cancel(armed_handle));
+	}
+	current_second += 2000;
+	REQUIRE(test_timerwheel.Advance(start + std::chrono::seconds(current_second)) == 0);
+	REQUIRE(test_timerwheel.Arm(std::chrono::seconds(1), [] {}));
+
+	// Timers armed from callbacks, still within the same Advance if they are due. These are overdue (real time is behind the wheel)
+	unsigned num_rearms = 0;
+	std::function<void()> rearm = [&test_timerwheel, &num_rearms, &rearm]
+	{
+		if (++num_rearms < 10)
+		{
+			REQUIRE(test_timerwheel.Arm(std::chrono::seconds(1), [&rearm] { rearm(); }));
+		}
+	};
+	REQUIRE(test_timerwheel.Arm(std::chrono::seconds(1), [&rearm] { rearm(); }));
+	current_second += 3000;
+	REQUIRE(test_timerwheel.Advance(start + std::chrono::seconds(current_second)) == 11);
+	REQUIRE(num_rearms == 10);
+
+	// Timers still armed on destruction are discarded without firing
+	std::shared_ptr<int> shared_value = std::make_shared<int>(42);
+	{
+		lockfree::cTimerWheel discarded_timerwheel(8);
+		REQUIRE(discarded_timerwheel.Arm(std::chrono::seconds(1), [shared_value] { REQUIRE(false); }));
+		REQUIRE(shared_value.use_count() == 2);
+	}
+	REQUIRE(shared_value.use_count() == 1);
+}
+
+//-------------------------------------------------------------------------
+TEST_CASE("cTimerWheel concurrent test", "[timerwheel]")
+{
+	typedef lockfree::cTimerWheel::tClock tClock;
+	static constexpr const unsigned NUM_TIMERS = 20000;
+	static constexpr const unsigned NUM_PRODUCERS = 4;
+
+	lockfree::cTimerWheel test_timerwheel(NUM_TIMERS, std::chrono::milliseconds(1));
+
+	// Producers arm timers with random delays and cancel some of them, while one ticker expires them
+	std::atomic<unsigned> num_fired(0);
+	std::atomic<unsigned> num_cancelled(0);
+	std::atomic<unsigned> num_early(0);
+	std::atomic<unsigned> num_failed(0);
+	std::atomic<unsigned> num_producers_done(0);
+
+	std::vector<std::future<void>> tasks;
+	for (unsigned producer = 0; producer != NUM_PRODUCERS; ++producer)
+	{
+		tasks.push_back(LaunchParallelTask(
+			[&, producer]
+			{
+				std::minstd_rand random(producer + 1);
+				for (unsigned i = producer; i < NUM_TIMERS; i += NUM_PRODUCERS)
+				{
+					const tClock::time_point deadline = tClock::now() + std::chrono::microseconds(random() % 50000);
+
+					lockfree::cTimerWheel::tTimerHandle handle;
+					const bool armed = test_timerwheel.ArmAt(deadline, [deadline, &num_fired, &num_early]
+					{
+						if (tClock::now() < deadline)
+						{
+							num_early.fetch_add(1, std::memory_order_relaxed);
+						}
+						num_fired.fetch_add(1, std::memory_order_relaxed);
+					}, handle);
+
+					if (!armed)
+					{
+						num_failed.fetch_add(1, std::memory_order_relaxed);
+						continue;
+					}
+
+					if (((i % 3) == 0) && test_timerwheel.Cancel(handle))
+					{
+						num_cancelled.fetch_add(1, std::memory_order_relaxed);
+					}
+				}
+				num_producers_done.fetch_add(1, std::memory_order_release);
+			}));
+	}
+
+	tasks.push_back(LaunchParallelTask(
+		[&]
+		{
+			while ((num_producers_done.load(std::memory_order_acquire) != NUM_PRODUCERS)
+				|| ((num_fired.load(std::memory_order_relaxed) + num_cancelled.load(std::memory_order_relaxed) + num_failed.load(std::memory_order_relaxed)) != NUM_TIMERS))
+			{
+				test_timerwheel.Advance();
+				std::this_thread::yield();
+			}
+		}));
+	WaitForAll(tasks);
+
+	REQUIRE(num_failed.load() == 0);
+	REQUIRE(num_fired.load() + num_cancelled.load() == NUM_TIMERS);
+	REQUIRE(num_cancelled.load() > 0);
+	REQUIRE(num_early.load() == 0);
+}
+
+//-------------------------------------------------------------------------
+TEST_CASE("cLockFreeHashMap single thread test", "[lockfreehashmap]")
+{
+	static constexpr const unsigned CAPACITY = 1000;
+
+	lockfree::cLockFreeHashMap<unsigned, unsigned> test_lockfreehashmap(CAPACITY);
+	REQUIRE(test_lockfreehashmap.Size() == 0);
+
+	unsigned value = 0;
+	REQUIRE(!test_lockfreehashmap.Find(0, value));
+	REQUIRE(!test_lockfreehashmap.Erase(0));
+
+	// The table grows from 2 buckets while filling up
+	for (unsigned i = 0; i != CAPACITY; ++i)
+	{
+		REQUIRE(test_lockfreehashmap.Insert(i * 7919, i));
+	}
+	REQUIRE(test_lockfreehashmap.Size() == CAPACITY);
+	REQUIRE(!test_lockfreehashmap.Insert(CAPACITY * 7919, 0U));
+
+	for (unsigned i = 0; i != CAPACITY; ++i)
+	{
+		REQUIRE(test_lockfreehashmap.Find(i * 7919, value));
+		REQUIRE(value == i);
+	}
+	REQUIRE(!test_lockfreehashmap.Contains(1));
+
+	// Keys already in the map are not inserted again
+	REQUIRE(test_lockfreehashmap.Erase(0));
+	REQUIRE(!test_lockfreehashmap.Erase(0));
+	REQUIRE(!test_lockfreehashmap.Contains(0));
+	REQUIRE(test_lockfreehashmap.Insert(0, 42U));
+	REQUIRE(!test_lockfreehashmap.Insert(0, 43U));
+	REQUIRE(test_lockfreehashmap.FindWith(0, [](const unsigned& found) { REQUIRE(found == 42); }));
+
+	// Erased nodes need to be reusable
+	for (unsigned round = 0; round != 10; ++round)
+	{
+		for (unsigned i = 0; i != CAPACITY; i += 2)
+		{
+			REQUIRE(test_lockfreehashmap.Erase(i * 7919));
+		}
+		REQUIRE(test_lockfreehashmap.Size() == CAPACITY / 2);
+		for (unsigned i = 0; i != CAPACITY; i += 2)
+		{
+			REQUIRE(test_lockfreehashmap.Insert(i * 7919, i + round));
+		}
+	}
+	for (unsigned i = 0; i != CAPACITY; ++i)
+	{
+		REQUIRE(test_lockfreehashmap.Find(i * 7919, value));
+		REQUIRE(value == ((i % 2) ? i : i + 9));
+	}
+
+	// Colliding hashes end up in the same spot of the list, they still need to be told apart by key
+	struct tCollidingHash { size_t operator()(const std::string&) const { return 7; } };
+	std::shared_ptr<int> shared_value = std::make_shared<int>(42);
+	{
+		lockfree::cLockFreeHashMap<std::string, std::shared_ptr<int>, tCollidingHash> test_collidinghashmap(100);
+		for (unsigned i = 0; i != 50; ++i)
+		{
+			REQUIRE(test_collidinghashmap.Insert(std::to_string(i), shared_value));
+		}
+		REQUIRE(!test_collidinghashmap.Insert("7", shared_value));
+		REQUIRE(test_collidinghashmap.Erase("7"));
+		REQUIRE(test_collidinghashmap.Contains("8"));
+		REQUIRE(!test_collidinghashmap.Contains("7"));
+		REQUIRE(test_collidinghashmap.Size() == 49);
+	}
+
+	// Elements left in the map, erased or not, are destroyed with it
+	REQUIRE(shared_value.use_count() == 1);
+}
+
+//-------------------------------------------------------------------------
+TEST_CASE("cLockFreeHashMap concurrent test", "[lockfreehashmap]")
+{
+	static constexpr const unsigned NUM_KEYS = 20000;
+	static constexpr const unsigned NUM_THREADS = 4;
+
+	// Room for the erased nodes still waiting to be reclaimed by the threads that retired them
+	lockfree::cLockFreeHashMap<unsigned, unsigned> test_lockfreehashmap(2 * NUM_KEYS);
+
+	// Every thread inserts its share of the keys, then all of them look up, erase and reinsert keys from everybody
+	std::atomic<unsigned> num_wrong_values(0);
+	std::atomic<unsigned> num_erased(0);
+	std::atomic<unsigned> num_threads_inserted(0);
+	std::vector<std::future<void>> tasks;
+	for (unsigned thread = 0; thread != NUM_THREADS; ++thread)
+	{
+		tasks.push_back(LaunchParallelTask(
+			[&test_lockfreehashmap, &num_wrong_values, &num_erased, &num_threads_inserted, thread]
+			{
+				for (unsigned i = thread; i < NUM_KEYS; i += NUM_THREADS)
+				{
+					while (!test_lockfreehashmap.Insert(i, i * 3))
+					{
+						std::this_thread::yield();
+					}
+				}
+				num_threads_inserted.fetch_add(1, std::memory_order_release);
+				while (num_threads_inserted.load(std::memory_order_acquire) != NUM_THREADS)
+				{
+					std::this_thread::yield();
+				}
+
+				for (unsigned i = 0; i != NUM_KEYS; ++i)
+				{
+					const unsigned key = (i * 7919 + thread * 5003) % NUM_KEYS;
+					unsigned value = 0;
+					if (test_lockfreehashmap.Find(key, value) && (value != key * 3))
+					{
+						num_wrong_values.fetch_add(1, std::memory_order_relaxed);
+					}
+
+					// Only the thread that erases a key puts it back
+					if (((key % NUM_THREADS) != thread) && test_lockfreehashmap.Erase(key))
+					{
+						num_erased.fetch_add(1, std::memory_order_relaxed);
+						while (!test_lockfreehashmap.Insert(key, key * 3))
+						{
+							std::this_thread::yield();
+						}
+					}
+				}
+			}));
+	}
+	WaitForAll(tasks);
+
+	REQUIRE(num_wrong_values.load() == 0);
+	REQUIRE(num_erased.load() > 0);
+	REQUIRE(test_lockfreehashmap.Size() == NUM_KEYS);
+	for (unsigned key = 0; key != NUM_KEYS; ++key)
+	{
+		unsigned value = 0;
+		REQUIRE(test_lockfreehashmap.Find(key, value));
+		REQUIRE(value == key * 3);
+	}
+}
+
+//-------------------------------------------------------------------------
+TEST_CASE("cLockFreeIntHashTable single thread test", "[lockfreeinthashtable]")
+{
+	static constexpr const unsigned CAPACITY = 1000;
+	typedef lockfree::cLockFreeIntHashTable<CAPACITY> tIntHashTable;
+
+	std::unique_ptr<tIntHashTable> test_inthashtable(new tIntHashTable());
+	REQUIRE(tIntHashTable::GetCapacity() == CAPACITY);
+
+	tIntHashTable::tValue value = 0;
+	REQUIRE(!test_inthashtable->Find(0, value));
+	REQUIRE(!test_inthashtable->Update(0, 1));
+
+	std::mt19937_64 random(42);
+	std::vector<tIntHashTable::tKey> keys(CAPACITY);
+	for (unsigned i = 0; i != CAPACITY; ++i)
+	{
+		keys[i] = random() >> 1;
+		REQUIRE(test_inthashtable->Insert(keys[i], i));
+	}
+
+	// Keys already in the table are not inserted again
+	REQUIRE(!test_inthashtable->Insert(keys[0], 0));
+	REQUIRE(!test_inthashtable->Insert(keys[CAPACITY - 1], 0));
+
+	for (unsigned i = 0; i != CAPACITY; ++i)
+	{
+		REQUIRE(test_inthashtable->Find(keys[i], value));
+		REQUIRE(value == i);
+	}
+
+	// Keys that were never inserted (top bit set, unlike the ones above)
+	for (unsigned i = 0; i != CAPACITY; ++i)
+	{
+		REQUIRE(!test_inthashtable->Contains(random() | (1ULL << 63)));
+	}
+
+	REQUIRE(test_inthashtable->Update(keys[10], 12345));
+	REQUIRE(test_inthashtable->Find(keys[10], value));
+	REQUIRE(value == 12345);
+
+	// Sequential keys, and keys that fall in the same group, probe the next groups once theirs is full
+	std::unique_ptr<lockfree::cLockFreeIntHashTable<64>> small_inthashtable(new lockfree::cLockFreeIntHashTable<64>());
+	unsigned num_inserted = 0;
+	while (small_inthashtable->Insert(num_inserted, num_inserted * 2))
+	{
+		++num_inserted;
+	}
+	REQUIRE(num_inserted >= 64);
+	REQUIRE(!small_inthashtable->Insert(num_inserted + 1, 0));
+	for (unsigned i = 0; i != num_inserted; ++i)
+	{
+		REQUIRE(small_inthashtable->Find(i, value));
+		REQUIRE(value == i * 2);
+	}
+	REQUIRE(!small_inthashtable->Contains(num_inserted));
+}
+
+//-------------------------------------------------------------------------
+TEST_CASE("cLockFreeIntHashTable concurrent test", "[lockfreeinthashtable]")
+{
+	static constexpr const unsigned NUM_KEYS = 20000;
+	static constexpr const unsigned NUM_THREADS = 4;
+	typedef lockfree::cLockFreeIntHashTable<NUM_KEYS> tIntHashTable;
+
+	std::unique_ptr<tIntHashTable> test_inthashtable(new tIntHashTable());
+
+	// All threads try to insert all the keys, in different orders, while looking up the ones inserted by the others
+	std::atomic<unsigned> num_inserted(0);
+	std::atomic<unsigned> num_wrong_values(0);
+	std::vector<std::future<void>> tasks;
+	for (unsigned thread = 0; thread != NUM_THREADS; ++thread)
+	{
+		tasks.push_back(LaunchParallelTask(
+			[&test_inthashtable, &num_inserted, &num_wrong_values, thread]
+			{
+				unsigned thread_inserted = 0;
+				for (unsigned i = 0; i != NUM_KEYS; ++i)
+				{
+					const uint64_t key = ((i * 7919ULL + thread * 5003ULL) % NUM_KEYS) * 0x9E3779B97F4A7C15ULL;
+					if (test_inthashtable->Insert(key, static_cast<uint32_t>(key >> 32)))
+					{
+						++thread_inserted;
+					}
+
+					// Might not be found yet if some other thread is still inserting it
+					tIntHashTable::tValue value = 0;
+					if (test_inthashtable->Find(key, value) && (value != static_cast<uint32_t>(key >> 32)))
+					{
+						num_wrong_values.fetch_add(1, std::memory_order_relaxed);
+					}
+				}
+				num_inserted.fetch_add(thread_inserted, std::memory_order_relaxed);
+			}));
+	}
+	WaitForAll(tasks);
+
+	REQUIRE(num_inserted.load() == NUM_KEYS);
+	REQUIRE(num_wrong_values.load() == 0);
+	for (unsigned i = 0; i != NUM_KEYS; ++i)
+	{
+		REQUIRE(test_inthashtable->Contains(i * 0x9E3779B97F4A7C15ULL));
+	}
+}
+
+//-------------------------------------------------------------------------
+TEST_CASE("cLockFreeSkipListMap single thread test", "[lockfreeskiplistmap]")
+{
+	static constexpr const unsigned CAPACITY = 1000;
+	typedef lockfree::cLockFreeSkipListMap<unsigned, std::string> tSkipListMap;
+
+	tSkipListMap test_skiplistmap(CAPACITY);
+	REQUIRE(test_skiplistmap.Empty());
+
+	std::string value;
+	REQUIRE(!test_skiplistmap.Find(0, value));
+	REQUIRE(!test_skiplistmap.Erase(0));
+
+	// Inserted out of order, visited in order
+	for (unsigned i = 0; i != CAPACITY; ++i)
+	{
+		const unsigned key = (i * 7919) % CAPACITY;
+		REQUIRE(test_skiplistmap.Insert(key, std::to_string(key)));
+	}
+	REQUIRE(!test_skiplistmap.Empty());
+	REQUIRE(!test_skiplistmap.Insert(0, "duplicate"));
+
+	for (unsigned i = 0; i != CAPACITY; ++i)
+	{
+		REQUIRE(test_skiplistmap.Find(i, value));
+		REQUIRE(value == std::to_string(i));
+	}
+	REQUIRE(!test_skiplistmap.Contains(CAPACITY));
+
+	unsigned expected_key = 0;
+	REQUIRE(test_skiplistmap.ForEach([&expected_key](const unsigned& key, const std::string& element)
+	{
+		REQUIRE(key == expected_key);
+		REQUIRE(element == std::to_string(key));
+		++expected_key;
+	}) == CAPACITY);
+
+	// Erase the even keys
+	for (unsigned i = 0; i < CAPACITY; i += 2)
+	{
+		REQUIRE(test_skiplistmap.Erase(i));
+		REQUIRE(!test_skiplistmap.Erase(i));
+		REQUIRE(!test_skiplistmap.Contains(i));
+	}
+
+	std::vector<unsigned> range_keys;
+	REQUIRE(test_skiplistmap.ForEachInRange(100, 110, [&range_keys](const unsigned& key, const std::string&)
+	{
+		range_keys.push_back(key);
+	}) == 5);
+	REQUIRE(range_keys == std::vector<unsigned>({ 101, 103, 105, 107, 109 }));
+	REQUIRE(test_skiplistmap.ForEachInRange(100, 101, [](const unsigned&, const std::string&) {}) == 0);
+	REQUIRE(test_skiplistmap.ForEachInRange(CAPACITY, CAPACITY * 2, [](const unsigned&, const std::string&) {}) == 0);
+
+	// Erased nodes go back to the pools, so erased keys can be inserted again
+	for (unsigned i = 0; i < CAPACITY; i += 2)
+	{
+		REQUIRE(test_skiplistmap.Insert(i, "again"));
+	}
+	REQUIRE(test_skiplistmap.Find(500, value));
+	REQUIRE(value == "again");
+	REQUIRE(test_skiplistmap.ForEach([](const unsigned&, const std::string&) {}) == CAPACITY);
+
+	for (unsigned i = 0; i != CAPACITY; ++i)
+	{
+		REQUIRE(test_skiplistmap.Erase(i));
+	}
+	REQUIRE(test_skiplistmap.Empty());
+}
+
+//-------------------------------------------------------------------------
+TEST_CASE("cLockFreeSkipListMap concurrent test", "[lockfreeskiplistmap]")
+{
+	static constexpr const unsigned NUM_KEYS = 10000;
+	static constexpr const unsigned NUM_WRITERS = 3;
+	static constexpr const unsigned NUM_ROUNDS = 5;
+	typedef lockfree::cLockFreeSkipListMap<unsigned, unsigned> tSkipListMap;
+
+	// Erased nodes can wait in the retired lists of other threads for a while, keep some spare capacity for them
+	tSkipListMap test_skiplistmap(NUM_KEYS * 2);
+
+	// Odd keys stay in the map the whole time, writers keep inserting and erasing the even ones while a reader scans ranges
+	for (unsigned key = 1; key < NUM_KEYS; key += 2)
+	{
+		REQUIRE(test_skiplistmap.Insert(key, key * 2));
+	}
+
+	std::atomic<unsigned> num_inserted(0);
+	std::atomic<unsigned> num_erased(0);
+	std::atomic<unsigned> num_writers_done(0);
+	std::vector<std::future<void>> tasks;
+	for (unsigned writer = 0; writer != NUM_WRITERS; ++writer)
+	{
+		tasks.push_back(LaunchParallelTask(
+			[&test_skiplistmap, &num_inserted, &num_erased, &num_writers_done, writer]
+			{
+				for (unsigned round = 0; round != NUM_ROUNDS; ++round)
+				{
+					for (unsigned i = 0; i != NUM_KEYS / 2; ++i)
+					{
+						const unsigned key = ((i * 7919 + writer * 1237) % (NUM_KEYS / 2)) * 2;
+						if (test_skiplistmap.Insert(key, key * 2))
+						{
+							num_inserted.fetch_add(1, std::memory_order_relaxed);
+						}
+						if (test_skiplistmap.Erase(((i * 5003 + writer * 311) % (NUM_KEYS / 2)) * 2))
+						{
+							num_erased.fetch_add(1, std::memory_order_relaxed);
+						}
+					}
+				}
+				num_writers_done.fetch_add(1, std::memory_order_release);
+			}));
+	}
+
+	std::atomic<unsigned> num_bad_scans(0);
+	tasks.push_back(LaunchParallelTask(
+		[&test_skiplistmap, &num_writers_done, &num_bad_scans]
+		{
+			unsigned first = 1;
+			while (num_writers_done.load(std::memory_order_acquire) != NUM_WRITERS)
+			{
+				// Every odd key in the range must show up, in order, with its value
+				const unsigned last = first + 200;
+				unsigned prev_key = first - 1;
+				unsigned num_odd = 0;
+				bool ok = true;
+				test_skiplistmap.ForEachInRange(first, last, [&](const unsigned& key, const unsigned& value)
+				{
+					ok = ok && (key > prev_key) && (key < last) && (value == key * 2);
+					prev_key = key;
+					num_odd += key & 1;
+				});
+				if (!ok || (num_odd != (std::min(last, NUM_KEYS) - first + 1) / 2))
+				{
+					num_bad_scans.fetch_add(1, std::memory_order_relaxed);
+				}
+				first = (first + 402) % NUM_KEYS | 1;
+			}
+		}));
+	WaitForAll(tasks);
+
+	REQUIRE(num_bad_scans.load() == 0);
+
+	// Every key inserted was either erased or is still there
+	unsigned num_even = 0;
+	test_skiplistmap.ForEach([&num_even](const unsigned& key, const unsigned&) { num_even += (key & 1) == 0; });
+	REQUIRE(num_inserted.load() - num_erased.load() == num_even);
+	for (unsigned key = 1; key < NUM_KEYS; key += 2)
+	{
+		REQUIRE(test_skiplistmap.Contains(key));
+	}
+}
+
+//-------------------------------------------------------------------------
+TEST_CASE("cLockFreeSlotMap single thread test", "[lockfreeslotmap]")
+{
+	static constexpr const unsigned CAPACITY = 100;
+	typedef lockfree::cLockFreeSlotMap<std::string> tSlotMap;
+
+	tSlotMap test_slotmap(CAPACITY);
+	REQUIRE(test_slotmap.GetCapacity() == CAPACITY);
+	REQUIRE(sizeof(tSlotMap::tHandle) == sizeof(uint32_t));
+
+	REQUIRE(!tSlotMap::tHandle().IsValid());
+	REQUIRE(!test_slotmap.Resolve(tSlotMap::tHandle()));
+	REQUIRE(!test_slotmap.Release(tSlotMap::tHandle()));
+
+	std::vector<tSlotMap::tHandle> handles;
+	for (unsigned i = 0; i != CAPACITY; ++i)
+	{
+		handles.push_back(test_slotmap.Acquire(std::to_string(i)));
+		REQUIRE(handles.back().IsValid());
+	}
+	REQUIRE(!test_slotmap.Acquire("full").IsValid());
+
+	for (unsigned i = 0; i != CAPACITY; ++i)
+	{
+		std::string* const element = test_slotmap.Resolve(handles[i]);
+		REQUIRE(element);
+		REQUIRE(*element == std::to_string(i));
+		REQUIRE(test_slotmap.GetHandle(element) == handles[i]);
+	}
+
+	// Released handles go stale, and stay stale once their slot is reused
+	const tSlotMap::tHandle stale = handles[10];
+	REQUIRE(test_slotmap.Release(stale));
+	REQUIRE(!test_slotmap.Release(stale));
+	REQUIRE(!test_slotmap.IsLive(stale));
+	REQUIRE(!test_slotmap.Resolve(stale));
+
+	const tSlotMap::tHandle reused = test_slotmap.Acquire("reused");
+	REQUIRE(reused.GetIndex() == stale.GetIndex());
+	REQUIRE(reused != stale);
+	REQUIRE(!test_slotmap.Resolve(stale));
+	REQUIRE(*test_slotmap.Resolve(reused) == "reused");
+	handles[10] = reused;
+
+	// Odd elements released, even ones visited in storage order
+	for (unsigned i = 1; i < CAPACITY; i += 2)
+	{
+		REQUIRE(test_slotmap.Release(handles[i]));
+	}
+
+	unsigned prev_index = 0;
+	bool ordered = true;
+	REQUIRE(test_slotmap.ForEach([&](tSlotMap::tHandle handle, std::string& element)
+	{
+		ordered = ordered && ((prev_index == 0) || (handle.GetIndex() > prev_index)) && (test_slotmap.Resolve(handle) == &element);
+		prev_index = handle.GetIndex();
+	}) == CAPACITY / 2);
+	REQUIRE(ordered);
+}
+
+//-------------------------------------------------------------------------
+TEST_CASE("cLockFreeSlotMap concurrent test", "[lockfreeslotmap]")
+{
+	static constexpr const unsigned CAPACITY = 1000;
+	static constexpr const unsigned NUM_THREADS = 4;
+	static constexpr const unsigned NUM_ITERATIONS = 20000;
+	typedef lockfree::cLockFreeSlotMap<uint64_t> tSlotMap;
+
+	tSlotMap test_slotmap(CAPACITY);
+
+	// Every thread acquires elements holding its own values and releases them later. Some handles are shared with the other threads,
+	// which try to release them too: only one release of each can succeed
+	std::vector<std::atomic<uint32_t>> shared_handles(NUM_THREADS);
+	for (std::atomic<uint32_t>& shared_handle : shared_handles)
+	{
+		shared_handle.store(tSlotMap::tHandle().mValue);
+	}
+
+	std::atomic<unsigned> num_acquired(0);
+	std::atomic<unsigned> num_released(0);
+	std::atomic<unsigned> num_wrong_values(0);
+	std::vector<std::future<void>> tasks;
+	for (unsigned thread = 0; thread != NUM_THREADS; ++thread)
+	{
+		tasks.push_back(LaunchParallelTask(
+			[&test_slotmap, &shared_handles, &num_acquired, &num_released, &num_wrong_values, thread]
+			{
+				std::vector<tSlotMap::tHandle> own_handles;
+				for (unsigned i = 0; i != NUM_ITERATIONS; ++i)
+				{
+					const uint64_t value = (uint64_t(thread) << 32) | i;
+					const tSlotMap::tHandle handle = test_slotmap.Acquire(value);
+					if (!handle.IsValid())
+					{
+						continue;
+					}
+					num_acquired.fetch_add(1, std::memory_order_relaxed);
+
+					if ((i % 8) == 0)
+					{
+						// Shared, released by whoever gets to it first
+						tSlotMap::tHandle previous;
+						previous.mValue = shared_handles[(thread + i) % NUM_THREADS].exchange(handle.mValue);
+						tSlotMap::tHandle stolen;
+						stolen.mValue = shared_handles[(thread + i + 1) % NUM_THREADS].load();
+						for (const tSlotMap::tHandle& to_release : { previous, stolen })
+						{
+							if (test_slotmap.Release(to_release))
+							{
+								num_released.fetch_add(1, std::memory_order_relaxed);
+							}
+						}
+						continue;
+					}
+
+					const uint64_t* const element = test_slotmap.Resolve(handle);
+					if (!element || (*element != value))
+					{
+						num_wrong_values.fetch_add(1, std::memory_order_relaxed);
+					}
+
+					own_handles.push_back(handle);
+					if (own_handles.size() == 50)
+					{
+						for (const tSlotMap::tHandle& own_handle : own_handles)
+						{
+							if (test_slotmap.Release(own_handle))
+							{
+								num_released.fetch_add(1, std::memory_order_relaxed);
+							}
+						}
+						own_handles.clear();
+					}
+				}
+
+				for (const tSlotMap::tHandle& own_handle : own_handles)
+				{
+					if (test_slotmap.Release(own_handle))
+					{
+						num_released.fetch_add(1, std::memory_order_relaxed);
+					}
+				}
+			}));
+	}
+	WaitForAll(tasks);
+
+	REQUIRE(num_wrong_values.load() == 0);
+
+	// Whatever is left live are the shared handles nobody released
+	const unsigned num_live = test_slotmap.ForEach([](tSlotMap::tHandle, uint64_t&) {});
+	REQUIRE(num_acquired.load() - num_released.load() == num_live);
+	REQUIRE(num_live <= NUM_THREADS);
+}
+
+//-------------------------------------------------------------------------
+TEST_CASE("cLockfreePool occupancy test", "[lockfreepool][jobsystem]")
+{
+	static constexpr const unsigned CAPACITY = 1000;
+	typedef lockfree::cLockFreePool<uint64_t, std::allocator<uint64_t>, lockfree::LFPF_TRACK_OCCUPANCY> tTestLockFreePool;
+	tTestLockFreePool test_lockfreepool(CAPACITY);
+
+	REQUIRE(test_lockfreepool.ForEachLive([](uint64_t&) {}) == 0);
+
+	std::vector<uint64_t*> elements;
+	for (unsigned i = 0; i != CAPACITY; ++i)
+	{
+		elements.push_back(test_lockfreepool.Acquire(i));
+	}
+	REQUIRE(test_lockfreepool.ForEachLive([](uint64_t&) {}) == CAPACITY);
+
+	// Release the odd ones, some of them in a batch (they stay live until the batch is released)
+	tTestLockFreePool::tReleaseBatch batch;
+	for (unsigned i = 1; i < CAPACITY; i += 2)
+	{
+		if (i < CAPACITY / 2)
+		{
+			test_lockfreepool.Release(elements[i]);
+		}
+		else
+		{
+			test_lockfreepool.BatchReleasePtr(batch, elements[i]);
+		}
+	}
+	REQUIRE(test_lockfreepool.ForEachLive([](uint64_t&) {}) == CAPACITY * 3 / 4);
+	test_lockfreepool.ReleaseBatch(batch);
+
+	const uint64_t* prev_element = nullptr;
+	bool only_even = true;
+	bool ordered = true;
+	REQUIRE(test_lockfreepool.ForEachLive([&](uint64_t& element)
+	{
+		only_even = only_even && ((element % 2) == 0);
+		ordered = ordered && (!prev_element || (&element > prev_element));
+		prev_element = &element;
+	}) == CAPACITY / 2);
+	REQUIRE(only_even);
+	REQUIRE(ordered);
+
+	// Ranges not aligned to the words of the bitmap
+	unsigned num_live_in_range = 0;
+	for (unsigned i = 0; i < CAPACITY; i += 2)
+	{
+		const unsigned idx = test_lockfreepool.GetElementIndex(elements[i]);
+		num_live_in_range += (idx >= 3) && (idx < 130);
+	}
+	REQUIRE(test_lockfreepool.ForEachLiveInRange(3, 130, [](uint64_t&) {}) == num_live_in_range);
+	REQUIRE(test_lockfreepool.ForEachLiveInRange(3, 3, [](uint64_t&) {}) == 0);
+	REQUIRE(test_lockfreepool.ForEachLiveInRange(0, CAPACITY * 2, [](uint64_t&) {}) == CAPACITY / 2);
+
+	// Elements reacquired show up again
+	REQUIRE(test_lockfreepool.Acquire(uint64_t(1)) != nullptr);
+	REQUIRE(test_lockfreepool.ForEachLive([](uint64_t&) {}) == CAPACITY / 2 + 1);
+
+	lockfree::cJobSystem job_system(4);
+	std::atomic<uint64_t> parallel_sum(0);
+	std::atomic<unsigned> parallel_count(0);
+	lockfree::ParallelForEachLive(job_system, test_lockfreepool, 100, [&parallel_sum, &parallel_count](uint64_t& element)
+	{
+		parallel_sum.fetch_add(element, std::memory_order_relaxed);
+		parallel_count.fetch_add(1, std::memory_order_relaxed);
+	});
+
+	uint64_t sum = 0;
+	test_lockfreepool.ForEachLive([&sum](uint64_t& element) { sum += element; });
+	REQUIRE(parallel_count.load() == CAPACITY / 2 + 1);
+	REQUIRE(parallel_sum.load() == sum);
+}
+
+//-------------------------------------------------------------------------
+TEST_CASE("cLockfreePool trim test", "[lockfreepool]")
+{
+	static constexpr const unsigned CAPACITY = 1 << 16;
+	static constexpr const unsigned KEEP_EVERY = 4096;
+	typedef lockfree::cLockFreePool<uint64_t, std::allocator<uint64_t>, lockfree::LFPF_TRIMMABLE> tTestLockFreePool;
+	tTestLockFreePool test_lockfreepool(CAPACITY);
+	const size_t page_size = lockfree::vm::GetPageSize();
+
+	std::vector<uint64_t*> elements;
+	while (uint64_t* const element = test_lockfreepool.Acquire(elements.size()))
+	{
+		elements.push_back(element);
+	}
+	REQUIRE(elements.size() == CAPACITY);
+	REQUIRE(test_lockfreepool.Trim() == 0);
+
+	// After the burst only a few elements stay, far apart. Everything else but the pages around them goes back to the OS
+	for (unsigned i = 0; i != CAPACITY; ++i)
+	{
+		if (i % KEEP_EVERY != 0)
+		{
+			test_lockfreepool.Release(elements[i]);
+		}
+	}
+
+	const size_t trimmed_bytes = test_lockfreepool.Trim();
+	REQUIRE(trimmed_bytes % page_size == 0);
+	REQUIRE(trimmed_bytes >= CAPACITY * sizeof(uint64_t) - (CAPACITY / KEEP_EVERY + 2) * page_size);
+	REQUIRE(test_lockfreepool.Trim() == 0);
+	REQUIRE(!test_lockfreepool.Empty());
+	REQUIRE(!test_lockfreepool.Full());
+
+	bool kept_intact = true;
+	for (unsigned i = 0; i < CAPACITY; i += KEEP_EVERY)
+	{
+		kept_intact = kept_intact && (*elements[i] == i);
+		test_lockfreepool.Release(elements[i]);
+	}
+	REQUIRE(kept_intact);
+	REQUIRE(test_lockfreepool.Full());
+
+	// Trimmed elements come back once the freelist runs out
+	std::vector<uint64_t*> reacquired;
+	while (uint64_t* const element = test_lockfreepool.Acquire(reacquired.size()))
+	{
+		reacquired.push_back(element);
+	}
+	REQUIRE(test_lockfreepool.Empty());
+	std::sort(reacquired.begin(), reacquired.end());
+	std::sort(elements.begin(), elements.end());
+	REQUIRE(reacquired == elements);
+
+	for (uint64_t* element : reacquired)
+	{
+		test_lockfreepool.Release(element);
+	}
+	REQUIRE(test_lockfreepool.Full());
+}
+
+//-------------------------------------------------------------------------
+TEST_CASE("cLockfreePool concurrent trim test", "[lockfreepool]")
+{
+	static constexpr const unsigned CAPACITY = 1 << 15;
+	static constexpr const unsigned NUM_THREADS = 4;
+	static constexpr const unsigned NUM_ITERATIONS = 200;
+	typedef lockfree::cLockFreePool<uint64_t, std::allocator<uint64_t>, lockfree::LFPF_TRIMMABLE> tTestLockFreePool;
+	tTestLockFreePool test_lockfreepool(CAPACITY);
+
+	// Threads acquire bursts of elements and release them, while another one keeps trimming
+	std::atomic<bool> done(false);
+	std::atomic<unsigned> num_corrupted(0);
+	std::future<void> trimmer = LaunchParallelTask([&test_lockfreepool, &done]
+	{
+		while (!done.load(std::memory_order_relaxed))
+		{
+			test_lockfreepool.Trim();
+			std::this_thread::yield();
+		}
+	});
+
+	std::vector<std::future<void>> tasks;
+	for (unsigned thread = 0; thread != NUM_THREADS; ++thread)
+	{
+		tasks.push_back(LaunchParallelTask([&test_lockfreepool, &num_corrupted, thread]
+		{
+			std::vector<uint64_t*> burst;
+			for (unsigned i = 0; i != NUM_ITERATIONS; ++i)
+			{
+				const uint64_t value = (uint64_t(thread) << 32) | i;
+				const unsigned burst_size = 1 + (i * 97) % (CAPACITY / NUM_THREADS);
+				while (burst.size() != burst_size)
+				{
+					uint64_t* const element = test_lockfreepool.Acquire(value);
+					if (!element)
+					{
+						std::this_thread::yield();
+						continue;
+					}
+					burst.push_back(element);
+				}
+
+				for (uint64_t* element : burst)
+				{
+					if (*element != value)
+					{
+						num_corrupted.fetch_add(1, std::memory_order_relaxed);
+					}
+					test_lockfreepool.Release(element);
+				}
+				burst.clear();
+			}
+		}));
+	}
+	WaitForAll(tasks);
+	done.store(true, std::memory_order_relaxed);
+	trimmer.wait();
+
+	REQUIRE(num_corrupted.load() == 0);
+	REQUIRE(test_lockfreepool.Full());
+
+	unsigned num_acquired = 0;
+	while (test_lockfreepool.AcquirePtr())
+	{
+		++num_acquired;
+	}
+	REQUIRE(num_acquired == CAPACITY);
+}
+
+//-------------------------------------------------------------------------
+TEST_CASE("cLockFreeBitmapPool single thread test", "[lockfreebitmappool]")
+{
+	// Not a multiple of the words of the bitmap, and elements smaller than cLockFreePool allows
+	static constexpr const unsigned CAPACITY = 200;
+	typedef lockfree::cLockFreeBitmapPool<uint8_t> tTestBitmapPool;
+	tTestBitmapPool test_bitmappool(CAPACITY);
+
+	REQUIRE(test_bitmappool.Full());
+	REQUIRE(!test_bitmappool.Empty());
+
+	std::vector<uint8_t*> elements;
+	std::vector<bool> acquired(CAPACITY, false);
+	for (unsigned i = 0; i != CAPACITY; ++i)
+	{
+		uint8_t* const element = test_bitmappool.Acquire(static_cast<uint8_t>(i));
+		REQUIRE(element);
+		REQUIRE(test_bitmappool.Manages(element));
+
+		const unsigned idx = test_bitmappool.GetElementIndex(element);
+		REQUIRE(!acquired[idx]);
+		acquired[idx] = true;
+		elements.push_back(element);
+	}
+	REQUIRE(test_bitmappool.Empty());
+	REQUIRE(!test_bitmappool.AcquirePtr());
+
+	// Released elements are handed out again, clustered in the word they were released to
+	test_bitmappool.Release(elements[5]);
+	test_bitmappool.Release(elements[150]);
+	REQUIRE(!test_bitmappool.Empty());
+	uint8_t* const reacquired1 = test_bitmappool.AcquirePtr();
+	uint8_t* const reacquired2 = test_bitmappool.AcquirePtr();
+	REQUIRE(((reacquired1 == elements[5]) || (reacquired1 == elements[150])));
+	REQUIRE(((reacquired2 == elements[5]) || (reacquired2 == elements[150])));
+	REQUIRE(reacquired1 != reacquired2);
+	REQUIRE(!test_bitmappool.AcquirePtr());
+
+	for (uint8_t* element : elements)
+	{
+		test_bitmappool.ReleasePtr(element);
+	}
+	REQUIRE(test_bitmappool.Full());
+
+	// Fresh pools hand out consecutive elements
+	uint8_t* const first = test_bitmappool.AcquirePtr();
+	uint8_t* const second = test_bitmappool.AcquirePtr();
+	REQUIRE(second == first + 1);
+}
+
+//-------------------------------------------------------------------------
+TEST_CASE("cLockFreeBitmapPool concurrent test", "[lockfreebitmappool]")
+{
+	static constexpr const unsigned CAPACITY = 1000;
+	static constexpr const unsigned NUM_THREADS = 8;
+	static constexpr const unsigned NUM_ITERATIONS = 20000;
+	typedef lockfree::cLockFreeBitmapPool<std::atomic<unsigned>> tTestBitmapPool;
+	tTestBitmapPool test_bitmappool(CAPACITY);
+
+	// Every thread keeps acquiring elements, tagging them as its own, and releasing them. An element handed out twice at the same
+	// time would show the tag of some other thread
+	std::atomic<unsigned> num_collisions(0);
+	std::vector<std::future<void>> tasks;
+	for (unsigned thread = 0; thread != NUM_THREADS; ++thread)
+	{
+		tasks.push_back(LaunchParallelTask(
+			[&test_bitmappool, &num_collisions, thread]
+			{
+				std::vector<std::atomic<unsigned>*> elements;
+				for (unsigned i = 0; i != NUM_ITERATIONS; ++i)
+				{
+					if (std::atomic<unsigned>* const element = test_bitmappool.Acquire(thread))
+					{
+						elements.push_back(element);
+					}
+
+					if ((elements.size() == (CAPACITY / NUM_THREADS)) || ((i % 7) == 0))
+					{
+						for (std::atomic<unsigned>* element : elements)
+						{
+							if (element->exchange(NUM_THREADS) != thread)
+							{
+								num_collisions.fetch_add(1, std::memory_order_relaxed);
+							}
+							test_bitmappool.Release(element);
+						}
+						elements.clear();
+					}
+				}
+
+				for (std::atomic<unsigned>* element : elements)
+				{
+					test_bitmappool.Release(element);
+				}
+			}));
+	}
+	WaitForAll(tasks);
+
+	REQUIRE(num_collisions.load() == 0);
+	REQUIRE(test_bitmappool.Full());
+}
+
+//-------------------------------------------------------------------------
+TEST_CASE("cLockFreeSlabAllocator single thread test", "[lockfreeslaballocator]")
+{
+	typedef lockfree::cLockFreeSlabAllocator<> tSlabAllocator;
+	tSlabAllocator slab_allocator(1 << 14);
+
+	REQUIRE(tSlabAllocator::GetSizeClass(1, 1) == 0);
+	REQUIRE(tSlabAllocator::GetSizeClass(8, 8) == 0);
+	REQUIRE(tSlabAllocator::GetSizeClass(9, 8) == 1);
+	REQUIRE(tSlabAllocator::GetSizeClass(1) == tSlabAllocator::GetSizeClass(alignof(std::max_align_t), 1));
+	REQUIRE(tSlabAllocator::GetSizeClass(4, 16) == 1);
+	REQUIRE(tSlabAllocator::GetSizeClass(tSlabAllocator::MAX_BLOCK_SIZE) == tSlabAllocator::NUM_SIZE_CLASSES - 1);
+	REQUIRE(tSlabAllocator::GetSizeClass(tSlabAllocator::MAX_BLOCK_SIZE + 1) == tSlabAllocator::NUM_SIZE_CLASSES);
+	REQUIRE(slab_allocator.GetCapacity(0) == (1 << 14) / 8);
+	REQUIRE(slab_allocator.GetCapacity(tSlabAllocator::NUM_SIZE_CLASSES - 1) == (1 << 14) / tSlabAllocator::MAX_BLOCK_SIZE);
+
+	// Every size gets a block big enough and aligned to its size class
+	std::vector<std::pair<void*, size_t>> blocks;
+	for (size_t size = 1; size <= tSlabAllocator::MAX_BLOCK_SIZE; size = size * 3 / 2 + 1)
+	{
+		void* const block = slab_allocator.Allocate(size);
+		REQUIRE(block);
+		REQUIRE(slab_allocator.Manages(block));
+		REQUIRE((reinterpret_cast<uintptr_t>(block) % (std::min)(size_t(8) << tSlabAllocator::GetSizeClass(size), alignof(std::max_align_t))) == 0);
+		memset(block, 0xAB, size);
+		blocks.emplace_back(block, size);
+	}
+
+	REQUIRE(!slab_allocator.Allocate(tSlabAllocator::MAX_BLOCK_SIZE + 1));
+	REQUIRE(!slab_allocator.Allocate(8, alignof(std::max_align_t) * 2));
+	int not_managed = 0;
+	REQUIRE(!slab_allocator.Manages(&not_managed));
+
+	// Size classes run out on their own
+	std::vector<void*> small_blocks;
+	while (void* const block = slab_allocator.Allocate(64))
+	{
+		small_blocks.push_back(block);
+	}
+	const size_t num_acquired = std::count_if(blocks.begin(), blocks.end(),
+		[](const std::pair<void*, size_t>& block) { return tSlabAllocator::GetSizeClass(block.second) == tSlabAllocator::GetSizeClass(64); });
+	REQUIRE(small_blocks.size() == slab_allocator.GetCapacity(tSlabAllocator::GetSizeClass(64)) - num_acquired);
+	REQUIRE(slab_allocator.Allocate(128));
+
+	for (void* block : small_blocks)
+	{
+		slab_allocator.Deallocate(block, 64);
+	}
+	for (const std::pair<void*, size_t>& block : blocks)
+	{
+		slab_allocator.Deallocate(block.first);
+	}
+	REQUIRE(slab_allocator.Allocate(tSlabAllocator::MAX_BLOCK_SIZE));
+
+	// Whole batches of one class go back at once
+	void* batch[16];
+	for (void*& block : batch)
+	{
+		block = slab_allocator.AllocateFromClass(2);
+		REQUIRE(slab_allocator.FindSizeClass(block) == 2);
+	}
+	REQUIRE(slab_allocator.FindSizeClass(&not_managed) == tSlabAllocator::NUM_SIZE_CLASSES);
+	REQUIRE(tSlabAllocator::GetBlockSize(2) == 32);
+	slab_allocator.DeallocateBatch(2, batch, 16);
+	REQUIRE(slab_allocator.AllocateFromClass(2) == batch[15]);
+}
+
+//-------------------------------------------------------------------------
+TEST_CASE("cLockFreeSlabAllocator concurrent test", "[lockfreeslaballocator]")
+{
+	static constexpr const unsigned NUM_THREADS = 4;
+	static constexpr const unsigned NUM_ITERATIONS = 20000;
+	typedef lockfree::cLockFreeSlabAllocator<> tSlabAllocator;
+	tSlabAllocator slab_allocator(1 << 16);
+
+	// Blocks of every size, filled with a pattern that must survive until they are deallocated (by some other thread for half of them)
+	typedef lockfree::cMPSCLockFreeQueue<std::pair<void*, size_t>, 1024> tHandoffQueue;
+	std::vector<std::unique_ptr<tHandoffQueue>> handoffs;
+	for (unsigned thread = 0; thread != NUM_THREADS; ++thread)
+	{
+		handoffs.emplace_back(new tHandoffQueue());
+	}
+
+	std::atomic<unsigned> num_corrupted(0);
+	std::vector<std::future<void>> tasks;
+	for (unsigned thread = 0; thread != NUM_THREADS; ++thread)
+	{
+		tasks.push_back(LaunchParallelTask(
+			[&slab_allocator, &handoffs, &num_corrupted, thread]
+			{
+				const auto check_and_deallocate = [&slab_allocator, &num_corrupted](const std::pair<void*, size_t>& block)
+				{
+					const unsigned char* const bytes = static_cast<const unsigned char*>(block.first);
+					if ((bytes[0] != static_cast<unsigned char>(block.second)) || (bytes[block.second - 1] != static_cast<unsigned char>(block.second)))
+					{
+						num_corrupted.fetch_add(1, std::memory_order_relaxed);
+					}
+					slab_allocator.Deallocate(block.first, block.second);
+				};
+
+				std::pair<void*, size_t> block;
+				for (unsigned i = 0; i != NUM_ITERATIONS; ++i)
+				{
+					const size_t size = 1 + (i * 37 + thread * 101) % 1024;
+					if (void* const ptr = slab_allocator.Allocate(size))
+					{
+						memset(ptr, static_cast<unsigned char>(size), size);
+						if (!(i & 1) || !handoffs[(thread + 1) % NUM_THREADS]->Push(std::make_pair(ptr, size)))
+						{
+							check_and_deallocate(std::make_pair(ptr, size));
+						}
+					}
+
+					while (handoffs[thread]->Pop(block))
+					{
+						check_and_deallocate(block);
+					}
+				}
+			}));
+	}
+	WaitForAll(tasks);
+
+	std::pair<void*, size_t> block;
+	for (auto& handoff : handoffs)
+	{
+		while (handoff->Pop(block))
+		{
+			slab_allocator.Deallocate(block.first, block.second);
+		}
+	}
+
+	REQUIRE(num_corrupted.load() == 0);
+}
+
+#if LF_PMR_ENABLED
+//-------------------------------------------------------------------------
+TEST_CASE("cLockFreeSlabMemoryResource test", "[lockfreeslaballocator]")
+{
+	typedef lockfree::cLockFreeSlabAllocator<> tSlabAllocator;
+	tSlabAllocator slab_allocator(1 << 16);
+	lockfree::cLockFreeSlabMemoryResource<> memory_resource(slab_allocator);
+
+	// Small strings come from the slab allocator, the vector outgrows it and goes upstream
+	{
+		std::pmr::vector<std::pmr::string> strings(&memory_resource);
+		for (unsigned i = 0; i != 2000; ++i)
+		{
+			strings.emplace_back(std::string(i % 100, 'x') + std::to_string(i));
+		}
+		REQUIRE(!slab_allocator.Manages(strings.data()));
+		REQUIRE(slab_allocator.Manages(strings[1099].data()));
+		REQUIRE(strings[1999].compare(std::string(99, 'x') + "1999") == 0);
+	}
+
+	// Everything went back to the slab allocator
+	for (unsigned size_class = 0; size_class != tSlabAllocator::NUM_SIZE_CLASSES; ++size_class)
+	{
+		std::vector<void*> blocks;
+		while (void* const block = slab_allocator.Allocate(size_t(8) << size_class, 8))
+		{
+			blocks.push_back(block);
+		}
+		REQUIRE(blocks.size() == slab_allocator.GetCapacity(size_class));
+		for (void* block : blocks)
+		{
+			slab_allocator.Deallocate(block);
+		}
+	}
+}
+#endif
+
+//-------------------------------------------------------------------------
+TEST_CASE("cLockFreeOwnedPool single thread test", "[lockfreeownedpool]")
+{
+	static constexpr const unsigned CAPACITY = 100;
+	lockfree::cLockFreeOwnedPool<uint64_t> test_pool(CAPACITY);
+	REQUIRE(test_pool.IsOwner());
+	REQUIRE(test_pool.Full());
+
+	std::vector<uint64_t*> elements;
+	while (uint64_t* const element = test_pool.Acquire(elements.size()))
+	{
+		elements.push_back(element);
+	}
+	REQUIRE(elements.size() == CAPACITY);
+	REQUIRE(test_pool.Empty());
+
+	// Releases from the owner are available straight away
+	test_pool.Release(elements.back());
+	REQUIRE(!test_pool.Empty());
+	REQUIRE(test_pool.AcquirePtr() == elements.back());
+
+	// Releases from other threads once the owner runs out of local elements, all at once
+	bool releaser_is_owner = true;
+	std::thread releaser([&test_pool, &elements, &releaser_is_owner]
+	{
+		releaser_is_owner = test_pool.IsOwner();
+		for (unsigned i = 0; i != CAPACITY / 2; ++i)
+		{
+			test_pool.ReleasePtr(elements[i]);
+		}
+
+		lockfree::cLockFreeOwnedPool<uint64_t>::tReleaseBatch batch;
+		for (unsigned i = CAPACITY / 2; i != CAPACITY; ++i)
+		{
+			test_pool.BatchReleasePtr(batch, elements[i]);
+		}
+		test_pool.ReleaseBatch(batch);
+	});
+	releaser.join();
+	REQUIRE(!releaser_is_owner);
+	REQUIRE(test_pool.Full());
+
+	std::vector<uint64_t*> reacquired;
+	while (uint64_t* const element = test_pool.AcquirePtr())
+	{
+		reacquired.push_back(element);
+	}
+	std::sort(reacquired.begin(), reacquired.end());
+	std::sort(elements.begin(), elements.end());
+	REQUIRE(reacquired == elements);
+
+	// Ownership moves along with the local elements
+	test_pool.ReleasePtr(elements[0]);
+	uint64_t* acquired[2] = {};
+	std::thread new_owner([&test_pool, &acquired]
+	{
+		test_pool.SetOwner();
+		acquired[0] = test_pool.AcquirePtr();
+		acquired[1] = test_pool.AcquirePtr();
+	});
+	new_owner.join();
+	REQUIRE(acquired[0] == elements[0]);
+	REQUIRE(!acquired[1]);
+	REQUIRE(!test_pool.IsOwner());
+}
+
+//-------------------------------------------------------------------------
+TEST_CASE("cLockFreeOwnedPool producer/consumer test", "[lockfreeownedpool]")
+{
+	static constexpr const unsigned NUM_CONSUMERS = 3;
+	static constexpr const unsigned NUM_ELEMENTS = 200000;
+	static constexpr const unsigned POOL_CAPACITY = 256;
+
+	// The owner produces elements into a queue, consumers check and release them (one by one or in batches)
+	lockfree::cLockFreeOwnedPool<uint64_t> test_pool(POOL_CAPACITY);
+	lockfree::cLockFreeQueue<uint64_t*, POOL_CAPACITY + 1> handoff;
+	std::atomic<bool> done(false);
+	std::atomic<unsigned> num_consumed(0);
+	std::atomic<unsigned> num_corrupted(0);
+
+	std::vector<std::future<void>> consumers;
+	for (unsigned consumer = 0; consumer != NUM_CONSUMERS; ++consumer)
+	{
+		consumers.push_back(LaunchParallelTask([&test_pool, &handoff, &done, &num_consumed, &num_corrupted, consumer]
+		{
+			lockfree::cLockFreeOwnedPool<uint64_t>::tReleaseBatch batch;
+			uint64_t* element = nullptr;
+			while (!done.load(std::memory_order_acquire) || !handoff.Empty())
+			{
+				if (!handoff.Pop(element))
+				{
+					test_pool.ReleaseBatch(batch);
+					std::this_thread::yield();
+					continue;
+				}
+
+				if (*element >= NUM_ELEMENTS)
+				{
+					num_corrupted.fetch_add(1, std::memory_order_relaxed);
+				}
+				*element = NUM_ELEMENTS;
+				num_consumed.fetch_add(1, std::memory_order_relaxed);
+
+				if (consumer == 0)
+				{
+					test_pool.ReleasePtr(element);
+					continue;
+				}
+
+				test_pool.BatchReleasePtr(batch, element);
+				if (batch.GetCount() == 8)
+				{
+					test_pool.ReleaseBatch(batch);
+				}
+			}
+			test_pool.ReleaseBatch(batch);
+		}));
+	}
+
+	for (unsigned i = 0; i != NUM_ELEMENTS; ++i)
+	{
+		uint64_t* element = nullptr;
+		while (!(element = test_pool.Acquire(i)))
+		{
+			std::this_thread::yield();
+		}
+		while (!handoff.Push(element))
+		{
+			std::this_thread::yield();
+		}
+	}
+	done.store(true, std::memory_order_release);
+	WaitForAll(consumers);
+
+	REQUIRE(num_corrupted.load() == 0);
+	REQUIRE(num_consumed.load() == NUM_ELEMENTS);
+	REQUIRE(test_pool.Full());
+}
+
+//-------------------------------------------------------------------------
+namespace
+{
+	//-------------------------------------------------------------------------
+	// Counts its constructions and destructions, to check they only happen once per slot
+	struct tRecycledMessage
+	{
+		tRecycledMessage() { sNumConstructed.fetch_add(1, std::memory_order_relaxed); }
+		~tRecycledMessage() { sNumDestructed.fetch_add(1, std::memory_order_relaxed); }
+
+		std::vector<int>	mPayload;
+		std::string			mName;
+
+		static std::atomic<unsigned> sNumConstructed;
+		static std::atomic<unsigned> sNumDestructed;
+	};
+
+	std::atomic<unsigned> tRecycledMessage::sNumConstructed(0);
+	std::atomic<unsigned> tRecycledMessage::sNumDestructed(0);
+
+	//-------------------------------------------------------------------------
+	struct tClearRecycledMessage
+	{
+		void operator()(tRecycledMessage& message) const
+		{
+			message.mPayload.clear();
+			message.mName.clear();
+		}
+	};
+}
+
+//-------------------------------------------------------------------------
+TEST_CASE("cLockFreeRecyclingPool single thread test", "[lockfreerecyclingpool]")
+{
+	static constexpr const unsigned CAPACITY = 16;
+	typedef lockfree::cLockFreeRecyclingPool<tRecycledMessage, tClearRecycledMessage> tTestRecyclingPool;
+	tRecycledMessage::sNumConstructed = 0;
+	tRecycledMessage::sNumDestructed = 0;
+
+	{
+		tTestRecyclingPool test_pool(CAPACITY);
+		REQUIRE(test_pool.GetNumConstructed() == 0);
+
+		tRecycledMessage* const message = test_pool.Acquire();
+		REQUIRE(message);
+		REQUIRE(test_pool.Manages(message));
+		message->mPayload.resize(1000, 7);
+		message->mName.assign(100, 'x');
+		test_pool.Release(message);
+
+		// Same object back, reset but keeping its memory
+		tRecycledMessage* const recycled = test_pool.Acquire();
+		REQUIRE(recycled == message);
+		REQUIRE(recycled->mPayload.empty());
+		REQUIRE(recycled->mPayload.capacity() >= 1000);
+		REQUIRE(recycled->mName.empty());
+		REQUIRE(recycled->mName.capacity() >= 100);
+		REQUIRE(tRecycledMessage::sNumConstructed.load() == 1);
+
+		std::vector<tRecycledMessage*> messages(1, recycled);
+		while (messages.size() != CAPACITY)
+		{
+			messages.push_back(test_pool.AcquireWait());
+		}
+		REQUIRE(test_pool.Empty());
+		REQUIRE(!test_pool.Acquire());
+		REQUIRE(test_pool.GetNumConstructed() == CAPACITY);
+
+		for (tRecycledMessage* acquired : messages)
+		{
+			test_pool.Release(acquired);
+		}
+		REQUIRE(test_pool.Full());
+		REQUIRE(tRecycledMessage::sNumConstructed.load() == CAPACITY);
+		REQUIRE(tRecycledMessage::sNumDestructed.load() == 0);
+	}
+	REQUIRE(tRecycledMessage::sNumDestructed.load() == CAPACITY);
+}
+
+//-------------------------------------------------------------------------
+TEST_CASE("cLockFreeRecyclingPool concurrent test", "[lockfreerecyclingpool]")
+{
+	static constexpr const unsigned CAPACITY = 64;
+	static constexpr const unsigned NUM_THREADS = 4;
+	static constexpr const unsigned NUM_ITERATIONS = 20000;
+	typedef lockfree::cLockFreeRecyclingPool<tRecycledMessage, tClearRecycledMessage> tTestRecyclingPool;
+	tRecycledMessage::sNumConstructed = 0;
+	tRecycledMessage::sNumDestructed = 0;
+
+	// Every object acquired must come reset, whoever released it
+	std::atomic<unsigned> num_dirty(0);
+	{
+		tTestRecyclingPool test_pool(CAPACITY);
+		std::vector<std::future<void>> tasks;
+		for (unsigned thread = 0; thread != NUM_THREADS; ++thread)
+		{
+			tasks.push_back(LaunchParallelTask([&test_pool, &num_dirty, thread]
+			{
+				tRecycledMessage* messages[4];
+				for (unsigned i = 0; i != NUM_ITERATIONS; ++i)
+				{
+					for (tRecycledMessage*& message : messages)
+					{
+						message = test_pool.AcquireWait();
+						if (!message->mPayload.empty() || !message->mName.empty())
+						{
+							num_dirty.fetch_add(1, std::memory_order_relaxed);
+						}
+						message->mPayload.assign(1 + (i + thread) % 64, static_cast<int>(i));
+						message->mName = std::to_string(i);
+					}
+					for (tRecycledMessage* message : messages)
+					{
+						test_pool.Release(message);
+					}
+				}
+			}));
+		}
+		WaitForAll(tasks);
+
+		REQUIRE(test_pool.Full());
+		REQUIRE(tRecycledMessage::sNumConstructed.load() == test_pool.GetNumConstructed());
+		REQUIRE(tRecycledMessage::sNumDestructed.load() == 0);
+	}
+	REQUIRE(num_dirty.load() == 0);
+	REQUIRE(tRecycledMessage::sNumDestructed.load() == tRecycledMessage::sNumConstructed.load());
+}
+
+//-------------------------------------------------------------------------
+TEST_CASE("cLockfreePool release all test", "[lockfreepool]")
+{
+	static constexpr const unsigned CAPACITY = 1 << 12;
+	typedef lockfree::cLockFreePool<uint64_t, std::allocator<uint64_t>, lockfree::LFPF_TRACK_OCCUPANCY | lockfree::LFPF_TRIMMABLE> tTestLockFreePool;
+	tTestLockFreePool test_lockfreepool(CAPACITY);
+
+	for (unsigned frame = 0; frame != 3; ++frame)
+	{
+		std::set<uint64_t*> elements;
+		while (uint64_t* const element = test_lockfreepool.Acquire(frame))
+		{
+			elements.insert(element);
+		}
+		REQUIRE(elements.size() == CAPACITY);
+		REQUIRE(test_lockfreepool.Empty());
+		REQUIRE(test_lockfreepool.ForEachLive([](uint64_t&) {}) == CAPACITY);
+
+		// End of the frame: everything back at once
+		test_lockfreepool.ReleaseAll();
+		REQUIRE(test_lockfreepool.Full());
+		REQUIRE(test_lockfreepool.ForEachLive([](uint64_t&) {}) == 0);
+	}
+
+	// Trimmed spans are part of the freelist again
+	REQUIRE(test_lockfreepool.Trim() > 0);
+	test_lockfreepool.ReleaseAll();
+	REQUIRE(test_lockfreepool.Full());
+	REQUIRE(test_lockfreepool.Trim() > 0);
+
+	unsigned num_acquired = 0;
+	while (test_lockfreepool.AcquirePtr())
+	{
+		++num_acquired;
+	}
+	REQUIRE(num_acquired == CAPACITY);
+}
+
+//-------------------------------------------------------------------------
+TEST_CASE("cLockFreeArena single thread test", "[lockfreearena]")
+{
+	static constexpr const size_t CAPACITY = 1024;
+	lockfree::cLockFreeArena<> test_arena(CAPACITY);
+	REQUIRE(test_arena.GetCapacity() == CAPACITY);
+	REQUIRE(test_arena.GetSize() == 0);
+
+	uint8_t* const byte = static_cast<uint8_t*>(test_arena.AllocatePtr(1, 1));
+	REQUIRE(byte);
+	REQUIRE(test_arena.Manages(byte));
+
+	// The next block skips whatever it takes to be aligned
+	uint64_t* const value = test_arena.Allocate<uint64_t>(42);
+	REQUIRE(value);
+	REQUIRE(*value == 42);
+	REQUIRE(reinterpret_cast<uintptr_t>(value) % alignof(uint64_t) == 0);
+	REQUIRE(reinterpret_cast<uint8_t*>(value) > byte);
+
+	void* const aligned = test_arena.AllocatePtr(16, 256);
+	REQUIRE(aligned);
+	REQUIRE(reinterpret_cast<uintptr_t>(aligned) % 256 == 0);
+
+	REQUIRE(!test_arena.AllocateArray<uint8_t>(CAPACITY));
+	REQUIRE(!test_arena.AllocateArray<uint64_t>(~size_t(0) / 4));
+	const size_t size = test_arena.GetSize();
+	REQUIRE(size <= CAPACITY);
+	while (test_arena.AllocatePtr(1, 1))
+	{
+	}
+	REQUIRE(test_arena.GetSize() == CAPACITY);
+	REQUIRE(!test_arena.Allocate<uint32_t>());
+
+	// Everything back at once, allocations start over from the beginning
+	test_arena.Reset();
+	REQUIRE(test_arena.GetSize() == 0);
+	REQUIRE(test_arena.AllocatePtr(1, 1) == byte);
+	REQUIRE(test_arena.AllocateArray<uint8_t>(CAPACITY - 1));
+	REQUIRE(!test_arena.AllocatePtr(1, 1));
+}
+
+//-------------------------------------------------------------------------
+TEST_CASE("cLockFreeArena concurrent test", "[lockfreearena]")
+{
+	static constexpr const size_t CAPACITY = 1 << 20;
+	static constexpr const unsigned NUM_THREADS = 4;
+	lockfree::cLockFreeArena<> test_arena(CAPACITY);
+
+	for (unsigned frame = 0; frame != 4; ++frame)
+	{
+		// Every thread fills its blocks with its id until the arena runs out. If two blocks overlapped, some would get overwritten
+		std::vector<std::vector<std::pair<uint32_t*, size_t>>> blocks(NUM_THREADS);
+		std::vector<std::future<void>> tasks;
+		for (unsigned thread = 0; thread != NUM_THREADS; ++thread)
+		{
+			tasks.push_back(LaunchParallelTask([&test_arena, &blocks, thread]
+			{
+				for (size_t n = 1 + thread;; n = n % 37 + 1)
+				{
+					uint32_t* const block = test_arena.AllocateArray<uint32_t>(n);
+					if (!block)
+					{
+						break;
+					}
+					std::fill(block, block + n, thread);
+					blocks[thread].emplace_back(block, n);
+				}
+			}));
+		}
+		WaitForAll(tasks);
+
+		size_t allocated_bytes = 0;
+		bool intact = true;
+		for (unsigned thread = 0; thread != NUM_THREADS; ++thread)
+		{
+			for (const auto& block : blocks[thread])
+			{
+				intact = intact && test_arena.Manages(block.first) && (reinterpret_cast<uintptr_t>(block.first) % alignof(uint32_t) == 0);
+				intact = intact && std::all_of(block.first, block.first + block.second, [thread](uint32_t value) { return value == thread; });
+				allocated_bytes += block.second * sizeof(uint32_t);
+			}
+		}
+		REQUIRE(intact);
+		REQUIRE(allocated_bytes <= test_arena.GetSize());
+		REQUIRE(test_arena.GetSize() > CAPACITY - 37 * sizeof(uint32_t));
+
+		test_arena.Reset();
+	}
+}
+
+//-------------------------------------------------------------------------
+TEST_CASE("Lockfree containers bulk push and pop test", "[lockfreestack][lockfreequeue]")
+{
+	// Nodes store trivial types as they are, and nothing else
+	static_assert(lockfree::detail::tLockFreeQueueNode<int>::IS_TRIVIAL && lockfree::detail::tLockFreeStackNode<int>::IS_TRIVIAL, "int nodes should be trivial");
+	static_assert(!lockfree::detail::tLockFreeQueueNode<std::string>::IS_TRIVIAL && !lockfree::detail::tLockFreeStackNode<std::string>::IS_TRIVIAL, "std::string nodes should not");
+
+	static constexpr const unsigned CAPACITY = 8;
+	const int values[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+	int results[10] = {};
+
+	SECTION("cLockFreeStack")
+	{
+		lockfree::cLockFreeStack<int, CAPACITY> test_lockfreestack;
+		REQUIRE(test_lockfreestack.PopBulk(results, 10) == 0);
+
+		// Only as many as nodes in the pool
+		REQUIRE(test_lockfreestack.PushBulk(values, 3) == 3);
+		REQUIRE(test_lockfreestack.Push(42));
+		REQUIRE(test_lockfreestack.PushBulk(values + 3, 7) == 4);
+		REQUIRE(test_lockfreestack.PushBulk(values, 1) == 0);
+
+		REQUIRE(test_lockfreestack.PopBulk(results, 5) == 5);
+		REQUIRE(std::vector<int>(results, results + 5) == std::vector<int>({ 7, 6, 5, 4, 42 }));
+		REQUIRE(test_lockfreestack.PopBulk(results, 0) == 0);
+		REQUIRE(test_lockfreestack.PopBulk(results, 10) == 3);
+		REQUIRE(std::vector<int>(results, results + 3) == std::vector<int>({ 3, 2, 1 }));
+		REQUIRE(test_lockfreestack.Empty());
+	}
+
+	SECTION("cLockFreeQueue")
+	{
+		lockfree::cLockFreeQueue<int, CAPACITY> test_lockfreequeue;
+		REQUIRE(test_lockfreequeue.PopBulk(results, 10) == 0);
+
+		REQUIRE(test_lockfreequeue.PushBulk(values, 3) == 3);
+		REQUIRE(test_lockfreequeue.Push(42));
+		REQUIRE(test_lockfreequeue.PushBulk(values + 3, 7) == 4);
+		REQUIRE(test_lockfreequeue.PushBulk(values, 1) == 0);
+
+		REQUIRE(test_lockfreequeue.PopBulk(results, 5) == 5);
+		REQUIRE(std::vector<int>(results, results + 5) == std::vector<int>({ 1, 2, 3, 42, 4 }));
+		REQUIRE(test_lockfreequeue.PopBulk(results, 0) == 0);
+		REQUIRE(test_lockfreequeue.PopBulk(results, 10) == 3);
+		REQUIRE(std::vector<int>(results, results + 3) == std::vector<int>({ 5, 6, 7 }));
+		REQUIRE(test_lockfreequeue.Empty());
+	}
+}
+
+//-------------------------------------------------------------------------
+TEST_CASE("Lockfree containers bulk push and pop concurrent test", "[lockfreestack][lockfreequeue]")
+{
+	static constexpr const unsigned NUM_PRODUCERS = 2;
+	static constexpr const unsigned NUM_CONSUMERS = 2;
+	static constexpr const unsigned NUM_ELEMENTS_PER_PRODUCER = 50000;
+	static constexpr const unsigned MAX_BULK = 16;
+	static constexpr const size_t CAPACITY = 256;
+
+	// Producers push runs of (producer, sequence) pairs, consumers pop runs. Every element must be popped exactly once and, from the
+	// queue, in the order each producer pushed them
+	const auto run_test = [](auto& container, bool fifo)
+	{
+		std::atomic<unsigned> num_popped(0);
+		std::vector<std::vector<unsigned>> popped(NUM_CONSUMERS);
+		std::atomic<bool> in_order(true);
+		std::vector<std::future<void>> tasks;
+
+		for (unsigned producer = 0; producer != NUM_PRODUCERS; ++producer)
+		{
+			tasks.push_back(LaunchParallelTask([&container, producer]
+			{
+				uint64_t values[MAX_BULK];
+				for (unsigned sequence = 0; sequence != NUM_ELEMENTS_PER_PRODUCER;)
+				{
+					const unsigned count = (std::min)(1 + sequence % MAX_BULK, NUM_ELEMENTS_PER_PRODUCER - sequence);
+					for (unsigned i = 0; i != count; ++i)
+					{
+						values[i] = (uint64_t(producer) << 32) | (sequence + i);
+					}
+
+					unsigned pushed = 0;
+					while (pushed != count)
+					{
+						const unsigned pushed_now = container.PushBulk(values + pushed, count - pushed);
+						pushed += pushed_now;
+						if (pushed_now == 0)
+						{
+							std::this_thread::yield();
+						}
+					}
+					sequence += count;
+				}
+			}));
+		}
+
+		for (unsigned consumer = 0; consumer != NUM_CONSUMERS; ++consumer)
+		{
+			tasks.push_back(LaunchParallelTask([&, consumer, fifo]
+			{
+				std::vector<unsigned> last_sequence(NUM_PRODUCERS, ~0U);
+				uint64_t results[MAX_BULK];
+				while (num_popped.load(std::memory_order_relaxed) != NUM_PRODUCERS * NUM_ELEMENTS_PER_PRODUCER)
+				{
+					const unsigned count = container.PopBulk(results, 1 + consumer * (MAX_BULK - 1));
+					for (unsigned i = 0; i != count; ++i)
+					{
+						const unsigned producer = static_cast<unsigned>(results[i] >> 32);
+						const unsigned sequence = static_cast<unsigned>(results[i]);
+						if (fifo && (last_sequence[producer] != ~0U) && (sequence <= last_sequence[producer]))
+						{
+							in_order = false;
+						}
+						last_sequence[producer] = sequence;
+						popped[consumer].push_back(producer * NUM_ELEMENTS_PER_PRODUCER + sequence);
+					}
+					num_popped.fetch_add(count, std::memory_order_relaxed);
+					if (count == 0)
+					{
+						std::this_thread::yield();
+					}
+				}
+			}));
+		}
+		WaitForAll(tasks);
+
+		std::vector<unsigned> all_popped;
+		for (const auto& consumer_popped : popped)
+		{
+			all_popped.insert(all_popped.end(), consumer_popped.begin(), consumer_popped.end());
+		}
+		std::sort(all_popped.begin(), all_popped.end());
+
+		std::vector<unsigned> expected(NUM_PRODUCERS * NUM_ELEMENTS_PER_PRODUCER);
+		std::iota(expected.begin(), expected.end(), 0U);
+		REQUIRE(all_popped == expected);
+		REQUIRE(in_order.load());
+		REQUIRE(container.Empty());
+	};
+
+	SECTION("cLockFreeStack")
+	{
+		lockfree::cLockFreeStack<uint64_t, CAPACITY> test_lockfreestack;
+		run_test(test_lockfreestack, false);
+	}
+
+	SECTION("cLockFreeQueue")
+	{
+		lockfree::cLockFreeQueue<uint64_t, CAPACITY> test_lockfreequeue;
+		run_test(test_lockfreequeue, true);
+	}
+}
+
+//-------------------------------------------------------------------------
+namespace
+{
+	// A payload a few kilobytes big, every byte derived from its id so torn or stale payloads are easy to spot
+	struct tBigPayload
+	{
+		tBigPayload() : tBigPayload(0) {}
+		tBigPayload(unsigned id) : mId(id) { memset(mBytes, static_cast<int>(id & 0xFF), sizeof(mBytes)); }
+
+		bool IsIntact() const
+		{
+			return std::all_of(std::begin(mBytes), std::end(mBytes), [this](uint8_t byte) { return byte == (mId & 0xFF); });
+		}
+
+		unsigned	mId;
+		uint8_t		mBytes[4092];
+	};
+}
+
+//-------------------------------------------------------------------------
+TEST_CASE("cLockFreePayloadQueue single thread test", "[lockfreepayloadqueue]")
+{
+	static constexpr const unsigned NUM_PAYLOADS = 24;
+	typedef lockfree::cLockFreePool<tBigPayload> tPayloadPool;
+
+	// Whatever the size of the payload, the queues only link 8-byte nodes
+	static_assert(sizeof(lockfree::detail::tLockFreeQueueNodeFor<uint32_t, 17>) == 8, "Nodes of payload queues should take 8 bytes");
+
+	tPayloadPool payload_pool(NUM_PAYLOADS);
+
+	SECTION("Queues of different capacities sharing the payload pool")
+	{
+		lockfree::cLockFreePayloadQueue<tBigPayload, 16> big_queue(payload_pool);
+		lockfree::cLockFreePayloadQueue<tBigPayload, 4> small_queue(payload_pool);
+		REQUIRE(&big_queue.GetPayloadPool() == &payload_pool);
+		REQUIRE(big_queue.Empty());
+
+		for (unsigned i = 0; i != 16; ++i)
+		{
+			REQUIRE(big_queue.Push(i));
+		}
+		for (unsigned i = 0; i != 4; ++i)
+		{
+			small_queue.PushWait(100 + i);
+		}
+
+		// Queues full, the payloads acquired for the failed pushes go back to the pool
+		REQUIRE(!big_queue.Push(16U));
+		REQUIRE(!small_queue.Push(104U));
+		REQUIRE(!payload_pool.Empty());
+
+		// Popped in place, right from the payload pool
+		bool in_order = true;
+		bool in_place = true;
+		for (unsigned i = 0; i != 16; ++i)
+		{
+			REQUIRE(big_queue.PopWith([&](tBigPayload& payload)
+			{
+				in_order = in_order && (payload.mId == i) && payload.IsIntact();
+				in_place = in_place && payload_pool.Manages(&payload);
+			}));
+		}
+		REQUIRE(in_order);
+		REQUIRE(in_place);
+		REQUIRE(big_queue.Empty());
+		REQUIRE(!big_queue.PopWith([](tBigPayload&) {}));
+
+		tBigPayload result;
+		for (unsigned i = 0; i != 4; ++i)
+		{
+			REQUIRE(small_queue.Pop(result));
+			REQUIRE(result.mId == 100 + i);
+			REQUIRE(result.IsIntact());
+		}
+		REQUIRE(!small_queue.Pop(result));
+		REQUIRE(payload_pool.Full());
+	}
+
+	SECTION("Payload pool exhausted before the queue")
+	{
+		lockfree::cLockFreePayloadQueue<tBigPayload, 32> test_queue(payload_pool);
+		for (unsigned i = 0; i != NUM_PAYLOADS; ++i)
+		{
+			REQUIRE(test_queue.Push(i));
+		}
+		REQUIRE(payload_pool.Empty());
+		REQUIRE(!test_queue.Push(NUM_PAYLOADS));
+
+		tBigPayload result;
+		test_queue.PopWait(result);
+		REQUIRE(result.mId == 0);
+		REQUIRE(test_queue.Push(NUM_PAYLOADS));
+	}
+
+	SECTION("Payloads left in a queue are released on destruction")
+	{
+		{
+			lockfree::cLockFreePayloadQueue<tBigPayload, 8> test_queue(payload_pool);
+			for (unsigned i = 0; i != 8; ++i)
+			{
+				REQUIRE(test_queue.Push(i));
+			}
+		}
+		REQUIRE(payload_pool.Full());
+	}
+}
+
+//-------------------------------------------------------------------------
+TEST_CASE("cLockFreePayloadQueue concurrent test", "[lockfreepayloadqueue]")
+{
+	static constexpr const unsigned NUM_PAYLOADS = 48;
+	static constexpr const unsigned NUM_PRODUCERS = 2;
+	static constexpr const unsigned NUM_CONSUMERS = 2;
+	static constexpr const unsigned NUM_ELEMENTS_PER_PRODUCER = 20000;
+
+	// Two queues of different capacities, both bigger than what the payload pool can hold at once, so producers wait on either. Every
+	// producer pushes to both, every consumer pops from both. Every payload must be popped once and intact, in the order it was pushed
+	lockfree::cLockFreePool<tBigPayload> payload_pool(NUM_PAYLOADS);
+	lockfree::cLockFreePayloadQueue<tBigPayload, 64> big_queue(payload_pool);
+	lockfree::cLockFreePayloadQueue<tBigPayload, 8> small_queue(payload_pool);
+
+	std::atomic<unsigned> num_popped(0);
+	std::atomic<unsigned> num_broken(0);
+	std::vector<std::vector<unsigned>> popped(NUM_CONSUMERS);
+	std::vector<std::future<void>> tasks;
+
+	for (unsigned producer = 0; producer != NUM_PRODUCERS; ++producer)
+	{
+		tasks.push_back(LaunchParallelTask([&, producer]
+		{
+			for (unsigned sequence = 0; sequence != NUM_ELEMENTS_PER_PRODUCER; ++sequence)
+			{
+				const unsigned id = producer * NUM_ELEMENTS_PER_PRODUCER + sequence;
+				if (sequence % 2)
+				{
+					small_queue.PushWait(id);
+				}
+				else
+				{
+					big_queue.PushWait(id);
+				}
+			}
+		}));
+	}
+
+	for (unsigned consumer = 0; consumer != NUM_CONSUMERS; ++consumer)
+	{
+		tasks.push_back(LaunchParallelTask([&, consumer]
+		{
+			std::vector<unsigned> last_id(2 * NUM_PRODUCERS, ~0U);
+			const auto consume = [&](unsigned queue_idx, tBigPayload& payload)
+			{
+				const unsigned stream = queue_idx * NUM_PRODUCERS + payload.mId / NUM_ELEMENTS_PER_PRODUCER;
+				if (!payload.IsIntact() || ((last_id[stream] != ~0U) && (payload.mId <= last_id[stream])))
+				{
+					num_broken.fetch_add(1, std::memory_order_relaxed);
+				}
+				last_id[stream] = payload.mId;
+				popped[consumer].push_back(payload.mId);
+				num_popped.fetch_add(1, std::memory_order_relaxed);
+			};
+
+			while (num_popped.load(std::memory_order_relaxed) != NUM_PRODUCERS * NUM_ELEMENTS_PER_PRODUCER)
+			{
+				const bool popped_big = big_queue.PopWith([&](tBigPayload& payload) { consume(0, payload); });
+				const bool popped_small = small_queue.PopWith([&](tBigPayload& payload) { consume(1, payload); });
+				if (!popped_big && !popped_small)
+				{
+					std::this_thread::yield();
+				}
+			}
+		}));
+	}
+	WaitForAll(tasks);
+
+	std::vector<unsigned> all_popped;
+	for (const auto& consumer_popped : popped)
+	{
+		all_popped.insert(all_popped.end(), consumer_popped.begin(), consumer_popped.end());
+	}
+	std::sort(all_popped.begin(), all_popped.end());
+
+	std::vector<unsigned> expected(NUM_PRODUCERS * NUM_ELEMENTS_PER_PRODUCER);
+	std::iota(expected.begin(), expected.end(), 0U);
+	REQUIRE(all_popped == expected);
+	REQUIRE(num_broken.load() == 0);
+	REQUIRE(big_queue.Empty());
+	REQUIRE(small_queue.Empty());
+	REQUIRE(payload_pool.Full());
+}
+
+#if defined __linux__
+//-------------------------------------------------------------------------
+TEST_CASE("lfmalloc test", "[lfmalloc]")
+{
+	namespace lfmalloc = lockfree::lfmalloc;
+
+	const auto fill = [](void* ptr, size_t size, unsigned char seed)
+	{
+		unsigned char* const bytes = static_cast<unsigned char*>(ptr);
+		for (size_t i = 0; i != size; ++i)
+		{
+			bytes[i] = static_cast<unsigned char>(seed + i);
+		}
+	};
+	const auto is_filled = [](const void* ptr, size_t size, unsigned char seed)
+	{
+		const unsigned char* const bytes = static_cast<const unsigned char*>(ptr);
+		for (size_t i = 0; i != size; ++i)
+		{
+			if (bytes[i] != static_cast<unsigned char>(seed + i))
+			{
+				return false;
+			}
+		}
+		return true;
+	};
+	const auto is_aligned = [](const void* ptr, size_t alignment) { return (reinterpret_cast<uintptr_t>(ptr) & (alignment - 1)) == 0; };
+
+	// Every size class, and large requests, sized right at and just past the power of two
+	static const size_t sizes[] = { 0, 1, 8, 9, 16, 100, 1000, 4096, 4097, 65536, 131072, 131073, 1 << 20 };
+
+	SECTION("Allocate and free")
+	{
+		std::vector<void*> ptrs;
+		for (size_t size : sizes)
+		{
+			void* const ptr = lfmalloc::Malloc(size);
+			REQUIRE(ptr != nullptr);
+			REQUIRE(is_aligned(ptr, alignof(std::max_align_t)));
+			REQUIRE(lfmalloc::MallocUsableSize(ptr) >= size);
+			fill(ptr, size, static_cast<unsigned char>(size));
+			ptrs.push_back(ptr);
+		}
+
+		for (size_t i = 0; i != ptrs.size(); ++i)
+		{
+			REQUIRE(is_filled(ptrs[i], sizes[i], static_cast<unsigned char>(sizes[i])));
+			lfmalloc::Free(ptrs[i]);
+		}
+
+		lfmalloc::Free(nullptr);
+		REQUIRE(lfmalloc::MallocUsableSize(nullptr) == 0);
+	}
+
+	SECTION("Calloc")
+	{
+		// Dirty blocks first, so the zeroed ones are likely to be recycled rather than fresh
+		for (size_t size : sizes)
+		{
+			void* const ptr = lfmalloc::Malloc(size);
+			REQUIRE(ptr != nullptr);
+			memset(ptr, 0xcd, size);
+			lfmalloc::Free(ptr);
+		}
+
+		for (size_t size : sizes)
+		{
+			unsigned char* const ptr = static_cast<unsigned char*>(lfmalloc::Calloc(size, 1));
+			REQUIRE(ptr != nullptr);
+			REQUIRE(std::all_of(ptr, ptr + size, [](unsigned char byte) { return byte == 0; }));
+			lfmalloc::Free(ptr);
+		}
+
+		REQUIRE(lfmalloc::Calloc(~size_t(0), 2) == nullptr);
+		REQUIRE(errno == ENOMEM);
+	}
+
+	SECTION("Realloc")
+	{
+		// Growing and shrinking across size classes and into and out of large allocations (which the kernel can move), contents kept
+		static const size_t steps[] = { 24, 200, 5000, 100000, 200000, 3 << 20, 150000, 1 << 20, 3000, 40, 16 };
+
+		void* ptr = lfmalloc::Realloc(nullptr, 10);
+		REQUIRE(ptr != nullptr);
+		fill(ptr, 10, 7);
+		size_t size = 10;
+		for (size_t new_size : steps)
+		{
+			ptr = lfmalloc::Realloc(ptr, new_size);
+			REQUIRE(ptr != nullptr);
+			REQUIRE(lfmalloc::MallocUsableSize(ptr) >= new_size);
+			REQUIRE(is_filled(ptr, (std::min)(size, new_size), 7));
+			fill(ptr, new_size, 7);
+			size = new_size;
+		}
+
+		REQUIRE(lfmalloc::Realloc(ptr, 0) == nullptr);
+	}
+
+	SECTION("Aligned")
+	{
+		for (size_t alignment = 16; alignment <= (64 << 10); alignment <<= 1)
+		{
+			for (size_t size : { size_t(1), alignment / 2, alignment, alignment * 3 })
+			{
+				void* const ptr = lfmalloc::AlignedAlloc(alignment, size);
+				REQUIRE(ptr != nullptr);
+				REQUIRE(is_aligned(ptr, alignment));
+				REQUIRE(lfmalloc::MallocUsableSize(ptr) >= size);
+				fill(ptr, size, 3);
+
+				void* posix_ptr = nullptr;
+				REQUIRE(lfmalloc::PosixMemalign(&posix_ptr, alignment, size) == 0);
+				REQUIRE(is_aligned(posix_ptr, alignment));
+				fill(posix_ptr, size, 5);
+
+				REQUIRE(is_filled(ptr, size, 3));
+				REQUIRE(is_filled(posix_ptr, size, 5));
+				lfmalloc::Free(ptr);
+				lfmalloc::Free(posix_ptr);
+			}
+		}
+
+		void* const page_ptr = lfmalloc::Valloc(100);
+		REQUIRE(is_aligned(page_ptr, 4096));
+		void* const pages_ptr = lfmalloc::Pvalloc(5000);
+		REQUIRE(is_aligned(pages_ptr, 4096));
+		REQUIRE(lfmalloc::MallocUsableSize(pages_ptr) >= 8192);
+		lfmalloc::Free(page_ptr);
+		lfmalloc::Free(pages_ptr);
+
+		REQUIRE(lfmalloc::AlignedAlloc(24, 100) == nullptr);
+		REQUIRE(errno == EINVAL);
+		void* posix_ptr = nullptr;
+		REQUIRE(lfmalloc::PosixMemalign(&posix_ptr, 4, 100) == EINVAL);
+		REQUIRE(lfmalloc::PosixMemalign(&posix_ptr, 48, 100) == EINVAL);
+		REQUIRE(posix_ptr == nullptr);
+	}
+
+	SECTION("Remote frees")
+	{
+		static constexpr const unsigned NUM_THREADS = 4;
+		static constexpr const unsigned NUM_ITERATIONS = 20000;
+
+		// Every thread hands half of its blocks to the next one to free, so blocks keep moving between thread caches and the pools
+		typedef lockfree::cMPSCLockFreeQueue<std::pair<void*, size_t>, 1024> tHandoffQueue;
+		std::vector<std::unique_ptr<tHandoffQueue>> handoffs;
+		for (unsigned thread = 0; thread != NUM_THREADS; ++thread)
+		{
+			handoffs.emplace_back(new tHandoffQueue());
+		}
+
+		std::atomic<unsigned> num_failed(0);
+		std::atomic<unsigned> num_corrupted(0);
+		std::vector<std::future<void>> tasks;
+		for (unsigned thread = 0; thread != NUM_THREADS; ++thread)
+		{
+			tasks.push_back(LaunchParallelTask([&, thread]
+			{
+				const auto check_and_free = [&](const std::pair<void*, size_t>& block)
+				{
+					if (!is_filled(block.first, block.second, static_cast<unsigned char>(block.second)))
+					{
+						num_corrupted.fetch_add(1, std::memory_order_relaxed);
+					}
+					lfmalloc::Free(block.first);
+				};
+
+				std::pair<void*, size_t> block;
+				for (unsigned i = 0; i != NUM_ITERATIONS; ++i)
+				{
+					const size_t size = 1 + (i * 37 + thread * 101) % ((i % 64) ? 512 : 200000);
+					void* const ptr = lfmalloc::Malloc(size);
+					if (!ptr)
+					{
+						num_failed.fetch_add(1, std::memory_order_relaxed);
+						continue;
+					}
+
+					fill(ptr, size, static_cast<unsigned char>(size));
+					if (!(i & 1) || !handoffs[(thread + 1) % NUM_THREADS]->Push(std::make_pair(ptr, size)))
+					{
+						check_and_free(std::make_pair(ptr, size));
+					}
+
+					while (handoffs[thread]->Pop(block))
+					{
+						check_and_free(block);
+					}
+				}
+			}));
+		}
+		WaitForAll(tasks);
+
+		std::pair<void*, size_t> block;
+		for (auto& handoff : handoffs)
+		{
+			while (handoff->Pop(block))
+			{
+				lfmalloc::Free(block.first);
+			}
+		}
+
+		REQUIRE(num_failed.load() == 0);
+		REQUIRE(num_corrupted.load() == 0);
+	}
+}
+#endif
+
+//-------------------------------------------------------------------------
+// Benchmarks. Hidden, run them explicitly with the [benchmark] tag
+//-------------------------------------------------------------------------
+namespace
+{
+	//-------------------------------------------------------------------------
+	template <typename Fnc>
+	double MeasureSeconds(Fnc&& fnc)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		fnc();
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+//-------------------------------------------------------------------------
+TEST_CASE("Relaxed vs strict FIFO queue benchmark", "[.][benchmark][relaxedlockfreequeue]")
+{
+	static constexpr const unsigned OPS_PER_THREAD = 200000;
+	static constexpr const size_t QUEUE_CAPACITY = 4096;
+
+	// Every element is stamped with a global push ticket and every pop takes a global pop ticket. The rank error of a pop is how far 
+	// the element popped is from the one a strict FIFO would have returned at that point. It is measured the same way on both queues
+	struct tStamped
+	{
+		tStamped(unsigned ticket = 0) : mTicket(ticket) {}
+		unsigned mTicket;
+	};
+
+	const auto run_benchmark = [](const char* name, auto& test_queue, unsigned num_threads)
+	{
+		std::atomic<unsigned> push_ticket(0);
+		std::atomic<unsigned> pop_ticket(0);
+		std::atomic<unsigned long long> total_rank_error(0);
+		std::atomic<unsigned> max_rank_error(0);
+
+		const double seconds = MeasureSeconds([&]
+		{
+			std::vector<std::future<void>> threads;
+			for (unsigned thread = 0; thread != num_threads; ++thread)
+			{
+				threads.push_back(LaunchParallelTask([&]
+				{
+					unsigned long long rank_error = 0;
+					unsigned thread_max_rank_error = 0;
+					for (unsigned op = 0; op != OPS_PER_THREAD; ++op)
+					{
+						// Every thread both produces and consumes, keeping the queue around half full
+						while (!test_queue.Push(tStamped(push_ticket.fetch_add(1, std::memory_order_relaxed))))
+						{
+							std::this_thread::yield();
+						}
+
+						tStamped popped;
+						while (!test_queue.Pop(popped));
+
+						const unsigned expected = pop_ticket.fetch_add(1, std::memory_order_relaxed);
+						const unsigned error = (popped.mTicket > expected) ? (popped.mTicket - expected) : (expected - popped.mTicket);
+						rank_error += error;
+						thread_max_rank_error = (std::max)(thread_max_rank_error, error);
+					}
+
+					total_rank_error.fetch_add(rank_error, std::memory_order_relaxed);
+					unsigned current_max = max_rank_error.load(std::memory_order_relaxed);
+					while ((current_max < thread_max_rank_error) && !max_rank_error.compare_exchange_weak(current_max, thread_max_rank_error));
+				}));
+			}
+			WaitForAll(threads);
+		});
+
+		const double total_ops = 2.0 * OPS_PER_THREAD * num_threads;
+		printf("%-32s threads: %2u  %8.2f Mops/s  mean rank error: %8.2f  max rank error: %u\n"
+			, name, num_threads, total_ops / seconds / 1e6
+			, static_cast<double>(total_rank_error.load()) / (static_cast<double>(OPS_PER_THREAD) * num_threads), max_rank_error.load());
+	};
+
+	const unsigned max_threads = (std::max)(2U, std::thread::hardware_concurrency());
+	for (unsigned num_threads = 1; num_threads <= max_threads; num_threads *= 2)
+	{
+		{
+			lockfree::cLockFreeQueue<tStamped, QUEUE_CAPACITY> strict_queue;
+			run_benchmark("cLockFreeQueue", strict_queue, num_threads);
+		}
+		{
+			typedef lockfree::cRelaxedLockFreeQueue<tStamped, 8> tRelaxedQueue;
+			tRelaxedQueue::tLockFreePool pool(QUEUE_CAPACITY + tRelaxedQueue::NUM_LANES);
+			tRelaxedQueue relaxed_queue(pool);
+			run_benchmark("cRelaxedLockFreeQueue<8 lanes>", relaxed_queue, num_threads);
+		}
+	}
+}
+
+//-------------------------------------------------------------------------
+TEST_CASE("Integer hash table lookup benchmark", "[.][benchmark][lockfreeinthashtable]")
+{
+	static constexpr const unsigned NUM_KEYS = 1 << 16;
+	static constexpr const unsigned LOOKUPS_PER_THREAD = 4000000;
+	typedef lockfree::cLockFreeIntHashTable<NUM_KEYS> tIntHashTable;
+
+	// Half of the lookups hit, half miss
+	std::mt19937_64 random(42);
+	std::vector<uint64_t> keys(2 * NUM_KEYS);
+	for (uint64_t& key : keys)
+	{
+		key = random() >> 1;
+	}
+
+	std::unique_ptr<tIntHashTable> int_hash_table(new tIntHashTable());
+	lockfree::cLockFreeHashMap<uint64_t, uint32_t> hash_map(NUM_KEYS);
+	for (unsigned i = 0; i != NUM_KEYS; ++i)
+	{
+		int_hash_table->Insert(keys[i], i);
+		hash_map.Insert(keys[i], i);
+	}
+
+	const auto run_benchmark = [&keys](const char* name, unsigned num_threads, auto&& find)
+	{
+		std::atomic<unsigned long long> total_found(0);
+		const double seconds = MeasureSeconds([&]
+		{
+			std::vector<std::future<void>> threads;
+			for (unsigned thread = 0; thread != num_threads; ++thread)
+			{
+				threads.push_back(LaunchParallelTask([&, thread]
+				{
+					unsigned long long found = 0;
+					unsigned key_idx = thread * 7919;
+					for (unsigned lookup = 0; lookup != LOOKUPS_PER_THREAD; ++lookup)
+					{
+						key_idx = (key_idx + 40503) & (2 * NUM_KEYS - 1);
+						found += find(keys[key_idx]) ? 1 : 0;
+					}
+					total_found.fetch_add(found, std::memory_order_relaxed);
+				}));
+			}
+			WaitForAll(threads);
+		});
+
+		printf("%-32s threads: %2u  %8.2f Mlookups/s  hit ratio: %.2f\n"
+			, name, num_threads, static_cast<double>(LOOKUPS_PER_THREAD) * num_threads / seconds / 1e6
+			, static_cast<double>(total_found.load()) / (static_cast<double>(LOOKUPS_PER_THREAD) * num_threads));
+	};
+
+	const unsigned max_threads = (std::max)(2U, std::thread::hardware_concurrency());
+	for (unsigned num_threads = 1; num_threads <= max_threads; num_threads *= 2)
+	{
+		run_benchmark("cLockFreeIntHashTable", num_threads, [&int_hash_table](uint64_t key) { uint32_t value; return int_hash_table->Find(key, value); });
+		run_benchmark("cLockFreeHashMap", num_threads, [&hash_map](uint64_t key) { uint32_t value; return hash_map.Find(key, value); });
+	}
+}
+
+//-------------------------------------------------------------------------
+TEST_CASE("Bitmap vs freelist pool benchmark", "[.][benchmark][lockfreebitmappool][lockfreepool]")
+{
+	static constexpr const unsigned CAPACITY = 1 << 16;
+	static constexpr const unsigned OPS_PER_THREAD = 2000000;
+	static constexpr const unsigned BATCH_SIZE = 16;
+
+	lockfree::cLockFreePool<uint64_t> freelist_pool(CAPACITY);
+	lockfree::cLockFreeBitmapPool<uint64_t> bitmap_pool(CAPACITY);
+
+	// Every thread acquires a few elements, touches them and releases them
+	const auto run_benchmark = [](const char* name, unsigned num_threads, auto& pool)
+	{
+		const double seconds = MeasureSeconds([&]
+		{
+			std::vector<std::future<void>> threads;
+			for (unsigned thread = 0; thread != num_threads; ++thread)
+			{
+				threads.push_back(LaunchParallelTask([&]
+				{
+					uint64_t* elements[BATCH_SIZE];
+					for (unsigned op = 0; op < OPS_PER_THREAD; op += BATCH_SIZE)
+					{
+						for (uint64_t*& element : elements)
+						{
+							element = pool.AcquirePtr();
+							*element = op;
+						}
+						for (uint64_t* element : elements)
+						{
+							pool.ReleasePtr(element);
+						}
+					}
+				}));
+			}
+			WaitForAll(threads);
+		});
+
+		printf("%-24s threads: %2u  %8.2f Mops/s\n", name, num_threads, static_cast<double>(OPS_PER_THREAD) * num_threads / seconds / 1e6);
+	};
+
+	const unsigned max_threads = (std::max)(2U, std::thread::hardware_concurrency());
+	for (unsigned num_threads = 1; num_threads <= max_threads; num_threads *= 2)
+	{
+		run_benchmark("cLockFreePool", num_threads, freelist_pool);
+		run_benchmark("cLockFreeBitmapPool", num_threads, bitmap_pool);
+	}
+}
+
+//-------------------------------------------------------------------------
+TEST_CASE("Owned vs shared pool producer/consumer benchmark", "[.][benchmark][lockfreeownedpool][lockfreepool]")
+{
+	static constexpr const unsigned NUM_ELEMENTS = 2000000;
+	static constexpr const unsigned CAPACITY = 1024;
+
+	// One thread acquires elements and hands them to another one, that releases them
+	const auto run_benchmark = [](const char* name, auto& pool)
+	{
+		lockfree::cLockFreeQueue<uint64_t*, CAPACITY> handoff;
+		const double seconds = MeasureSeconds([&]
+		{
+			std::future<void> consumer = LaunchParallelTask([&]
+			{
+				uint64_t* element = nullptr;
+				for (unsigned i = 0; i != NUM_ELEMENTS; ++i)
+				{
+					while (!handoff.Pop(element))
+					{
+						std::this_thread::yield();
+					}
+					pool.ReleasePtr(element);
+				}
+			});
+
+			for (unsigned i = 0; i != NUM_ELEMENTS; ++i)
+			{
+				uint64_t* element = nullptr;
+				while (!(element = pool.AcquirePtr()))
+				{
+					std::this_thread::yield();
+				}
+				*element = i;
+				while (!handoff.Push(element))
+				{
+					std::this_thread::yield();
+				}
+			}
+			consumer.wait();
+		});
+
+		printf("%-24s %8.2f Mops/s\n", name, static_cast<double>(NUM_ELEMENTS) / seconds / 1e6);
+	};
+
+	lockfree::cLockFreePool<uint64_t> shared_pool(CAPACITY);
+	lockfree::cLockFreeOwnedPool<uint64_t> owned_pool(CAPACITY);
+	run_benchmark("cLockFreePool", shared_pool);
+	run_benchmark("cLockFreeOwnedPool", owned_pool);
+}
+
+//-------------------------------------------------------------------------
+TEST_CASE("Pool ReleaseAll vs one by one release benchmark", "[.][benchmark][lockfreepool]")
+{
+	static constexpr const unsigned CAPACITY = 1 << 16;
+	static constexpr const unsigned NUM_FRAMES = 200;
+
+	// Every frame takes all the elements of the pool and gives them back at its end
+	const auto run_benchmark = [](const char* name, auto&& end_frame)
+	{
+		lockfree::cLockFreePool<uint64_t> pool(CAPACITY);
+		std::vector<uint64_t*> elements(CAPACITY);
+		double release_seconds = 0.0;
+		for (unsigned frame = 0; frame != NUM_FRAMES; ++frame)
+		{
+			for (uint64_t*& element : elements)
+			{
+				element = pool.Acquire(frame);
+			}
+			release_seconds += MeasureSeconds([&] { end_frame(pool, elements); });
+		}
+
+		printf("%-24s %8.2f M elements/s\n", name, static_cast<double>(CAPACITY) * NUM_FRAMES / release_seconds / 1e6);
+	};
+
+	run_benchmark("Release", [](auto& pool, const std::vector<uint64_t*>& elements)
+	{
+		for (uint64_t* element : elements)
+		{
+			pool.ReleasePtr(element);
+		}
+	});
+	run_benchmark("ReleaseAll", [](auto& pool, const std::vector<uint64_t*>&)
+	{
+		pool.ReleaseAll();
+	});
+}
+
+//-------------------------------------------------------------------------
+namespace
+{
+	// 64 bytes of plain data, a cache line worth of payload
+	struct tPod64
+	{
+		uint64_t mWords[8];
+	};
+}
+
+//-------------------------------------------------------------------------
+TEST_CASE("Trivial vs generic nodes push and pop benchmark", "[.][benchmark][lockfreestack][lockfreequeue]")
+{
+	static constexpr const unsigned NUM_ROUNDS = 100000;
+	static constexpr const unsigned BULK_SIZE = 32;
+
+	// Every round pushes BULK_SIZE elements and pops them all back, either one by one or all at once
+	const auto run_benchmark = [](const char* name, auto& container, auto value)
+	{
+		typedef decltype(value) tValue;
+		tValue values[BULK_SIZE];
+		std::fill(values, values + BULK_SIZE, value);
+		tValue results[BULK_SIZE];
+
+		const double one_by_one_seconds = MeasureSeconds([&]
+		{
+			for (unsigned round = 0; round != NUM_ROUNDS; ++round)
+			{
+				for (const tValue& pushed : values)
+				{
+					container.Push(pushed);
+				}
+				for (tValue& result : results)
+				{
+					container.Pop(result);
+				}
+			}
+		});
+
+		const double bulk_seconds = MeasureSeconds([&]
+		{
+			for (unsigned round = 0; round != NUM_ROUNDS; ++round)
+			{
+				container.PushBulk(values, BULK_SIZE);
+				container.PopBulk(results, BULK_SIZE);
+			}
+		});
+
+		const double num_ops = 2.0 * NUM_ROUNDS * BULK_SIZE;
+		printf("%-44s one by one: %8.2f Mops/s  bulk: %8.2f Mops/s\n", name, num_ops / one_by_one_seconds / 1e6, num_ops / bulk_seconds / 1e6);
+	};
+
+	// The same trivial payload, in the nodes picked for it by default and in the generic ones non-trivial types get
+	const auto run_containers = [&run_benchmark](const char* payload_name, auto value, auto trivial)
+	{
+		typedef decltype(value) tValue;
+		typedef lockfree::cLockFreeStack<tValue, lockfree::LFSS_SHARED, std::allocator<lockfree::detail::tLockFreeStackNode<tValue, lockfree::tTaggedPtr, decltype(trivial)::value>>> tStack;
+		typedef lockfree::cLockFreeQueue<tValue, lockfree::LFQS_SHARED, std::allocator<lockfree::detail::tLockFreeQueueNode<tValue, lockfree::tTaggedPtr, decltype(trivial)::value>>> tQueue;
+		const char* const nodes_name = decltype(trivial)::value ? "trivial" : "generic";
+
+		typename tStack::tLockFreePool stack_pool(BULK_SIZE);
+		typename tQueue::tLockFreePool queue_pool(BULK_SIZE + 1);	// + the sentinel
+		tStack stack(stack_pool);
+		tQueue queue(queue_pool);
+
+		char name[64];
+		snprintf(name, sizeof(name), "cLockFreeStack<%s> %s nodes", payload_name, nodes_name);
+		run_benchmark(name, stack, value);
+		snprintf(name, sizeof(name), "cLockFreeQueue<%s> %s nodes", payload_name, nodes_name);
+		run_benchmark(name, queue, value);
+	};
+
+	run_containers("int", 42, std::true_type());
+	run_containers("int", 42, std::false_type());
+	run_containers("64 byte POD", tPod64(), std::true_type());
+	run_containers("64 byte POD", tPod64(), std::false_type());
+}
+
+//-------------------------------------------------------------------------
+TEST_CASE("Inline vs out of line payload queue benchmark", "[.][benchmark][lockfreequeue][lockfreepayloadqueue]")
+{
+	static constexpr const unsigned NUM_ROUNDS = 2000;
+	static constexpr const size_t CAPACITY = 256;
+
+	// Every round fills the queue up and pops everything back in place, reading the id of each payload
+	const auto run_benchmark = [](const char* name, auto& queue)
+	{
+		unsigned checksum = 0;
+		const double seconds = MeasureSeconds([&]
+		{
+			for (unsigned round = 0; round != NUM_ROUNDS; ++round)
+			{
+				for (unsigned i = 0; i != CAPACITY; ++i)
+				{
+					queue.Push(i);
+				}
+				while (queue.PopWith([&checksum](tBigPayload& payload) { checksum += payload.mId; }))
+				{
+				}
+			}
+		});
+
+		const double num_ops = 2.0 * NUM_ROUNDS * CAPACITY;
+		printf("%-40s %8.2f Mops/s (checksum %u)\n", name, num_ops / seconds / 1e6, checksum);
+	};
+
+	// Both hold a megabyte worth of payloads, out of the stack
+	auto inline_queue = std::make_unique<lockfree::cLockFreeQueue<tBigPayload, CAPACITY>>();
+	auto payload_pool = std::make_unique<lockfree::cLockFreePool<tBigPayload>>(static_cast<unsigned>(CAPACITY));
+	auto payload_queue = std::make_unique<lockfree::cLockFreePayloadQueue<tBigPayload, CAPACITY>>(*payload_pool);
+	run_benchmark("cLockFreeQueue<4KB payload>", *inline_queue);
+	run_benchmark("cLockFreePayloadQueue<4KB payload>", *payload_queue);
+}